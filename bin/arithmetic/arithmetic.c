@@ -1127,10 +1127,11 @@ arithmetic_tofile(struct arithmeticparams *p, char *token, int freeflag)
   /* Save it to a file. */
   popped->wcs=p->refdata.wcs;
   if(popped->ndim==1 && p->onedasimage==0)
-    gal_table_write(popped, NULL, NULL, p->cp.tableformat, filename,
-                    "ARITHMETIC", 0);
+    gal_table_write_threads(popped, NULL, NULL, p->cp.tableformat, filename,
+                            "ARITHMETIC", 0, p->cp.numthreads);
   else
-    gal_fits_img_write(popped, filename, NULL, PROGRAM_NAME);
+    gal_fits_img_write_compress(popped, filename, NULL, PROGRAM_NAME,
+                                p->cp.compress);
   if(!p->cp.quiet)
     printf(" - Write: %s\n", filename);
 
@@ -1454,6 +1455,11 @@ arithmetic_operator_run(struct arithmeticparams *p, int operator,
          last-in-first-out). So for the operators which need a
          specific order, the first poped operand is actally the
          last (right most, in in-fix notation) input operand.*/
+      /* When more than one operand is necessary, read the files among
+         them in parallel. */
+      if(num_operands>1 && num_operands!=-1)
+        operands_prefetch(p, num_operands);
+
       switch(num_operands)
         {
         case 0:
@@ -1489,6 +1495,7 @@ arithmetic_operator_run(struct arithmeticparams *p, int operator,
              linked list of any number of operands within the single 'd1'
              pointer. */
           numop=pop_number_of_operands(p, operator, operator_string, &d2);
+          operands_prefetch(p, numop);
           for(i=0;i<numop;++i)
             gal_list_data_add(&d1, operands_pop(p, operator_string));
           break;
@@ -1638,9 +1645,8 @@ arithmetic_final_read_file(struct arithmeticparams *p,
   if( gal_fits_file_recognized(filename) )
     {
       /* Read the data, note that the WCS has already been set. */
-      out=gal_array_read_one_ch(filename, hdu, NULL,
-                                p->cp.minmapsize,
-                                p->cp.quietmmap);
+      out=gal_array_read_one_ch_threads(filename, hdu, NULL, p->cp.numthreads,
+                                        p->cp.minmapsize, p->cp.quietmmap);
       out->ndim=gal_dimension_remove_extra(out->ndim, out->dsize,
                                             NULL);
       if(!p->cp.quiet) printf(" - %s (hdu %s) is read.\n", filename, hdu);
@@ -1813,12 +1819,13 @@ reversepolish(struct arithmeticparams *p)
       /* Put a copy of the WCS structure from the reference image, it
          will be freed while freeing 'data'. */
       if(data->ndim==1 && p->onedasimage==0)
-        gal_table_write(data, NULL, NULL, p->cp.tableformat,
-                        p->onedonstdout ? NULL : p->cp.output,
-                        "ARITHMETIC", 0);
+        gal_table_write_threads(data, NULL, NULL, p->cp.tableformat,
+                                p->onedonstdout ? NULL : p->cp.output,
+                                "ARITHMETIC", 0, p->cp.numthreads);
       else
         for(tmp=data; tmp!=NULL; tmp=tmp->next)
-          gal_fits_img_write(tmp, p->cp.output, NULL, PROGRAM_NAME);
+          gal_fits_img_write_compress(tmp, p->cp.output, NULL, PROGRAM_NAME,
+                                      p->cp.compress);
 
       /* Let the user know that the job is done. */
       if(!p->cp.quiet)
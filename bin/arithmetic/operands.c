@@ -218,6 +218,65 @@ operands_add(struct arithmeticparams *p, char *filename, gal_data_t *data)
 
 
 
+/* Read the files of the top 'num' operands (that will be popped by the
+   next operator) in parallel. Until now, each file was read when it was
+   popped (one after the other). But when many files are necessary (for
+   example when stacking many exposures), the latency of opening and
+   reading each file can dominate (especially on network file-systems). */
+void
+operands_prefetch(struct arithmeticparams *p, size_t num)
+{
+  size_t i, count=0;
+  gal_data_t *data, *read;
+  struct operand *tmp, **nodes;
+  gal_list_str_t *filenames=NULL, *hdus=NULL;
+
+  /* Find the operands that are files and haven't been read yet. */
+  for(i=0, tmp=p->operands; tmp!=NULL && i<num; tmp=tmp->next, ++i)
+    if(tmp->filename && tmp->data==NULL) ++count;
+
+  /* If there is only one file, it will be read when it is popped. */
+  if(count<2) return;
+
+  /* Keep the nodes (to put the datasets in them) and the file names and
+     HDUs (in the same order). */
+  errno=0;
+  nodes=malloc(count*sizeof *nodes);
+  if(nodes==NULL)
+    error(EXIT_FAILURE, errno, "%s: allocating %zu bytes for 'nodes'",
+          __func__, count*sizeof *nodes);
+  count=0;
+  for(i=0, tmp=p->operands; tmp!=NULL && i<num; tmp=tmp->next, ++i)
+    if(tmp->filename && tmp->data==NULL)
+      {
+        nodes[count++]=tmp;
+        gal_list_str_add(&hdus, tmp->hdu, 0);
+        gal_list_str_add(&filenames, tmp->filename, 0);
+      }
+  gal_list_str_reverse(&hdus);
+  gal_list_str_reverse(&filenames);
+
+  /* Read the files and put each dataset in its node. */
+  read=gal_array_read_one_ch_many(filenames, hdus, p->cp.numthreads,
+                                  p->cp.minmapsize, p->cp.quietmmap);
+  for(i=0; i<count; ++i)
+    {
+      data=read;
+      read=read->next;
+      data->next=NULL;
+      nodes[i]->data=data;
+    }
+
+  /* Clean up (the strings belong to the nodes). */
+  gal_list_str_free(filenames, 0);
+  gal_list_str_free(hdus, 0);
+  free(nodes);
+}
+
+
+
+
+
 gal_data_t *
 operands_pop(struct arithmeticparams *p, char *operator)
 {
@@ -240,9 +299,14 @@ operands_pop(struct arithmeticparams *p, char *operator)
       hdu=operands->hdu;
       filename=operands->filename;
 
-      /* Read the dataset and remove possibly extra dimensions. */
-      data=gal_array_read_one_ch(filename, hdu, NULL, p->cp.minmapsize,
-                                 p->cp.quietmmap);
+      /* Read the dataset (if it wasn't already read by
+         'operands_prefetch') and remove possibly extra dimensions. */
+      data = ( operands->data
+               ? operands->data
+               : gal_array_read_one_ch_threads(filename, hdu, NULL,
+                                               p->cp.numthreads,
+                                               p->cp.minmapsize,
+                                               p->cp.quietmmap) );
       data->ndim=gal_dimension_remove_extra(data->ndim, data->dsize, NULL);
 
       /* When the reference data structure's dimensionality is non-zero, it
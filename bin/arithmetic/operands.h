@@ -29,6 +29,9 @@ operands_num(struct arithmeticparams *p);
 void
 operands_add(struct arithmeticparams *p, char *filename, gal_data_t *data);
 
+void
+operands_prefetch(struct arithmeticparams *p, size_t num);
+
 gal_data_t *
 operands_pop(struct arithmeticparams *p, char *operator);
 
@@ -122,6 +122,7 @@ ui_initialize_options(struct buildprogparams *p,
         case GAL_OPTIONS_KEY_LOG:
         case GAL_OPTIONS_KEY_HDU:
         case GAL_OPTIONS_KEY_TYPE:
+        case GAL_OPTIONS_KEY_COMPRESS:
         case GAL_OPTIONS_KEY_SEARCHIN:
         case GAL_OPTIONS_KEY_NUMTHREADS:
         case GAL_OPTIONS_KEY_TABLEFORMAT:
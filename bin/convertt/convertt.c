@@ -331,14 +331,16 @@ convertt(struct converttparams *p)
       if(p->numch==3 && p->rgbtohsv)
         color_rgb_to_hsv(p);
       for(channel=p->chll; channel!=NULL; channel=channel->next)
-        gal_fits_img_write(channel, p->cp.output, NULL, PROGRAM_NAME);
+        gal_fits_img_write_compress(channel, p->cp.output, NULL, PROGRAM_NAME,
+                                    p->cp.compress);
       break;
 
     /* Plain text: only one channel is acceptable. */
     case OUT_FORMAT_TXT:
       gal_checkset_writable_remove(p->cp.output, p->inputnames->v, 0,
                                    p->cp.dontdelete);
-      gal_txt_write(p->chll, NULL, NULL, p->cp.output, 0, 1);
+      gal_txt_write_threads(p->chll, NULL, NULL, p->cp.output, 0, 1,
+                            p->cp.numthreads);
       break;
 
     /* JPEG: */
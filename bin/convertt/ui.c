@@ -752,8 +752,8 @@ ui_make_channels_ll(struct converttparams *p)
             }
 
           /* Read in the array and its WCS information. */
-          data=gal_fits_img_read(name->v, hdu, p->cp.minmapsize,
-                                 p->cp.quietmmap);
+          data=gal_fits_img_read_threads(name->v, hdu, p->cp.numthreads,
+                                         p->cp.minmapsize, p->cp.quietmmap);
           data->wcs=gal_wcs_read(name->v, hdu, p->cp.wcslinearmatrix,
                                  0, 0, &data->nwcs);
           data->ndim=gal_dimension_remove_extra(data->ndim, data->dsize,
@@ -813,11 +813,11 @@ convolve(struct convolveparams *p)
 
   /* Save the output (which is in p->input) array. */
   if(p->input->ndim==1)
-    gal_table_write(p->input, NULL, NULL, p->cp.tableformat, p->cp.output,
-                    "CONVOLVED", 0);
+    gal_table_write_threads(p->input, NULL, NULL, p->cp.tableformat,
+                            p->cp.output, "CONVOLVED", 0, p->cp.numthreads);
   else
-    gal_fits_img_write_to_type(p->input, cp->output, NULL, PROGRAM_NAME,
-                               cp->type);
+    gal_fits_img_write_to_type_compress(p->input, cp->output, NULL,
+                                        PROGRAM_NAME, cp->type, cp->compress);
 
   /* Write Convolve's parameters as keywords into the first extension of
      the output. */
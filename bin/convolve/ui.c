@@ -442,10 +442,11 @@ ui_read_input(struct convolveparams *p)
   if( p->filename && gal_array_name_recognized(p->filename) )
     if (p->isfits && p->hdu_type==IMAGE_HDU)
       {
-        p->input=gal_array_read_one_ch_to_type(p->filename, p->cp.hdu, NULL,
-                                               INPUT_USE_TYPE,
-                                               p->cp.minmapsize,
-                                               p->cp.quietmmap);
+        p->input=gal_array_read_one_ch_to_type_threads(p->filename, p->cp.hdu,
+                                                       NULL, INPUT_USE_TYPE,
+                                                       p->cp.numthreads,
+                                                       p->cp.minmapsize,
+                                                       p->cp.quietmmap);
         p->input->wcs=gal_wcs_read(p->filename, p->cp.hdu,
                                    p->cp.wcslinearmatrix, 0, 0,
                                    &p->input->nwcs);
@@ -474,10 +475,11 @@ ui_read_kernel(struct convolveparams *p)
       && p->input->ndim>1
       && gal_array_name_recognized(p->kernelname)  )
     {
-      p->kernel = gal_array_read_one_ch_to_type(p->kernelname, p->khdu,
-                                                NULL, INPUT_USE_TYPE,
-                                                p->cp.minmapsize,
-                                                p->cp.quietmmap);
+      p->kernel = gal_array_read_one_ch_to_type_threads(p->kernelname, p->khdu,
+                                                        NULL, INPUT_USE_TYPE,
+                                                        p->cp.numthreads,
+                                                        p->cp.minmapsize,
+                                                        p->cp.quietmmap);
       p->kernel->ndim=gal_dimension_remove_extra(p->kernel->ndim,
                                                  p->kernel->dsize,
                                                  p->kernel->wcs);
@@ -137,6 +137,7 @@ ui_initialize_options(struct cosmiccalparams *p,
         case GAL_OPTIONS_KEY_HDU:
         case GAL_OPTIONS_KEY_LOG:
         case GAL_OPTIONS_KEY_TYPE:
+        case GAL_OPTIONS_KEY_COMPRESS:
         case GAL_OPTIONS_KEY_QUIET:
         case GAL_OPTIONS_KEY_SEARCHIN:
         case GAL_OPTIONS_KEY_NUMTHREADS:
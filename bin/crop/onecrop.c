@@ -560,8 +560,11 @@ onecrop_make_array(struct onecropparams *crp, long *fpixel_i,
     }
 
 
-  /* Create the output crop image. */
+  /* Create the output crop image (tile-compressed if requested). */
   fits_open_file(&crp->outfits, outname, READWRITE, &status);
+  gal_fits_io_error(status, "opening output");
+  gal_fits_img_compress_set(crp->outfits, type, ndim, p->cp.compress,
+                            outname);
   fits_create_img(crp->outfits, gal_fits_type_to_bitpix(type),
                   ndim, naxes, &status);
   gal_fits_io_error(status, "creating image");
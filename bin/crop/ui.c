@@ -34,6 +34,7 @@ along with Gnuastro. If not, see <http://www.gnu.org/licenses/>.
 #include <gnuastro/fits.h>
 #include <gnuastro/blank.h>
 #include <gnuastro/table.h>
+#include <gnuastro/threads.h>
 #include <gnuastro/pointer.h>
 #include <gnuastro/dimension.h>
 
@@ -1014,14 +1015,84 @@ ui_preparations_to_img_mode_values(struct cropparams *p)
 
 
 
+/* Parameters for reading the metadata of the input images on multiple
+   threads. */
+struct ui_read_imgs_params
+{
+  struct cropparams          *p;  /* Main program parameters.           */
+  int                    *types;  /* Type of each input image.          */
+  pthread_mutex_t      wcsmutex;  /* To read the WCS on one thread.     */
+};
+
+
+
+
+
+/* Read the size, type and WCS of the input images. Opening each file and
+   reading its header is affected by the latency of the file-system, so it
+   is done in parallel. But WCSLIB is unfortunately not thread-safe when
+   reading the WCS information, so only one thread can parse the WCS at
+   any moment (the header is already in memory by then). */
+static void *
+ui_read_imgs_on_thread(void *in_prm)
+{
+  /* Low-level definitions to be done first. */
+  struct gal_threads_params *tprm=(struct gal_threads_params *)in_prm;
+  struct ui_read_imgs_params *rp=(struct ui_read_imgs_params *)tprm->params;
+  struct cropparams *p=rp->p;
+
+  /* Subsequent definitions. */
+  int status;
+  size_t i, ind;
+  fitsfile *tmpfits;
+  struct inputimgs *img;
+
+  /* Go over all the images that were assigned to this thread. */
+  for(i=0; tprm->indexs[i] != GAL_BLANK_SIZE_T; ++i)
+    {
+      /* Open the image and read its basic information. */
+      status=0;
+      ind=tprm->indexs[i];
+      img=&p->imgs[ind];
+      tmpfits=gal_fits_hdu_open_format(img->name, p->cp.hdu, 0);
+      gal_fits_img_info(tmpfits, &rp->types[ind], &img->ndim, &img->dsize,
+                        NULL, NULL);
+
+      /* Read the WCS. */
+      pthread_mutex_lock(&rp->wcsmutex);
+      img->wcs=gal_wcs_read_fitsptr(tmpfits, p->cp.wcslinearmatrix,
+                                    p->hstartwcs, p->hendwcs, &img->nwcs);
+      if(img->wcs)
+        img->wcstxt=gal_wcs_write_wcsstr(img->wcs, &img->nwcskeys);
+      pthread_mutex_unlock(&rp->wcsmutex);
+      if(img->wcs==NULL && p->mode==IMGCROP_MODE_WCS)
+        error(EXIT_FAILURE, 0, "%s (hdu %s): the WCS structure is "
+              "not recognized or isn't present. Hence the WCS mode "
+              "cannot be used as input coordinates. You can try with "
+              "pixel coordinates using '--mode=img'", img->name,
+              p->cp.hdu);
+
+      /* Close the file. */
+      fits_close_file(tmpfits, &status);
+      gal_fits_io_error(status, NULL);
+    }
+
+  /* Wait for all threads to finish and return. */
+  if(tprm->b) pthread_barrier_wait(tprm->b);
+  return NULL;
+}
+
+
+
+
+
 void
 ui_preparations(struct cropparams *p)
 {
-  fitsfile *tmpfits;
-  int internalimgmode=0;
   struct inputimgs *img;
-  int status, firsttype=0;
-  size_t input_counter, firstndim=0;
+  struct ui_read_imgs_params rp;
+  int err, firsttype=0, internalimgmode=0;
+  size_t input_counter, numthreads, firstndim=0;
 
 
   /* If there is only one dataset, convert the given coordinates to pixels
@@ -1051,32 +1122,35 @@ ui_preparations(struct cropparams *p)
   if(p->imgs==NULL)
     error(EXIT_FAILURE, errno, "%s: %zu bytes for p->imgs",
           __func__, p->numin*sizeof *p->imgs);
+  input_counter=p->numin;
+  while(p->inputs)
+    p->imgs[--input_counter].name=gal_list_str_pop(&p->inputs);
+
+
+  /* Read the basic information of all the input images on multiple
+     threads (when CFITSIO is thread-safe). */
+#if GAL_CONFIG_HAVE_FITS_IS_REENTRANT == 1
+  numthreads = fits_is_reentrant() ? p->cp.numthreads : 1;
+#else
+  numthreads = 1;
+#endif
+  rp.p=p;
+  rp.types=gal_pointer_allocate(GAL_TYPE_INT, p->numin, 0, __func__,
+                                "rp.types");
+  if( (err=pthread_mutex_init(&rp.wcsmutex, NULL)) )
+    error(EXIT_FAILURE, err, "%s: can't initialize mutex", __func__);
+  gal_threads_spin_off(ui_read_imgs_on_thread, &rp, p->numin,
+                       numthreads<p->numin ? numthreads : p->numin,
+                       p->cp.minmapsize, p->cp.quietmmap);
+  pthread_mutex_destroy(&rp.wcsmutex);
 
 
   /* Do basic checks of all input images. */
   input_counter=p->numin;
-  while(p->inputs)
+  while(input_counter)
     {
-      /* Pop from the list of input images and get the info. */
-      status=0;
       img=&p->imgs[--input_counter];
-      img->name=gal_list_str_pop(&p->inputs);
-      tmpfits=gal_fits_hdu_open_format(img->name, p->cp.hdu, 0);
-      gal_fits_img_info(tmpfits, &p->type, &img->ndim, &img->dsize,
-                        NULL, NULL);
-      img->wcs=gal_wcs_read_fitsptr(tmpfits, p->cp.wcslinearmatrix,
-                                    p->hstartwcs, p->hendwcs, &img->nwcs);
-      if(img->wcs)
-        img->wcstxt=gal_wcs_write_wcsstr(img->wcs, &img->nwcskeys);
-      else
-        if(p->mode==IMGCROP_MODE_WCS)
-          error(EXIT_FAILURE, 0, "%s (hdu %s): the WCS structure is "
-                "not recognized or isn't present. Hence the WCS mode "
-                "cannot be used as input coordinates. You can try with "
-                "pixel coordinates using '--mode=img'", img->name,
-                p->cp.hdu);
-      fits_close_file(tmpfits, &status);
-      gal_fits_io_error(status, NULL);
+      p->type=rp.types[input_counter];
 
       /* Make sure all the images have the same type and dimensions. */
       if(firsttype==0)
@@ -1123,6 +1197,7 @@ ui_preparations(struct cropparams *p)
       /* In WCS mode, we need some additional preparations. */
       if(p->mode==IMGCROP_MODE_WCS) wcsmode_check_prepare(p, img);
     }
+  free(rp.types);
 
 
   /* Polygon cropping is currently only supported on 2D */
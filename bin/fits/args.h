@@ -63,6 +63,19 @@ struct argp_option program_options[] =
       GAL_OPTIONS_NOT_MANDATORY,
       GAL_OPTIONS_NOT_SET
     },
+    {
+      "datasumcache",
+      UI_KEY_DATASUMCACHE,
+      "STR",
+      0,
+      "File to keep (and reuse) --datasum results.",
+      UI_GROUP_EXTENSION_INFORMATION,
+      &p->datasumcache,
+      GAL_TYPE_STRING,
+      GAL_OPTIONS_RANGE_ANY,
+      GAL_OPTIONS_NOT_MANDATORY,
+      GAL_OPTIONS_NOT_SET
+    },
     {
       "pixelscale",
       UI_KEY_PIXELSCALE,
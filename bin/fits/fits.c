@@ -312,7 +312,8 @@ fits_print_extension_info(struct fitsparams *p)
                "etc).\n");
       printf("-----\n");
     }
-  gal_table_write(cols, NULL, NULL, GAL_TABLE_FORMAT_TXT, NULL, NULL, 0);
+  gal_table_write_threads(cols, NULL, NULL, GAL_TABLE_FORMAT_TXT, NULL, NULL,
+                          0, p->cp.numthreads);
   gal_list_data_free(cols);
 }
 
@@ -347,7 +348,9 @@ fits_hdu_number(struct fitsparams *p)
 static void
 fits_datasum(struct fitsparams *p)
 {
-  printf("%ld\n", gal_fits_hdu_datasum(p->input->v, p->cp.hdu));
+  printf("%ld\n", gal_fits_hdu_datasum_cached(p->input->v, p->cp.hdu,
+                                              p->datasumcache,
+                                              p->cp.numthreads));
 }
 
 
@@ -594,8 +594,9 @@ keywords_wcs_convert(struct fitsparams *p)
       /* If the number of dimensions is two, then read the dataset,
          otherwise, ignore it. */
       if(ndim==2)
-        data=gal_fits_img_read(p->input->v, p->cp.hdu, p->cp.minmapsize,
-                               p->cp.quietmmap);
+        data=gal_fits_img_read_threads(p->input->v, p->cp.hdu,
+                                       p->cp.numthreads, p->cp.minmapsize,
+                                       p->cp.quietmmap);
     }
 
   /* Read the input's WCS and make sure one exists. */
@@ -654,7 +655,8 @@ keywords_wcs_convert(struct fitsparams *p)
     {
       /* Add the output WCS to the dataset and write it. */
       data->wcs=outwcs;
-      gal_fits_img_write(data, output, NULL, PROGRAM_NAME);
+      gal_fits_img_write_compress(data, output, NULL, PROGRAM_NAME,
+                                  p->cp.compress);
 
       /* Clean up, but remove the pointer first (so it doesn't free it
          here). */
@@ -920,9 +922,8 @@ keywords_value_in_output_rest(struct fitsparams *p, gal_data_t *out,
 static void
 keywords_value(struct fitsparams *p)
 {
-  int status;
-  fitsfile *fptr=NULL;
   gal_list_str_t *input, *tmp;
+  gal_fits_header_t **headers;
   size_t i, ii=0, ninput, nkeys;
   gal_data_t *out=NULL, *keysll=NULL;
 
@@ -941,12 +942,17 @@ keywords_value(struct fitsparams *p)
   gal_options_merge_list_of_csv(&p->keyvalue);
   nkeys=gal_list_str_number(p->keyvalue);
 
+  /* Read the headers of all the inputs on multiple threads. */
+  headers=gal_fits_header_read_many(p->input, p->cp.hdu, p->cp.numthreads);
+
   /* Parse each input file, read the keywords and put them in the output
      list. */
   for(input=p->input; input!=NULL; input=input->next)
     {
-      /* Open the input FITS file. */
-      fptr=gal_fits_hdu_open(input->v, p->cp.hdu, READONLY, 1);
+      /* If the HDU couldn't be opened, read it again to abort with the
+         proper error message. */
+      if(headers[ii]==NULL)
+        headers[ii]=gal_fits_header_read(input->v, p->cp.hdu, 1);
 
       /* Allocate the array to keep the keys. */
       i=0;
@@ -960,35 +966,28 @@ keywords_value(struct fitsparams *p)
 
       /* Read the keys. Note that we only need the comments and units if
          '--colinfoinstdout' is called. */
-      gal_fits_key_read_from_ptr(fptr, keysll, p->colinfoinstdout,
-                                 p->colinfoinstdout);
-
-      /* Close the input FITS file. */
-      status=0;
-      if(fits_close_file(fptr, &status))
-        gal_fits_io_error(status, NULL);
+      gal_fits_header_key_read(headers[ii], keysll, p->colinfoinstdout,
+                               p->colinfoinstdout);
 
       /* Write the values of this column into the final output. */
       if(ii==0)
-        {
-          ++ii;
-          out=keywords_value_in_output_first(p, out, input->v,
-                                             keysll, ninput);
-        }
+        out=keywords_value_in_output_first(p, out, input->v,
+                                           keysll, ninput);
       else
-        keywords_value_in_output_rest(p, out, input->v, keysll,
-                                      ii++);
+        keywords_value_in_output_rest(p, out, input->v, keysll, ii);
 
       /* Clean up. */
+      ++ii;
       for(i=0;i<nkeys;++i) keysll[i].name=NULL;
       gal_data_array_free(keysll, nkeys, 1);
     }
+  gal_fits_header_array_free(headers, ninput);
 
   /* Write the values. */
   gal_checkset_writable_remove(p->cp.output, p->input->v, 0,
                                p->cp.dontdelete);
-  gal_table_write(out, NULL, NULL, p->cp.tableformat,
-                  p->cp.output, "KEY-VALUES", p->colinfoinstdout);
+  gal_table_write_threads(out, NULL, NULL, p->cp.tableformat, p->cp.output,
+                          "KEY-VALUES", p->colinfoinstdout, p->cp.numthreads);
 
   /* Clean up. */
   gal_list_str_free(p->keyvalue, 0);
@@ -122,7 +122,8 @@ meta_write_to_file(struct fitsparams *p, gal_warp_wcsalign_t *wa)
   /* Convert to type and write to file. */
   if(p->cp.type!=output->type)
     output=gal_data_copy_to_new_type_free(output, p->cp.type);
-  gal_fits_img_write(output, p->cp.output, headers, PROGRAM_NAME);
+  gal_fits_img_write_compress(output, p->cp.output, headers, PROGRAM_NAME,
+                              p->cp.compress);
 
   /* Clean up. */
   wa->output=NULL; /* Must be here to prevent double freeing. */
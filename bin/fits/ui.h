@@ -91,6 +91,7 @@ enum option_keys_enum
   UI_KEY_PRIMARYIMGHDU,
   UI_KEY_WCSDISTORTION,
   UI_KEY_EDGESAMPLING,
+  UI_KEY_DATASUMCACHE,
 };
 
 
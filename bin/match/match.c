@@ -404,8 +404,8 @@ match_catalog_read_write_all(struct matchparams *p, size_t *permutation,
   else if(cat)
     {
       /* Write the catalog to a file. */
-      gal_table_write(cat, NULL, NULL, p->cp.tableformat, outname,
-                      extname, 0);
+      gal_table_write_threads(cat, NULL, NULL, p->cp.tableformat, outname,
+                              extname, 0, p->cp.numthreads);
 
       /* Clean up. */
       gal_list_data_free(cat);
@@ -480,16 +480,16 @@ match_catalog_write_one_row(struct matchparams *p, gal_data_t *a,
 
       /* Reverse the table and write it out. */
       gal_list_data_reverse(&cat);
-      gal_table_write(cat, NULL, NULL, p->cp.tableformat,
-                      p->out1name, "MATCHED", 0);
+      gal_table_write_threads(cat, NULL, NULL, p->cp.tableformat, p->out1name,
+                              "MATCHED", 0, p->cp.numthreads);
       gal_list_data_free(cat);
     }
 
   /* There wasn't any row to add, just write the 'a' columns and don't free
      it ('a' will be freed in the higher-level function). */
   else
-    gal_table_write(a, NULL, NULL, p->cp.tableformat, p->out1name,
-                    "MATCHED", 0);
+    gal_table_write_threads(a, NULL, NULL, p->cp.tableformat, p->out1name,
+                            "MATCHED", 0, p->cp.numthreads);
 }
 
 
@@ -546,8 +546,8 @@ match_catalog_write_one_col(struct matchparams *p, gal_data_t *a,
 
   /* Reverse the table and write it out. */
   gal_list_data_reverse(&cat);
-  gal_table_write(cat, NULL, NULL, p->cp.tableformat, p->out1name,
-                  "MATCHED", 0);
+  gal_table_write_threads(cat, NULL, NULL, p->cp.tableformat, p->out1name,
+                          "MATCHED", 0, p->cp.numthreads);
   gal_list_data_free(cat);
 }
 
@@ -589,8 +589,8 @@ match_catalog_kdtree_build(struct matchparams *p)
   gal_fits_key_list_add_end(&keylist, GAL_TYPE_SIZE_T,
                             MATCH_KDTREE_ROOT_KEY, 0,
                             &root, 0, comment, 0, unit, 0);
-  gal_table_write(kdtree, &keylist, NULL, GAL_TABLE_FORMAT_BFITS,
-                  p->out1name, "kdtree", 0);
+  gal_table_write_threads(kdtree, &keylist, NULL, GAL_TABLE_FORMAT_BFITS,
+                          p->out1name, "kdtree", 0, p->cp.numthreads);
 
   /* Let the user know that the k-d tree has been built. */
   if(!p->cp.quiet)
@@ -684,9 +684,10 @@ match_catalog_sort_based(struct matchparams *p, size_t *nummatched)
     }
 
   /* Do the matching. */
-  mcols=gal_match_sort_based(p->cols1, p->cols2, p->aperture->array,
-                             0, 1, p->cp.minmapsize, p->cp.quietmmap,
-                             nummatched);
+  mcols=gal_match_sort_based_threads(p->cols1, p->cols2,
+                                     p->aperture->array, 0, 1,
+                                     p->cp.numthreads, p->cp.minmapsize,
+                                     p->cp.quietmmap, nummatched);
 
   /* Let the user know that it finished. */
   if(!p->cp.quiet)
@@ -811,8 +812,8 @@ match_catalog(struct matchparams *p)
         "from 1).";
 
       /* Write them into the table. */
-      gal_table_write(mcols, NULL, NULL, p->cp.tableformat, p->logname,
-                      "LOG_INFO", 0);
+      gal_table_write_threads(mcols, NULL, NULL, p->cp.tableformat, p->logname,
+                              "LOG_INFO", 0, p->cp.numthreads);
 
       /* Set the comment pointer to NULL: they weren't allocated. */
       mcols->comment=NULL;
@@ -149,6 +149,136 @@ struct argp_option program_options[] =
       GAL_OPTIONS_NOT_MANDATORY,
       GAL_OPTIONS_NOT_SET
     },
+    {
+      "prevcat",
+      UI_KEY_PREVCAT,
+      "FITS/TXT",
+      0,
+      "Catalog of previous run (incremental mode).",
+      GAL_OPTIONS_GROUP_INPUT,
+      &p->prevcat,
+      GAL_TYPE_STRING,
+      GAL_OPTIONS_RANGE_ANY,
+      GAL_OPTIONS_NOT_MANDATORY,
+      GAL_OPTIONS_NOT_SET
+    },
+    {
+      "prevcathdu",
+      UI_KEY_PREVCATHDU,
+      "STR",
+      0,
+      "HDU/extension of '--prevcat'.",
+      GAL_OPTIONS_GROUP_INPUT,
+      &p->prevcathdu,
+      GAL_TYPE_STRING,
+      GAL_OPTIONS_RANGE_ANY,
+      GAL_OPTIONS_NOT_MANDATORY,
+      GAL_OPTIONS_NOT_SET
+    },
+    {
+      "prevlabels",
+      UI_KEY_PREVLABELS,
+      "FITS",
+      0,
+      "Labels used to make '--prevcat'.",
+      GAL_OPTIONS_GROUP_INPUT,
+      &p->prevlabels,
+      GAL_TYPE_STRING,
+      GAL_OPTIONS_RANGE_ANY,
+      GAL_OPTIONS_NOT_MANDATORY,
+      GAL_OPTIONS_NOT_SET
+    },
+    {
+      "prevlabelshdu",
+      UI_KEY_PREVLABELSHDU,
+      "STR",
+      0,
+      "HDU/extension of '--prevlabels'.",
+      GAL_OPTIONS_GROUP_INPUT,
+      &p->prevlabelshdu,
+      GAL_TYPE_STRING,
+      GAL_OPTIONS_RANGE_ANY,
+      GAL_OPTIONS_NOT_MANDATORY,
+      GAL_OPTIONS_NOT_SET
+    },
+    {
+      "prevvalues",
+      UI_KEY_PREVVALUES,
+      "FITS",
+      0,
+      "Values used to make '--prevcat'.",
+      GAL_OPTIONS_GROUP_INPUT,
+      &p->prevvalues,
+      GAL_TYPE_STRING,
+      GAL_OPTIONS_RANGE_ANY,
+      GAL_OPTIONS_NOT_MANDATORY,
+      GAL_OPTIONS_NOT_SET
+    },
+    {
+      "prevvalueshdu",
+      UI_KEY_PREVVALUESHDU,
+      "STR",
+      0,
+      "HDU/extension of '--prevvalues'.",
+      GAL_OPTIONS_GROUP_INPUT,
+      &p->prevvalueshdu,
+      GAL_TYPE_STRING,
+      GAL_OPTIONS_RANGE_ANY,
+      GAL_OPTIONS_NOT_MANDATORY,
+      GAL_OPTIONS_NOT_SET
+    },
+    {
+      "prevclumps",
+      UI_KEY_PREVCLUMPS,
+      "FITS",
+      0,
+      "Clumps used to make '--prevcat'.",
+      GAL_OPTIONS_GROUP_INPUT,
+      &p->prevclumps,
+      GAL_TYPE_STRING,
+      GAL_OPTIONS_RANGE_ANY,
+      GAL_OPTIONS_NOT_MANDATORY,
+      GAL_OPTIONS_NOT_SET
+    },
+    {
+      "prevclumpshdu",
+      UI_KEY_PREVCLUMPSHDU,
+      "STR",
+      0,
+      "HDU/extension of '--prevclumps'.",
+      GAL_OPTIONS_GROUP_INPUT,
+      &p->prevclumpshdu,
+      GAL_TYPE_STRING,
+      GAL_OPTIONS_RANGE_ANY,
+      GAL_OPTIONS_NOT_MANDATORY,
+      GAL_OPTIONS_NOT_SET
+    },
+    {
+      "prevclumpscat",
+      UI_KEY_PREVCLUMPSCAT,
+      "FITS/TXT",
+      0,
+      "Clumps catalog of previous run.",
+      GAL_OPTIONS_GROUP_INPUT,
+      &p->prevclumpscat,
+      GAL_TYPE_STRING,
+      GAL_OPTIONS_RANGE_ANY,
+      GAL_OPTIONS_NOT_MANDATORY,
+      GAL_OPTIONS_NOT_SET
+    },
+    {
+      "prevclumpscathdu",
+      UI_KEY_PREVCLUMPSCATHDU,
+      "STR",
+      0,
+      "HDU/extension of '--prevclumpscat'.",
+      GAL_OPTIONS_GROUP_INPUT,
+      &p->prevclumpscathdu,
+      GAL_TYPE_STRING,
+      GAL_OPTIONS_RANGE_ANY,
+      GAL_OPTIONS_NOT_MANDATORY,
+      GAL_OPTIONS_NOT_SET
+    },
     {
       "variance",
       UI_KEY_VARIANCE,
@@ -232,6 +362,19 @@ struct argp_option program_options[] =
       GAL_OPTIONS_NOT_MANDATORY,
       GAL_OPTIONS_NOT_SET
     },
+    {
+      "checksums",
+      UI_KEY_CHECKSUMS,
+      0,
+      0,
+      "Write input checksums (for '--prevcat').",
+      GAL_OPTIONS_GROUP_OUTPUT,
+      &p->checksums,
+      GAL_OPTIONS_NO_ARG_TYPE,
+      GAL_OPTIONS_RANGE_0_OR_1,
+      GAL_OPTIONS_NOT_MANDATORY,
+      GAL_OPTIONS_NOT_SET
+    },
     {
       "sfmagnsigma",
       UI_KEY_SFMAGNSIGMA,
@@ -371,17 +371,63 @@ columns_sanity_check(struct mkcatalogparams *p)
 
 
 
+/* The order-based measurements (that need all the values of each
+   object/clump) are necessary when any of these intermediate values are
+   requested. */
+int
+columns_order_based(uint8_t *oiflag)
+{
+  return ( oiflag[    OCOL_MEDIAN        ]
+           || oiflag[ OCOL_MAXIMUM       ]
+           || oiflag[ OCOL_HALFMAXSUM    ]
+           || oiflag[ OCOL_HALFMAXNUM    ]
+           || oiflag[ OCOL_HALFSUMNUM    ]
+           || oiflag[ OCOL_SIGCLIPNUM    ]
+           || oiflag[ OCOL_SIGCLIPSTD    ]
+           || oiflag[ OCOL_SIGCLIPMEAN   ]
+           || oiflag[ OCOL_FRACMAX1NUM   ]
+           || oiflag[ OCOL_FRACMAX2NUM   ]
+           || oiflag[ OCOL_SIGCLIPMEDIAN ] );
+}
+
+
+
+
+
+/* Flags of an output column (see 'MKCATALOG_COLFLAG_*' in 'main.h'),
+   based on the intermediate values that it needs. */
+static uint8_t
+columns_flag(uint8_t *oiflag)
+{
+  uint8_t out=0;
+
+  if( columns_order_based(oiflag) )
+    out |= MKCATALOG_COLFLAG_ORDERBASED;
+  if( oiflag[    OCOL_UPPERLIMIT_B    ]
+      || oiflag[ OCOL_UPPERLIMIT_S    ]
+      || oiflag[ OCOL_UPPERLIMIT_Q    ]
+      || oiflag[ OCOL_UPPERLIMIT_SKEW ] )
+    out |= MKCATALOG_COLFLAG_UPPERLIMIT;
+  return out;
+}
+
+
+
+
+
 /* Set the necessary parameters for each output column and allocate the
    space necessary to keep the values. */
 void
 columns_define_alloc(struct mkcatalogparams *p)
 {
+  size_t i;
   gal_list_i32_t *colcode;
+  uint8_t oiflag[OCOL_NUMCOLS];
   size_t ndim=p->objects->ndim;
   gal_list_str_t *strtmp, *noclumpimg=NULL;
   int disp_fmt=0, disp_width=0, disp_precision=0;
   char *name=NULL, *unit=NULL, *ocomment=NULL, *ccomment=NULL;
-  uint8_t otype=GAL_TYPE_INVALID, ctype=GAL_TYPE_INVALID, *oiflag, *ciflag;
+  uint8_t otype=GAL_TYPE_INVALID, ctype=GAL_TYPE_INVALID, *ciflag;
 
   /* Do a sanity check on the columns given the input dataset. */
   columns_sanity_check(p);
@@ -391,14 +437,20 @@ columns_define_alloc(struct mkcatalogparams *p)
      smaller domain of raw measurements. So to avoid having to calculate
      something multiple times, each parameter will flag the intermediate
      parameters it requires in these arrays. */
-  oiflag = p->oiflag = gal_pointer_allocate(GAL_TYPE_UINT8, OCOL_NUMCOLS, 1,
-                                            __func__, "oiflag");
+  p->oiflag = gal_pointer_allocate(GAL_TYPE_UINT8, OCOL_NUMCOLS, 1,
+                                   __func__, "p->oiflag");
   ciflag = p->ciflag = gal_pointer_allocate(GAL_TYPE_UINT8, CCOL_NUMCOLS, 1,
                                             __func__, "ciflag");
 
   /* Allocate the columns. */
   for(colcode=p->columnids; colcode!=NULL; colcode=colcode->next)
     {
+      /* The intermediate flags of the objects are first set for this
+         column alone (in 'oiflag'), so the measurements that it needs are
+         also known (for example in the incremental mode). They are added
+         to 'p->oiflag' after the column is defined. */
+      memset(oiflag, 0, sizeof oiflag);
+
       /* Set the column-specific parameters, please follow the same order
          as 'args.h'. IMPORTANT: we want the names to be the same as the
          option names. Note that zero 'disp_' variables will be
@@ -1586,7 +1638,7 @@ columns_define_alloc(struct mkcatalogparams *p)
           disp_width     = 8;
           disp_precision = 3;
           p->upperlimit  = 1;
-          oiflag[ OCOL_UPPERLIMIT_SKEW ] = oiflag[ CCOL_UPPERLIMIT_SKEW ] = 1;
+          oiflag[ OCOL_UPPERLIMIT_SKEW ] = ciflag[ CCOL_UPPERLIMIT_SKEW ] = 1;
           break;
 
         case UI_KEY_RIVERMEAN:
@@ -2014,6 +2066,10 @@ columns_define_alloc(struct mkcatalogparams *p)
         }
 
 
+      /* Add the intermediate flags of this column to the full list. */
+      for(i=0;i<OCOL_NUMCOLS;++i) p->oiflag[i] |= oiflag[i];
+
+
       /* If this is an object's column, add it to the list of columns. We
          will be using the 'status' element to keep the MakeCatalog code
          for the columns. */
@@ -2023,6 +2079,7 @@ columns_define_alloc(struct mkcatalogparams *p)
                                   &p->numobjects, NULL, 0, p->cp.minmapsize,
                                   p->cp.quietmmap, name, unit, ocomment);
           p->objectcols->status         = colcode->v;
+          p->objectcols->flag          |= columns_flag(oiflag);
           p->objectcols->disp_fmt       = disp_fmt;
           p->objectcols->disp_width     = disp_width;
           p->objectcols->disp_precision = disp_precision;
@@ -2042,6 +2099,7 @@ columns_define_alloc(struct mkcatalogparams *p)
                                       p->cp.minmapsize, p->cp.quietmmap,
                                       name, unit, ccomment);
               p->clumpcols->status         = colcode->v;
+              p->clumpcols->flag          |= columns_flag(oiflag);
               p->clumpcols->disp_fmt       = disp_fmt;
               p->clumpcols->disp_width     = disp_width;
               p->clumpcols->disp_precision = disp_precision;
@@ -23,6 +23,9 @@ along with Gnuastro. If not, see <http://www.gnu.org/licenses/>.
 #ifndef COLUMNS_H
 #define COLUMNS_H
 
+int
+columns_order_based(uint8_t *oiflag);
+
 void
 columns_define_alloc(struct mkcatalogparams *p);
 
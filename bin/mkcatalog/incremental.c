@@ -0,0 +1,923 @@
+/*********************************************************************
+MakeCatalog - Make a catalog from an input and labeled image.
+MakeCatalog is part of GNU Astronomy Utilities (Gnuastro) package.
+
+Original author:
+     Mohammad Akhlaghi <mohammad@akhlaghi.org>
+Contributing author(s):
+Copyright (C) 2015-2023 Free Software Foundation, Inc.
+
+Gnuastro is free software: you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by the
+Free Software Foundation, either version 3 of the License, or (at your
+option) any later version.
+
+Gnuastro is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Gnuastro. If not, see <http://www.gnu.org/licenses/>.
+**********************************************************************/
+#include <config.h>
+
+#include <math.h>
+#include <stdio.h>
+#include <errno.h>
+#include <error.h>
+#include <string.h>
+#include <stdlib.h>
+#include <inttypes.h>
+
+#include <gnuastro/wcs.h>
+#include <gnuastro/data.h>
+#include <gnuastro/fits.h>
+#include <gnuastro/array.h>
+#include <gnuastro/blank.h>
+#include <gnuastro/table.h>
+#include <gnuastro/pointer.h>
+#include <gnuastro/dimension.h>
+
+#include <gnuastro-internal/checkset.h>
+
+#include "main.h"
+
+#include "incremental.h"
+
+
+
+
+
+
+
+
+
+
+
+
+
+
+/* Basis and prime of the hash that is used for the checksums. */
+#define INCREMENTAL_HASH_BASIS 0xcbf29ce484222325ULL
+#define INCREMENTAL_HASH_PRIME 0x100000001b3ULL
+
+/* Names of the keywords that keep the checksums in the output catalog (in
+   the same order as 'enum incrementalsums'). */
+static char *incremental_keynames[INCSUM_NUMBER]=
+  {"INCLABS", "INCCLUMP", "INCVALS", "INCSKY", "INCSTD", "INCCONF",
+   "INCUPLIM"};
+
+
+
+
+
+
+
+
+
+
+/*********************************************************************/
+/*******************           Checksums          ********************/
+/*********************************************************************/
+/* Add the given bytes to the hash. This is the 64-bit FNV-1a hash, but
+   on 8-byte words (with a shift after each multiplication, so the high
+   bits also affect the low bits). It is not meant to be secure, it should
+   just change when the inputs change and be fast enough to be done on the
+   inputs of every run. */
+static uint64_t
+incremental_hash(uint64_t hash, void *in, size_t size)
+{
+  size_t i;
+  uint64_t word;
+  unsigned char *b=in;
+
+  for(i=0; i+sizeof word<=size; i+=sizeof word)
+    {
+      memcpy(&word, b+i, sizeof word);
+      hash = (hash ^ word) * INCREMENTAL_HASH_PRIME;
+      hash ^= hash>>32;
+    }
+  for(; i<size; ++i)
+    hash = (hash ^ b[i]) * INCREMENTAL_HASH_PRIME;
+  return hash;
+}
+
+
+
+
+
+/* Checksum of a dataset (its type, size and values). Zero is reserved for
+   inputs that aren't used. */
+static uint64_t
+incremental_checksum(gal_data_t *data)
+{
+  uint64_t out=INCREMENTAL_HASH_BASIS;
+
+  if(data==NULL) return 0;
+  out=incremental_hash(out, &data->type, sizeof data->type);
+  out=incremental_hash(out, data->dsize, data->ndim * sizeof *data->dsize);
+  out=incremental_hash(out, data->array,
+                       data->size * gal_type_sizeof(data->type));
+  return out ? out : 1;
+}
+
+
+
+
+
+/* Checksum of the options that affect the measurements of all objects.
+   The WCS of the labels is also included because it is used in the
+   RA/Dec and surface brightness columns. */
+static uint64_t
+incremental_config(struct mkcatalogparams *p)
+{
+  int nkeyrec;
+  char *wcsstr;
+  struct wcsprm *wcs;
+  uint64_t out=INCREMENTAL_HASH_BASIS;
+
+  /* Numerical options. */
+  out=incremental_hash(out, &p->zeropoint,   sizeof p->zeropoint);
+  out=incremental_hash(out, &p->variance,    sizeof p->variance);
+  out=incremental_hash(out, &p->subtractsky, sizeof p->subtractsky);
+  out=incremental_hash(out, p->sigmaclip,    sizeof p->sigmaclip);
+  out=incremental_hash(out, &p->cpscorr,     sizeof p->cpscorr);
+  out=incremental_hash(out, &p->spatialresolution,
+                       sizeof p->spatialresolution);
+  if(p->fracmax)
+    out=incremental_hash(out, p->fracmax->array,
+                         p->fracmax->size
+                         * gal_type_sizeof(p->fracmax->type));
+
+  /* The WCS (as header keywords). A copy is used because the linear
+     matrix may be changed when writing the keywords. */
+  if(p->objects->wcs)
+    {
+      wcs=gal_wcs_copy(p->objects->wcs);
+      wcsstr=gal_wcs_write_wcsstr(wcs, &nkeyrec);
+      if(wcsstr)
+        {
+          out=incremental_hash(out, wcsstr, 80*nkeyrec);
+          free(wcsstr);
+        }
+      gal_wcs_free(wcs);
+    }
+
+  /* Return the checksum. */
+  return out ? out : 1;
+}
+
+
+
+
+
+/* Checksum of the upper-limit options and mask. */
+static uint64_t
+incremental_config_upperlimit(struct mkcatalogparams *p)
+{
+  size_t i;
+  uint64_t mask, out=INCREMENTAL_HASH_BASIS;
+
+  out=incremental_hash(out, &p->upnum,       sizeof p->upnum);
+  out=incremental_hash(out, &p->upnsigma,    sizeof p->upnsigma);
+  out=incremental_hash(out, p->upsigmaclip,  sizeof p->upsigmaclip);
+  out=incremental_hash(out, &p->rng_seed,    sizeof p->rng_seed);
+  out=incremental_hash(out, (void *)(p->rng_name), strlen(p->rng_name));
+  if(p->uprange)
+    for(i=0;p->uprange[i]!=-1;++i)
+      out=incremental_hash(out, &p->uprange[i], sizeof *p->uprange);
+  if(p->upmask)
+    {
+      mask=incremental_checksum(p->upmask);
+      out=incremental_hash(out, &mask, sizeof mask);
+    }
+  return out ? out : 1;
+}
+
+
+
+
+
+/* Write the checksums in the output catalog's meta-data (only when
+   '--checksums' is called). */
+void
+incremental_write_keys(struct mkcatalogparams *p,
+                       gal_fits_list_key_t **keylist)
+{
+  size_t i;
+  char *str;
+  char *comments[INCSUM_NUMBER]={"Checksum of object labels.",
+                                 "Checksum of clump labels.",
+                                 "Checksum of values (before Sky "
+                                 "subtraction).",
+                                 "Checksum of Sky.",
+                                 "Checksum of Sky STD (or variance).",
+                                 "Checksum of measurement options.",
+                                 "Checksum of upper-limit options and mask."};
+
+  if(p->checksums==0) return;
+  gal_fits_key_list_title_add_end(keylist, "Checksums of inputs (for "
+                                  "'--prevcat')", 0);
+  for(i=0;i<INCSUM_NUMBER;++i)
+    if(p->incsum[i])
+      {
+        if( asprintf(&str, "%016"PRIx64, p->incsum[i])<0 )
+          error(EXIT_FAILURE, 0, "%s: asprintf allocation", __func__);
+        gal_fits_key_list_add_end(keylist, GAL_TYPE_STRING,
+                                  incremental_keynames[i], 0, str, 1,
+                                  comments[i], 0, NULL, 0);
+      }
+}
+
+
+
+
+
+
+
+
+
+
+/*********************************************************************/
+/*******************         Preparations         ********************/
+/*********************************************************************/
+/* Find the column with the given name in the previous catalog. */
+static gal_data_t *
+incremental_prevcat_column(gal_data_t *prevcat, char *name)
+{
+  gal_data_t *tmp;
+  for(tmp=prevcat; tmp!=NULL; tmp=tmp->next)
+    if( tmp->name && !strcasecmp(tmp->name, name) )
+      return tmp;
+  return NULL;
+}
+
+
+
+
+
+/* Read the checksums of the previous run from the meta-data of the
+   previous catalog (a zero value shows that the checksum isn't present).
+   In a FITS table, they are keywords of the table's HDU and in a
+   plain-text table, they are in the '# [key] NAME: VALUE' comment lines
+   at the start of the file. */
+static void
+incremental_read_sums(struct mkcatalogparams *p)
+{
+  FILE *fp;
+  char **strarr;
+  gal_data_t *keys;
+  char *line=NULL;
+  size_t i, len, linelen=0;
+
+  /* Initialize the values. */
+  for(i=0;i<INCSUM_NUMBER;++i) p->incprev[i]=0;
+
+  /* Read the values. */
+  if( gal_fits_file_recognized(p->prevcat) )
+    {
+      keys=gal_data_array_calloc(INCSUM_NUMBER);
+      for(i=0;i<INCSUM_NUMBER;++i)
+        {
+          keys[i].next = i<INCSUM_NUMBER-1 ? &keys[i+1] : NULL;
+          keys[i].name = incremental_keynames[i];
+          keys[i].type = GAL_TYPE_STRING;
+        }
+      gal_fits_key_read(p->prevcat, p->prevcathdu, keys, 0, 0);
+      for(i=0;i<INCSUM_NUMBER;++i)
+        {
+          if(keys[i].status==0)
+            {
+              strarr=keys[i].array;
+              p->incprev[i]=strtoull(strarr[0], NULL, 16);
+            }
+          keys[i].name=NULL;
+        }
+      gal_data_array_free(keys, INCSUM_NUMBER, 1);
+    }
+  else
+    {
+      errno=0;
+      fp=fopen(p->prevcat, "r");
+      if(fp==NULL)
+        error(EXIT_FAILURE, errno, "%s", p->prevcat);
+      while( getline(&line, &linelen, fp)!=-1 && line[0]=='#' )
+        if( !strncmp(line, "# [key] ", 8) )
+          for(i=0;i<INCSUM_NUMBER;++i)
+            {
+              len=strlen(incremental_keynames[i]);
+              if( !strncmp(line+8, incremental_keynames[i], len)
+                  && line[8+len]==':' )
+                p->incprev[i]=strtoull(line+9+len, NULL, 16);
+            }
+      free(line);
+      fclose(fp);
+    }
+}
+
+
+
+
+
+/* Read an image of a previous run and make sure it has the same size as
+   the current labels. Its checksum should also be the same as the one
+   that was recorded in the previous catalog: otherwise it isn't the image
+   that was used to produce it. */
+static gal_data_t *
+incremental_read_image(struct mkcatalogparams *p, char *filename,
+                       char *hdu, char *hduoption, uint8_t type,
+                       size_t sumind)
+{
+  gal_data_t *out;
+
+  /* Make sure the HDU is given (when necessary). */
+  if( gal_fits_file_recognized(filename) && hdu==NULL )
+    error(EXIT_FAILURE, 0, "%s: no HDU/extension provided, please use "
+          "'--%s' to give a specific HDU using its number (counting from "
+          "zero) or name", filename, hduoption);
+
+  /* Read the dataset and convert it to the desired type. */
+  out=gal_array_read_one_ch_to_type_threads(filename, hdu, NULL, type,
+                                            p->cp.numthreads, p->cp.minmapsize,
+                                            p->cp.quietmmap);
+  out->ndim=gal_dimension_remove_extra(out->ndim, out->dsize, NULL);
+
+  /* Make sure it has the same size as the labels. */
+  if( gal_dimension_is_different(p->objects, out) )
+    error(EXIT_FAILURE, 0, "%s (hdu: %s) and %s (hdu: %s) have a "
+          "different dimension/size", filename, hdu, p->objectsfile,
+          p->cp.hdu);
+
+  /* Make sure it was used to produce the previous catalog. */
+  if( incremental_checksum(out)!=p->incprev[sumind] )
+    error(EXIT_FAILURE, 0, "%s (hdu: %s): not the image that was used to "
+          "produce %s (its checksum is different from the '%s' keyword "
+          "of the previous catalog)", filename, hdu, p->prevcat,
+          incremental_keynames[sumind]);
+
+  /* Return the dataset. */
+  return out;
+}
+
+
+
+
+
+/* Flag the labels that have changed between the previous and current
+   runs. A label has changed if any of its pixels has a different label in
+   the two runs (in the current run or in the previous run), or if the
+   value or clump label of any of its pixels has changed. When any label
+   or value of the image has changed (even outside the objects),
+   'p->incanychange' is set: the upper-limit measurements of all objects
+   depend on the whole image. */
+static uint8_t *
+incremental_changed(struct mkcatalogparams *p, int32_t maxlab)
+{
+  size_t i;
+  float *nv=NULL, *ov=NULL;
+  int32_t *n, *o, *nc=NULL, *oc=NULL;
+  gal_data_t *prevlabs, *prevvals=NULL, *prevclumps=NULL;
+  uint8_t *changed=gal_pointer_allocate(GAL_TYPE_UINT8, maxlab+1, 1,
+                                        __func__, "changed");
+
+  /* Read the previous labels. */
+  prevlabs=incremental_read_image(p, p->prevlabels, p->prevlabelshdu,
+                                  "prevlabelshdu", GAL_TYPE_INT32,
+                                  INCSUM_LABELS);
+  n=p->objects->array;
+  o=prevlabs->array;
+
+  /* Read the previous values when they were used in both runs (when the
+     previous run didn't use the values, none of its columns depend on
+     them). */
+  if(p->values && p->incprev[INCSUM_VALUES])
+    {
+      prevvals=incremental_read_image(p, p->prevvalues, p->prevvalueshdu,
+                                      "prevvalueshdu", GAL_TYPE_FLOAT32,
+                                      INCSUM_VALUES);
+      nv=p->values->array;
+      ov=prevvals->array;
+    }
+
+  /* Read the previous clump labels. */
+  if(p->clumps)
+    {
+      prevclumps=incremental_read_image(p, p->prevclumps, p->prevclumpshdu,
+                                        "prevclumpshdu", GAL_TYPE_INT32,
+                                        INCSUM_CLUMPS);
+      nc=p->clumps->array;
+      oc=prevclumps->array;
+    }
+
+  /* Go over all the pixels and flag the changed labels. Note that
+     labels in the previous run that are larger than the current maximum
+     label don't exist in the current run, so they can be ignored. Two NaN
+     values are considered to be identical. */
+  p->incanychange=0;
+  for(i=0;i<p->objects->size;++i)
+    if( n[i]!=o[i] )
+      {
+        p->incanychange=1;
+        if(n[i]>0)                 changed[ n[i] ]=1;
+        if(o[i]>0 && o[i]<=maxlab) changed[ o[i] ]=1;
+      }
+    else if( nv && nv[i]!=ov[i] && !(isnan(nv[i]) && isnan(ov[i])) )
+      {
+        p->incanychange=1;
+        if(n[i]>0) changed[ n[i] ]=1;
+      }
+    else if( nc && n[i]>0 && nc[i]!=oc[i] )
+      changed[ n[i] ]=1;
+
+  /* Clean up and return. */
+  gal_data_free(prevlabs);
+  if(prevvals) gal_data_free(prevvals);
+  if(prevclumps) gal_data_free(prevclumps);
+  return changed;
+}
+
+
+
+
+
+/* Read the clumps catalog of the previous run and find the rows of the
+   clumps of each object in it ('p->prevcrow' and 'p->prevcnum'). The
+   clumps of each object are in consecutive rows (sorted by their ID in
+   the object), even when the previous run was called with
+   '--noclumpsort'. */
+static void
+incremental_prev_clumps(struct mkcatalogparams *p, int32_t maxlab)
+{
+  size_t i, r, *labind;
+  int32_t *host, *idin;
+  gal_data_t *hcol, *icol, *hconv, *iconv;
+
+  /* Read the previous clumps catalog and make sure it has the IDs. */
+  p->prevclumpcols=gal_table_read(p->prevclumpscat, p->prevclumpscathdu,
+                                  NULL, NULL, GAL_TABLE_SEARCH_NAME, 1,
+                                  p->cp.numthreads, p->cp.minmapsize,
+                                  p->cp.quietmmap, NULL);
+  hcol=incremental_prevcat_column(p->prevclumpcols, "HOST_OBJ_ID");
+  icol=incremental_prevcat_column(p->prevclumpcols, "ID_IN_HOST_OBJ");
+  if(hcol==NULL || icol==NULL)
+    error(EXIT_FAILURE, 0, "%s: no 'HOST_OBJ_ID' or 'ID_IN_HOST_OBJ' "
+          "column! The previous clumps catalog should also contain the "
+          "clump IDs (for example produced by calling '--ids')",
+          p->prevclumpscat);
+  hconv = ( hcol->type==GAL_TYPE_INT32
+            ? hcol
+            : gal_data_copy_to_new_type(hcol, GAL_TYPE_INT32) );
+  iconv = ( icol->type==GAL_TYPE_INT32
+            ? icol
+            : gal_data_copy_to_new_type(icol, GAL_TYPE_INT32) );
+  host=hconv->array;
+  idin=iconv->array;
+
+  /* Index of each label in the objects catalog. */
+  labind=gal_pointer_allocate(GAL_TYPE_SIZE_T, maxlab+1, 0, __func__,
+                              "labind");
+  for(i=0;i<=(size_t)maxlab;++i) labind[i]=GAL_BLANK_SIZE_T;
+  for(i=0;i<p->numobjects;++i)
+    labind[ p->outlabs ? p->outlabs[i] : i+1 ]=i;
+
+  /* Find the rows of each object's clumps. */
+  p->prevcrow=gal_pointer_allocate(GAL_TYPE_SIZE_T, p->numobjects, 0,
+                                   __func__, "p->prevcrow");
+  p->prevcnum=gal_pointer_allocate(GAL_TYPE_SIZE_T, p->numobjects, 1,
+                                   __func__, "p->prevcnum");
+  for(i=0;i<p->numobjects;++i) p->prevcrow[i]=GAL_BLANK_SIZE_T;
+  for(r=0;r<hconv->size;++r)
+    if( host[r]>0 && host[r]<=maxlab
+        && (i=labind[ host[r] ])!=GAL_BLANK_SIZE_T )
+      {
+        if(p->prevcnum[i]==0) p->prevcrow[i]=r;
+        if( r!=p->prevcrow[i]+p->prevcnum[i]
+            || idin[r]!=(int32_t)(p->prevcnum[i]+1) )
+          error(EXIT_FAILURE, 0, "%s: the clumps of object %d are not in "
+                "consecutive rows (sorted by their 'ID_IN_HOST_OBJ')",
+                p->prevclumpscat, host[r]);
+        ++p->prevcnum[i];
+      }
+
+  /* Clean up. */
+  if(hconv!=hcol) gal_data_free(hconv);
+  if(iconv!=icol) gal_data_free(iconv);
+  free(labind);
+}
+
+
+
+
+
+/* Prepare the incremental mode: read the previous catalog and find the
+   objects that didn't change since the previous run ('p->prevrow' will
+   keep the row of each object in the previous catalog, or
+   'GAL_BLANK_SIZE_T' when it has changed). With '--checksums', the
+   checksums of the labels and values (that aren't yet Sky-subtracted) are
+   also calculated here to be written in the output. */
+void
+incremental_prepare(struct mkcatalogparams *p)
+{
+  uint8_t *changed;
+  int32_t *id, label, maxlab;
+  gal_data_t *idcol, *idconv;
+  size_t i, *labrow, nrows;
+
+  /* Checksums of the labels and values (they are only written in the
+     output, the images of the previous run are checked against the
+     checksums of the previous catalog). */
+  if(p->checksums)
+    {
+      p->incsum[INCSUM_LABELS] = incremental_checksum(p->objects);
+      p->incsum[INCSUM_CLUMPS] = incremental_checksum(p->clumps);
+      p->incsum[INCSUM_VALUES] = incremental_checksum(p->values);
+    }
+
+  /* The rest is only necessary in incremental mode. */
+  if(p->prevcat==NULL) return;
+
+  /* Basic sanity checks. */
+  if(p->prevlabels==NULL)
+    error(EXIT_FAILURE, 0, "no labeled image from the previous run! With "
+          "'--prevcat', it is also necessary to give the labeled image "
+          "that was used to produce it with '--prevlabels'");
+  if(p->spectrum)
+    error(EXIT_FAILURE, 0, "'--prevcat' (incremental mode) can't be used "
+          "with '--spectrum'");
+  if( p->clumps && (p->prevclumps==NULL || p->prevclumpscat==NULL) )
+    error(EXIT_FAILURE, 0, "no clumps from the previous run! With "
+          "'--prevcat' and '--clumpscat', it is also necessary to give the "
+          "clumps labeled image and the clumps catalog of the previous run "
+          "with '--prevclumps' and '--prevclumpscat'");
+  if( gal_fits_file_recognized(p->prevcat) && p->prevcathdu==NULL )
+    error(EXIT_FAILURE, 0, "%s: no HDU/extension provided for the "
+          "previous catalog. Please use '--prevcathdu' to give a specific "
+          "HDU using its number (counting from zero) or name",
+          p->prevcat);
+  if( p->clumps && gal_fits_file_recognized(p->prevclumpscat)
+      && p->prevclumpscathdu==NULL )
+    error(EXIT_FAILURE, 0, "%s: no HDU/extension provided for the "
+          "previous clumps catalog. Please use '--prevclumpscathdu' to "
+          "give a specific HDU using its number (counting from zero) or "
+          "name", p->prevclumpscat);
+
+  /* Read the checksums of the previous run. Without them, it isn't
+     possible to know which inputs produced the previous catalog, so no
+     row can be reused. */
+  incremental_read_sums(p);
+  if(p->incprev[INCSUM_LABELS]==0)
+    {
+      if(!p->cp.quiet)
+        fprintf(stderr, "WARNING: %s: no '%s' keyword (checksum of the "
+                "labels that produced it; it should be produced with "
+                "'--checksums'), all objects will be measured\n", p->prevcat,
+                incremental_keynames[INCSUM_LABELS]);
+      return;
+    }
+  if(p->values && p->incprev[INCSUM_VALUES] && p->prevvalues==NULL)
+    error(EXIT_FAILURE, 0, "no values image from the previous run! The "
+          "values are used in this run, so with '--prevcat', it is also "
+          "necessary to give the values image that was used to produce "
+          "it with '--prevvalues'");
+  if(p->clumps && p->incprev[INCSUM_CLUMPS]==0)
+    error(EXIT_FAILURE, 0, "%s: no '%s' keyword! The previous catalog "
+          "wasn't produced with a clumps image, so it can't be used with "
+          "'--clumpscat'", p->prevcat, incremental_keynames[INCSUM_CLUMPS]);
+
+  /* Find the changed labels. Note that the labels are sorted in
+     'outlabs', so its last element is the maximum label. */
+  maxlab = p->outlabs ? p->outlabs[p->numobjects-1] : p->numobjects;
+  changed=incremental_changed(p, maxlab);
+
+  /* Read the previous catalog and make sure it has the object IDs. */
+  p->prevcatcols=gal_table_read(p->prevcat, p->prevcathdu, NULL, NULL,
+                                GAL_TABLE_SEARCH_NAME, 1, p->cp.numthreads,
+                                p->cp.minmapsize, p->cp.quietmmap, NULL);
+  idcol=incremental_prevcat_column(p->prevcatcols, "OBJ_ID");
+  if(idcol==NULL)
+    error(EXIT_FAILURE, 0, "%s: no 'OBJ_ID' column! The previous catalog "
+          "should also contain the object IDs (for example produced by "
+          "calling '--ids' or '--objid')", p->prevcat);
+  nrows=idcol->size;
+
+  /* Keep the row of each (unchanged) label in the previous catalog. */
+  labrow=gal_pointer_allocate(GAL_TYPE_SIZE_T, maxlab+1, 0, __func__,
+                              "labrow");
+  for(i=0;i<=(size_t)maxlab;++i) labrow[i]=GAL_BLANK_SIZE_T;
+  idconv = ( idcol->type==GAL_TYPE_INT32
+             ? idcol
+             : gal_data_copy_to_new_type(idcol, GAL_TYPE_INT32) );
+  id=idconv->array;
+  for(i=0;i<nrows;++i)
+    if(id[i]>0 && id[i]<=maxlab && changed[ id[i] ]==0)
+      labrow[ id[i] ]=i;
+
+  /* Set the row of each object in the previous catalog. */
+  p->prevrow=gal_pointer_allocate(GAL_TYPE_SIZE_T, p->numobjects, 0,
+                                  __func__, "p->prevrow");
+  for(i=0;i<p->numobjects;++i)
+    {
+      label = p->outlabs ? p->outlabs[i] : i+1;
+      p->prevrow[i]=labrow[label];
+    }
+
+  /* The rows of each object's clumps in the previous clumps catalog. */
+  if(p->clumps) incremental_prev_clumps(p, maxlab);
+
+  /* Clean up. */
+  if(idconv!=idcol) gal_data_free(idconv);
+  free(labrow);
+  free(changed);
+}
+
+
+
+
+
+/* Don't reuse anything from the previous catalog(s): all objects will be
+   measured. */
+static void
+incremental_prev_free(struct mkcatalogparams *p)
+{
+  free(p->prevrow);
+  free(p->prevcrow);
+  free(p->prevcnum);
+  gal_list_data_free(p->prevcatcols);
+  gal_list_data_free(p->prevclumpcols);
+  p->prevcatcols=p->prevclumpcols=NULL;
+  p->prevrow=p->prevcrow=p->prevcnum=NULL;
+}
+
+
+
+
+
+/* Flag the columns of a catalog that can't be copied from the previous
+   catalog, so they should be measured for all objects: columns that don't
+   exist in the previous catalog, and upper-limit columns when the
+   upper-limit measurements of the previous run can't be reused. The
+   number of such columns is returned. */
+static size_t
+incremental_plan_columns(struct mkcatalogparams *p, gal_data_t *columns,
+                         gal_data_t *prevcols, int upreusable)
+{
+  size_t num=0;
+  gal_data_t *column;
+
+  for(column=columns; column!=NULL; column=column->next)
+    if( incremental_prevcat_column(prevcols, column->name)==NULL
+        || ( !upreusable && (column->flag & MKCATALOG_COLFLAG_UPPERLIMIT) ) )
+      {
+        ++num;
+        column->flag |= MKCATALOG_COLFLAG_MEASUREALL;
+        if(column->flag & MKCATALOG_COLFLAG_ORDERBASED) p->incorderbased=1;
+        if(column->flag & MKCATALOG_COLFLAG_UPPERLIMIT) p->incupperlimit=1;
+      }
+  return num;
+}
+
+
+
+
+
+/* Calculate the checksums of the other inputs and the configuration (that
+   are only ready after all the inputs are read; only when they should be
+   written or compared with a previous run) and in incremental mode,
+   decide which objects should be measured ('p->numtodo'), and which
+   columns can be copied from the previous catalog(s). */
+void
+incremental_plan(struct mkcatalogparams *p)
+{
+  int upreusable;
+  char *differs=NULL;
+  size_t i, reused=0, nmeasure;
+
+  /* Checksums of the other inputs and the configuration. */
+  if(p->checksums || p->prevrow)
+    {
+      p->incsum[INCSUM_SKY]        = incremental_checksum(p->sky);
+      p->incsum[INCSUM_STD]        = incremental_checksum(p->std);
+      p->incsum[INCSUM_CONFIG]     = incremental_config(p);
+      p->incsum[INCSUM_UPPERLIMIT] = ( p->upperlimit
+                                       ? incremental_config_upperlimit(p)
+                                       : 0 );
+    }
+
+  /* By default, all objects are measured. */
+  p->numtodo=p->numobjects;
+  if(p->prevrow==NULL) return;
+
+  /* The Sky, its standard deviation and the options that affect all the
+     measurements should be identical to the previous run. The Sky or STD
+     may only be used in one of the runs: when they weren't used in the
+     previous run, none of its columns depend on them, and when they
+     aren't used in this run, none of the requested columns depend on
+     them. */
+  if( p->incsum[INCSUM_CONFIG]!=p->incprev[INCSUM_CONFIG] )
+    differs="configuration (for example the zero point or the WCS)";
+  else if( p->incsum[INCSUM_SKY] && p->incprev[INCSUM_SKY]
+           && p->incsum[INCSUM_SKY]!=p->incprev[INCSUM_SKY] )
+    differs="Sky";
+  else if( p->incsum[INCSUM_STD] && p->incprev[INCSUM_STD]
+           && p->incsum[INCSUM_STD]!=p->incprev[INCSUM_STD] )
+    differs="Sky standard deviation";
+  if(differs)
+    {
+      if(!p->cp.quiet)
+        fprintf(stderr, "WARNING: the %s is different from the run that "
+                "produced %s, all objects will be measured\n", differs,
+                p->prevcat);
+      incremental_prev_free(p);
+      return;
+    }
+
+  /* The upper-limit measurements use the labels and values of the whole
+     image (to find the random positions), so they can only be reused
+     when nothing has changed and the same upper-limit options (and mask)
+     are used. */
+  upreusable = ( !p->incanychange
+                 && ( p->incsum[INCSUM_UPPERLIMIT]
+                      == p->incprev[INCSUM_UPPERLIMIT] ) );
+
+  /* Find the columns that should be measured for all objects. When there
+     are any, the reused objects are also measured (only for those
+     columns). */
+  nmeasure=incremental_plan_columns(p, p->objectcols, p->prevcatcols,
+                                    upreusable);
+  if(p->clumps)
+    nmeasure+=incremental_plan_columns(p, p->clumpcols, p->prevclumpcols,
+                                       upreusable);
+  p->incpartial = nmeasure>0;
+
+  /* Set the number of objects to measure. */
+  for(i=0;i<p->numobjects;++i)
+    if(p->prevrow[i]!=GAL_BLANK_SIZE_T) ++reused;
+  if(p->incpartial==0) p->numtodo=p->numobjects-reused;
+
+  /* Report the status. */
+  if(!p->cp.quiet)
+    {
+      printf("  - Incremental: %zu of %zu objects reused from %s.\n",
+             reused, p->numobjects, p->prevcat);
+      if(nmeasure)
+        printf("  - Incremental: %zu column(s) measured for all "
+               "objects.\n", nmeasure);
+    }
+}
+
+
+
+
+
+
+
+
+
+
+
+
+
+
+
+
+
+
+
+
+/*********************************************************************/
+/*******************          Final merge         ********************/
+/*********************************************************************/
+/* Copy the rows of the reused objects from a previous catalog into the
+   columns that weren't measured for all objects. 'newrow' and 'prevrow'
+   are the first rows of each object in the two catalogs and 'num' is the
+   number of rows of each object ('newrow==NULL' and 'num==NULL' for the
+   objects catalog: one row per object, in the same order). */
+static void
+incremental_merge_columns(struct mkcatalogparams *p, gal_data_t *columns,
+                          gal_data_t *prevcols, size_t *newrow,
+                          size_t *prevrow, size_t *num)
+{
+  size_t i, j, n, tsize;
+  gal_data_t *column, *prev, *conv;
+
+  /* Go over the output columns. */
+  for(column=columns; column!=NULL; column=column->next)
+    if( (column->flag & MKCATALOG_COLFLAG_MEASUREALL)==0 )
+      {
+        /* Find the previous column, and convert it to the same type. */
+        prev=incremental_prevcat_column(prevcols, column->name);
+        conv = ( prev->type==column->type
+                 ? prev
+                 : gal_data_copy_to_new_type(prev, column->type) );
+
+        /* Copy the values of the reused rows. */
+        tsize=gal_type_sizeof(column->type);
+        for(i=0;i<p->numobjects;++i)
+          if(p->prevrow[i]!=GAL_BLANK_SIZE_T)
+            {
+              n = num ? num[i] : 1;
+              for(j=0;j<n;++j)
+                memcpy(gal_pointer_increment(column->array,
+                                             (newrow ? newrow[i] : i) + j,
+                                             column->type),
+                       gal_pointer_increment(conv->array, prevrow[i]+j,
+                                             conv->type), tsize);
+            }
+
+        /* Clean up. */
+        if(conv!=prev) gal_data_free(conv);
+      }
+}
+
+
+
+
+
+/* Find the first row of the clumps of each reused object in the output
+   clumps catalog. When the reused objects were measured (for the columns
+   that couldn't be copied), their clumps are already in the catalog,
+   otherwise, their rows are placed after the clumps of the measured
+   objects (the clumps catalog is sorted by object afterwards, unless
+   '--noclumpsort' is called). */
+static size_t *
+incremental_merge_clump_rows(struct mkcatalogparams *p)
+{
+  int32_t label;
+  size_t i, j, r, *out;
+
+  /* Initialize the output. */
+  out=gal_pointer_allocate(GAL_TYPE_SIZE_T, p->numobjects, 0, __func__,
+                           "out");
+  for(i=0;i<p->numobjects;++i) out[i]=GAL_BLANK_SIZE_T;
+
+  /* Find (or allocate) the rows. */
+  if(p->incpartial)
+    for(r=0;r<p->clumprowsfilled;++r)
+      {
+        i = ( p->outlabsinv
+              ? p->outlabsinv[ p->hostobjid_c[r] ]
+              : p->hostobjid_c[r] - 1 );
+        if(out[i]==GAL_BLANK_SIZE_T) out[i]=r;
+      }
+  else
+    for(i=0;i<p->numobjects;++i)
+      if(p->prevrow[i]!=GAL_BLANK_SIZE_T)
+        {
+          label = p->outlabs ? p->outlabs[i] : i+1;
+          out[i]=p->clumprowsfilled;
+          p->numclumps_c[i]=p->prevcnum[i];
+          p->clumprowsfilled+=p->prevcnum[i];
+          if(p->clumprowsfilled>p->numclumps) break;
+          for(j=0;j<p->prevcnum[i];++j) p->hostobjid_c[ out[i]+j ]=label;
+        }
+
+  /* The number of clumps of each reused object should be the same in the
+     two runs. */
+  for(i=0;i<p->numobjects;++i)
+    if( p->prevrow[i]!=GAL_BLANK_SIZE_T
+        && p->numclumps_c[i]!=p->prevcnum[i] )
+      break;
+  if( i<p->numobjects || p->clumprowsfilled!=p->numclumps )
+    error(EXIT_FAILURE, 0, "%s: the number of clumps in the previous "
+          "clumps catalog is different from the previous clumps labeled "
+          "image (%s)", p->prevclumpscat, p->prevclumps);
+
+  /* Return the rows. */
+  return out;
+}
+
+
+
+
+
+/* Copy the rows of the reused objects (and their clumps) from the
+   previous catalog(s) into the output columns. This should be done after
+   all the processing on the measured objects is finished (for example the
+   WCS conversion). */
+void
+incremental_merge(struct mkcatalogparams *p)
+{
+  size_t *clumprow;
+
+  /* If nothing is reused, there is nothing to merge. */
+  if(p->prevrow==NULL) return;
+
+  /* The objects catalog. */
+  incremental_merge_columns(p, p->objectcols, p->prevcatcols, NULL,
+                            p->prevrow, NULL);
+
+  /* The clumps catalog. */
+  if(p->clumps)
+    {
+      clumprow=incremental_merge_clump_rows(p);
+      incremental_merge_columns(p, p->clumpcols, p->prevclumpcols,
+                                clumprow, p->prevcrow, p->prevcnum);
+      free(clumprow);
+    }
+
+  /* Clean up. */
+  gal_list_data_free(p->prevcatcols);
+  gal_list_data_free(p->prevclumpcols);
+  p->prevcatcols=p->prevclumpcols=NULL;
+}
@@ -0,0 +1,39 @@
+/*********************************************************************
+MakeCatalog - Make a catalog from an input and labeled image.
+MakeCatalog is part of GNU Astronomy Utilities (Gnuastro) package.
+
+Original author:
+     Mohammad Akhlaghi <mohammad@akhlaghi.org>
+Contributing author(s):
+Copyright (C) 2015-2023 Free Software Foundation, Inc.
+
+Gnuastro is free software: you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by the
+Free Software Foundation, either version 3 of the License, or (at your
+option) any later version.
+
+Gnuastro is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Gnuastro. If not, see <http://www.gnu.org/licenses/>.
+**********************************************************************/
+#ifndef INCREMENTAL_H
+#define INCREMENTAL_H
+
+void
+incremental_write_keys(struct mkcatalogparams *p,
+                       gal_fits_list_key_t **keylist);
+
+void
+incremental_prepare(struct mkcatalogparams *p);
+
+void
+incremental_plan(struct mkcatalogparams *p);
+
+void
+incremental_merge(struct mkcatalogparams *p);
+
+#endif
@@ -41,10 +41,25 @@ along with Gnuastro. If not, see <http://www.gnu.org/licenses/>.
 #define MKCATALOG_UPPERLIMIT_MAXFAILS_MULTIP 10
 
 
+/* Minimum number of pixels in an object's tile for it to be processed
+   with all threads (nested parallelism). */
+#define MKCATALOG_NESTED_MINSIZE 10000
+
+
 /* Unit string to use if values dataset doesn't have any. */
 #define MKCATALOG_NO_UNIT "input-units"
 
 
+/* Flags of the output columns (kept in the 'flag' element of each
+   column): the column needs the order-based measurements, the column
+   needs the upper-limit measurements, or (in incremental mode) the column
+   should be measured for all objects (it can't be copied from the
+   previous catalog). */
+#define MKCATALOG_COLFLAG_ORDERBASED  ( GAL_DATA_FLAG_MAXFLAG << 1 )
+#define MKCATALOG_COLFLAG_UPPERLIMIT  ( GAL_DATA_FLAG_MAXFLAG << 2 )
+#define MKCATALOG_COLFLAG_MEASUREALL  ( GAL_DATA_FLAG_MAXFLAG << 3 )
+
+
 
 /* Intermediate/raw array elements
    ===============================
@@ -208,6 +223,27 @@ enum clumpcols
 
 
 
+/* Checksums of the inputs and configuration. They are written in the
+   output catalog's meta-data, so in incremental mode ('--prevcat'), the
+   inputs of a previous run can be compared with the current run. */
+enum incrementalsums
+  {
+    INCSUM_LABELS,       /* Object labels.                            */
+    INCSUM_CLUMPS,       /* Clump labels.                             */
+    INCSUM_VALUES,       /* Values (before subtracting the Sky).      */
+    INCSUM_SKY,          /* Sky (image or a single value).            */
+    INCSUM_STD,          /* Sky standard deviation (or variance).     */
+    INCSUM_CONFIG,       /* Options that affect the measurements.     */
+    INCSUM_UPPERLIMIT,   /* Upper-limit options and mask.             */
+
+    INCSUM_NUMBER,       /* SHOULD BE LAST: total number of checksums.*/
+  };
+
+
+
+
+
+
 /* Main program parameters structure */
 struct mkcatalogparams
 {
@@ -223,9 +259,20 @@ struct mkcatalogparams
   char                *skyhdu;  /* HDU of sky image.                    */
   char               *stdfile;  /* File name of sky STD file.           */
   char                *stdhdu;  /* HDU of sky STD image.                */
+  char               *prevcat;  /* Catalog of a previous run.           */
+  char            *prevcathdu;  /* HDU of previous catalog.             */
+  char            *prevlabels;  /* Labels used for previous catalog.    */
+  char         *prevlabelshdu;  /* HDU of previous labels.              */
+  char            *prevvalues;  /* Values used for previous catalog.    */
+  char         *prevvalueshdu;  /* HDU of previous values.              */
+  char            *prevclumps;  /* Clumps used for previous catalog.    */
+  char         *prevclumpshdu;  /* HDU of previous clumps.              */
+  char         *prevclumpscat;  /* Clumps catalog of a previous run.    */
+  char      *prevclumpscathdu;  /* HDU of previous clumps catalog.      */
 
   uint8_t           clumpscat;  /* ==1: create clumps catalog.          */
   uint8_t         noclumpsort;  /* Don't sort the clumps catalog.       */
+  uint8_t           checksums;  /* Write checksums of the inputs.       */
   float             zeropoint;  /* Zero-point magnitude of object.      */
   uint8_t            variance;  /* Input STD file is actually variance. */
   uint8_t        forcereadstd;  /* Read STD even if not needed.         */
@@ -257,6 +304,8 @@ struct mkcatalogparams
   gal_data_t             *sky;  /* Sky.                                 */
   gal_data_t             *std;  /* Sky standard deviation.              */
   gal_data_t          *upmask;  /* Upper limit magnitude mask.          */
+  gal_data_t           *upsum;  /* Upper limit: row-wise cumulative sum.*/
+  gal_data_t           *upbad;  /* Upper limit: cumulative num. unusable*/
   float                medstd;  /* Median standard deviation value.     */
   float               cpscorr;  /* Counts-per-second correction.        */
   int32_t            *outlabs;  /* Labels in output catalog (when necessary) */
@@ -274,6 +323,20 @@ struct mkcatalogparams
   uint8_t             *ciflag;  /* Intermediate flags for clumps.       */
   pthread_mutex_t       mutex;  /* Mutex to change the total numbers.   */
   size_t      clumprowsfilled;  /* No. filled clump rows at this moment.*/
+  size_t            *objorder;  /* Object indexs, largest tiles first.  */
+  size_t              nextobj;  /* Next element of 'objorder' to use.   */
+  size_t              numtodo;  /* Number of objects to measure.        */
+  size_t             *prevrow;  /* Row of object in prev. cat. (or blank)*/
+  size_t            *prevcrow;  /* First row of object's clumps in prev.*/
+  size_t            *prevcnum;  /* Number of object's clumps in prev.   */
+  gal_data_t     *prevcatcols;  /* Columns of the previous catalog.     */
+  gal_data_t   *prevclumpcols;  /* Columns of previous clumps catalog.  */
+  uint64_t  incsum[INCSUM_NUMBER];  /* Checksums of inputs and config.  */
+  uint64_t incprev[INCSUM_NUMBER];  /* Checksums of the previous run.   */
+  uint8_t        incanychange;  /* A label or value has changed.        */
+  uint8_t          incpartial;  /* Reused rows also need measurements.  */
+  uint8_t       incorderbased;  /* ... with order-based measurements.   */
+  uint8_t       incupperlimit;  /* ... with upper-limit measurements.   */
   gsl_rng                *rng;  /* Main random number generator.        */
   unsigned long int  rng_seed;  /* Random number generator seed.        */
   const char        *rng_name;  /* Name of random number generator.     */
@@ -303,6 +366,7 @@ struct mkcatalogparams
   uint8_t            hasblank;  /* Dataset has blank values.            */
   uint8_t              hasmag;  /* Catalog has magnitude columns.       */
   uint8_t          upperlimit;  /* Calculate upper limit magnitude.     */
+  uint8_t          orderbased;  /* Order-based measurements are needed. */
 };
 
 #endif
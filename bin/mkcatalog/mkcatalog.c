@@ -36,6 +36,7 @@ along with Gnuastro. If not, see <http://www.gnu.org/licenses/>.
 #include <gnuastro/data.h>
 #include <gnuastro/fits.h>
 #include <gnuastro/units.h>
+#include <gnuastro/qsort.h>
 #include <gnuastro/threads.h>
 #include <gnuastro/pointer.h>
 #include <gnuastro/dimension.h>
@@ -52,6 +53,7 @@ along with Gnuastro. If not, see <http://www.gnu.org/licenses/>.
 #include "parse.h"
 #include "columns.h"
 #include "upperlimit.h"
+#include "incremental.h"
 
 
 
@@ -90,125 +92,186 @@ mkcatalog_clump_starting_index(struct mkcatalog_passparams *pp)
 
 
 
-/* Each thread will call this function once. It will go over all the
-   objects that are assigned to it. */
-static void *
-mkcatalog_single_object(void *in_prm)
+/* Initialize the per-thread (or per-object in the nested case)
+   parameters. 'numthreads' is the number of threads that can be used
+   within the processing of a single object. */
+static void
+mkcatalog_passparams_init(struct mkcatalogparams *p,
+                          struct mkcatalog_passparams *pp,
+                          size_t numthreads)
 {
-  struct gal_threads_params *tprm=(struct gal_threads_params *)in_prm;
-  struct mkcatalogparams *p=(struct mkcatalogparams *)(tprm->params);
   size_t ndim=p->objects->ndim;
-
-  size_t i;
   uint8_t *oif=p->oiflag;
-  struct mkcatalog_passparams pp;
-
 
   /* Initialize the mkcatalog_passparams elements. */
-  pp.p               = p;
-  pp.clumpstartindex = 0;
-  pp.rng             = p->rng ? gsl_rng_clone(p->rng) : NULL;
-  pp.oi              = gal_pointer_allocate(GAL_TYPE_FLOAT64, OCOL_NUMCOLS,
-                                            0, __func__, "pp.oi");
+  pp->p               = p;
+  pp->clumpstartindex = 0;
+  pp->numthreads      = numthreads;
+  pp->rng             = p->rng ? gsl_rng_clone(p->rng) : NULL;
+  pp->oi              = gal_pointer_allocate(GAL_TYPE_FLOAT64, OCOL_NUMCOLS,
+                                             0, __func__, "pp->oi");
+
+  /* The buffers for order-based measurements will be allocated (and
+     possibly enlarged) for each object in the first pass. */
+  pp->ordnum=pp->ordsize=0;
+  pp->ordvals=NULL;
+  pp->ordclab=NULL;
 
   /* If we have second order measurements, allocate the array keeping the
      temporary shift values for each object of this thread. Note that the
      clumps catalog (if requested), will have the same measurements, so its
      just enough to check the objects. */
-  pp.shift = ( ( oif[    OCOL_GXX ]
-                 || oif[ OCOL_GYY ]
-                 || oif[ OCOL_GXY ]
-                 || oif[ OCOL_VXX ]
-                 || oif[ OCOL_VYY ]
-                 || oif[ OCOL_VXY ] )
-               ? gal_pointer_allocate(GAL_TYPE_SIZE_T, ndim, 0, __func__,
-                                       "pp.shift")
-               : NULL );
+  pp->shift = ( ( oif[    OCOL_GXX ]
+                  || oif[ OCOL_GYY ]
+                  || oif[ OCOL_GXY ]
+                  || oif[ OCOL_VXX ]
+                  || oif[ OCOL_VYY ]
+                  || oif[ OCOL_VXY ] )
+                ? gal_pointer_allocate(GAL_TYPE_SIZE_T, ndim, 0, __func__,
+                                       "pp->shift")
+                : NULL );
 
   /* If we have upper-limit mode, then allocate the container to keep the
      values to calculate the standard deviation. */
   if(p->upperlimit)
     {
       /* Allocate the space to keep the upper-limit values. */
-      pp.up_vals = gal_data_alloc(NULL, GAL_TYPE_FLOAT32, 1, &p->upnum,
-                                  NULL, 0, p->cp.minmapsize, p->cp.quietmmap,
-                                  NULL, NULL, NULL);
+      pp->up_vals = gal_data_alloc(NULL, GAL_TYPE_FLOAT32, 1, &p->upnum,
+                                   NULL, 0, p->cp.minmapsize,
+                                   p->cp.quietmmap, NULL, NULL, NULL);
 
       /* Set the blank checked flag to 1. By definition, this dataset won't
          have any blank values. Also 'flag' is initialized to '0'. So we
          just have to set the checked flag ('GAL_DATA_FLAG_BLANK_CH') to
          one to inform later steps that there are no blank values. */
-      pp.up_vals->flag |= GAL_DATA_FLAG_BLANK_CH;
+      pp->up_vals->flag |= GAL_DATA_FLAG_BLANK_CH;
     }
   else
-    pp.up_vals=NULL;
+    pp->up_vals=NULL;
+}
+
+
 
-  /* Fill the desired columns for all the objects given to this thread. */
-  for(i=0; tprm->indexs[i]!=GAL_BLANK_SIZE_T; ++i)
-    {
-      /* For easy reading. Note that the object IDs start from one while
-         the array positions start from 0. */
-      pp.ci       = NULL;
-      pp.object   = ( p->outlabs
-                      ? p->outlabs[ tprm->indexs[i] ]
-                      : tprm->indexs[i] + 1 );
-      pp.tile     = &p->tiles[   tprm->indexs[i] ];
-      pp.spectrum = &p->spectra[ tprm->indexs[i] ];
-
-      /* Initialize the parameters for this object/tile. */
-      parse_initialize(&pp);
-
-      /* Get the first pass information. */
-      parse_objects(&pp);
-
-      /* Currently the second pass is only necessary when there is a clumps
-         image. */
-      if(p->clumps)
-        {
-          /* Allocate space for the properties of each clump. */
-          pp.ci = gal_pointer_allocate(GAL_TYPE_FLOAT64,
-                                       pp.clumpsinobj * CCOL_NUMCOLS, 1,
-                                       __func__, "pp.ci");
-
-          /* Get the starting row of this object's clumps in the final
-             catalog. This index is also necessary for the unique random
-             number generator seeds of each clump. */
-          mkcatalog_clump_starting_index(&pp);
-
-          /* Get the second pass information. */
-          parse_clumps(&pp);
-        }
 
-      /* If an order-based calculation is requested, another pass is
-         necessary. */
-      if( p->oiflag[ OCOL_MEDIAN ]
-          || p->oiflag[ OCOL_MAXIMUM ]
-          || p->oiflag[ OCOL_HALFMAXSUM ]
-          || p->oiflag[ OCOL_HALFMAXNUM ]
-          || p->oiflag[ OCOL_HALFSUMNUM ]
-          || p->oiflag[ OCOL_SIGCLIPNUM ]
-          || p->oiflag[ OCOL_SIGCLIPSTD ]
-          || p->oiflag[ OCOL_SIGCLIPMEAN ]
-          || p->oiflag[ OCOL_FRACMAX1NUM ]
-          || p->oiflag[ OCOL_FRACMAX2NUM ]
-          || p->oiflag[ OCOL_SIGCLIPMEDIAN ])
-        parse_order_based(&pp);
-
-      /* Calculate the upper limit magnitude (if necessary). */
-      if(p->upperlimit) upperlimit_calculate(&pp);
-
-      /* Write the pass information into the columns. */
-      columns_fill(&pp);
-
-      /* Clean up for this object. */
-      if(pp.ci) free(pp.ci);
-    }
+
+static void
+mkcatalog_passparams_free(struct mkcatalog_passparams *pp)
+{
+  free(pp->oi);
+  free(pp->shift);
+  if(pp->ordvals) free(pp->ordvals);
+  if(pp->ordclab) free(pp->ordclab);
+  gal_data_free(pp->up_vals);
+  if(pp->rng) gsl_rng_free(pp->rng);
+}
+
+
+
+
+
+/* Do all the measurements on the object with the given index (counting
+   from zero). */
+static void
+mkcatalog_one_object(struct mkcatalog_passparams *pp, size_t index)
+{
+  struct mkcatalogparams *p=pp->p;
+  int reused = p->prevrow && p->prevrow[index]!=GAL_BLANK_SIZE_T;
+
+  /* For easy reading. Note that the object IDs start from one while the
+     array positions start from 0. */
+  pp->ci       = NULL;
+  pp->object   = p->outlabs ? p->outlabs[ index ] : index + 1;
+  pp->tile     = &p->tiles[   index ];
+  pp->spectrum = &p->spectra[ index ];
+
+  /* Initialize the parameters for this object/tile. */
+  parse_initialize(pp);
+
+  /* Do the measurements on the pixels of the object and its clumps (the
+     space for the clump measurements, 'pp->ci', is allocated there). */
+  parse_objects(pp);
+
+  /* Get the starting row of this object's clumps in the final
+     catalog. This index is also necessary for the unique random number
+     generator seeds of each clump. */
+  if(p->clumps) mkcatalog_clump_starting_index(pp);
+
+  /* If an order-based calculation is requested, use the values that were
+     collected in the first pass. In incremental mode, the objects that are
+     reused from the previous catalog are only measured for the columns
+     that can't be copied from it (see 'incremental_plan'), so the
+     expensive steps are skipped when those columns don't need them. */
+  if( p->orderbased && (!reused || p->incorderbased) )
+    parse_order_based(pp);
+
+  /* Calculate the upper limit magnitude (if necessary). */
+  if( p->upperlimit && (!reused || p->incupperlimit) )
+    upperlimit_calculate(pp);
+
+  /* Write the pass information into the columns. */
+  columns_fill(pp);
+
+  /* Clean up for this object. */
+  if(pp->ci) free(pp->ci);
+}
+
+
+
+
+
+/* Return the index of the next object that should be processed, or
+   'GAL_BLANK_SIZE_T' when there are no more objects. Since the objects are
+   sorted by the size of their tiles (largest first), each thread will
+   take the next largest object as soon as it finishes its previous
+   one. */
+static size_t
+mkcatalog_next_object(struct mkcatalogparams *p)
+{
+  size_t out;
+
+  /* Lock the mutex if we are working on more than one thread. */
+  if(p->cp.numthreads>1)
+    pthread_mutex_lock(&p->mutex);
+
+  /* Get the next object and increment the counter. */
+  out = ( p->nextobj < p->numtodo
+          ? p->objorder[ p->nextobj++ ]
+          : GAL_BLANK_SIZE_T );
+
+  /* Unlock the mutex (if it was locked). */
+  if(p->cp.numthreads>1)
+    pthread_mutex_unlock(&p->mutex);
+
+  /* Return the index. */
+  return out;
+}
+
+
+
+
+
+/* Each thread will call this function once. Instead of a fixed set of
+   objects, it will keep taking the next object (from 'p->objorder') until
+   no more objects remain. So the index given to this thread (in
+   'tprm->indexs') is irrelevant here. */
+static void *
+mkcatalog_single_object(void *in_prm)
+{
+  struct gal_threads_params *tprm=(struct gal_threads_params *)in_prm;
+  struct mkcatalogparams *p=(struct mkcatalogparams *)(tprm->params);
+
+  size_t index;
+  struct mkcatalog_passparams pp;
+
+  /* Initialize the mkcatalog_passparams elements. */
+  mkcatalog_passparams_init(p, &pp, 1);
+
+  /* Fill the desired columns for all the objects given to this thread. */
+  while( (index=mkcatalog_next_object(p)) != GAL_BLANK_SIZE_T )
+    mkcatalog_one_object(&pp, index);
 
   /* Clean up. */
-  free(pp.oi);
-  free(pp.shift);
-  gal_data_free(pp.up_vals);
-  if(pp.rng) gsl_rng_free(pp.rng);
+  mkcatalog_passparams_free(&pp);
 
   /* Wait until all the threads finish and return. */
   if(tprm->b) pthread_barrier_wait(tprm->b);
@@ -219,6 +282,120 @@ mkcatalog_single_object(void *in_prm)
 
 
 
+/* Set the order that objects should be processed. Each object's
+   processing time is roughly proportional to the area of its tile, so we
+   want to start with the largest objects: if a large object is started
+   last, all the other threads will be idle until it finishes. In this
+   function, we also count the number of "big" objects: objects whose tile
+   is so large that they will take more time than the average time of each
+   thread. These objects will be processed one by one with all the threads
+   (nested parallelism) before the others.
+
+   When only one thread is requested, the original order is preserved (the
+   output clumps catalog is only sorted when there are multiple
+   threads). In incremental mode ('--prevcat'), only the objects that
+   should be measured ('p->numtodo') are put in the list: the reused
+   objects are only measured when some columns can't be copied from the
+   previous catalog. */
+static size_t
+mkcatalog_object_order(struct mkcatalogparams *p)
+{
+  size_t i, j=0, numbig=0;
+  uint64_t *tsize, total=0;
+
+  /* Allocate the array of object indexs. */
+  p->nextobj=0;
+  if(p->numtodo==0) return 0;
+  p->objorder=gal_pointer_allocate(GAL_TYPE_SIZE_T, p->numtodo, 0,
+                                   __func__, "p->objorder");
+  for(i=0;i<p->numobjects;++i)
+    if( p->prevrow==NULL || p->incpartial
+        || p->prevrow[i]==GAL_BLANK_SIZE_T )
+      p->objorder[j++]=i;
+
+  /* Nothing more is necessary with a single thread. */
+  if(p->cp.numthreads==1) return 0;
+
+  /* Put the size of each object's tile in an array and sort the indexs
+     based on it (largest first). */
+  tsize=gal_pointer_allocate(GAL_TYPE_UINT64, p->numobjects, 0, __func__,
+                             "tsize");
+  for(i=0;i<p->numtodo;++i)
+    total += tsize[ p->objorder[i] ] = p->tiles[ p->objorder[i] ].size;
+  gal_qsort_index_single=tsize;
+  qsort(p->objorder, p->numtodo, sizeof *p->objorder,
+        gal_qsort_index_single_uint64_d);
+
+  /* Count the big objects (that are at the start of the sorted list). */
+  for(i=0;i<p->numtodo;++i)
+    if( tsize[ p->objorder[i] ] > MKCATALOG_NESTED_MINSIZE
+        && tsize[ p->objorder[i] ] > total/p->cp.numthreads )
+      ++numbig;
+    else break;
+
+  /* Clean up and return. */
+  free(tsize);
+  return numbig;
+}
+
+
+
+
+
+/* Decide which passes over the pixels are necessary based on the
+   requested columns. The order-based measurements need all the values of
+   each object/clump, these are collected in the first pass over each
+   object (only when necessary), so a separate pass isn't needed. */
+static void
+mkcatalog_pass_plan(struct mkcatalogparams *p)
+{
+  p->orderbased = columns_order_based(p->oiflag);
+}
+
+
+
+
+
+/* Process all the objects. The big objects are processed first (one at a
+   time, but each one using all the threads internally), the rest are
+   distributed over the threads. */
+static void
+mkcatalog_all_objects(struct mkcatalogparams *p)
+{
+  size_t i, numbig;
+  struct mkcatalog_passparams pp;
+
+  /* Set the order of the objects. */
+  numbig=mkcatalog_object_order(p);
+
+  /* Process the big objects. */
+  if(numbig)
+    {
+      mkcatalog_passparams_init(p, &pp, p->cp.numthreads);
+      for(i=0;i<numbig;++i)
+        mkcatalog_one_object(&pp, p->objorder[ p->nextobj++ ]);
+      mkcatalog_passparams_free(&pp);
+    }
+
+  /* Process the remaining objects, where each thread takes a new object
+     once it is finished with the previous one. */
+  if(p->nextobj<p->numtodo)
+    gal_threads_spin_off(mkcatalog_single_object, p,
+                         ( p->numtodo-p->nextobj < p->cp.numthreads
+                           ? p->numtodo-p->nextobj
+                           : p->cp.numthreads ),
+                         p->cp.numthreads, p->cp.minmapsize,
+                         p->cp.quietmmap);
+
+  /* Clean up. */
+  free(p->objorder);
+  p->objorder=NULL;
+}
+
+
+
+
+
 
 
 
@@ -451,8 +628,9 @@ mkcatalog_outputs_keys(struct mkcatalogparams *p, int o0c1)
   float pixarea=NAN, fvalue;
   gal_fits_list_key_t *keylist=NULL;
 
-  /* First, add the file names. */
+  /* First, add the file names and the checksums of the inputs. */
   mkcatalog_outputs_keys_infiles(p, &keylist);
+  incremental_write_keys(p, &keylist);
 
   /* Type of catalog. */
   gal_fits_key_list_add_end(&keylist, GAL_TYPE_STRING, "CATTYPE", 0,
@@ -661,8 +839,8 @@ mkcatalog_write_outputs(struct mkcatalogparams *p)
       /* Reverse the comments list (so it is printed in the same order
          here), write the objects catalog and free the comments. */
       gal_list_str_reverse(&comments);
-      gal_table_write(p->objectcols, &keylist, NULL, p->cp.tableformat,
-                      p->objectsout, "OBJECTS", 0);
+      gal_table_write_threads(p->objectcols, &keylist, NULL, p->cp.tableformat,
+                              p->objectsout, "OBJECTS", 0, p->cp.numthreads);
       gal_list_str_free(comments, 1);
 
 
@@ -678,8 +856,9 @@ mkcatalog_write_outputs(struct mkcatalogparams *p)
              Reverse the comments list (so it is printed in the same order
              here), write the objects catalog and free the comments. */
           gal_list_str_reverse(&comments);
-          gal_table_write(p->clumpcols, NULL, comments, p->cp.tableformat,
-                          p->clumpsout, "CLUMPS", 0);
+          gal_table_write_threads(p->clumpcols, NULL, comments,
+                                  p->cp.tableformat, p->clumpsout, "CLUMPS", 0,
+                                  p->cp.numthreads);
           gal_list_str_free(comments, 1);
         }
     }
@@ -708,17 +887,18 @@ mkcatalog_write_outputs(struct mkcatalogparams *p)
               {
                 /* Write the table. */
                 sprintf(str, "SPECTRUM_%zu", i+1);
-                gal_table_write(&p->spectra[i], NULL, NULL,
-                                GAL_TABLE_FORMAT_BFITS,
-                                p->objectsout, str, 0);
+                gal_table_write_threads(&p->spectra[i], NULL, NULL,
+                                        GAL_TABLE_FORMAT_BFITS, p->objectsout,
+                                        str, 0, p->cp.numthreads);
               }
             else
               {
                 sprintf(str, "-spec-%zu.txt", i+1);
                 fname=gal_checkset_automatic_output(&p->cp, p->objectsout,
                                                     str);
-                gal_table_write(&p->spectra[i], NULL, NULL, GAL_TABLE_FORMAT_TXT,
-                                fname, NULL, 0);
+                gal_table_write_threads(&p->spectra[i], NULL, NULL,
+                                        GAL_TABLE_FORMAT_TXT, fname, NULL, 0,
+                                        p->cp.numthreads);
                 free(fname);
               }
           }
@@ -797,18 +977,35 @@ mkcatalog(struct mkcatalogparams *p)
      it to assign a column to the clumps in the final catalog. */
   if( p->cp.numthreads > 1 ) pthread_mutex_init(&p->mutex, NULL);
 
+  /* Set the necessary passes over each object. */
+  mkcatalog_pass_plan(p);
+
+  /* Prepare the row-wise cumulative arrays that are necessary for the
+     upper-limit measurements. */
+  if(p->upperlimit) upperlimit_cumulative(p);
+
   /* Do the processing on each thread. */
-  gal_threads_spin_off(mkcatalog_single_object, p, p->numobjects,
-                       p->cp.numthreads, p->cp.minmapsize,
-                       p->cp.quietmmap);
+  mkcatalog_all_objects(p);
+
+  /* The upper-limit cumulative arrays are no longer necessary. */
+  if(p->upperlimit)
+    {
+      gal_data_free(p->upsum);
+      gal_data_free(p->upbad);
+      p->upsum=p->upbad=NULL;
+    }
 
   /* Post-thread processing, for example to convert image coordinates to RA
      and Dec. */
   mkcatalog_wcs_conversion(p);
 
+  /* In incremental mode, copy the reused objects (and their clumps) from
+     the previous catalog(s). */
+  incremental_merge(p);
+
   /* If the columns need to be sorted (by object ID), then some adjustments
      need to be made (possibly to both the objects and clumps catalogs). */
-  if(p->hostobjid_c)
+  if(p->hostobjid_c && !p->noclumpsort)
     sort_clumps_by_objid(p);
 
   /* Write the filled columns into the output. */
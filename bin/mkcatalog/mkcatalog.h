@@ -42,6 +42,11 @@ struct mkcatalog_passparams
   size_t    clumpstartindex;    /* Clump starting row in final catalog. */
   gal_data_t       *up_vals;    /* Container for upper-limit values.    */
   gal_data_t      *spectrum;    /* Spectrum of each object.             */
+  size_t         numthreads;    /* Threads to use within this object.   */
+  float            *ordvals;    /* Usable values for order statistics.  */
+  int32_t          *ordclab;    /* Clump label of each 'ordvals' element*/
+  size_t             ordnum;    /* Number of elements in 'ordvals'.     */
+  size_t            ordsize;    /* Allocated size of 'ordvals'.         */
 };
 
 void
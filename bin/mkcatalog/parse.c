@@ -31,6 +31,7 @@ along with Gnuastro. If not, see <http://www.gnu.org/licenses/>.
 #include <stdlib.h>
 
 #include <gnuastro/data.h>
+#include <gnuastro/threads.h>
 #include <gnuastro/pointer.h>
 #include <gnuastro/dimension.h>
 #include <gnuastro/statistics.h>
@@ -431,6 +432,474 @@ parse_spectrum(struct mkcatalog_passparams *pp, gal_data_t *xybin)
 
 
 
+/* Prepare the buffers that keep the values of each object for the
+   order-based measurements. These are allocated once for each thread and
+   are only enlarged when the tile of an object is larger than the
+   allocated space (the number of usable values in an object can't be
+   larger than its tile's size). */
+static void
+parse_order_buffers(struct mkcatalog_passparams *pp)
+{
+  struct mkcatalogparams *p=pp->p;
+  size_t size=pp->tile->size;
+
+  /* Re-allocate the buffers if necessary. */
+  if(size>pp->ordsize)
+    {
+      if(pp->ordvals) free(pp->ordvals);
+      if(pp->ordclab) free(pp->ordclab);
+      pp->ordvals=gal_pointer_allocate(GAL_TYPE_FLOAT32, size, 0, __func__,
+                                       "pp->ordvals");
+      pp->ordclab = ( p->clumps
+                      ? gal_pointer_allocate(GAL_TYPE_INT32, size, 0,
+                                             __func__, "pp->ordclab")
+                      : NULL );
+      pp->ordsize=size;
+    }
+
+  /* Reset the counter. */
+  pp->ordnum=0;
+}
+
+
+
+
+
+/* Per-object state of the clump measurements. The clumps are measured in
+   the same pass over the pixels as the object, but the number of clumps
+   in an object is only known after parsing all its pixels. So the
+   per-clump arrays are enlarged when a larger clump label is found. */
+struct parse_clumps_params
+{
+  size_t             num;  /* Number of clumps with allocated space.    */
+  uint8_t         dominv;  /* ==1: the minimum value is necessary.      */
+  uint8_t         domaxv;  /* ==1: the maximum value is necessary.      */
+  uint8_t           doxy;  /* ==1: the XY projections are necessary.    */
+  double       *minima_v;  /* Minimum value of each clump.              */
+  double       *maxima_v;  /* Maximum value of each clump.              */
+  gal_data_t      *xybin;  /* XY projection of each clump.              */
+  size_t            nngb;  /* Number of neighbors of each pixel.        */
+  size_t           *dinc;  /* Increments for neighbor parsing.          */
+  int32_t       *ngblabs;  /* Clump labels that touch a river pixel.    */
+};
+
+
+
+
+
+/* Return 1 if the coordinates of the clump pixels are necessary. */
+static int
+parse_clumps_need_coord(uint8_t *cif)
+{
+  return ( cif[    CCOL_GX      ]
+           || cif[ CCOL_GY      ]
+           || cif[ CCOL_GZ      ]
+           || cif[ CCOL_VX      ]
+           || cif[ CCOL_VY      ]
+           || cif[ CCOL_VZ      ]
+           || cif[ CCOL_MINX    ]
+           || cif[ CCOL_MAXX    ]
+           || cif[ CCOL_MINY    ]
+           || cif[ CCOL_MAXY    ]
+           || cif[ CCOL_MINZ    ]
+           || cif[ CCOL_MAXZ    ]
+           || cif[ CCOL_MINVX   ]
+           || cif[ CCOL_MAXVX   ]
+           || cif[ CCOL_MINVY   ]
+           || cif[ CCOL_MAXVY   ]
+           || cif[ CCOL_MINVZ   ]
+           || cif[ CCOL_MAXVZ   ]
+           || cif[ CCOL_MINVNUM ]
+           || cif[ CCOL_MAXVNUM ] );
+}
+
+
+
+
+
+/* Prepare the clump parameters of this object (no clump has any space
+   yet, it is allocated once the first clump label is seen). */
+static void
+parse_clumps_init(struct mkcatalog_passparams *pp,
+                  struct parse_clumps_params *cp)
+{
+  struct mkcatalogparams *p=pp->p;
+  uint8_t *cif=p->ciflag;
+  size_t ndim=p->objects->ndim;
+
+  /* Initialize the parameters. */
+  memset(cp, 0, sizeof *cp);
+  cp->dominv = ( cif[    CCOL_MINVNUM ] || cif[ CCOL_MINVX ]
+                 || cif[ CCOL_MINVY   ] || cif[ CCOL_MINVZ ] );
+  cp->domaxv = ( cif[    CCOL_MAXVNUM ] || cif[ CCOL_MAXVX ]
+                 || cif[ CCOL_MAXVY   ] || cif[ CCOL_MAXVZ ] );
+  cp->doxy   = cif[ CCOL_NUMALLXY ] || cif[ CCOL_NUMXY ];
+
+  /* Preparations for neighbor parsing. */
+  if( cif[    CCOL_RIV_NUM     ]
+      || cif[ CCOL_RIV_SUM     ]
+      || cif[ CCOL_RIV_SUM_VAR ] )
+    {
+      cp->nngb=gal_dimension_num_neighbors(ndim);
+      cp->ngblabs=gal_pointer_allocate(GAL_TYPE_INT32, cp->nngb, 0,
+                                       __func__, "cp->ngblabs");
+      cp->dinc=gal_dimension_increment(ndim, p->objects->dsize);
+    }
+}
+
+
+
+
+
+/* Make sure there is space for the measurements of 'num' clumps. The
+   intermediate values of the new clumps are initialized to zero and their
+   extrema to values that will be replaced by the first pixel. */
+static void
+parse_clumps_grow(struct mkcatalog_passparams *pp,
+                  struct parse_clumps_params *cp, size_t num)
+{
+  size_t i, newnum;
+  gal_data_t *xybin;
+  struct mkcatalogparams *p=pp->p;
+
+  /* If there is already enough space, then don't continue. To avoid too
+     many re-allocations, the space is at least doubled. */
+  if(num<=cp->num) return;
+  newnum = 2*cp->num > num ? 2*cp->num : num;
+
+  /* Intermediate values of each clump. */
+  errno=0;
+  pp->ci=realloc(pp->ci, newnum*CCOL_NUMCOLS*sizeof *pp->ci);
+  if(pp->ci==NULL)
+    error(EXIT_FAILURE, errno, "%s: %zu bytes for 'pp->ci'", __func__,
+          newnum*CCOL_NUMCOLS*sizeof *pp->ci);
+  memset(&pp->ci[ cp->num * CCOL_NUMCOLS ], 0,
+         (newnum-cp->num)*CCOL_NUMCOLS*sizeof *pp->ci);
+
+  /* Value extrema. */
+  if(cp->dominv)
+    {
+      errno=0;
+      cp->minima_v=realloc(cp->minima_v, newnum*sizeof *cp->minima_v);
+      if(cp->minima_v==NULL)
+        error(EXIT_FAILURE, errno, "%s: %zu bytes for 'cp->minima_v'",
+              __func__, newnum*sizeof *cp->minima_v);
+      for(i=cp->num;i<newnum;++i) cp->minima_v[i]=FLT_MAX;
+    }
+  if(cp->domaxv)
+    {
+      errno=0;
+      cp->maxima_v=realloc(cp->maxima_v, newnum*sizeof *cp->maxima_v);
+      if(cp->maxima_v==NULL)
+        error(EXIT_FAILURE, errno, "%s: %zu bytes for 'cp->maxima_v'",
+              __func__, newnum*sizeof *cp->maxima_v);
+      for(i=cp->num;i<newnum;++i) cp->maxima_v[i]=-FLT_MAX;
+    }
+
+  /* XY projections: the already allocated projections are kept (only the
+     array of data structures is re-allocated). */
+  if(cp->doxy)
+    {
+      xybin=gal_data_array_calloc(newnum);
+      if(cp->xybin)
+        {
+          memcpy(xybin, cp->xybin, cp->num*sizeof *xybin);
+          free(cp->xybin);
+        }
+      for(i=cp->num;i<newnum;++i)
+        gal_data_initialize(&xybin[i], NULL, GAL_TYPE_UINT8, 2,
+                            &pp->tile->dsize[1], NULL, 1, p->cp.minmapsize,
+                            p->cp.quietmmap, NULL, NULL, NULL);
+      cp->xybin=xybin;
+    }
+
+  /* Keep the new number. */
+  cp->num=newnum;
+}
+
+
+
+
+
+/* Macro to help in finding the minimum and maximum coordinates. */
+#define CMIN(COL, DIM) ( ci[ CCOL_NUMALL ]==1.0f                        \
+                         ? (c[ DIM ]+1)                                 \
+                         : ( (c[ DIM ]+1) < ci[ COL ]                   \
+                             ? (c[ DIM ]+1) : ci[ COL ] ) )
+#define CMAX(COL, DIM) ( ci[ CCOL_NUMALL ]==1.0f                        \
+                         ? (c[ DIM ]+1)                                 \
+                         : ( (c[ DIM ]+1) > ci[ COL ]                   \
+                             ? (c[ DIM ]+1) : ci[ COL ] ) )
+
+/* Measurements on a pixel of the object that is on a clump. The
+   coordinates ('c' and 'sc') and tile ID ('tid') of this pixel have
+   already been found in 'parse_objects'. */
+static void
+parse_clumps_pixel(struct mkcatalog_passparams *pp,
+                   struct parse_clumps_params *cp, int32_t *C, float *V,
+                   float *SK, float *ST, size_t *c, size_t *sc, size_t tid,
+                   size_t pind, uint8_t goodvalue)
+{
+  struct mkcatalogparams *p=pp->p;
+  size_t ndim=p->objects->ndim;
+
+  double *ci;
+  float var, sval, varval, skyval;
+  uint8_t *cif=p->ciflag;
+  float *std=p->std?p->std->array:NULL, *sky=p->sky?p->sky->array:NULL;
+
+  /* Pointer to make things easier. Note that the clump labels start from
+     1, but the array indexs from 0.*/
+  size_t cind = *C-1;
+  parse_clumps_grow(pp, cp, *C);
+  ci=&pp->ci[ cind * CCOL_NUMCOLS ];
+
+  /* Add to the area of this clump. */
+  if( cif[ CCOL_NUMALL ]
+      || cif[ CCOL_MINX ] || cif[ CCOL_MAXX ]
+      || cif[ CCOL_MINY ] || cif[ CCOL_MAXY ]
+      || cif[ CCOL_MINZ ] || cif[ CCOL_MAXZ ] )
+    ci[ CCOL_NUMALL ]++;
+  if(cif[ CCOL_NUMALLXY ])
+    ((uint8_t *)(cp->xybin[cind].array))[ pind ] = 1;
+
+  /* Raw-position related measurements. */
+  if(c)
+    {
+      /* Position extrema measurements. */
+      if(cif[ CCOL_MINX ]) ci[CCOL_MINX]=CMIN(CCOL_MINX, ndim-1);
+      if(cif[ CCOL_MAXX ]) ci[CCOL_MAXX]=CMAX(CCOL_MAXX, ndim-1);
+      if(cif[ CCOL_MINY ]) ci[CCOL_MINY]=CMIN(CCOL_MINY, ndim-2);
+      if(cif[ CCOL_MAXY ]) ci[CCOL_MAXY]=CMAX(CCOL_MAXY, ndim-2);
+      if(cif[ CCOL_MINZ ]) ci[CCOL_MINZ]=CMIN(CCOL_MINZ, ndim-3);
+      if(cif[ CCOL_MAXZ ]) ci[CCOL_MAXZ]=CMAX(CCOL_MAXZ, ndim-3);
+
+      /* General geometric (independent of pixel value) calculations. */
+      if(cif[ CCOL_GX ]) ci[ CCOL_GX ] += c[ ndim-1 ]+1;
+      if(cif[ CCOL_GY ]) ci[ CCOL_GY ] += c[ ndim-2 ]+1;
+      if(cif[ CCOL_GZ ]) ci[ CCOL_GZ ] += c[ ndim-3 ]+1;
+      if(pp->shift)
+        {
+          /* Raw second-order measurements. */
+          ci[ CCOL_GXX ] += sc[1] * sc[1];
+          ci[ CCOL_GYY ] += sc[0] * sc[0];
+          ci[ CCOL_GXY ] += sc[1] * sc[0];
+        }
+    }
+
+  /* Value related measurements, see 'parse_objects' for comments. */
+  if(goodvalue)
+    {
+      /* Fill in the necessary information. */
+      if(cif[ CCOL_NUM   ]) ci[ CCOL_NUM   ]++;
+      if(cif[ CCOL_SUM   ]) ci[ CCOL_SUM   ] += *V;
+      if(cif[ CCOL_SUMP2 ]) ci[ CCOL_SUMP2 ] += *V * *V;
+      if(cif[ CCOL_NUMXY ])
+        ((uint8_t *)(cp->xybin[cind].array))[ pind ] = 2;
+
+      /* Minimum/maximum pixel positions. */
+      if( cif[ CCOL_MINVNUM ] && *V<=cp->minima_v[cind] )
+        {
+          if( *V<cp->minima_v[cind] )
+            {
+              cp->minima_v[cind] = *V;
+              ci[ CCOL_MINVNUM ]=1;
+              if(cif[CCOL_MINVX]) ci[ CCOL_MINVX ] = c[ ndim-1 ]+1;
+              if(cif[CCOL_MINVY]) ci[ CCOL_MINVY ] = c[ ndim-2 ]+1;
+              if(cif[CCOL_MINVZ]) ci[ CCOL_MINVZ ] = c[ ndim-3 ]+1;
+            }
+          else
+            {
+              ci[ CCOL_MINVNUM ]++;
+              if(cif[CCOL_MINVX]) ci[ CCOL_MINVX ] += c[ ndim-1 ]+1;
+              if(cif[CCOL_MINVY]) ci[ CCOL_MINVY ] += c[ ndim-2 ]+1;
+              if(cif[CCOL_MINVZ]) ci[ CCOL_MINVZ ] += c[ ndim-3 ]+1;
+            }
+        }
+      if( cif[ CCOL_MAXVNUM ] && *V>=cp->maxima_v[cind] )
+        {
+          if( *V>cp->maxima_v[cind] )
+            {
+              cp->maxima_v[cind] = *V;
+              ci[ CCOL_MAXVNUM ]=1;
+              if(cif[CCOL_MAXVX]) ci[ CCOL_MAXVX ] = c[ ndim-1 ]+1;
+              if(cif[CCOL_MAXVY]) ci[ CCOL_MAXVY ] = c[ ndim-2 ]+1;
+              if(cif[CCOL_MAXVZ]) ci[ CCOL_MAXVZ ] = c[ ndim-3 ]+1;
+            }
+          else
+            {
+              ci[ CCOL_MAXVNUM ]++;
+              if(cif[CCOL_MAXVX]) ci[ CCOL_MAXVX ] += c[ ndim-1 ]+1;
+              if(cif[CCOL_MAXVY]) ci[ CCOL_MAXVY ] += c[ ndim-2 ]+1;
+              if(cif[CCOL_MAXVZ]) ci[ CCOL_MAXVZ ] += c[ ndim-3 ]+1;
+            }
+        }
+
+      /* Columns that need positive values. */
+      if( *V > 0.0f )
+        {
+          if(cif[ CCOL_NUMWHT ]) ci[ CCOL_NUMWHT ]++;
+          if(cif[ CCOL_SUMWHT ]) ci[ CCOL_SUMWHT ] += *V;
+          if(cif[ CCOL_VX ]) ci[ CCOL_VX ] += *V * (c[ ndim-1 ]+1);
+          if(cif[ CCOL_VY ]) ci[ CCOL_VY ] += *V * (c[ ndim-2 ]+1);
+          if(cif[ CCOL_VZ ]) ci[ CCOL_VZ ] += *V * (c[ ndim-3 ]+1);
+          if(pp->shift)
+            {
+              ci[ CCOL_VXX ] += *V * sc[1] * sc[1];
+              ci[ CCOL_VYY ] += *V * sc[0] * sc[0];
+              ci[ CCOL_VXY ] += *V * sc[1] * sc[0];
+            }
+        }
+    }
+
+  /* Sky based measurements. */
+  if(p->sky && cif[ CCOL_SUMSKY ])
+    {
+      skyval = ( pp->st_sky
+                 ? *SK             /* Full. */
+                 : ( p->sky->size>1
+                     ? sky[tid]    /* Tile. */
+                     : sky[0] ) ); /* 1 value. */
+      if(!isnan(skyval))
+        {
+          ci[ CCOL_NUMSKY  ]++;
+          ci[ CCOL_SUMSKY  ] += skyval;
+        }
+    }
+
+  /* Sky Standard deviation based measurements, see 'parse_objects' for
+     comments. */
+  if(p->std)
+    {
+      sval = pp->st_std ? *ST : (p->std->size>1 ? std[tid] : std[0]);
+      var = p->variance ? sval : sval*sval;
+      if(cif[ CCOL_SUMVAR  ] && (!isnan(var)))
+        {
+          ci[ CCOL_NUMVAR ]++;
+          ci[ CCOL_SUMVAR ] += var;
+        }
+      if(cif[ CCOL_SUM_VAR ] && goodvalue)
+        {
+          varval=p->variance ? var : sval;
+          if(!isnan(varval))
+            {
+              ci[ CCOL_SUM_VAR_NUM ]++;
+              ci[ CCOL_SUM_VAR     ] += varval + fabs(*V);
+            }
+        }
+    }
+}
+
+
+
+
+
+/* This pixel of the object is on the diffuse region. If any river-based
+   measurements are necessary, check to see if it is touching a clump or
+   not. The value of this pixel has to be added to any of the clumps it
+   touches. But since it might touch a labeled region more than once, we
+   use 'ngblabs' to keep track of which label we have already added its
+   value to. 'ii' is the number of different labels this river pixel has
+   already been considered for. The touching clump may not have been
+   reached yet, so space is also allocated for it here. */
+static void
+parse_clumps_river(struct mkcatalog_passparams *pp,
+                   struct parse_clumps_params *cp, int32_t *O, float *V,
+                   float *ST, size_t tid)
+{
+  struct mkcatalogparams *p=pp->p;
+  size_t ndim=p->objects->ndim, *dsize=p->objects->dsize;
+
+  int32_t nlab;
+  double *cir;
+  size_t i, ii=0;
+  float sval, *std=p->std?p->std->array:NULL;
+  int32_t *objects=p->objects->array, *clumps=p->clumps->array;
+  uint8_t *cif=p->ciflag;
+
+  /* Go over the neighbors and see if this pixel is touching a clump or
+     not. */
+  memset(cp->ngblabs, 0, cp->nngb*sizeof *cp->ngblabs);
+  GAL_DIMENSION_NEIGHBOR_OP(O-objects, ndim, dsize, ndim, cp->dinc,
+    {
+      /* Neighbor's label (mainly for easy reading). */
+      nlab=clumps[nind];
+
+      /* We only want neighbors that are a clump and part of this
+         object. */
+      if( nlab>0 && objects[nind]==pp->object)
+        {
+          /* Go over all already checked labels and make sure this clump
+             hasn't already been considered. */
+          for(i=0;i<ii;++i) if(cp->ngblabs[i]==nlab) break;
+
+          /* It hasn't been considered yet: */
+          if(i==ii)
+            {
+              /* Make sure it won't be considered any more. */
+              cp->ngblabs[ii++] = nlab;
+
+              /* To help in reading. */
+              parse_clumps_grow(pp, cp, nlab);
+              cir=&pp->ci[ (nlab-1) * CCOL_NUMCOLS ];
+
+              /* Write in the necessary values. */
+              if(cif[ CCOL_RIV_NUM  ]) cir[ CCOL_RIV_NUM ]++;
+              if(cif[ CCOL_RIV_SUM  ]) cir[ CCOL_RIV_SUM ] += *V;
+              if(cif[ CCOL_RIV_SUM_VAR  ])
+                {
+                  sval = ( pp->st_std
+                           ? *ST
+                           : ( p->std->size>1 ? std[tid] : std[0] ) );
+                  cir[ CCOL_RIV_SUM_VAR ] += fabs(*V)
+                    + (p->variance ? sval : sval*sval);
+                }
+            }
+        }
+    });
+}
+
+
+
+
+
+/* Write the higher-level clump columns and clean up. */
+static void
+parse_clumps_finish(struct mkcatalog_passparams *pp,
+                    struct parse_clumps_params *cp)
+{
+  size_t i;
+  double *ci;
+  uint8_t *u, *uf, *cif=pp->p->ciflag;
+
+  /* Write the XY projection columns. */
+  if(cp->xybin)
+    for(i=0;i<pp->clumpsinobj;++i)
+      {
+        /* Any non-zero pixel must be set for NUMALLXY. */
+        ci=&pp->ci[ i * CCOL_NUMCOLS ];
+        uf=(u=cp->xybin[i].array)+cp->xybin[i].size;
+        do
+          if(*u)
+            {
+              if(cif[ CCOL_NUMALLXY ]          ) ci[ CCOL_NUMALLXY ]++;
+              if(cif[ CCOL_NUMXY    ] && *u==2 ) ci[ CCOL_NUMXY    ]++;
+            }
+        while(++u<uf);
+      }
+
+  /* Clean up. */
+  if(cp->dinc) free(cp->dinc);
+  if(cp->ngblabs) free(cp->ngblabs);
+  if(cp->minima_v) free(cp->minima_v);
+  if(cp->maxima_v) free(cp->maxima_v);
+  if(cp->xybin) gal_data_array_free(cp->xybin, cp->num, 1);
+}
+
+
+
+
+
 void
 parse_objects(struct mkcatalog_passparams *pp)
 {
@@ -441,7 +910,8 @@ parse_objects(struct mkcatalog_passparams *pp)
   double *oi=pp->oi;
   gal_data_t *xybin=NULL;
   size_t *tsize=pp->tile->dsize;
-  uint8_t *u, *uf, goodvalue, *xybinarr=NULL;
+  struct parse_clumps_params cp;
+  uint8_t *u, *uf, doxy, goodvalue, *xybinarr=NULL;
   double minima_v=FLT_MAX, maxima_v=-FLT_MAX;
   size_t d, pind=0, increment=0, num_increment=1;
   int32_t *O, *OO, *C=NULL, *objarr=p->objects->array;
@@ -480,6 +950,8 @@ parse_objects(struct mkcatalog_passparams *pp)
                  || oif[ OCOL_MINVNUM ]
                  || oif[ OCOL_MAXVNUM ]
                  || sc
+                 /* Coordinate-related columns of the clumps. */
+                 || ( p->clumps && parse_clumps_need_coord(p->ciflag) )
                  /* When the sky and its STD are tiles, we'll also need
                     the coordinate to find which tile a pixel belongs
                     to. */
@@ -499,6 +971,16 @@ parse_objects(struct mkcatalog_passparams *pp)
       xybinarr=xybin->array;
     }
 
+  /* If order-based measurements are necessary, prepare the buffers to
+     keep the usable values (and their clump labels). */
+  if(p->orderbased) parse_order_buffers(pp);
+
+  /* The clumps are measured in the same pass. The projection index
+     ('pind') is necessary if the object or its clumps need the XY
+     projection. */
+  if(p->clumps) parse_clumps_init(pp, &cp);
+  doxy = xybin || (p->clumps && cp.doxy);
+
   /* Parse each contiguous patch of memory covered by this object. */
   while( pp->start_end_inc[0] + increment <= pp->start_end_inc[1] )
     {
@@ -576,6 +1058,14 @@ parse_objects(struct mkcatalog_passparams *pp)
                   /* For the standard-deviation measurements later. */
                   goodvalue=1;
 
+                  /* Keep the value for the order-based measurements. */
+                  if(pp->ordvals)
+                    {
+                      if(pp->ordclab)
+                        pp->ordclab[ pp->ordnum ] = *C>0 ? *C : 0;
+                      pp->ordvals[ pp->ordnum++ ] = *V;
+                    }
+
                   /* General flux summations. */
                   if(xybin) xybinarr[ pind ]=2;
                   if(oif[ OCOL_NUM ])   oi[ OCOL_NUM   ]++;
@@ -711,10 +1201,22 @@ parse_objects(struct mkcatalog_passparams *pp)
                         }
                     }
                 }
+
+
+              /* Clump measurements: pixels that are on a clump, or on the
+                 diffuse region (for the river measurements). */
+              if(p->clumps)
+                {
+                  if(*C>0)
+                    parse_clumps_pixel(pp, &cp, C, V, SK, ST, c, sc, tid,
+                                       pind, goodvalue);
+                  else if(cp.ngblabs)
+                    parse_clumps_river(pp, &cp, O, V, ST, tid);
+                }
             }
 
           /* Increment the other pointers. */
-          if( xybin                ) ++pind;
+          if( doxy                 ) ++pind;
           if( p->values            ) ++V;
           if( p->clumps            ) ++C;
           if( p->sky && pp->st_sky ) ++SK;
@@ -728,7 +1230,7 @@ parse_objects(struct mkcatalog_passparams *pp)
 
       /* If a 2D projection is requested, see if we should initialize (set
          to zero) the projection-index ('pind') not. */
-      if(xybin && (num_increment-1)%tsize[1]==0 )
+      if(doxy && (num_increment-1)%tsize[1]==0 )
         pind=0;
     }
 
@@ -758,6 +1260,9 @@ parse_objects(struct mkcatalog_passparams *pp)
   if(p->spectrum)
     parse_spectrum(pp, xybin);
 
+  /* Finish the clump measurements. */
+  if(p->clumps) parse_clumps_finish(pp, &cp);
+
   /* Clean up. */
   if(c)     free(c);
   if(sc)    free(sc);
@@ -768,457 +1273,6 @@ parse_objects(struct mkcatalog_passparams *pp)
 
 
 
-/* To keep the main function easier to read. */
-static void *
-parse_init_extrema(uint8_t *cif, uint8_t type, size_t num, int max1min0)
-{
-  void *out;
-  double *out_d;
-  size_t i, *out_s;
-
-  /* Allocate the array. */
-  out=gal_pointer_allocate(type, num, 0, __func__, "out");
-
-  /* Initialize the array. */
-  switch(type)
-    {
-    case GAL_TYPE_FLOAT64:
-      out_d=out;
-      for(i=0;i<num;++i) out_d[i]= max1min0 ? -FLT_MAX : FLT_MAX;
-      break;
-    case GAL_TYPE_SIZE_T:
-      out_s=out;
-      for(i=0;i<num;++i) out_s[i]= max1min0 ? 0 : GAL_BLANK_SIZE_T;
-      break;
-    default:
-      error(EXIT_FAILURE, 0, "%s: a bug! Please contact us at %s to fix "
-            "the problem. Type code %d isn't recognized", __func__,
-            PACKAGE_BUGREPORT, type);
-    }
-
-  /* Return the allocated array. */
-  return out;
-}
-
-
-
-
-
-
-/* Macro to help in finding the minimum and maximum coordinates. */
-#define CMIN(COL, DIM) ( ci[ CCOL_NUMALL ]==1.0f                        \
-                         ? (c[ DIM ]+1)                                 \
-                         : ( (c[ DIM ]+1) < ci[ COL ]                   \
-                             ? (c[ DIM ]+1) : ci[ COL ] ) )
-#define CMAX(COL, DIM) ( ci[ CCOL_NUMALL ]==1.0f                        \
-                         ? (c[ DIM ]+1)                                 \
-                         : ( (c[ DIM ]+1) > ci[ COL ]                   \
-                             ? (c[ DIM ]+1) : ci[ COL ] ) )
-
-/* Parse over the clumps within an object.  */
-void
-parse_clumps(struct mkcatalog_passparams *pp)
-{
-  struct mkcatalogparams *p=pp->p;
-  size_t ndim=p->objects->ndim, *dsize=p->objects->dsize;
-
-  double *ci, *cir;
-  gal_data_t *xybin=NULL;
-  int32_t *O, *OO, *C=NULL, nlab;
-  size_t cind, *tsize=pp->tile->dsize;
-  double *minima_v=NULL, *maxima_v=NULL;
-  uint8_t *u, *uf, goodvalue, *cif=p->ciflag;
-  size_t nngb=gal_dimension_num_neighbors(ndim);
-  size_t i, ii, d, pind=0, increment=0, num_increment=1;
-  float var, sval, varval, skyval, *V=NULL, *SK=NULL, *ST=NULL;
-  int32_t *objects=p->objects->array, *clumps=p->clumps->array;
-  float *std=p->std?p->std->array:NULL, *sky=p->sky?p->sky->array:NULL;
-
-  /* If tile processing isn't necessary, set 'tid' to a blank value. */
-  size_t tid = ( ( (p->sky     && p->sky->size>1 && pp->st_sky == NULL )
-                   || ( p->std && p->std->size>1 && pp->st_std == NULL ) )
-                 ? 0 : GAL_BLANK_SIZE_T );
-
-  /* Coordinate shift. */
-  size_t *sc = ( pp->shift
-                 ? gal_pointer_allocate(GAL_TYPE_SIZE_T, ndim, 0, __func__,
-                                        "sc")
-                 : NULL );
-
-  /* If any coordinate columns are requested. */
-  size_t *c = ( ( cif[    CCOL_GX    ]
-                  || cif[ CCOL_GY    ]
-                  || cif[ CCOL_GZ    ]
-                  || cif[ CCOL_VX    ]
-                  || cif[ CCOL_VY    ]
-                  || cif[ CCOL_VZ    ]
-                  || cif[ CCOL_MINX  ]
-                  || cif[ CCOL_MAXX  ]
-                  || cif[ CCOL_MINY  ]
-                  || cif[ CCOL_MAXY  ]
-                  || cif[ CCOL_MINZ  ]
-                  || cif[ CCOL_MAXZ  ]
-                  || cif[ CCOL_MINVX ]
-                  || cif[ CCOL_MAXVX ]
-                  || cif[ CCOL_MINVY ]
-                  || cif[ CCOL_MAXVY ]
-                  || cif[ CCOL_MINVZ ]
-                  || cif[ CCOL_MAXVZ ]
-                  || cif[ CCOL_MINVNUM ]
-                  || cif[ CCOL_MAXVNUM ]
-                  || sc
-                  || tid==GAL_BLANK_SIZE_T )
-                ? gal_pointer_allocate(GAL_TYPE_SIZE_T, ndim, 0, __func__,
-                                       "c")
-                : NULL );
-
-  /* Preparations for neighbor parsing. */
-  int32_t *ngblabs=( ( cif[    CCOL_RIV_NUM     ]
-                       || cif[ CCOL_RIV_SUM     ]
-                       || cif[ CCOL_RIV_SUM_VAR ] )
-                     ? gal_pointer_allocate(GAL_TYPE_INT32, nngb, 0,
-                                             __func__, "ngblabs")
-                     : NULL );
-  size_t *dinc = ngblabs ? gal_dimension_increment(ndim, dsize) : NULL;
-
-  /* If an XY projection area is requested, we'll need to allocate an array
-     to keep the projected space.*/
-  if( cif[    CCOL_NUMALLXY ]
-      || cif[ CCOL_NUMXY    ] )
-    {
-      xybin=gal_data_array_calloc(pp->clumpsinobj);
-      for(i=0;i<pp->clumpsinobj;++i)
-        gal_data_initialize(&xybin[i], NULL, GAL_TYPE_UINT8, 2, &tsize[1],
-                            NULL, 1, p->cp.minmapsize, p->cp.quietmmap,
-                            NULL, NULL, NULL);
-    }
-
-  /* For the extrema columns. */
-  if( cif[    CCOL_MINVNUM ] || cif[ CCOL_MINVX ]
-      || cif[ CCOL_MINVY   ] || cif[ CCOL_MINVZ ] )
-    minima_v=parse_init_extrema(cif, GAL_TYPE_FLOAT64, pp->clumpsinobj, 0);
-  if( cif[    CCOL_MAXVNUM ] || cif[ CCOL_MAXVX ]
-      || cif[ CCOL_MAXVY   ] || cif[ CCOL_MAXVZ ] )
-    maxima_v=parse_init_extrema(cif, GAL_TYPE_FLOAT64, pp->clumpsinobj, 1);
-
-  /* Parse each contiguous patch of memory covered by this object. */
-  while( pp->start_end_inc[0] + increment <= pp->start_end_inc[1] )
-    {
-      /* Set the contiguous range to parse. The pixel-to-pixel counting
-         along the fastest dimension will be done over the 'O' pointer. */
-      C = pp->st_c + increment;
-      if( p->values            ) V  = pp->st_v   + increment;
-      if( p->sky && pp->st_sky ) SK = pp->st_sky + increment;
-      if( p->std && pp->st_std ) ST = pp->st_std + increment;
-      OO = ( O = pp->st_o + increment ) + tsize[ndim-1];
-
-      /* Parse the tile */
-      do
-        {
-          /* If this pixel belongs to the requested object then do the
-             processing. */
-          if( *O==pp->object )
-            {
-              /* We are on a clump. */
-              if(p->clumps && *C>0)
-                {
-                  /* Pointer to make things easier. Note that the clump
-                     labels start from 1, but the array indexs from 0.*/
-                  cind = *C-1;
-                  ci=&pp->ci[ cind * CCOL_NUMCOLS ];
-
-                  /* Add to the area of this object. */
-                  if( cif[ CCOL_NUMALL ]
-                      || cif[ CCOL_MINX ] || cif[ CCOL_MAXX ]
-                      || cif[ CCOL_MINY ] || cif[ CCOL_MAXY ]
-                      || cif[ CCOL_MINZ ] || cif[ CCOL_MAXZ ] )
-                    ci[ CCOL_NUMALL ]++;
-                  if(cif[ CCOL_NUMALLXY ])
-                    ((uint8_t *)(xybin[cind].array))[ pind ] = 1;
-
-                  /* Raw-position related measurements. */
-                  if(c)
-                    {
-                      /* Get "C" the coordinates of this point. */
-                      gal_dimension_index_to_coord(O-objects, ndim, dsize, c);
-
-                      /* Position extrema measurements. */
-                      if(cif[ CCOL_MINX ])
-                        ci[CCOL_MINX]=CMIN(CCOL_MINX, ndim-1);
-                      if(cif[ CCOL_MAXX ])
-                        ci[CCOL_MAXX]=CMAX(CCOL_MAXX, ndim-1);
-                      if(cif[ CCOL_MINY ])
-                        ci[CCOL_MINY]=CMIN(CCOL_MINY, ndim-2);
-                      if(cif[ CCOL_MAXY ])
-                        ci[CCOL_MAXY]=CMAX(CCOL_MAXY, ndim-2);
-                      if(cif[ CCOL_MINZ ])
-                        ci[CCOL_MINZ]=CMIN(CCOL_MINZ, ndim-3);
-                      if(cif[ CCOL_MAXZ ])
-                        ci[CCOL_MAXZ]=CMAX(CCOL_MAXZ, ndim-3);
-
-                      /* If we need tile-ID, get the tile ID now. */
-                      if(tid!=GAL_BLANK_SIZE_T)
-                        tid=gal_tile_full_id_from_coord(&p->cp.tl, c);
-
-                      /* General geometric (independent of pixel value)
-                         calculations. */
-                      if(cif[ CCOL_GX ]) ci[ CCOL_GX ] += c[ ndim-1 ]+1;
-                      if(cif[ CCOL_GY ]) ci[ CCOL_GY ] += c[ ndim-2 ]+1;
-                      if(cif[ CCOL_GZ ]) ci[ CCOL_GZ ] += c[ ndim-3 ]+1;
-                      if(pp->shift)
-                        {
-                          /* Shifted coordinates for second order moments,
-                             see explanations in the first pass.*/
-                          for(d=0;d<ndim;++d) sc[d] = c[d] + 1 - pp->shift[d];
-
-                          /* Raw second-order measurements. */
-                          ci[ CCOL_GXX ] += sc[1] * sc[1];
-                          ci[ CCOL_GYY ] += sc[0] * sc[0];
-                          ci[ CCOL_GXY ] += sc[1] * sc[0];
-                        }
-                    }
-
-                  /* Value related measurements, see 'parse_objects' for
-                     comments. */
-                  goodvalue=0;
-                  if( p->values && !( p->hasblank && isnan(*V) ) )
-                    {
-                      /* For the standard-deviation measurement. */
-                      goodvalue=1;
-
-                      /* Fill in the necessary information. */
-                      if(cif[ CCOL_NUM   ]) ci[ CCOL_NUM   ]++;
-                      if(cif[ CCOL_SUM   ]) ci[ CCOL_SUM   ] += *V;
-                      if(cif[ CCOL_SUMP2 ]) ci[ CCOL_SUMP2 ] += *V * *V;
-                      if(cif[ CCOL_NUMXY ])
-                        ((uint8_t *)(xybin[cind].array))[ pind ] = 2;
-
-                      /* Minimum/maximum pixel positions. */
-                      if( cif[ CCOL_MINVNUM ] && *V<=minima_v[cind] )
-                        {
-                          if( *V<minima_v[cind] )
-                            {
-                              minima_v[cind] = *V;
-                              ci[ CCOL_MINVNUM ]=1;
-                              if(cif[CCOL_MINVX]) ci[ CCOL_MINVX ] = c[ ndim-1 ]+1;
-                              if(cif[CCOL_MINVY]) ci[ CCOL_MINVY ] = c[ ndim-2 ]+1;
-                              if(cif[CCOL_MINVZ]) ci[ CCOL_MINVZ ] = c[ ndim-3 ]+1;
-                            }
-                          else
-                            {
-                              ci[ CCOL_MINVNUM ]++;
-                              if(cif[CCOL_MINVX]) ci[ CCOL_MINVX ] += c[ ndim-1 ]+1;
-                              if(cif[CCOL_MINVY]) ci[ CCOL_MINVY ] += c[ ndim-2 ]+1;
-                              if(cif[CCOL_MINVZ]) ci[ CCOL_MINVZ ] += c[ ndim-3 ]+1;
-                            }
-                        }
-                      if( cif[ CCOL_MAXVNUM ] && *V>=maxima_v[cind] )
-                        {
-                          if( *V>maxima_v[cind] )
-                            {
-                              maxima_v[cind] = *V;
-                              ci[ CCOL_MAXVNUM ]=1;
-                              if(cif[CCOL_MAXVX]) ci[ CCOL_MAXVX ] = c[ ndim-1 ]+1;
-                              if(cif[CCOL_MAXVY]) ci[ CCOL_MAXVY ] = c[ ndim-2 ]+1;
-                              if(cif[CCOL_MAXVZ]) ci[ CCOL_MAXVZ ] = c[ ndim-3 ]+1;
-                            }
-                          else
-                            {
-                              ci[ CCOL_MAXVNUM ]++;
-                              if(cif[CCOL_MAXVX]) ci[ CCOL_MAXVX ] += c[ ndim-1 ]+1;
-                              if(cif[CCOL_MAXVY]) ci[ CCOL_MAXVY ] += c[ ndim-2 ]+1;
-                              if(cif[CCOL_MAXVZ]) ci[ CCOL_MAXVZ ] += c[ ndim-3 ]+1;
-                            }
-                        }
-
-                      /* Columns that need positive values. */
-                      if( *V > 0.0f )
-                        {
-                          if(cif[ CCOL_NUMWHT ]) ci[ CCOL_NUMWHT ]++;
-                          if(cif[ CCOL_SUMWHT ]) ci[ CCOL_SUMWHT ] += *V;
-                          if(cif[ CCOL_VX ])
-                            ci[   CCOL_VX ] += *V * (c[ ndim-1 ]+1);
-                          if(cif[ CCOL_VY ])
-                            ci[   CCOL_VY ] += *V * (c[ ndim-2 ]+1);
-                          if(cif[ CCOL_VZ ])
-                            ci[   CCOL_VZ ] += *V * (c[ ndim-3 ]+1);
-                          if(pp->shift)
-                            {
-                              ci[ CCOL_VXX ] += *V * sc[1] * sc[1];
-                              ci[ CCOL_VYY ] += *V * sc[0] * sc[0];
-                              ci[ CCOL_VXY ] += *V * sc[1] * sc[0];
-                            }
-                        }
-                    }
-
-                  /* Sky based measurements. */
-                  if(p->sky && cif[ CCOL_SUMSKY ])
-                    {
-                      skyval = ( pp->st_sky
-                                 ? *SK             /* Full. */
-                                 : ( p->sky->size>1
-                                     ? sky[tid]    /* Tile. */
-                                     : sky[0] ) ); /* 1 value. */
-                      if(!isnan(skyval))
-                        {
-                          ci[ CCOL_NUMSKY  ]++;
-                          ci[ CCOL_SUMSKY  ] += skyval;
-                        }
-                    }
-
-                  /* Sky Standard deviation based measurements, see
-                     'parse_objects' for comments. */
-                  if(p->std)
-                    {
-                      sval = ( pp->st_std
-                               ? *ST
-                               : (p->std->size>1 ? std[tid] : std[0]) );
-                      var = p->variance ? sval : sval*sval;
-                      if(cif[ CCOL_SUMVAR  ] && (!isnan(var)))
-                        {
-                          ci[ CCOL_NUMVAR ]++;
-                          ci[ CCOL_SUMVAR ] += var;
-                        }
-                      if(cif[ CCOL_SUM_VAR ] && goodvalue)
-                        {
-                          varval=p->variance ? var : sval;
-                          if(!isnan(varval))
-                            {
-                              ci[ CCOL_SUM_VAR_NUM ]++;
-                              ci[ CCOL_SUM_VAR     ] += varval + fabs(*V);
-                            }
-                        }
-                    }
-                }
-
-              /* This pixel is on the diffuse region (and the object
-                 actually has clumps). If any river-based measurements are
-                 necessary check to see if it is touching a clump or not,
-                 but only if this object actually has any clumps. */
-              else if(ngblabs && pp->clumpsinobj)
-                {
-                  /* We are on a diffuse (possibly a river) pixel. So the
-                     value of this pixel has to be added to any of the
-                     clumps in touches. But since it might touch a labeled
-                     region more than once, we use 'ngblabs' to keep track
-                     of which label we have already added its value
-                     to. 'ii' is the number of different labels this river
-                     pixel has already been considered for. 'ngblabs' will
-                     keep the list labels. */
-                  ii=0;
-                  memset(ngblabs, 0, nngb*sizeof *ngblabs);
-
-                  /* Go over the neighbors and see if this pixel is
-                     touching a clump or not. */
-                  GAL_DIMENSION_NEIGHBOR_OP(O-objects, ndim, dsize, ndim,
-                                            dinc,
-                     {
-                       /* Neighbor's label (mainly for easy reading). */
-                       nlab=clumps[nind];
-
-                       /* We only want neighbors that are a clump and part
-                          of this object and part of the same object. */
-                       if( nlab>0 && objects[nind]==pp->object)
-                         {
-                           /* Go over all already checked labels and make
-                              sure this clump hasn't already been
-                              considered. */
-                           for(i=0;i<ii;++i) if(ngblabs[i]==nlab) break;
-
-                           /* It hasn't been considered yet: */
-                           if(i==ii)
-                             {
-                               /* Make sure it won't be considered any
-                                  more. */
-                               ngblabs[ii++] = nlab;
-
-                               /* To help in reading. */
-                               cir=&pp->ci[ (nlab-1) * CCOL_NUMCOLS ];
-
-                               /* Write in the necessary values. */
-                               if(cif[ CCOL_RIV_NUM  ])
-                                 cir[ CCOL_RIV_NUM ]++;
-
-                               if(cif[ CCOL_RIV_SUM  ])
-                                 cir[ CCOL_RIV_SUM ] += *V;
-
-                               if(cif[ CCOL_RIV_SUM_VAR  ])
-                                 {
-                                   sval = ( pp->st_std
-                                            ? *ST
-                                            : ( p->std->size>1
-                                                ? std[tid]
-                                                : std[0] )     );
-                                   cir[ CCOL_RIV_SUM_VAR ] += fabs(*V)
-                                     + (p->variance ? sval : sval*sval);
-                                 }
-                             }
-                         }
-                     });
-                }
-            }
-
-          /* Increment the other pointers. */
-          ++C;
-          if( xybin                ) ++pind;
-          if( p->values            ) ++V;
-          if( p->sky && pp->st_sky ) ++SK;
-          if( p->std && pp->st_std ) ++ST;
-        }
-      while(++O<OO);
-
-      /* Increment to the next contiguous region of this tile. */
-      increment += ( gal_tile_block_increment(p->objects, tsize,
-                                              num_increment++, NULL) );
-
-      /* If a 2D projection is requested, see if we should initialize (set
-         to zero) the projection-index ('pind') not. */
-      if(xybin && (num_increment-1) % tsize[1]==0 )
-        pind=0;
-    }
-
-
-  /* Write the higher-level columns. */
-  for(i=0;i<pp->clumpsinobj;++i)
-    {
-      /* Pointer to make things easier. */
-      ci=&pp->ci[ i * CCOL_NUMCOLS ];
-
-      /* Write the XY projection columns. */
-      if(xybin)
-        {
-          /* Any non-zero pixel must be set for NUMALLXY. */
-          uf=(u=xybin[i].array)+xybin[i].size;
-          do
-            if(*u)
-              {
-                if(cif[ CCOL_NUMALLXY ]          ) ci[ CCOL_NUMALLXY ]++;
-                if(cif[ CCOL_NUMXY    ] && *u==2 ) ci[ CCOL_NUMXY    ]++;
-              }
-          while(++u<uf);
-
-          /* For a check on the projected 2D areas. */
-          if(xybin && pp->object==2)
-            gal_fits_img_write(&xybin[i], "xybin.fits", NULL, NULL);
-
-        }
-    }
-
-
-  /* Clean up. */
-  if(c) free(c);
-  if(sc) free(sc);
-  if(dinc) free(dinc);
-  if(ngblabs) free(ngblabs);
-  if(minima_v) free(minima_v);
-  if(maxima_v) free(maxima_v);
-  if(xybin) gal_data_array_free(xybin, pp->clumpsinobj, 1);
-}
-
-
-
-
-
 static size_t
 parse_frac_find(gal_data_t *sorted_d, double value, double frac, int dosum)
 {
@@ -1341,20 +1395,210 @@ parse_area_of_frac_sum(struct mkcatalog_passparams *pp, gal_data_t *values,
 
 
 
+/* Parameters for the order-based measurements of one object and its
+   clumps (that can be done on separate threads). */
+struct parse_order_params
+{
+  struct mkcatalog_passparams *pp; /* Parameters of this object.        */
+  gal_data_t             *objvals; /* Values of the object.             */
+  gal_data_t            *fracvals; /* Values for fraction measurements. */
+  gal_data_t         **clumpsvals; /* Values of each clump.             */
+};
+
+
+
+
+
+/* Sigma-clipping and median measurements of the object. */
+static void
+parse_order_object_stats(struct mkcatalog_passparams *pp,
+                         gal_data_t *objvals)
+{
+  struct mkcatalogparams *p=pp->p;
+
+  float *sigcliparr;
+  gal_data_t *result;
+
+  if(p->oiflag[ OCOL_MEDIAN ])
+    {
+      result=gal_data_copy_to_new_type_free(gal_statistics_median(objvals, 1),
+                                            GAL_TYPE_FLOAT64);
+      pp->oi[OCOL_MEDIAN]=*((double *)(result->array));
+      gal_data_free(result);
+    }
+  if(p->oiflag[ OCOL_SIGCLIPNUM ]
+     || p->oiflag[ OCOL_SIGCLIPSTD ]
+     || p->oiflag[ OCOL_SIGCLIPMEAN ]
+     || p->oiflag[ OCOL_SIGCLIPMEDIAN ])
+    {
+      /* Calculate the sigma-clipped results and write them in any
+         requested column. */
+      result=gal_statistics_sigma_clip(objvals, p->sigmaclip[0],
+                                       p->sigmaclip[1], 1, 1);
+      sigcliparr=result->array;
+      if(p->oiflag[ OCOL_SIGCLIPNUM ])
+        pp->oi[OCOL_SIGCLIPNUM]=sigcliparr[0];
+      if(p->oiflag[ OCOL_SIGCLIPSTD ])
+        pp->oi[OCOL_SIGCLIPSTD]=sigcliparr[3];
+      if(p->oiflag[ OCOL_SIGCLIPMEAN ])
+        pp->oi[OCOL_SIGCLIPMEAN]=sigcliparr[2];
+      if(p->oiflag[ OCOL_SIGCLIPMEDIAN ])
+        pp->oi[OCOL_SIGCLIPMEDIAN]=sigcliparr[1];
+
+      /* Clean up the sigma-clipped values. */
+      gal_data_free(result);
+    }
+}
+
+
+
+
+
+/* Fractional measurements of the object. */
+static void
+parse_order_object_frac(struct mkcatalog_passparams *pp,
+                        gal_data_t *fracvals)
+{
+  struct mkcatalogparams *p=pp->p;
+
+  if( p->oiflag[    OCOL_MAXIMUM     ]
+      || p->oiflag[ OCOL_HALFMAXNUM  ]
+      || p->oiflag[ OCOL_HALFMAXSUM  ]
+      || p->oiflag[ OCOL_HALFSUMNUM  ]
+      || p->oiflag[ OCOL_FRACMAX1NUM ]
+      || p->oiflag[ OCOL_FRACMAX2NUM ] )
+    parse_area_of_frac_sum(pp, fracvals, pp->oi, 1);
+}
+
+
+
+
+
+/* All the order-based measurements of one clump. */
+static void
+parse_order_clump(struct mkcatalog_passparams *pp, gal_data_t *clumpvals,
+                  size_t i)
+{
+  struct mkcatalogparams *p=pp->p;
+
+  float *sigcliparr;
+  gal_data_t *result;
+  double *ci=&pp->ci[ i * CCOL_NUMCOLS ];
+
+  /* Median. */
+  if(p->ciflag[ CCOL_MEDIAN ])
+    {
+      if(clumpvals)
+        {
+          result=gal_statistics_median(clumpvals, 1);
+          result=gal_data_copy_to_new_type_free(result, GAL_TYPE_FLOAT64);
+          ci[ CCOL_MEDIAN ] = ( *((double *)(result->array))
+                                - (ci[ CCOL_RIV_SUM ]/ci[ CCOL_RIV_NUM ]) );
+          gal_data_free(result);
+        }
+      else ci[ CCOL_MEDIAN ] = NAN;
+    }
+
+  /* Sigma-clipping measurements. */
+  if(p->ciflag[ CCOL_SIGCLIPNUM ]
+     || p->ciflag[ CCOL_SIGCLIPSTD ]
+     || p->ciflag[ CCOL_SIGCLIPMEAN ]
+     || p->ciflag[ CCOL_SIGCLIPMEDIAN ])
+    {
+      if(clumpvals)
+        {
+          result=gal_statistics_sigma_clip(clumpvals, p->sigmaclip[0],
+                                           p->sigmaclip[1], 1, 1);
+          sigcliparr=result->array;
+          if(p->ciflag[ CCOL_SIGCLIPNUM ])
+            ci[CCOL_SIGCLIPNUM]=sigcliparr[0];
+          if(p->ciflag[ CCOL_SIGCLIPSTD ])
+            ci[CCOL_SIGCLIPSTD]=( sigcliparr[3]
+                                  - (ci[ CCOL_RIV_SUM ]/ci[ CCOL_RIV_NUM ]));
+          if(p->ciflag[ CCOL_SIGCLIPMEAN ])
+            ci[CCOL_SIGCLIPMEAN]=( sigcliparr[2]
+                                   - (ci[ CCOL_RIV_SUM ]/ci[ CCOL_RIV_NUM ]));
+          if(p->ciflag[ CCOL_SIGCLIPMEDIAN ])
+            ci[CCOL_SIGCLIPMEDIAN]=( sigcliparr[1]
+                                     - (ci[ CCOL_RIV_SUM ]/ci[ CCOL_RIV_NUM ]));
+          gal_data_free(result);
+        }
+      else
+        {
+          if(p->ciflag[ CCOL_SIGCLIPNUM    ]) ci[ CCOL_SIGCLIPNUM  ]=NAN;
+          if(p->ciflag[ CCOL_SIGCLIPSTD    ]) ci[ CCOL_SIGCLIPSTD  ]=NAN;
+          if(p->ciflag[ CCOL_SIGCLIPMEAN   ]) ci[ CCOL_SIGCLIPMEAN ]=NAN;
+          if(p->ciflag[ CCOL_SIGCLIPMEDIAN ]) ci[CCOL_SIGCLIPMEDIAN]=NAN;
+        }
+    }
+
+  /* Estimate half of the total sum. */
+  if( p->ciflag[    CCOL_MAXIMUM     ]
+      || p->ciflag[ CCOL_HALFMAXNUM  ]
+      || p->ciflag[ CCOL_HALFMAXSUM  ]
+      || p->ciflag[ CCOL_HALFSUMNUM  ]
+      || p->ciflag[ CCOL_FRACMAX1NUM ]
+      || p->ciflag[ CCOL_FRACMAX1SUM ]
+      || p->ciflag[ CCOL_FRACMAX2NUM ]
+      || p->ciflag[ CCOL_FRACMAX2SUM ] )
+    {
+      if(clumpvals)
+        parse_area_of_frac_sum(pp, clumpvals, ci, 0);
+      else
+        {
+          if( p->ciflag[ CCOL_MAXIMUM     ]) ci[ CCOL_MAXIMUM     ]=NAN;
+          if( p->ciflag[ CCOL_HALFMAXNUM  ]) ci[ CCOL_HALFMAXNUM  ]=NAN;
+          if( p->ciflag[ CCOL_HALFMAXSUM  ]) ci[ CCOL_HALFMAXSUM  ]=NAN;
+          if( p->ciflag[ CCOL_HALFSUMNUM  ]) ci[ CCOL_HALFSUMNUM  ]=NAN;
+          if( p->ciflag[ CCOL_FRACMAX1NUM ]) ci[ CCOL_FRACMAX1NUM ]=NAN;
+          if( p->ciflag[ CCOL_FRACMAX1SUM ]) ci[ CCOL_FRACMAX1SUM ]=NAN;
+          if( p->ciflag[ CCOL_FRACMAX2NUM ]) ci[ CCOL_FRACMAX2NUM ]=NAN;
+          if( p->ciflag[ CCOL_FRACMAX2SUM ]) ci[ CCOL_FRACMAX2SUM ]=NAN;
+        }
+    }
+}
+
+
+
+
+
+static void *
+parse_order_on_thread(void *in_prm)
+{
+  struct gal_threads_params *tprm=(struct gal_threads_params *)in_prm;
+  struct parse_order_params *op=(struct parse_order_params *)(tprm->params);
+
+  size_t i, j;
+
+  /* The first two jobs are for the object, the rest are for clumps. */
+  for(i=0; tprm->indexs[i]!=GAL_BLANK_SIZE_T; ++i)
+    switch( j=tprm->indexs[i] )
+      {
+      case 0:  parse_order_object_stats(op->pp, op->objvals);          break;
+      case 1:  parse_order_object_frac(op->pp, op->fracvals);          break;
+      default: parse_order_clump(op->pp, op->clumpsvals[j-2], j-2);
+      }
+
+  /* Wait for all threads to finish and return. */
+  if(tprm->b) pthread_barrier_wait(tprm->b);
+  return NULL;
+}
+
+
+
+
+
 void
 parse_order_based(struct mkcatalog_passparams *pp)
 {
   struct mkcatalogparams *p=pp->p;
 
-  float *V;
+  size_t i;
+  int32_t c;
   double *ci;
-  float *sigcliparr;
-  gal_data_t *result;
-  int32_t *O, *OO, *C=NULL;
-  size_t i, increment=0, num_increment=1;
+  struct parse_order_params op;
   gal_data_t *objvals=NULL, **clumpsvals=NULL;
-  size_t *tsize=pp->tile->dsize, ndim=p->objects->ndim;
-  size_t counter=0, *ccounter=NULL, tmpsize=pp->oi[OCOL_NUM];
+  size_t *ccounter=NULL, tmpsize=pp->ordnum;
 
   /* It may happen that there are no usable pixels for this object (and
      thus its possible clumps). In this case `tmpsize' will be zero and we
@@ -1391,10 +1635,10 @@ parse_order_based(struct mkcatalog_passparams *pp)
       return;
     }
 
-  /* We know we have pixels to use, so allocate space for the values within
-     the object. */
-  objvals=gal_data_alloc(NULL, p->values->type, 1, &tmpsize, NULL, 0,
-                         p->cp.minmapsize, p->cp.quietmmap, NULL, NULL,
+  /* We know we have pixels to use, so put the values that were collected
+     in the first pass into a dataset (without copying). */
+  objvals=gal_data_alloc(pp->ordvals, GAL_TYPE_FLOAT32, 1, &tmpsize, NULL,
+                         0, p->cp.minmapsize, p->cp.quietmmap, NULL, NULL,
                          NULL);
 
   /* Clump preparations. */
@@ -1407,192 +1651,69 @@ parse_order_based(struct mkcatalog_passparams *pp)
         error(EXIT_FAILURE, errno, "%s: couldn't allocate 'clumpsvals' for "
               "%zu clumps", __func__, pp->clumpsinobj);
 
-      /* Allocate the array necessary to keep the values of each clump. */
+      /* Count the number of values in each clump. */
       ccounter=gal_pointer_allocate(GAL_TYPE_SIZE_T, pp->clumpsinobj, 1,
                                     __func__, "ccounter");
+      for(i=0;i<pp->ordnum;++i)
+        if(pp->ordclab[i]) ++ccounter[ pp->ordclab[i]-1 ];
+
+      /* Allocate the array necessary to keep the values of each clump. */
       for(i=0;i<pp->clumpsinobj;++i)
         {
-          tmpsize=pp->ci[ i * CCOL_NUMCOLS + CCOL_NUM ];
+          tmpsize=ccounter[i];
           clumpsvals[i] = ( tmpsize
-                            ? gal_data_alloc(NULL, p->values->type, 1,
+                            ? gal_data_alloc(NULL, GAL_TYPE_FLOAT32, 1,
                                              &tmpsize, NULL, 0,
                                              p->cp.minmapsize,
                                              p->cp.quietmmap,
                                              NULL, NULL, NULL)
                             : NULL );
+          ccounter[i]=0;
         }
-    }
-
-
-  /* Parse each contiguous patch of memory covered by this object. */
-  while( pp->start_end_inc[0] + increment <= pp->start_end_inc[1] )
-    {
-      /* Set the contiguous range to parse. The pixel-to-pixel counting
-         along the fastest dimension will be done over the 'O' pointer. */
-      V = pp->st_v + increment;
-      if(p->clumps) C = pp->st_c + increment;
-      OO = ( O = pp->st_o + increment ) + tsize[ndim-1];
-
-      /* Parse the next contiguous region of this tile. */
-      do
-        {
-          /* If this pixel belongs to the requested object, then do the
-             processing. 'hasblank' is constant, so when the values doesn't
-             have any blank values, the 'isnan' will never be checked. */
-          if( *O==pp->object && !( p->hasblank && isnan(*V) ) )
-            {
-              /* Copy the value for the whole object. */
-              memcpy( gal_pointer_increment(objvals->array, counter++,
-                                             p->values->type), V,
-                      gal_type_sizeof(p->values->type) );
-
-              /* We are also on a clump. */
-              if(p->clumps && *C>0 && clumpsvals[*C-1]!=NULL)
-                memcpy( gal_pointer_increment(clumpsvals[*C-1]->array,
-                                              ccounter[*C-1]++,
-                                              p->values->type), V,
-                        gal_type_sizeof(p->values->type) );
-            }
-
-          /* Increment the other pointers. */
-          ++V;
-          if(p->clumps) ++C;
-        }
-      while(++O<OO);
 
-      /* Increment to the next contiguous region of this tile. */
-      increment += ( gal_tile_block_increment(p->objects, tsize,
-                                              num_increment++, NULL) );
+      /* Put each value in its clump's dataset. */
+      for(i=0;i<pp->ordnum;++i)
+        if( (c=pp->ordclab[i]) )
+          ((float *)(clumpsvals[c-1]->array))[ ccounter[c-1]++ ]
+            = pp->ordvals[i];
     }
 
 
-  /* Calculate the necessary values for the objects. */
-  if(p->oiflag[ OCOL_MEDIAN ])
+  /* Do the measurements. The measurements on the object and each clump
+     are independent, so when multiple threads are available for this
+     object, they will be done in parallel. In this case, the fraction
+     measurements on the object need a separate copy of the values
+     (because the statistics are done in place). */
+  op.pp=pp;
+  op.objvals=objvals;
+  op.clumpsvals=clumpsvals;
+  if(pp->numthreads>1)
     {
-      result=gal_data_copy_to_new_type_free(gal_statistics_median(objvals, 1),
-                                            GAL_TYPE_FLOAT64);
-      pp->oi[OCOL_MEDIAN]=*((double *)(result->array));
-      gal_data_free(result);
+      op.fracvals=gal_data_copy_to_new_type(objvals, GAL_TYPE_FLOAT64);
+      gal_threads_spin_off(parse_order_on_thread, &op,
+                           2 + (p->clumps ? pp->clumpsinobj : 0),
+                           pp->numthreads, p->cp.minmapsize,
+                           p->cp.quietmmap);
+      gal_data_free(op.fracvals);
     }
-  if(p->oiflag[ OCOL_SIGCLIPNUM ]
-     || p->oiflag[ OCOL_SIGCLIPSTD ]
-     || p->oiflag[ OCOL_SIGCLIPMEAN ]
-     || p->oiflag[ OCOL_SIGCLIPMEDIAN ])
+  else
     {
-      /* Calculate the sigma-clipped results and write them in any
-         requested column. */
-      result=gal_statistics_sigma_clip(objvals, p->sigmaclip[0],
-                                       p->sigmaclip[1], 1, 1);
-      sigcliparr=result->array;
-      if(p->oiflag[ OCOL_SIGCLIPNUM ])
-        pp->oi[OCOL_SIGCLIPNUM]=sigcliparr[0];
-      if(p->oiflag[ OCOL_SIGCLIPSTD ])
-        pp->oi[OCOL_SIGCLIPSTD]=sigcliparr[3];
-      if(p->oiflag[ OCOL_SIGCLIPMEAN ])
-        pp->oi[OCOL_SIGCLIPMEAN]=sigcliparr[2];
-      if(p->oiflag[ OCOL_SIGCLIPMEDIAN ])
-        pp->oi[OCOL_SIGCLIPMEDIAN]=sigcliparr[1];
-
-      /* Clean up the sigma-clipped values. */
-      gal_data_free(result);
+      op.fracvals=objvals;
+      parse_order_object_stats(pp, objvals);
+      parse_order_object_frac(pp, objvals);
+      if(p->clumps)
+        for(i=0;i<pp->clumpsinobj;++i)
+          parse_order_clump(pp, clumpsvals[i], i);
     }
 
-  /* Fractional values. */
-  if( p->oiflag[    OCOL_MAXIMUM     ]
-      || p->oiflag[ OCOL_HALFMAXNUM  ]
-      || p->oiflag[ OCOL_HALFMAXSUM  ]
-      || p->oiflag[ OCOL_HALFSUMNUM  ]
-      || p->oiflag[ OCOL_FRACMAX1NUM ]
-      || p->oiflag[ OCOL_FRACMAX2NUM ] )
-    parse_area_of_frac_sum(pp, objvals, pp->oi, 1);
-
-  /* Clean up the object values. */
+  /* Clean up (the values of the object are in the buffer of this thread,
+     so they shouldn't be freed here). */
+  objvals->array=NULL;
   gal_data_free(objvals);
-
-
-  /* Calculate the necessary value for clumps. */
   if(p->clumps)
     {
       for(i=0;i<pp->clumpsinobj;++i)
-        {
-          /* Set the main row to fill. */
-          ci=&pp->ci[ i * CCOL_NUMCOLS ];
-
-          /* Median. */
-          if(p->ciflag[ CCOL_MEDIAN ])
-            {
-              if(clumpsvals[i])
-                {
-                  result=gal_statistics_median(clumpsvals[i], 1);
-                  result=gal_data_copy_to_new_type_free(result, GAL_TYPE_FLOAT64);
-                  ci[ CCOL_MEDIAN ] = ( *((double *)(result->array))
-                                        - (ci[ CCOL_RIV_SUM ]/ci[ CCOL_RIV_NUM ]) );
-                  gal_data_free(result);
-                }
-              else ci[ CCOL_MEDIAN ] = NAN;
-            }
-
-          /* Sigma-clipping measurements. */
-          if(p->ciflag[ CCOL_SIGCLIPNUM ]
-             || p->ciflag[ CCOL_SIGCLIPSTD ]
-             || p->ciflag[ CCOL_SIGCLIPMEAN ]
-             || p->ciflag[ CCOL_SIGCLIPMEDIAN ])
-            {
-              if(clumpsvals[i])
-                {
-                  result=gal_statistics_sigma_clip(clumpsvals[i], p->sigmaclip[0],
-                                                   p->sigmaclip[1], 1, 1);
-                  sigcliparr=result->array;
-                  if(p->ciflag[ CCOL_SIGCLIPNUM ])
-                    ci[CCOL_SIGCLIPNUM]=sigcliparr[0];
-                  if(p->ciflag[ CCOL_SIGCLIPSTD ])
-                    ci[CCOL_SIGCLIPSTD]=( sigcliparr[3]
-                                          - (ci[ CCOL_RIV_SUM ]/ci[ CCOL_RIV_NUM ]));
-                  if(p->ciflag[ CCOL_SIGCLIPMEAN ])
-                    ci[CCOL_SIGCLIPMEAN]=( sigcliparr[2]
-                                           - (ci[ CCOL_RIV_SUM ]/ci[ CCOL_RIV_NUM ]));
-                  if(p->ciflag[ CCOL_SIGCLIPMEDIAN ])
-                    ci[CCOL_SIGCLIPMEDIAN]=( sigcliparr[1]
-                                             - (ci[ CCOL_RIV_SUM ]/ci[ CCOL_RIV_NUM ]));
-                  gal_data_free(result);
-                }
-              else
-                {
-                  if(p->ciflag[ CCOL_SIGCLIPNUM    ]) ci[ CCOL_SIGCLIPNUM  ]=NAN;
-                  if(p->ciflag[ CCOL_SIGCLIPSTD    ]) ci[ CCOL_SIGCLIPSTD  ]=NAN;
-                  if(p->ciflag[ CCOL_SIGCLIPMEAN   ]) ci[ CCOL_SIGCLIPMEAN ]=NAN;
-                  if(p->ciflag[ CCOL_SIGCLIPMEDIAN ]) ci[CCOL_SIGCLIPMEDIAN]=NAN;
-                }
-            }
-
-          /* Estimate half of the total sum. */
-          if( p->ciflag[    CCOL_MAXIMUM     ]
-              || p->ciflag[ CCOL_HALFMAXNUM  ]
-              || p->ciflag[ CCOL_HALFMAXSUM  ]
-              || p->ciflag[ CCOL_HALFSUMNUM  ]
-              || p->ciflag[ CCOL_FRACMAX1NUM ]
-              || p->ciflag[ CCOL_FRACMAX1SUM ]
-              || p->ciflag[ CCOL_FRACMAX2NUM ]
-              || p->ciflag[ CCOL_FRACMAX2SUM ] )
-            {
-              if(clumpsvals[i])
-                parse_area_of_frac_sum(pp, clumpsvals[i], ci, 0);
-              else
-                {
-                  if( p->ciflag[ CCOL_MAXIMUM     ]) ci[ CCOL_MAXIMUM     ]=NAN;
-                  if( p->ciflag[ CCOL_HALFMAXNUM  ]) ci[ CCOL_HALFMAXNUM  ]=NAN;
-                  if( p->ciflag[ CCOL_HALFMAXSUM  ]) ci[ CCOL_HALFMAXSUM  ]=NAN;
-                  if( p->ciflag[ CCOL_HALFSUMNUM  ]) ci[ CCOL_HALFSUMNUM  ]=NAN;
-                  if( p->ciflag[ CCOL_FRACMAX1NUM ]) ci[ CCOL_FRACMAX1NUM ]=NAN;
-                  if( p->ciflag[ CCOL_FRACMAX1SUM ]) ci[ CCOL_FRACMAX1SUM ]=NAN;
-                  if( p->ciflag[ CCOL_FRACMAX2NUM ]) ci[ CCOL_FRACMAX2NUM ]=NAN;
-                  if( p->ciflag[ CCOL_FRACMAX2SUM ]) ci[ CCOL_FRACMAX2SUM ]=NAN;
-                }
-            }
-
-          /* Clean up this clump's values. */
-          gal_data_free(clumpsvals[i]);
-        }
+        gal_data_free(clumpsvals[i]);
       free(clumpsvals);
       free(ccounter);
     }
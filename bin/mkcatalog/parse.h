@@ -29,9 +29,6 @@ parse_initialize(struct mkcatalog_passparams *pp);
 void
 parse_objects(struct mkcatalog_passparams *pp);
 
-void
-parse_clumps(struct mkcatalog_passparams *pp);
-
 void
 parse_order_based(struct mkcatalog_passparams *pp);
 
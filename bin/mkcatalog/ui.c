@@ -50,6 +50,7 @@ along with Gnuastro. If not, see <http://www.gnu.org/licenses/>.
 
 #include "ui.h"
 #include "columns.h"
+#include "incremental.h"
 #include "authors-cite.h"
 
 
@@ -142,6 +143,7 @@ ui_initialize_options(struct mkcatalogparams *p,
         {
         case GAL_OPTIONS_KEY_LOG:
         case GAL_OPTIONS_KEY_TYPE:
+        case GAL_OPTIONS_KEY_COMPRESS:
         case GAL_OPTIONS_KEY_SEARCHIN:
         case GAL_OPTIONS_KEY_IGNORECASE:
         case GAL_OPTIONS_KEY_WORKOVERCH:
@@ -838,8 +840,10 @@ ui_read_labels(struct mkcatalogparams *p)
   gal_data_t *tmp, *keys=gal_data_array_calloc(2);
 
   /* Read it into memory. */
-  p->objects = gal_array_read_one_ch(p->objectsfile, p->cp.hdu, NULL,
-                                     p->cp.minmapsize, p->cp.quietmmap);
+  p->objects = gal_array_read_one_ch_threads(p->objectsfile, p->cp.hdu, NULL,
+                                             p->cp.numthreads,
+                                             p->cp.minmapsize,
+                                             p->cp.quietmmap);
   p->objects->ndim=gal_dimension_remove_extra(p->objects->ndim,
                                               p->objects->dsize, NULL);
 
@@ -916,9 +920,11 @@ ui_read_labels(struct mkcatalogparams *p)
               "configuration file", p->usedclumpsfile);
 
       /* Read the clumps image. */
-      p->clumps = gal_array_read_one_ch(p->usedclumpsfile, p->clumpshdu,
-                                        NULL, p->cp.minmapsize,
-                                        p->cp.quietmmap);
+      p->clumps = gal_array_read_one_ch_threads(p->usedclumpsfile,
+                                                p->clumpshdu, NULL,
+                                                p->cp.numthreads,
+                                                p->cp.minmapsize,
+                                                p->cp.quietmmap);
       p->clumps->ndim=gal_dimension_remove_extra(p->clumps->ndim,
                                                  p->clumps->dsize, NULL);
 
@@ -1267,10 +1273,12 @@ ui_preparations_read_inputs(struct mkcatalogparams *p)
               "give the filename", p->usedvaluesfile);
 
       /* Read the values dataset. */
-      p->values=gal_array_read_one_ch_to_type(p->usedvaluesfile, p->valueshdu,
-                                              NULL, GAL_TYPE_FLOAT32,
-                                              p->cp.minmapsize,
-                                              p->cp.quietmmap);
+      p->values=gal_array_read_one_ch_to_type_threads(p->usedvaluesfile,
+                                                      p->valueshdu, NULL,
+                                                      GAL_TYPE_FLOAT32,
+                                                      p->cp.numthreads,
+                                                      p->cp.minmapsize,
+                                                      p->cp.quietmmap);
       p->values->ndim=gal_dimension_remove_extra(p->values->ndim,
                                                  p->values->dsize, NULL);
 
@@ -1301,6 +1309,13 @@ ui_preparations_read_inputs(struct mkcatalogparams *p)
     }
 
 
+  /* Checksums of the labels and values (for the output's meta-data) and
+     in incremental mode, the objects that have changed since the previous
+     run. This is done before subtracting the Sky, so the values can be
+     compared with the values of the previous run. */
+  incremental_prepare(p);
+
+
 
   /* Read the Sky image and check its size. */
   if(p->subtractsky || need_sky)
@@ -1319,10 +1334,12 @@ ui_preparations_read_inputs(struct mkcatalogparams *p)
                   "give the filename", p->usedskyfile);
 
           /* Read the Sky dataset. */
-          p->sky=gal_array_read_one_ch_to_type(p->usedskyfile, p->skyhdu,
-                                               NULL, GAL_TYPE_FLOAT32,
-                                               p->cp.minmapsize,
-                                               p->cp.quietmmap);
+          p->sky=gal_array_read_one_ch_to_type_threads(p->usedskyfile,
+                                                       p->skyhdu, NULL,
+                                                       GAL_TYPE_FLOAT32,
+                                                       p->cp.numthreads,
+                                                       p->cp.minmapsize,
+                                                       p->cp.quietmmap);
           p->sky->ndim=gal_dimension_remove_extra(p->sky->ndim,
                                                   p->sky->dsize, NULL);
 
@@ -1351,9 +1368,11 @@ ui_preparations_read_inputs(struct mkcatalogparams *p)
               p->usedstdfile);
 
       /* Read the Sky standard deviation image into memory. */
-      p->std=gal_array_read_one_ch_to_type(p->usedstdfile, p->stdhdu,
-                                           NULL, GAL_TYPE_FLOAT32,
-                                           p->cp.minmapsize, p->cp.quietmmap);
+      p->std=gal_array_read_one_ch_to_type_threads(p->usedstdfile, p->stdhdu,
+                                                   NULL, GAL_TYPE_FLOAT32,
+                                                   p->cp.numthreads,
+                                                   p->cp.minmapsize,
+                                                   p->cp.quietmmap);
       p->std->ndim=gal_dimension_remove_extra(p->std->ndim,
                                               p->std->dsize, NULL);
 
@@ -1387,9 +1406,11 @@ ui_preparations_read_inputs(struct mkcatalogparams *p)
                   p->upmaskfile);
 
           /* Read the mask image. */
-          p->upmask = gal_array_read_one_ch(p->upmaskfile, p->upmaskhdu,
-                                            NULL, p->cp.minmapsize,
-                                            p->cp.quietmmap);
+          p->upmask = gal_array_read_one_ch_threads(p->upmaskfile,
+                                                    p->upmaskhdu, NULL,
+                                                    p->cp.numthreads,
+                                                    p->cp.minmapsize,
+                                                    p->cp.quietmmap);
           p->upmask->ndim=gal_dimension_remove_extra(p->upmask->ndim,
                                                      p->upmask->dsize,
                                                      NULL);
@@ -1834,14 +1855,21 @@ ui_preparations(struct mkcatalogparams *p)
     error(EXIT_FAILURE, 0, "no zeropoint specified");
 
 
+  /* Checksums of the other inputs and the configuration, and in
+     incremental mode, the rows and columns that will be measured. */
+  incremental_plan(p);
+
+
   /* Prepare the two internal arrays necessary to sort the clumps catalog
      by object and clump IDs. We are allocating and filling these in
      separately (and not using the actual output columns that have the same
      values), because playing with the output columns can cause bad
      bugs. If the user wants performance, they are encouraged to run
      MakeCatalog with '--noclumpsort' and avoid the whole process all
-     together. */
-  if(p->clumps && !p->noclumpsort && p->cp.numthreads>1)
+     together. In incremental mode, these are also necessary to find the
+     clumps of the reused objects (even with '--noclumpsort'). */
+  if( p->clumps
+      && ( (!p->noclumpsort && p->cp.numthreads>1) || p->prevcat ) )
     {
       p->hostobjid_c=gal_pointer_allocate(GAL_TYPE_SIZE_T,
                                           p->clumpcols->size, 0, __func__,
@@ -2048,6 +2076,19 @@ ui_free_report(struct mkcatalogparams *p, struct timeval *t1)
   free(p->valueshdu);
   free(p->clumpsfile);
   free(p->valuesfile);
+  free(p->prevcat);
+  free(p->prevrow);
+  free(p->prevcrow);
+  free(p->prevcnum);
+  free(p->prevcathdu);
+  free(p->prevlabels);
+  free(p->prevvalues);
+  free(p->prevclumps);
+  free(p->prevclumpscat);
+  free(p->prevlabelshdu);
+  free(p->prevvalueshdu);
+  free(p->prevclumpshdu);
+  free(p->prevclumpscathdu);
   free(p->hostobjid_c);
   free(p->numclumps_c);
   gal_data_free(p->sky);
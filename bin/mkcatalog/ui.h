@@ -98,6 +98,17 @@ enum option_keys_enum
   UI_KEY_NOCLUMPSORT,
   UI_KEY_FRACMAX,
   UI_KEY_SPATIALRESOLUTION,
+  UI_KEY_PREVCAT,
+  UI_KEY_PREVCATHDU,
+  UI_KEY_PREVLABELS,
+  UI_KEY_PREVLABELSHDU,
+  UI_KEY_PREVVALUES,
+  UI_KEY_PREVVALUESHDU,
+  UI_KEY_PREVCLUMPS,
+  UI_KEY_PREVCLUMPSHDU,
+  UI_KEY_PREVCLUMPSCAT,
+  UI_KEY_PREVCLUMPSCATHDU,
+  UI_KEY_CHECKSUMS,
 
   UI_KEY_OBJID,                         /* Catalog columns. */
   UI_KEY_IDINHOSTOBJ,
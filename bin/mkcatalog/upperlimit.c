@@ -147,6 +147,107 @@ upperlimit_make_clump_tiles(struct mkcatalog_passparams *pp)
 
 
 
+/*********************************************************************/
+/*******************    Row-wise cumulative arrays   *****************/
+/*********************************************************************/
+/* To find the sum of values under a target's footprint when it is placed
+   in a random position, we don't need to parse every pixel of the
+   footprint: the footprint can be broken into contiguous runs along the
+   fastest dimension and the sum of each run is just the difference of two
+   elements in the row-wise cumulative sum of the values. The same is done
+   to check if the random footprint overlaps with a labeled, masked or
+   blank pixel: we keep the cumulative number of such (unusable) pixels in
+   each row.
+
+   These arrays are only built once (for all targets), so with a footprint
+   of 'N' rows, each random position will need '2N' lookups, independent
+   of the area of the target. */
+static void *
+upperlimit_cumulative_on_thread(void *in_prm)
+{
+  struct gal_threads_params *tprm=(struct gal_threads_params *)in_prm;
+  struct mkcatalogparams *p=(struct mkcatalogparams *)(tprm->params);
+  size_t width=p->objects->dsize[p->objects->ndim-1];
+
+  double s;
+  uint32_t b;
+  size_t i, r, start;
+  float *V=p->values->array;
+  double *S=p->upsum->array;
+  uint32_t *B=p->upbad->array;
+  int32_t *O=p->objects->array;
+  uint8_t *M=p->upmask ? p->upmask->array : NULL;
+
+  /* Go over all the rows assigned to this thread. */
+  for(r=0; tprm->indexs[r]!=GAL_BLANK_SIZE_T; ++r)
+    {
+      s=0.0f;
+      b=0;
+      start=tprm->indexs[r]*width;
+      for(i=start; i<start+width; ++i)
+        {
+          /* If this pixel is a non-zero object code, or is masked, or has
+             a blank value, then it is unusable. */
+          if( O[i] || (M && M[i]) || ( p->hasblank && isnan(V[i]) ) ) ++b;
+          else s+=V[i];
+
+          /* Write the cumulative values. */
+          S[i]=s;
+          B[i]=b;
+        }
+    }
+
+  /* Wait for all threads to finish and return. */
+  if(tprm->b) pthread_barrier_wait(tprm->b);
+  return NULL;
+}
+
+
+
+
+
+void
+upperlimit_cumulative(struct mkcatalogparams *p)
+{
+  gal_data_t *objects=p->objects;
+  size_t width=objects->dsize[objects->ndim-1];
+
+  /* Allocate the two arrays. Together they need 12 bytes per pixel, so
+     like the other large arrays, they are allocated through
+     'gal_pointer_allocate_ram_or_mmap' (within 'gal_data_alloc') to be
+     memory-mapped when they are larger than '--minmapsize'. */
+  p->upsum=gal_data_alloc(NULL, GAL_TYPE_FLOAT64, objects->ndim,
+                          objects->dsize, NULL, 0, p->cp.minmapsize,
+                          p->cp.quietmmap, NULL, NULL, NULL);
+  p->upbad=gal_data_alloc(NULL, GAL_TYPE_UINT32, objects->ndim,
+                          objects->dsize, NULL, 0, p->cp.minmapsize,
+                          p->cp.quietmmap, NULL, NULL, NULL);
+
+  /* Fill them (every row is independent). */
+  gal_threads_spin_off(upperlimit_cumulative_on_thread, p,
+                       objects->size/width, p->cp.numthreads,
+                       p->cp.minmapsize, p->cp.quietmmap);
+}
+
+
+
+
+
+
+
+
+
+
+
+
+
+
+
+
+
+
+
+
 /*********************************************************************/
 /*******************         For one tile         ********************/
 /*********************************************************************/
@@ -425,8 +526,8 @@ upperlimit_write_check(struct mkcatalogparams *p, gal_list_sizet_t *check_x,
   x->next=y;
   if(check_z) { y->next=z; z->next=s; }
   else        { y->next=s;            }
-  gal_table_write(x, &keylist, NULL, p->cp.tableformat, p->upcheckout,
-                  "UPPERLIMIT_CHECK", 0);
+  gal_table_write_threads(x, &keylist, NULL, p->cp.tableformat, p->upcheckout,
+                          "UPPERLIMIT_CHECK", 0, p->cp.numthreads);
 
   /* Inform the user. */
   if(!p->cp.quiet)
@@ -540,27 +641,199 @@ upperlimit_measure(struct mkcatalog_passparams *pp, int32_t clumplab,
 
 
 
+/* Find the contiguous runs of the target's footprint along the fastest
+   dimension. Each run is kept as two numbers in 'runs': the offset of its
+   first pixel from the first pixel of the tile (within the full
+   dataset), and its length. If 'runs==NULL', the runs are only counted.
+   In any case, the number of runs is returned. */
+static size_t
+upperlimit_footprint_runs(struct mkcatalog_passparams *pp, gal_data_t *tile,
+                          int32_t *st_oo, int32_t *st_oc, int32_t clumplab,
+                          size_t *runs)
+{
+  struct mkcatalogparams *p=pp->p;
+  size_t ndim=p->objects->ndim, *dsize=p->objects->dsize;
+
+  int inrun;
+  int32_t *oO, *oOO, *oC=NULL;
+  size_t numruns=0, se_inc[2], increment=0, num_increment=1;
+
+  /* Starting and ending indexs of the tile. */
+  gal_tile_start_end_ind_inclusive(tile, p->objects, se_inc);
+
+  /* Parse over the contiguous regions of the tile. */
+  while( se_inc[0] + increment <= se_inc[1] )
+    {
+      /* Set the pointers. */
+      inrun=0;
+      oO = st_oo + increment;
+      oOO = oO + tile->dsize[ndim-1];
+      if(clumplab) oC = st_oc + increment;
+
+      /* Parse over this contiguous region and find the runs. */
+      do
+        {
+          if( *oO==pp->object && ( oC==NULL || *oC==clumplab ) )
+            {
+              if(inrun) { if(runs) ++runs[ 2*(numruns-1)+1 ]; }
+              else
+                {
+                  if(runs)
+                    {
+                      runs[ 2*numruns   ] = oO-st_oo;
+                      runs[ 2*numruns+1 ] = 1;
+                    }
+                  inrun=1;
+                  ++numruns;
+                }
+            }
+          else inrun=0;
+          if(oC) ++oC;
+        }
+      while(++oO<oOO);
+
+      /* Increment to the next contiguous region of this tile. */
+      increment += ( gal_tile_block_increment(p->objects, dsize,
+                                              num_increment++, NULL) );
+    }
+
+  /* Return the number of runs. */
+  return numruns;
+}
+
+
+
+
+
+/* Find the sum of the values under the target's footprint (given as runs
+   along the fastest dimension) when its tile is placed at the random
+   position 'rcoord' and put it in 'sum'. If any pixel of the random
+   footprint is over a labeled region, is masked, or is blank, this
+   function will return 0 (the random position is not usable), otherwise
+   it returns 1.
+
+   Each run is within one row of the dataset, so its sum (and the number of
+   unusable pixels within it) is found from the difference of two
+   elements in the row-wise cumulative arrays (see
+   'upperlimit_cumulative'). This function doesn't change anything in its
+   inputs, so it can safely be called on different threads. */
+static int
+upperlimit_random_sum(struct mkcatalog_passparams *pp, size_t *rcoord,
+                      size_t *runs, size_t numruns, double *sum)
+{
+  struct mkcatalogparams *p=pp->p;
+  size_t ndim=p->objects->ndim, *dsize=p->objects->dsize;
+
+  size_t *r, *rf, start, first, last;
+  size_t width=dsize[ndim-1];
+  double *S=p->upsum->array;
+  uint32_t *B=p->upbad->array;
+
+  /* Index of the first pixel of the tile in the random position. */
+  start=gal_dimension_coord_to_index(ndim, dsize, rcoord);
+
+  /* Parse over the runs. */
+  *sum=0.0f;
+  rf=(r=runs)+2*numruns;
+  if(r<rf)
+    do
+      {
+        /* Indexs of the first and last pixel of this run. */
+        first = start + r[0];
+        last  = first + r[1] - 1;
+
+        /* If there is any unusable pixel in this run, the random position
+           can't be used. */
+        if( B[last] - ( first%width ? B[first-1] : 0 ) ) return 0;
+
+        /* Add the sum of this run. */
+        *sum += S[last] - ( first%width ? S[first-1] : 0.0f );
+      }
+    while( (r+=2) < rf );
+
+  /* The random position was usable. */
+  return 1;
+}
+
+
+
+
+
+/* Parameters to measure the sums over a batch of random positions on
+   multiple threads. */
+struct upperlimit_batch_params
+{
+  struct mkcatalog_passparams *pp; /* Parameters of this object.       */
+  size_t                  *rcoord; /* Random coordinates (ndim each).  */
+  size_t                    *runs; /* Runs of the target's footprint.  */
+  size_t                  numruns; /* Number of runs.                  */
+  double                    *sums; /* Sum over each random position.   */
+  uint8_t                 *usable; /* If each position is usable.      */
+};
+
+
+
+
+
+static void *
+upperlimit_batch_on_thread(void *in_prm)
+{
+  struct gal_threads_params *tprm=(struct gal_threads_params *)in_prm;
+  struct upperlimit_batch_params *bp=
+    (struct upperlimit_batch_params *)(tprm->params);
+  size_t ndim=bp->pp->p->objects->ndim;
+
+  size_t i, j;
+
+  /* Go over all the random positions assigned to this thread. */
+  for(i=0; tprm->indexs[i]!=GAL_BLANK_SIZE_T; ++i)
+    {
+      j=tprm->indexs[i];
+      bp->usable[j]=upperlimit_random_sum(bp->pp, &bp->rcoord[j*ndim],
+                                          bp->runs, bp->numruns,
+                                          &bp->sums[j]);
+    }
+
+  /* Wait for all threads to finish and return. */
+  if(tprm->b) pthread_barrier_wait(tprm->b);
+  return NULL;
+}
+
+
+
+
+
+/* Put the footprint of the target over random positions and measure the
+   sum of values under it.
+
+   When multiple threads can be used for this target ('pp->numthreads'),
+   the random positions are generated in batches (in the same order as the
+   serial case), the sum over each position of the batch is measured on
+   different threads, and finally the results are used in order. The
+   random number generator is re-seeded for every target, so the final
+   result is identical to the serial case for the same seed (positions
+   that are generated after the stopping criteria is reached will just
+   not be used). */
 static void
 upperlimit_one_tile(struct mkcatalog_passparams *pp, gal_data_t *tile,
                     unsigned long seed, int32_t clumplab)
 {
   struct mkcatalogparams *p=pp->p;
-  size_t ndim=p->objects->ndim, *dsize=p->objects->dsize;
+  size_t ndim=p->objects->ndim;
 
-  double sum;
-  void *tarray;
-  uint8_t *M=NULL, *st_m=NULL;
-  int continueparse, writecheck=0;
+  int writecheck=0;
+  uint8_t *usable;
+  double *sums;
+  size_t *runs, numruns;
+  int32_t *st_oo, *st_oc;
   struct gal_list_f32_t *check_s=NULL;
-  size_t d, counter=0, se_inc[2], nfailed=0;
-  float *V, *st_v, *uparr=pp->up_vals->array;
-  size_t min[3], max[3], increment, num_increment;
-  int32_t *O, *OO, *oO, *st_o, *st_oo, *st_oc, *oC=NULL;
+  struct upperlimit_batch_params bp;
+  size_t i, d, counter=0, se_inc[2], nfailed=0;
+  float *uparr=pp->up_vals->array;
+  size_t min[3], max[3], *rcoord, batchsize, maxbatch;
   size_t hw2, hw0=tile->dsize[0]/2, hw1=tile->dsize[1]/2;
   size_t maxfails = p->upnum * MKCATALOG_UPPERLIMIT_MAXFAILS_MULTIP;
   struct gal_list_sizet_t *check_x=NULL, *check_y=NULL, *check_z=NULL;
-  size_t *rcoord=gal_pointer_allocate(GAL_TYPE_SIZE_T, ndim, 0, __func__,
-                                      "rcoord");
 
   /* See if a check table must be created for this distribution. */
   if( p->checkuplim[0]==pp->object )
@@ -578,7 +851,6 @@ upperlimit_one_tile(struct mkcatalog_passparams *pp, gal_data_t *tile,
 
 
   /* Initializations. */
-  tarray=tile->array;
   gsl_rng_set(pp->rng, seed);
   pp->up_vals->flag &= ~GAL_DATA_FLAG_SORT_CH;
   hw2 = tile->ndim==3 ? tile->dsize[2]/2 : GAL_BLANK_SIZE_T;
@@ -596,110 +868,105 @@ upperlimit_one_tile(struct mkcatalog_passparams *pp, gal_data_t *tile,
   st_oc = clumplab ? (int32_t *)(p->clumps->array) + se_inc[0] : NULL;
 
 
-  /* Continue measuring randomly until we get the desired total number. */
-  while(nfailed<maxfails && counter<p->upnum)
-    {
-      /* Get the random coordinates. */
-      for(d=0;d<ndim;++d)
-        rcoord[d] = upperlimit_random_position(pp, tile, d, min, max);
-
-      /* Set the tile's new starting pointer. */
-      tile->array = gal_pointer_increment(p->objects->array,
-                          gal_dimension_coord_to_index(ndim, dsize, rcoord),
-                                          p->objects->type);
-
-      /* Starting and ending coordinates for this random position, note
-         that in 'pp' we have the starting and ending coordinates of the
-         actual tile. */
-      increment     = 0;
-      num_increment = 1;
-      continueparse = 1;
-      sum           = 0.0f;
-
-      /* Starting pointers for the random tile. */
-      st_v   = gal_tile_start_end_ind_inclusive(tile, p->values, se_inc);
-      st_o               = (int32_t *)(p->objects->array) + se_inc[0];
-      if(p->upmask) st_m = (uint8_t *)(p->upmask->array)  + se_inc[0];
-
-      /* Parse over this object/clump. */
-      while( se_inc[0] + increment <= se_inc[1] )
-        {
-          /* Set the pointers. */
-          V               = st_v  + increment;    /* Random tile.   */
-          O               = st_o  + increment;    /* Random tile.   */
-          if(st_m) M      = st_m  + increment;    /* Random tile.   */
-          oO              = st_oo + increment;    /* Original tile. */
-          if(clumplab) oC = st_oc + increment;    /* Original tile. */
-
-
-          /* Parse over this contiguous region, similar to the first and
-             second pass functions. */
-          OO = O + tile->dsize[ndim-1];
-          do
-            {
-              /* Only use pixels over this object/clump. */
-              if( *oO==pp->object && ( oC==NULL || *oC==clumplab ) )
-                {
-                  /* If this pixel is a non-zero object code, or is masked,
-                     or has a blank value, then stop parsing. */
-                  if( *O || (M && *M) || ( p->hasblank && isnan(*V) ) )
-                    continueparse=0;
-                  else
-                    sum += *V;
-                }
+  /* Find the runs of the target's footprint. */
+  numruns=upperlimit_footprint_runs(pp, tile, st_oo, st_oc, clumplab, NULL);
+  runs = ( numruns
+           ? gal_pointer_allocate(GAL_TYPE_SIZE_T, 2*numruns, 0, __func__,
+                                  "runs")
+           : NULL );
+  if(runs) upperlimit_footprint_runs(pp, tile, st_oo, st_oc, clumplab, runs);
 
-              /* Increment the other pointers. */
-              ++V;
-              ++oO;
-              if(M) ++M;
-              if(oC) ++oC;
-            }
-          while(continueparse && ++O<OO);
 
+  /* Allocate the space for the random positions and their sums. When
+     there is only one thread, the batch will only have one element. */
+  maxbatch = ( pp->numthreads>1
+               ? (p->upnum>pp->numthreads ? p->upnum : pp->numthreads)
+               : 1 );
+  sums=gal_pointer_allocate(GAL_TYPE_FLOAT64, maxbatch, 0, __func__,
+                            "sums");
+  usable=gal_pointer_allocate(GAL_TYPE_UINT8, maxbatch, 0, __func__,
+                              "usable");
+  rcoord=gal_pointer_allocate(GAL_TYPE_SIZE_T, maxbatch*ndim, 0, __func__,
+                              "rcoord");
 
-          /* Increment to the next contiguous region of this tile. */
-          if(continueparse)
-            increment += ( gal_tile_block_increment(p->objects, dsize,
-                                                    num_increment++, NULL) );
-          else break;
-        }
 
+  /* Set the constant batch parameters. */
+  bp.pp=pp;
+  bp.runs=runs;
+  bp.sums=sums;
+  bp.rcoord=rcoord;
+  bp.usable=usable;
+  bp.numruns=numruns;
 
-      /* Further processing is only necessary if this random tile was fully
-         parsed. If it was, we must reset 'nfailed' to zero again. */
-      if(continueparse)
-        {
-          nfailed=0;
-          uparr[ counter++ ] = sum;
-        }
-      else ++nfailed;
 
+  /* Continue measuring randomly until we get the desired total number. */
+  while(nfailed<maxfails && counter<p->upnum)
+    {
+      /* Number of random positions in this batch: all the remaining
+         necessary positions (no more than the allocated space). */
+      batchsize = ( maxbatch>1
+                    ? ( p->upnum-counter>pp->numthreads
+                        ? p->upnum-counter
+                        : pp->numthreads )
+                    : 1 );
 
-      /* If a check is necessary, put the center of the tile independent of
-         the values/labels (in FITS coordinates). Note that 'rcoord' is the
-         position of the first pixel of the tile, so we need to add half
-         the width of the tile (the 'hw*' variables). */
-      if(writecheck)
-        {
-          switch(ndim)
-            {
-            case 2:
-              gal_list_sizet_add(&check_x, rcoord[1]+1 + hw1);
-              gal_list_sizet_add(&check_y, rcoord[0]+1 + hw0);
-              break;
+      /* Get the random coordinates. */
+      for(i=0;i<batchsize;++i)
+        for(d=0;d<ndim;++d)
+          rcoord[i*ndim+d] = upperlimit_random_position(pp, tile, d, min,
+                                                        max);
+
+      /* Measure the sums over the random positions. */
+      if(batchsize>1)
+        gal_threads_spin_off(upperlimit_batch_on_thread, &bp, batchsize,
+                             pp->numthreads, p->cp.minmapsize,
+                             p->cp.quietmmap);
+      else
+        usable[0]=upperlimit_random_sum(pp, rcoord, runs, numruns, sums);
 
-            case 3:
-              gal_list_sizet_add(&check_x, rcoord[2]+1 + hw2);
-              gal_list_sizet_add(&check_y, rcoord[1]+1 + hw1);
-              gal_list_sizet_add(&check_z, rcoord[0]+1 + hw0);
-              break;
+      /* Use the measurements in the same order they were generated. */
+      for(i=0;i<batchsize;++i)
+        {
+          /* If the stopping criteria has been reached, don't continue. */
+          if(nfailed>=maxfails || counter>=p->upnum) break;
 
-            default:
-              error(EXIT_FAILURE, 0, "%s: a bug! Please contact us at %s "
-                    "to fix the problem. 'ndim' value of %zu is not "
-                    "recognized", __func__, PACKAGE_BUGREPORT, ndim);
+          /* Further processing is only necessary if this random tile was
+             fully parsed. If it was, we must reset 'nfailed' to zero
+             again. */
+          if(usable[i])
+            {
+              nfailed=0;
+              uparr[ counter++ ] = sums[i];
+            }
+          else ++nfailed;
+
+          /* If a check is necessary, put the center of the tile
+             independent of the values/labels (in FITS coordinates). Note
+             that 'rcoord' is the position of the first pixel of the tile,
+             so we need to add half the width of the tile (the 'hw*'
+             variables). */
+          if(writecheck)
+            {
+              switch(ndim)
+                {
+                case 2:
+                  gal_list_sizet_add(&check_x, rcoord[i*ndim+1]+1 + hw1);
+                  gal_list_sizet_add(&check_y, rcoord[i*ndim  ]+1 + hw0);
+                  break;
+
+                case 3:
+                  gal_list_sizet_add(&check_x, rcoord[i*ndim+2]+1 + hw2);
+                  gal_list_sizet_add(&check_y, rcoord[i*ndim+1]+1 + hw1);
+                  gal_list_sizet_add(&check_z, rcoord[i*ndim  ]+1 + hw0);
+                  break;
+
+                default:
+                  error(EXIT_FAILURE, 0, "%s: a bug! Please contact us at "
+                        "%s to fix the problem. 'ndim' value of %zu is not "
+                        "recognized", __func__, PACKAGE_BUGREPORT, ndim);
+                }
+              gal_list_f32_add(&check_s, usable[i] ? sums[i] : NAN);
             }
-          gal_list_f32_add(&check_s, continueparse ? sum : NAN);
         }
     }
 
@@ -710,12 +977,15 @@ upperlimit_one_tile(struct mkcatalog_passparams *pp, gal_data_t *tile,
   /* Do the measurement on the random distribution. */
   upperlimit_measure(pp, clumplab, counter==p->upnum);
 
-  /* Reset the tile's array pointer, clean up and return. */
+  /* Clean up and return. */
+  if(runs) free(runs);
+  free(sums);
   free(rcoord);
-  tile->array=tarray;
+  free(usable);
   gal_list_f32_free(check_s);
   gal_list_sizet_free(check_x);
   gal_list_sizet_free(check_y);
+  gal_list_sizet_free(check_z);
 }
 
 
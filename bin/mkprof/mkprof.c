@@ -151,7 +151,8 @@ saveindividual(struct mkonthread *mkp)
   /* Write the array to the file (a separately built PSF doesn't need WCS
      coordinates). */
   if(ibq->ispsf && p->psfinimg==0)
-    gal_fits_img_write(ibq->image, filename, NULL, PROGRAM_NAME);
+    gal_fits_img_write_compress(ibq->image, filename, NULL, PROGRAM_NAME,
+                                p->cp.compress);
   else
     {
       /* Allocate space for the corrected crpix and fill it in. Both
@@ -162,9 +163,9 @@ saveindividual(struct mkonthread *mkp)
         crpix[i] = ((double *)(p->crpix->array))[i] - os*(mkp->fpixel_i[i]-1);
 
       /* Write the image. */
-      gal_fits_img_write_corr_wcs_str(ibq->image, filename, p->wcsstr,
-                                      p->wcsnkeyrec, crpix, NULL,
-                                      PROGRAM_NAME);
+      gal_fits_img_write_corr_wcs_str_compress(ibq->image, filename, p->wcsstr,
+                                               p->wcsnkeyrec, crpix, NULL,
+                                               PROGRAM_NAME, p->cp.compress);
     }
   ibq->indivcreated=1;
 
@@ -706,8 +707,9 @@ mkprof_write(struct mkprofparams *p)
          type. Until now, we were using 'p->wcs' for the WCS, but from now
          on, will put it in 'out' to also free it while freeing 'out'. */
       out->wcs=p->wcs;
-      gal_fits_img_write_to_type(out, p->mergedimgname, NULL,
-                                 PROGRAM_NAME, p->cp.type);
+      gal_fits_img_write_to_type_compress(out, p->mergedimgname, NULL,
+                                          PROGRAM_NAME, p->cp.type,
+                                          p->cp.compress);
       p->wcs=NULL;
 
       /* Clean up */
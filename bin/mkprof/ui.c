@@ -1951,10 +1951,12 @@ ui_read_ndim(struct mkprofparams *p)
           else
             {
               /* Read the image. */
-              p->out=gal_array_read_one_ch_to_type(p->backname, p->backhdu,
-                                                   NULL, GAL_TYPE_FLOAT32,
-                                                   p->cp.minmapsize,
-                                                   p->cp.quietmmap);
+              p->out=gal_array_read_one_ch_to_type_threads(p->backname,
+                                                           p->backhdu, NULL,
+                                                           GAL_TYPE_FLOAT32,
+                                                           p->cp.numthreads,
+                                                           p->cp.minmapsize,
+                                                           p->cp.quietmmap);
               p->out->ndim=gal_dimension_remove_extra(p->out->ndim,
                                                       p->out->dsize, NULL);
               p->ndim=p->out->ndim;
@@ -211,26 +211,27 @@ detection_initial(struct noisechiselparams *p)
 /****************************************************************
  ************            Pseudo detections           ************
  ****************************************************************/
-/* Set all the pixels we don't need to Nan. */
+/* Set all the pixels we don't need to Nan. The loops are written over
+   indexs with the conditions as selections (not branches to different
+   operations), so they can be vectorized by the compiler. */
 static void
 detection_pseudo_sky_or_det(struct noisechiselparams *p, uint8_t *w, int s0d1)
 {
-  int32_t *l=p->olabel->array;
-  uint8_t *b=p->binary->array, *bf=b+p->binary->size;
+  size_t i, size=p->binary->size;
+  int32_t *restrict l=p->olabel->array;
+  uint8_t *restrict b=p->binary->array, *restrict wr=w;
 
   if(s0d1)
     /* Set all sky regions (label equal to zero) to zero, since a blank
        pixel is also non-zero, we don't need to check for blanks in this
        case. */
-    do *w++ = *l++ ? *b : 0; while(++b<bf);
+    for(i=0;i<size;++i) wr[i] = l[i] ? b[i] : 0;
   else
     /* Set all detected pixels to 1. */
-    do
-      {
-        *w++ = *l ? *l==GAL_BLANK_INT32 ? GAL_BLANK_UINT8 : 1 : *b;
-        ++l;
-      }
-    while(++b<bf);
+    for(i=0;i<size;++i)
+      wr[i] = ( l[i]
+                ? ( l[i]==GAL_BLANK_INT32 ? GAL_BLANK_UINT8 : 1 )
+                : b[i] );
 }
 
 
@@ -1032,9 +1033,9 @@ detection_remove_false_initial(struct noisechiselparams *p,
 static size_t
 detection_quantile_expand(struct noisechiselparams *p, gal_data_t *workbin)
 {
-  int32_t *o, *of;
-  size_t *d, numexpanded=0;
+  int32_t *o;
   gal_data_t *diffuseindexs;
+  size_t j, *d, numexpanded=0;
   float *i, *e_th, *arr=p->conv->array;
   uint8_t *b=workbin->array, *bf=b+workbin->size;
 
@@ -1048,27 +1049,23 @@ detection_quantile_expand(struct noisechiselparams *p, gal_data_t *workbin)
                                    NULL, 0, p->cp.minmapsize, p->cp.quietmmap,
                                    NULL, NULL, NULL);
 
-      /* Fill in the diffuse indexs and initialize the objects dataset. */
+      /* Initialize the objects dataset: if the binary value is 1, then we
+         want an initial label of 1 (the object is already detected). If
+         it isn't, then we only want it if it is above the threshold. This
+         loop has no dependency between pixels, so it can be vectorized
+         (unlike the collection of indexs below). */
       b    = workbin->array;
       arr  = p->conv->array;
-      d    = diffuseindexs->array;
+      o    = p->olabel->array;
       e_th = p->exp_thresh_full->array;
-      of   = (o=p->olabel->array) + p->olabel->size;
-      do
-        {
-          /* If the binary value is 1, then we want an initial label of 1
-             (the object is already detected). If it isn't, then we only
-             want it if it is above the threshold. */
-          *o = *b==1 ? 1 : ( *arr>*e_th ? GAL_LABEL_INIT : 0);
-          if(*b==0 && *arr>*e_th)
-            *d++ = o - (int32_t *)(p->olabel->array);
-
-          /* Increment the points and go onto the next pixel. */
-          ++b;
-          ++arr;
-          ++e_th;
-        }
-      while(++o<of);
+      for(j=0;j<p->olabel->size;++j)
+        o[j] = b[j]==1 ? 1 : ( arr[j]>e_th[j] ? GAL_LABEL_INIT : 0 );
+
+      /* Fill in the diffuse indexs: the pixels that were not originally
+         detected (binary value of 0), but are above the threshold. */
+      d=diffuseindexs->array;
+      for(j=0;j<p->olabel->size;++j)
+        if(b[j]==0 && o[j]==GAL_LABEL_INIT) *d++ = j;
 
       /* Expand the detections. Note that because we are only concerned
          with those regions that are touching a detected region, it is
@@ -1093,17 +1090,12 @@ detection_quantile_expand(struct noisechiselparams *p, gal_data_t *workbin)
         {
           b=workbin->array;
           i=p->input->array;
-          of=(o=p->olabel->array)+p->olabel->size;
-          do
+          o=p->olabel->array;
+          for(j=0;j<p->olabel->size;++j)
             {
-              if(isnan(*i++))
-                {
-                  *o=GAL_BLANK_INT32;
-                  *b=GAL_BLANK_UINT8;
-                }
-              ++b;
+              o[j] = isnan(i[j]) ? GAL_BLANK_INT32 : o[j];
+              b[j] = isnan(i[j]) ? GAL_BLANK_UINT8 : b[j];
             }
-          while(++o<of);
         }
 
       /* Clean up. */
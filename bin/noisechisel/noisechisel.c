@@ -140,10 +140,15 @@ noisechisel_convolve(struct noisechiselparams *p)
 static void
 noisechisel_output(struct noisechiselparams *p)
 {
+  gal_data_t *disp;
   gal_fits_list_key_t *keys=NULL;
+  gal_fits_writer_t *writer=gal_fits_writer_start(2, p->cp.numthreads>1);
 
 
-  /* Put a copy of the input into the output (when necessary). */
+  /* Put a copy of the input into the output (when necessary). The
+     extensions are written on a separate thread (when possible), so the
+     full Sky and its standard deviation images can be built while the
+     previous extensions are being written. */
   if(p->rawoutput==0)
     {
       /* Subtract the Sky value. */
@@ -152,7 +157,9 @@ noisechisel_output(struct noisechiselparams *p)
       /* Correct the name of the input and write it out. */
       if(p->input->name) free(p->input->name);
       p->input->name="INPUT-NO-SKY";
-      gal_fits_img_write(p->input, p->cp.output, NULL, PROGRAM_NAME);
+      gal_fits_writer_img(writer, p->input, p->cp.output, NULL,
+                          PROGRAM_NAME, p->cp.compress,
+                          GAL_FITS_WRITER_BORROW);
       p->input->name=NULL;
     }
 
@@ -169,13 +176,17 @@ noisechisel_output(struct noisechiselparams *p)
   if(p->label)
     {
       p->olabel->name = "DETECTIONS";
-      gal_fits_img_write(p->olabel, p->cp.output, keys, PROGRAM_NAME);
+      gal_fits_writer_img(writer, p->olabel, p->cp.output, keys,
+                          PROGRAM_NAME, p->cp.compress,
+                          GAL_FITS_WRITER_BORROW);
       p->olabel->name=NULL;
     }
   else
     {
       p->binary->name = "DETECTIONS";
-      gal_fits_img_write(p->binary, p->cp.output, keys, PROGRAM_NAME);
+      gal_fits_writer_img(writer, p->binary, p->cp.output, keys,
+                          PROGRAM_NAME, p->cp.compress,
+                          GAL_FITS_WRITER_BORROW);
       p->binary->name=NULL;
     }
   keys=NULL;
@@ -184,8 +195,12 @@ noisechisel_output(struct noisechiselparams *p)
   /* Write the Sky image into the output */
   if(p->sky->name) free(p->sky->name);
   p->sky->name="SKY";
-  gal_tile_full_values_write(p->sky, &p->cp.tl, !p->ignoreblankintiles,
-                             p->cp.output, NULL, PROGRAM_NAME);
+  disp=gal_tile_full_values_for_write(p->sky, &p->cp.tl,
+                                      !p->ignoreblankintiles);
+  gal_fits_writer_img(writer, disp, p->cp.output, NULL, PROGRAM_NAME,
+                      p->cp.compress, ( disp==p->sky
+                                        ? GAL_FITS_WRITER_BORROW
+                                        : GAL_FITS_WRITER_FREE ) );
   p->sky->name=NULL;
 
 
@@ -200,11 +215,20 @@ noisechisel_output(struct noisechiselparams *p)
   gal_fits_key_list_add(&keys, GAL_TYPE_FLOAT32, "MEDSTD", 0, &p->medstd, 0,
                         "Median raw tile standard deviation", 0,
                         p->input->unit, 0);
-  gal_tile_full_values_write(p->std, &p->cp.tl, !p->ignoreblankintiles,
-                             p->cp.output, keys, PROGRAM_NAME);
+  disp=gal_tile_full_values_for_write(p->std, &p->cp.tl,
+                                      !p->ignoreblankintiles);
+  gal_fits_writer_img(writer, disp, p->cp.output, keys, PROGRAM_NAME,
+                      p->cp.compress, ( disp==p->std
+                                        ? GAL_FITS_WRITER_BORROW
+                                        : GAL_FITS_WRITER_FREE ) );
   p->std->name=NULL;
 
 
+  /* Wait for all the extensions to be written (the datasets may be freed
+     afterwards and the configuration keywords go into the same file). */
+  gal_fits_writer_finish(writer);
+
+
   /* Write the configuration keywords. */
   gal_fits_key_write_filename("input", p->inputname, &p->cp.okeys, 1,
                               p->cp.quiet);
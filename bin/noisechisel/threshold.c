@@ -29,6 +29,7 @@ along with Gnuastro. If not, see <http://www.gnu.org/licenses/>.
 #include <stdlib.h>
 
 #include <gnuastro/fits.h>
+#include <gnuastro/tile.h>
 #include <gnuastro/blank.h>
 #include <gnuastro/threads.h>
 #include <gnuastro/pointer.h>
@@ -68,7 +69,60 @@ struct threshold_apply_p
 
 
 
-/* Apply the threshold on the tiles given to this thread. */
+/* Apply the quantile threshold on one contiguous row of a tile: pixels
+   above 'v1' get a value of 1, and if they are also above 'v2', they get
+   'THRESHOLD_NO_ERODE_VALUE'. When the '>' comparison fails, it can be
+   either because the pixel was actually smaller than the threshold, or
+   that it was a NaN value. In the first case, the output is 0, in the
+   second, it is blank.
+
+   The comparisons are used as numbers (not as conditions for branches)
+   and the two pointers don't overlap ('restrict'), so the compiler can
+   vectorize these loops. The check for blank values is constant over the
+   whole tile, so it is done once outside the loop. */
+static void
+threshold_apply_row_quantile(float *restrict in, uint8_t *restrict out,
+                             size_t n, float v1, float v2, int hasblank)
+{
+  size_t i;
+  if(hasblank)
+    for(i=0;i<n;++i)
+      out[i] = ( in[i]==in[i]
+                 ? (in[i]>v1) * ( 1 + (in[i]>v2)
+                                  * (THRESHOLD_NO_ERODE_VALUE-1) )
+                 : GAL_BLANK_UINT8 );
+  else
+    for(i=0;i<n;++i)
+      out[i] = (in[i]>v1) * ( 1 + (in[i]>v2)*(THRESHOLD_NO_ERODE_VALUE-1) );
+}
+
+
+
+
+
+/* Similar to 'threshold_apply_row_quantile', but for a Sky and Sky
+   standard deviation threshold: pixels that are more than 'dthresh'
+   standard deviations above the Sky get a value of 1. */
+static void
+threshold_apply_row_sky_std(float *restrict in, uint8_t *restrict out,
+                            size_t n, float sky, float th, int hasblank)
+{
+  size_t i;
+  if(hasblank)
+    for(i=0;i<n;++i)
+      out[i] = in[i]==in[i] ? (in[i]-sky > th) : GAL_BLANK_UINT8;
+  else
+    for(i=0;i<n;++i)
+      out[i] = in[i]-sky > th;
+}
+
+
+
+
+
+/* Apply the threshold on the tiles given to this thread. Each tile is
+   parsed as a series of contiguous rows (in the input and in
+   'p->binary'), where the kernels above can be applied. */
 static void *
 threshold_apply_on_thread(void *in_prm)
 {
@@ -76,10 +130,18 @@ threshold_apply_on_thread(void *in_prm)
   struct threshold_apply_p *taprm=(struct threshold_apply_p *)(tprm->params);
   struct noisechiselparams *p=taprm->p;
 
-  size_t i, tid;
-  void *tarray=NULL;
-  gal_data_t *tile, *tblock=NULL;
-  float *value1=taprm->value1, *value2=taprm->value2;
+  int hasblank;
+  gal_data_t *tile, *work;
+  size_t i, tid, start, rowlen, increment, num_increment;
+  float *value1=taprm->value1, *value2=taprm->value2, *in;
+  uint8_t *out, *binary=p->binary->array;
+  size_t s_e_ind[2];
+
+  /* The quantile threshold is applied on the convolved image (if it
+     exists). */
+  work = ( taprm->kind==THRESHOLD_QUANTILES && p->conv
+           ? p->conv
+           : p->input );
 
   /* Go over all the tiles assigned to this thread. */
   for(i=0; tprm->indexs[i] != GAL_BLANK_SIZE_T; ++i)
@@ -87,64 +149,44 @@ threshold_apply_on_thread(void *in_prm)
       /* For easy reading. */
       tid=tprm->indexs[i];
       tile=&p->cp.tl.tiles[tid];
-
-      /* Based on the kind of threshold. */
-      switch(taprm->kind)
+      rowlen=tile->dsize[tile->ndim-1];
+      hasblank=tile->flag & GAL_DATA_FLAG_HASBLANK;
+
+      /* Starting pointers of this tile in the work and binary arrays. */
+      in=gal_tile_start_end_ind_inclusive(tile, work, s_e_ind);
+      start=s_e_ind[0];
+      out=binary+start;
+
+      /* Go over the contiguous rows of this tile. */
+      increment=0;
+      num_increment=1;
+      while( start + increment <= s_e_ind[1] )
         {
-
-        /* This is a quantile threshold. */
-        case THRESHOLD_QUANTILES:
-          /* Correct the tile's pointers to apply the threshold on the
-             convolved image. */
-          if(p->conv)
+          switch(taprm->kind)
             {
-              tarray=tile->array; tblock=tile->block;
-              tile->array=gal_tile_block_relative_to_other(tile, p->conv);
-              tile->block=p->conv;
+            case THRESHOLD_QUANTILES:
+              threshold_apply_row_quantile(in+increment, out+increment,
+                                           rowlen, value1[tid], value2[tid],
+                                           hasblank);
+              break;
+
+            case THRESHOLD_SKY_STD:
+              threshold_apply_row_sky_std(in+increment, out+increment,
+                                          rowlen, value1[tid],
+                                          p->dthresh * value2[tid],
+                                          hasblank);
+              break;
+
+            default:
+              error(EXIT_FAILURE, 0, "%s: a bug! Please contact us at %s "
+                    "so we can address the problem. A value of %d had for "
+                    "'taprm->kind' is not valid", __func__,
+                    PACKAGE_BUGREPORT, taprm->kind);
             }
 
-          /* Apply the threshold: When the '>' comparison fails, it can be
-             either because the pixel was actually smaller than the
-             threshold, or that it was a NaN value. In the first case,
-             return 0, in the second, return a blank value.
-
-             We already know if a tile contains a blank value (which is a
-             constant over the whole loop). So before checking if the value
-             is blank, see if the tile actually has a blank value. This
-             will help in efficiency, because the compiler can move this
-             check out of the loop and only check for NaN values when we
-             know the tile has blank pixels. */
-          GAL_TILE_PO_OISET(float, uint8_t, tile, p->binary, 1, 0, {
-              *o = ( *i > value1[tid]
-                     ? ( *i > value2[tid] ? THRESHOLD_NO_ERODE_VALUE : 1 )
-                     : ( (tile->flag & GAL_DATA_FLAG_HASBLANK) && !(*i==*i)
-                         ? GAL_BLANK_UINT8 : 0 ) );
-            });
-
-          /* Revert the tile's pointers back to what they were. */
-          if(p->conv) { tile->array=tarray; tile->block=tblock; }
-          break;
-
-
-        /* This is a Sky and Sky STD threshold. */
-        case THRESHOLD_SKY_STD:
-
-          /* See the explanation above the same step in the quantile
-             threshold for an explanation. */
-          GAL_TILE_PO_OISET(float, uint8_t, tile, p->binary, 1, 0, {
-              *o = ( ( *i - value1[tid] > p->dthresh * value2[tid] )
-                     ? 1
-                     : ( (tile->flag & GAL_DATA_FLAG_HASBLANK) && !(*i==*i)
-                         ? GAL_BLANK_UINT8 : 0 ) );
-            });
-          break;
-
-
-        default:
-          error(EXIT_FAILURE, 0, "%s: a bug! Please contact us at %s so we "
-                "can address the problem. A value of %d had for "
-                "'taprm->kind' is not valid", __func__, PACKAGE_BUGREPORT,
-                taprm->kind);
+          /* Go to the next contiguous row of the tile. */
+          increment += gal_tile_block_increment(work, tile->dsize,
+                                                num_increment++, NULL);
         }
     }
 
@@ -225,8 +267,8 @@ threshold_write_sn_table(struct noisechiselparams *p, gal_data_t *insn,
      because when the output is a FITS table, we want all the tables in one
      FITS file. We have already deleted any existing file with the same
      name in 'ui_set_output_names'.*/
-  gal_table_write(cols, NULL, comments, p->cp.tableformat, filename,
-                  extname, 0);
+  gal_table_write_threads(cols, NULL, comments, p->cp.tableformat, filename,
+                          extname, 0, p->cp.numthreads);
 
 
   /* Clean up (if necessary). */
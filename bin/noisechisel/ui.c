@@ -606,10 +606,11 @@ ui_preparations_read_input(struct noisechiselparams *p)
   /* Read the input as a single precision floating point dataset, also load
      the WCS and finally remove any possibly existing extra dimensions
      (with a length of 1). */
-  p->input = gal_array_read_one_ch_to_type(p->inputname, p->cp.hdu,
-                                           NULL, GAL_TYPE_FLOAT32,
-                                           p->cp.minmapsize,
-                                           p->cp.quietmmap);
+  p->input = gal_array_read_one_ch_to_type_threads(p->inputname, p->cp.hdu,
+                                                   NULL, GAL_TYPE_FLOAT32,
+                                                   p->cp.numthreads,
+                                                   p->cp.minmapsize,
+                                                   p->cp.quietmmap);
   p->input->wcs = gal_wcs_read(p->inputname, p->cp.hdu,
                                p->cp.wcslinearmatrix, 0, 0,
                                &p->input->nwcs);
@@ -679,10 +680,12 @@ ui_preparations(struct noisechiselparams *p)
   if(p->convolvedname)
     {
       /* Read the input convolved image. */
-      p->conv = gal_array_read_one_ch_to_type(p->convolvedname, p->chdu,
-                                              NULL, GAL_TYPE_FLOAT32,
-                                              p->cp.minmapsize,
-                                              p->cp.quietmmap);
+      p->conv = gal_array_read_one_ch_to_type_threads(p->convolvedname,
+                                                      p->chdu, NULL,
+                                                      GAL_TYPE_FLOAT32,
+                                                      p->cp.numthreads,
+                                                      p->cp.minmapsize,
+                                                      p->cp.quietmmap);
 
       /* Make sure the convolved image is the same size as the input. */
       if( gal_dimension_is_different(p->input, p->conv) )
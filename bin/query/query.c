@@ -269,9 +269,9 @@ query_output_data(struct queryparams *p)
   table=gal_table_read(p->downloadname, "1", NULL, NULL,
                        GAL_TABLE_SEARCH_NAME, 1, p->cp.numthreads,
                        p->cp.minmapsize, p->cp.quietmmap, NULL);
-  gal_table_write(table, NULL, NULL, p->cp.tableformat,
-                  p->cp.output ? p->cp.output : p->cp.output,
-                  "QUERY", 0);
+  gal_table_write_threads(table, NULL, NULL, p->cp.tableformat,
+                          p->cp.output ? p->cp.output : p->cp.output, "QUERY",
+                          0, p->cp.numthreads);
 
   /* Get basic information about the table and free it. */
   p->outtableinfo[0]=table->size;
@@ -555,8 +555,8 @@ clumps_write_sn_table(struct segmentparams *p, gal_data_t *insn,
   gal_table_comments_add_intro(&comments, PROGRAM_STRING, &p->rawtime);
 
   /* write the table. */
-  gal_table_write(cols, NULL, comments, p->cp.tableformat, filename,
-                  "SKY_CLUMP_SN", 0);
+  gal_table_write_threads(cols, NULL, comments, p->cp.tableformat, filename,
+                          "SKY_CLUMP_SN", 0, p->cp.numthreads);
 
   /* Clean up (if necessary). */
   if(sn!=insn) gal_data_free(sn);
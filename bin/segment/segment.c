@@ -1064,8 +1064,9 @@ segment_save_sn_table(struct clumps_params *clprm)
   /* Set the column pointers and write them into a table.. */
   clumpinobj->next=sn;
   objind->next=clumpinobj;
-  gal_table_write(objind, NULL, comments, p->cp.tableformat, p->clumpsn_d_name,
-                  "DET_CLUMP_SN", 0);
+  gal_table_write_threads(objind, NULL, comments, p->cp.tableformat,
+                          p->clumpsn_d_name, "DET_CLUMP_SN", 0,
+                          p->cp.numthreads);
 
 
   /* Clean up. */
@@ -1380,11 +1381,16 @@ void
 segment_output(struct segmentparams *p)
 {
   float *f, *ff;
+  gal_data_t *disp;
   gal_fits_list_key_t *keys=NULL;
+  gal_fits_writer_t *writer=gal_fits_writer_start(2, p->cp.numthreads>1);
 
-  /* The Sky-subtracted input (if requested). */
+  /* The Sky-subtracted input (if requested). The extensions are written
+     on a separate thread (when possible), so the next extensions can be
+     prepared while the previous ones are being written. */
   if(!p->rawoutput)
-    gal_fits_img_write(p->input, p->cp.output, NULL, PROGRAM_NAME);
+    gal_fits_writer_img(writer, p->input, p->cp.output, NULL, PROGRAM_NAME,
+                        p->cp.compress, GAL_FITS_WRITER_BORROW);
 
 
   /* The clump labels. */
@@ -1395,7 +1401,8 @@ segment_output(struct segmentparams *p)
                         &p->numclumps, 0, "Total number of clumps", 0,
                         "counter", 0);
   p->clabel->name="CLUMPS";
-  gal_fits_img_write(p->clabel, p->cp.output, keys, PROGRAM_NAME);
+  gal_fits_writer_img(writer, p->clabel, p->cp.output, keys, PROGRAM_NAME,
+                      p->cp.compress, GAL_FITS_WRITER_BORROW);
   p->clabel->name=NULL;
   keys=NULL;
 
@@ -1407,7 +1414,9 @@ segment_output(struct segmentparams *p)
                             &p->numobjects, 0, "Total number of objects", 0,
                             "counter", 0);
       p->olabel->name="OBJECTS";
-      gal_fits_img_write(p->olabel, p->cp.output, keys, PROGRAM_NAME);
+      gal_fits_writer_img(writer, p->olabel, p->cp.output, keys,
+                          PROGRAM_NAME, p->cp.compress,
+                          GAL_FITS_WRITER_BORROW);
       p->olabel->name=NULL;
       keys=NULL;
     }
@@ -1441,14 +1450,20 @@ segment_output(struct segmentparams *p)
 
       /* Write the STD dataset into the output file. */
       p->std->name="SKY_STD";
-      if(p->std->size == p->input->size)
-        gal_fits_img_write(p->std, p->cp.output, keys, PROGRAM_NAME);
-      else
-        gal_tile_full_values_write(p->std, &p->cp.tl, 1, p->cp.output, keys,
-                                   PROGRAM_NAME);
+      disp = ( p->std->size == p->input->size
+               ? p->std
+               : gal_tile_full_values_for_write(p->std, &p->cp.tl, 1) );
+      gal_fits_writer_img(writer, disp, p->cp.output, keys, PROGRAM_NAME,
+                          p->cp.compress, ( disp==p->std
+                                            ? GAL_FITS_WRITER_BORROW
+                                            : GAL_FITS_WRITER_FREE ) );
       p->std->name=NULL;
     }
 
+  /* Wait for all the extensions to be written (the datasets may be freed
+     afterwards and the configuration keywords go into the same file). */
+  gal_fits_writer_finish(writer);
+
   /* Write the configuration keywords. */
   gal_fits_key_write_filename("input", p->inputname, &p->cp.okeys, 1,
                               p->cp.quiet);
@@ -411,10 +411,11 @@ ui_prepare_inputs(struct segmentparams *p)
   gal_data_t *maxd, *ccin, *blankflag, *ccout=NULL;
 
   /* Read the input as a single precision floating point dataset. */
-  p->input = gal_array_read_one_ch_to_type(p->inputname, p->cp.hdu,
-                                           NULL, GAL_TYPE_FLOAT32,
-                                           p->cp.minmapsize,
-                                           p->cp.quietmmap);
+  p->input = gal_array_read_one_ch_to_type_threads(p->inputname, p->cp.hdu,
+                                                   NULL, GAL_TYPE_FLOAT32,
+                                                   p->cp.numthreads,
+                                                   p->cp.minmapsize,
+                                                   p->cp.quietmmap);
   p->input->wcs = gal_wcs_read(p->inputname, p->cp.hdu,
                                p->cp.wcslinearmatrix, 0, 0,
                                &p->input->nwcs);
@@ -442,10 +443,12 @@ ui_prepare_inputs(struct segmentparams *p)
   if(p->convolvedname)
     {
       /* Read the input convolved image. */
-      p->conv = gal_array_read_one_ch_to_type(p->convolvedname, p->chdu,
-                                              NULL, GAL_TYPE_FLOAT32,
-                                              p->cp.minmapsize,
-                                              p->cp.quietmmap);
+      p->conv = gal_array_read_one_ch_to_type_threads(p->convolvedname,
+                                                      p->chdu, NULL,
+                                                      GAL_TYPE_FLOAT32,
+                                                      p->cp.numthreads,
+                                                      p->cp.minmapsize,
+                                                      p->cp.quietmmap);
       p->conv->ndim=gal_dimension_remove_extra(p->conv->ndim,
                                                p->conv->dsize,
                                                p->conv->wcs);
@@ -465,9 +468,10 @@ ui_prepare_inputs(struct segmentparams *p)
   if( strcmp(p->useddetectionname, DETECTION_ALL) )
     {
       /* Read the dataset into memory. */
-      p->olabel = gal_array_read_one_ch(p->useddetectionname, p->dhdu,
-                                        NULL, p->cp.minmapsize,
-                                        p->cp.quietmmap);
+      p->olabel = gal_array_read_one_ch_threads(p->useddetectionname, p->dhdu,
+                                                NULL, p->cp.numthreads,
+                                                p->cp.minmapsize,
+                                                p->cp.quietmmap);
       p->olabel->ndim=gal_dimension_remove_extra(p->olabel->ndim,
                                                  p->olabel->dsize, NULL);
       if( gal_dimension_is_different(p->input, p->olabel) )
@@ -773,9 +777,11 @@ ui_read_std_and_sky(struct segmentparams *p)
               "option)");
 
       /* Read the STD image. */
-      p->std=gal_array_read_one_ch_to_type(p->usedstdname, p->stdhdu,
-                                           NULL, GAL_TYPE_FLOAT32,
-                                           p->cp.minmapsize, p->cp.quietmmap);
+      p->std=gal_array_read_one_ch_to_type_threads(p->usedstdname, p->stdhdu,
+                                                   NULL, GAL_TYPE_FLOAT32,
+                                                   p->cp.numthreads,
+                                                   p->cp.minmapsize,
+                                                   p->cp.quietmmap);
       p->std->ndim=gal_dimension_remove_extra(p->std->ndim,
                                               p->std->dsize, NULL);
 
@@ -833,9 +839,11 @@ ui_read_std_and_sky(struct segmentparams *p)
                   "HDU will be necessary");
 
           /* Read the Sky dataset. */
-          sky=gal_array_read_one_ch_to_type(p->skyname, p->skyhdu,
-                                            NULL, GAL_TYPE_FLOAT32,
-                                            p->cp.minmapsize, p->cp.quietmmap);
+          sky=gal_array_read_one_ch_to_type_threads(p->skyname, p->skyhdu,
+                                                    NULL, GAL_TYPE_FLOAT32,
+                                                    p->cp.numthreads,
+                                                    p->cp.minmapsize,
+                                                    p->cp.quietmmap);
           sky->ndim=gal_dimension_remove_extra(sky->ndim, sky->dsize,
                                                NULL);
 
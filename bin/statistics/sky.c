@@ -135,6 +135,24 @@ sky_on_thread(void *in_prm)
 
 
 
+/* Write the final tile values (one element per tile or over the full
+   image) as a FITS image. Unlike 'gal_tile_full_values_write', this also
+   applies the '--compress' option (check images are not compressed). */
+static void
+sky_write_values(struct statisticsparams *p, gal_data_t *values,
+                 char *filename)
+{
+  gal_data_t *disp=gal_tile_full_values_for_write(values, &p->cp.tl,
+                                                  !p->ignoreblankintiles);
+  gal_fits_img_write_compress(disp, filename, NULL, PROGRAM_NAME,
+                              p->cp.compress);
+  if(disp!=values) gal_data_free(disp);
+}
+
+
+
+
+
 void
 sky(struct statisticsparams *p)
 {
@@ -282,10 +300,8 @@ sky(struct statisticsparams *p)
   p->sky_t->name="SKY";
   p->std_t->name="SKY_STD";
   p->cp.keepinputdir=keepinputdir;
-  gal_tile_full_values_write(p->sky_t, tl, !p->ignoreblankintiles, outname,
-                             NULL, PROGRAM_NAME);
-  gal_tile_full_values_write(p->std_t, tl, !p->ignoreblankintiles, outname,
-                             NULL, PROGRAM_NAME);
+  sky_write_values(p, p->sky_t, outname);
+  sky_write_values(p, p->std_t, outname);
   p->sky_t->name = p->std_t->name = NULL;
   gal_fits_key_write_filename("input", p->inputname, &p->cp.okeys, 1,
                               p->cp.quiet);
@@ -678,8 +678,8 @@ write_output_table(struct statisticsparams *p, gal_data_t *table,
 
   /* Write the table. */
   gal_checkset_writable_remove(output, p->inputname, 0, p->cp.dontdelete);
-  gal_table_write(table, NULL, comments, p->cp.tableformat, output,
-                  "TABLE", 0);
+  gal_table_write_threads(table, NULL, comments, p->cp.tableformat, output,
+                          "TABLE", 0, p->cp.numthreads);
 
 
   /* Write the configuration information if we have a FITS output. */
@@ -859,7 +859,8 @@ histogram_2d(struct statisticsparams *p)
 
       /* Write the output. */
       output=statistics_output_name(p, suf, &isfits);
-      gal_fits_img_write(img, output, NULL, PROGRAM_STRING);
+      gal_fits_img_write_compress(img, output, NULL, PROGRAM_STRING,
+                                  p->cp.compress);
       gal_fits_key_write_filename("input", p->inputname, &p->cp.okeys, 1,
                                   p->cp.quiet);
       gal_fits_key_write_config(&p->cp.okeys, "Statistics configuration",
@@ -1372,8 +1373,9 @@ statistics_fit_estimate(struct statisticsparams *p, gal_data_t *fit,
             printf("  Written to: %s\n", p->cp.output);
         }
       keys=statistics_fit_params_to_keys(p, fit, whtnat, redchisq);
-      gal_table_write(p->fitestval, &keys, NULL, p->cp.tableformat,
-                      p->cp.output, "FIT_ESTIMATE", 0);
+      gal_table_write_threads(p->fitestval, &keys, NULL, p->cp.tableformat,
+                              p->cp.output, "FIT_ESTIMATE", 0,
+                              p->cp.numthreads);
     }
 
   /* Print estimated value on the commandline. */
@@ -1135,8 +1135,9 @@ ui_preparations(struct statisticsparams *p)
   if(p->isfits && p->hdu_type==IMAGE_HDU)
     {
       p->inputformat=INPUT_FORMAT_IMAGE;
-      p->input=gal_array_read_one_ch(p->inputname, cp->hdu, NULL,
-                                     cp->minmapsize, p->cp.quietmmap);
+      p->input=gal_array_read_one_ch_threads(p->inputname, cp->hdu, NULL,
+                                             cp->numthreads, cp->minmapsize,
+                                             p->cp.quietmmap);
       p->input->wcs=gal_wcs_read(p->inputname, cp->hdu,
                                  p->cp.wcslinearmatrix, 0, 0,
                                  &p->input->nwcs);
@@ -1187,8 +1188,9 @@ ui_preparations(struct statisticsparams *p)
             {
               gal_checkset_writable_remove(tl->tilecheckname, p->inputname,
                                            0, cp->dontdelete);
-              gal_table_write(check, NULL, NULL, cp->tableformat,
-                              tl->tilecheckname, "TABLE", 0);
+              gal_table_write_threads(check, NULL, NULL, cp->tableformat,
+                                      tl->tilecheckname, "TABLE", 0,
+                                      cp->numthreads);
             }
           gal_data_free(check);
         }
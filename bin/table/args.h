@@ -135,6 +135,19 @@ struct argp_option program_options[] =
       GAL_OPTIONS_NOT_MANDATORY,
       GAL_OPTIONS_NOT_SET
     },
+    {
+      "streamrows",
+      UI_KEY_STREAMROWS,
+      "INT",
+      0,
+      "Process FITS input in chunks of INT rows.",
+      GAL_OPTIONS_GROUP_INPUT,
+      &p->streamrows,
+      GAL_TYPE_SIZE_T,
+      GAL_OPTIONS_RANGE_GE_0,
+      GAL_OPTIONS_NOT_MANDATORY,
+      GAL_OPTIONS_NOT_SET
+    },
 
 
 
@@ -370,10 +370,6 @@ arithmetic_indexs_final(struct tableparams *p)
   struct column_pack *tmp;
   struct arithmetic_token *atmp;
 
-  /* Set the column array that will allow removal of some read columns
-     (where operations will be done). */
-  p->colarray=gal_list_data_to_array_ptr(p->table, &p->numcolarray);
-
   /* go over each package of columns. */
   for(tmp=p->outcols;tmp!=NULL;tmp=tmp->next)
     {
@@ -439,13 +435,18 @@ arithmetic_indexs_final(struct tableparams *p)
 /*********************************************************************/
 /********************       Low-level tools      *********************/
 /*********************************************************************/
+/* Counter for the placeholder names of the arithmetic outputs (reset in
+   every call to 'arithmetic_operate', so when the table is processed in
+   chunks, all chunks get the same names). */
+static size_t arithmetic_placeholder_counter=0;
+
 static void
 arithmetic_placeholder_name(gal_data_t *col)
 {
-  static size_t counter=0;
+  size_t counter;
 
   /* Increment counter next time this function is called. */
-  ++counter;
+  counter=++arithmetic_placeholder_counter;
 
   /* Free any possibly existing metadata. */
   if(col->name)    free(col->name);
@@ -1137,20 +1138,30 @@ arithmetic_reverse_polish(struct tableparams *p,
           token->loadcol=NULL;
         }
 
-      /* Constant number: just put it on top of the stack. */
+      /* Constant number: just put it on top of the stack. When the table
+         is processed in chunks, the constant is necessary for the next
+         chunks also, so a copy is used. */
       else if(token->constant)
         {
-          gal_list_data_add(&stack, token->constant);
-          token->constant=NULL;
+          if(p->iter)
+            gal_list_data_add(&stack, gal_data_copy(token->constant));
+          else
+            {
+              gal_list_data_add(&stack, token->constant);
+              token->constant=NULL;
+            }
         }
 
       /* The column wasn't in the main input. */
       else if(token->id_at_usage)
         {
           gal_list_data_add(&stack, arithmetic_read_at_usage(p, token));
-          token->num_at_usage=GAL_BLANK_SIZE_T;
-          free(token->id_at_usage);
-          token->id_at_usage=NULL;
+          if(p->iter==NULL)
+            {
+              token->num_at_usage=GAL_BLANK_SIZE_T;
+              free(token->id_at_usage);
+              token->id_at_usage=NULL;
+            }
         }
 
       /* A column from the table. */
@@ -1221,14 +1232,75 @@ arithmetic_reverse_polish(struct tableparams *p,
 /*********************************************************************/
 /********************         High-level         *********************/
 /*********************************************************************/
+/* See if all the arithmetic operations only depend on the values within
+   each row (so the table can be processed in chunks of rows). */
+int
+arithmetic_rowlocal(struct tableparams *p)
+{
+  struct column_pack *outpack;
+  struct arithmetic_token *token;
+
+  for(outpack=p->outcols; outpack!=NULL; outpack=outpack->next)
+    for(token=outpack->arith; token!=NULL; token=token->next)
+      {
+        /* Columns from other files have all the rows. */
+        if(token->loadcol) return 0;
+
+        /* Operators that need all the rows, or that depend on the number
+           or position of the rows. The random number generators are also
+           included here because each chunk would start with the same
+           seed. */
+        switch(token->operator)
+          {
+          case GAL_ARITHMETIC_OP_MINVAL:
+          case GAL_ARITHMETIC_OP_MAXVAL:
+          case GAL_ARITHMETIC_OP_NUMBERVAL:
+          case GAL_ARITHMETIC_OP_SUMVAL:
+          case GAL_ARITHMETIC_OP_MEANVAL:
+          case GAL_ARITHMETIC_OP_STDVAL:
+          case GAL_ARITHMETIC_OP_MEDIANVAL:
+          case GAL_ARITHMETIC_OP_UNIQUE:
+          case GAL_ARITHMETIC_OP_NOBLANK:
+          case GAL_ARITHMETIC_OP_MKNOISE_SIGMA:
+          case GAL_ARITHMETIC_OP_MKNOISE_POISSON:
+          case GAL_ARITHMETIC_OP_MKNOISE_UNIFORM:
+          case GAL_ARITHMETIC_OP_RANDOM_FROM_HIST:
+          case GAL_ARITHMETIC_OP_RANDOM_FROM_HIST_RAW:
+          case GAL_ARITHMETIC_OP_STITCH:
+          case GAL_ARITHMETIC_OP_MAKENEW:
+          case GAL_ARITHMETIC_OP_SIZE:
+          case GAL_ARITHMETIC_OP_INDEX:
+          case GAL_ARITHMETIC_OP_COUNTER:
+          case GAL_ARITHMETIC_OP_INDEXONLY:
+          case GAL_ARITHMETIC_OP_COUNTERONLY:
+          case ARITHMETIC_TABLE_OP_SORTEDTOINTERVAL:
+            return 0;
+          }
+      }
+
+  /* All the operations are row-local. */
+  return 1;
+}
+
+
+
+
+
 void
 arithmetic_operate(struct tableparams *p)
 {
   size_t i;
   struct column_pack *outpack;
 
-  /* Set the final indexs and define 'colarray'. */
-  arithmetic_indexs_final(p);
+  /* Set the final indexs (only once: when the table is processed in
+     chunks, this function is called on every chunk). */
+  if(p->iter==NULL || p->iter->nchunk==1) arithmetic_indexs_final(p);
+  arithmetic_placeholder_counter=0;
+
+  /* Set the column array that will allow removal of some read columns
+     (where operations will be done). */
+  if(p->colarray) free(p->colarray);
+  p->colarray=gal_list_data_to_array_ptr(p->table, &p->numcolarray);
 
   /* From now on, we will be looking for columns from the index in
      'colarray', so to keep things clean, we'll set all the 'next' elements
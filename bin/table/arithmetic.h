@@ -60,6 +60,9 @@ arithmetic_init(struct tableparams *p, struct arithmetic_token **arith,
 void
 arithmetic_token_free(struct arithmetic_token *list);
 
+int
+arithmetic_rowlocal(struct tableparams *p);
+
 void
 arithmetic_operate(struct tableparams *p);
 
@@ -26,6 +26,7 @@ along with Gnuastro. If not, see <http://www.gnu.org/licenses/>.
 /* Include necessary headers */
 #include <gsl/gsl_rng.h>
 #include <gnuastro/data.h>
+#include <gnuastro/table.h>
 
 #include <gnuastro-internal/options.h>
 #include <gnuastro-internal/arithmetic-set.h>
@@ -124,6 +125,7 @@ struct tableparams
   gal_list_str_t    *tovector;  /* Merge columns into a vector column.  */
   gal_list_str_t  *catrowfile;  /* Filename to concat column wise.      */
   gal_list_str_t   *catrowhdu;  /* HDU/extension for the catcolumn.     */
+  size_t           streamrows;  /* Num. rows to process in each chunk.  */
   gal_data_t     *colmetadata;  /* Set column metadata.                 */
   uint8_t             txteasy;  /* Easy/simple to ready txt output.     */
   char          *txtf32fmtstr;  /* Floating point formats (exp, flt).   */
@@ -154,6 +156,14 @@ struct tableparams
   size_t            *colmatch;  /* Number of matches found for columns. */
   uint8_t        txtf32format;  /* Floating point formats (exp, flt).   */
   uint8_t        txtf64format;  /* Floating point formats (exp, flt).   */
+  gal_data_t          *rowids;  /* Only read these rows of input.       */
+  size_t             rowstart;  /* First row to read from the input.    */
+  size_t               rownum;  /* Number of rows to read from input.   */
+  gal_table_iter_t      *iter;  /* Read input in chunks (streaming).    */
+  size_t              nselect;  /* Number of selection columns.         */
+  size_t         origoutncols;  /* Number of requested output columns.  */
+  size_t        *selectindout;  /* Index of selection cols. in read.    */
+  size_t       *selecttypeout;  /* Type of selection columns.           */
 
   /* For arithmetic operators. */
   gal_list_str_t  *wcstoimg_p;  /* Pointer to the node.                 */
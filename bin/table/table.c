@@ -37,7 +37,6 @@ along with Gnuastro. If not, see <http://www.gnu.org/licenses/>.
 #include <gnuastro/fits.h>
 #include <gnuastro/list.h>
 #include <gnuastro/table.h>
-#include <gnuastro/qsort.h>
 #include <gnuastro/pointer.h>
 #include <gnuastro/polygon.h>
 #include <gnuastro/arithmetic.h>
@@ -76,30 +75,17 @@ table_error_no_column(char *optionname, char *id)
 
 static void
 table_apply_permutation(gal_data_t *table, size_t *permutation,
-                        size_t permsize, int inverse)
+                        size_t permsize, int inverse, size_t numthreads)
 {
   gal_data_t *tmp;
 
+  /* Apply the permutation on all the columns (vector columns are permuted
+     along their rows). */
+  gal_permutation_apply_columns(table, permutation, inverse, numthreads);
+
+  /* Correct the size. */
   for(tmp=table;tmp!=NULL;tmp=tmp->next)
     {
-      /* Apply the permutation. */
-      if(inverse)
-        {
-          if(tmp->ndim==1)
-            gal_permutation_apply_inverse(tmp, permutation);
-          else
-            error(EXIT_FAILURE, 0, "%s: inverse permutation on "
-                  "vector columns is not yet supported. Please "
-                  "get in touch with us at '%s' to add this "
-                  "feature", __func__, PACKAGE_BUGREPORT);
-        }
-      else
-        {
-          if(tmp->ndim==1) gal_permutation_apply(tmp, permutation);
-          else    gal_permutation_apply_onlydim0(tmp, permutation);
-        }
-
-      /* Correct the size. */
       tmp->dsize[0]=permsize;
       tmp->size = tmp->dsize[0] * (tmp->ndim==1 ? 1 : tmp->dsize[1]);
     }
@@ -167,18 +153,18 @@ table_bring_to_top(gal_data_t *table, gal_data_t *rowids)
 
 
 static gal_data_t *
-table_selection_range(struct tableparams *p, gal_data_t *col)
+table_selection_range(gal_data_t *col, gal_data_t *range)
 {
   size_t one=1;
   double *darr;
   int numok=GAL_ARITHMETIC_FLAG_NUMOK;
   int inplace=GAL_ARITHMETIC_FLAG_INPLACE;
-  gal_data_t *min=NULL, *max=NULL, *tmp, *ltmin, *gemax=NULL;
+  gal_data_t *min=NULL, *max=NULL, *ltmin, *gemax=NULL;
 
   /* First, make sure everything is OK. */
-  if(p->range==NULL)
+  if(range==NULL)
     error(EXIT_FAILURE, 0, "%s: a bug! Please contact us to fix the "
-          "problem at %s. 'p->range' should not be NULL at this point",
+          "problem at %s. 'range' should not be NULL at this point",
           __func__, PACKAGE_BUGREPORT);
 
   /* Allocations. */
@@ -188,16 +174,10 @@ table_selection_range(struct tableparams *p, gal_data_t *col)
                      NULL, NULL, NULL);
 
   /* Read the range of values for this column. */
-  darr=p->range->array;
+  darr=range->array;
   ((double *)(min->array))[0] = darr[0];
   ((double *)(max->array))[0] = darr[1];
 
-  /* Move 'p->range' to the next element in the list and free the current
-     one (we have already read its values and don't need it any more). */
-  tmp=p->range;
-  p->range=p->range->next;
-  gal_data_free(tmp);
-
   /* Find all the elements outside this range (smaller than the minimum,
      larger than the maximum or blank) as separate binary flags.. */
   ltmin=gal_arithmetic(GAL_ARITHMETIC_OP_LT, 1, numok, col, min);
@@ -336,7 +316,7 @@ table_selection_string_eq_ne(gal_data_t *column, char *reference, int e0n1)
 
 
 static gal_data_t *
-table_selection_equal_or_notequal(struct tableparams *p, gal_data_t *col,
+table_selection_equal_or_notequal(gal_data_t *col, gal_data_t *arg,
                                   int e0n1)
 {
   void *varr;
@@ -345,7 +325,6 @@ table_selection_equal_or_notequal(struct tableparams *p, gal_data_t *col,
   int numok=GAL_ARITHMETIC_FLAG_NUMOK;
   int inplace=GAL_ARITHMETIC_FLAG_INPLACE;
   gal_data_t *eq, *out=NULL, *value=NULL;
-  gal_data_t *arg = e0n1 ? p->notequal : p->equal;
 
   /* Note that this operator is used to make the "masked" array, so when
      'e0n1==0' the operator should be 'GAL_ARITHMETIC_OP_NE' and
@@ -359,7 +338,7 @@ table_selection_equal_or_notequal(struct tableparams *p, gal_data_t *col,
   /* First, make sure everything is OK. */
   if(arg==NULL)
     error(EXIT_FAILURE, 0, "%s: a bug! Please contact us to fix the "
-          "problem at %s. 'p->range' should not be NULL at this point",
+          "problem at %s. 'arg' should not be NULL at this point",
           __func__, PACKAGE_BUGREPORT);
 
   /* To easily parse the given values. */
@@ -410,15 +389,8 @@ table_selection_equal_or_notequal(struct tableparams *p, gal_data_t *col,
   */
 
 
-  /* Move the main pointer to the next possible call of the given
-     option. Note that 'arg' already points to 'p->equal' or 'p->notequal',
-     so it will automatically be freed with the next step.*/
-  if(e0n1) p->notequal=p->notequal->next;
-  else     p->equal=p->equal->next;
-
   /* Clean up and return. */
   gal_data_free(value);
-  gal_data_free(arg);
   return out;
 }
 
@@ -426,27 +398,25 @@ table_selection_equal_or_notequal(struct tableparams *p, gal_data_t *col,
 
 
 
-static void
-table_select_by_value(struct tableparams *p)
+/* Build the mask of rows to remove (with a value of 1) from the columns
+   in 'selectcol'. The option values ('p->range', 'p->equal' and
+   'p->notequal') are not changed, so this can be called on separate
+   blocks of rows. */
+gal_data_t *
+table_select_mask(struct tableparams *p, struct list_select *selectcol,
+                  size_t *dsize)
 {
-  gal_data_t *rowids;
   struct list_select *tmp;
-  uint8_t *u, *uf, *ustart;
-  size_t i, *s, ngood=0;
   int inplace=GAL_ARITHMETIC_FLAG_INPLACE;
   gal_data_t *mask, *blmask, *addmask=NULL;
-
-  /* It may happen that the input table is empty! In such cases, just
-     return and don't bother with this step. */
-  if(p->table->size==0 || p->table->array==NULL || p->table->dsize==NULL)
-    return;
+  gal_data_t *range=p->range, *equal=p->equal, *notequal=p->notequal;
 
   /* Allocate datasets for the necessary numbers and write them in. */
-  mask=gal_data_alloc(NULL, GAL_TYPE_UINT8, 1, p->table->dsize, NULL, 1,
+  mask=gal_data_alloc(NULL, GAL_TYPE_UINT8, 1, dsize, NULL, 1,
                       p->cp.minmapsize, p->cp.quietmmap, NULL, NULL, NULL);
 
   /* Go over each selection criteria and remove the necessary elements. */
-  for(tmp=p->selectcol;tmp!=NULL;tmp=tmp->next)
+  for(tmp=selectcol;tmp!=NULL;tmp=tmp->next)
     {
       /* Make sure the input isn't a vector column. */
       if(tmp->col->ndim!=1)
@@ -456,11 +426,13 @@ table_select_by_value(struct tableparams *p)
               "this feature, please get in touch with us at '%s' to add "
               "it", PACKAGE_BUGREPORT);
 
-      /* Do the specific type of selection. */
+      /* Do the specific type of selection. Each call to '--range',
+         '--equal' or '--notequal' is used for one selection column. */
       switch(tmp->type)
         {
         case SELECT_TYPE_RANGE:
-          addmask=table_selection_range(p, tmp->col);
+          addmask=table_selection_range(tmp->col, range);
+          range=range->next;
           break;
 
         /* '--inpolygon' and '--outpolygon' need two columns. */
@@ -472,11 +444,13 @@ table_select_by_value(struct tableparams *p)
           break;
 
         case SELECT_TYPE_EQUAL:
-          addmask=table_selection_equal_or_notequal(p, tmp->col, 0);
+          addmask=table_selection_equal_or_notequal(tmp->col, equal, 0);
+          equal=equal->next;
           break;
 
         case SELECT_TYPE_NOTEQUAL:
-          addmask=table_selection_equal_or_notequal(p, tmp->col, 1);
+          addmask=table_selection_equal_or_notequal(tmp->col, notequal, 1);
+          notequal=notequal->next;
           break;
 
         case SELECT_TYPE_NOBLANK:
@@ -523,6 +497,30 @@ table_select_by_value(struct tableparams *p)
       gal_data_free(addmask);
     }
 
+  /* Return the mask. */
+  return mask;
+}
+
+
+
+
+
+static void
+table_select_by_value(struct tableparams *p)
+{
+  size_t i, *s, ngood=0;
+  struct list_select *tmp;
+  uint8_t *u, *uf, *ustart;
+  gal_data_t *mask, *rowids;
+
+  /* It may happen that the input table is empty! In such cases, just
+     return and don't bother with this step. */
+  if(p->table->size==0 || p->table->array==NULL || p->table->dsize==NULL)
+    return;
+
+  /* Build the mask of rows to remove. */
+  mask=table_select_mask(p, p->selectcol, p->table->dsize);
+
   /* Find the final number of elements to print and allocate the array to
      keep them. */
   uf=(u=mask->array)+mask->size;
@@ -551,6 +549,14 @@ table_select_by_value(struct tableparams *p)
   for(tmp=p->selectcol;tmp!=NULL;tmp=tmp->next)
     { if(p->freeselect[i]) {gal_data_free(tmp->col); tmp->col=NULL;} ++i; }
   ui_list_select_free(p->selectcol, 0);
+  p->selectcol=NULL;
+  if(p->iter==NULL)  /* Necessary for next chunks when streaming. */
+    {
+      gal_list_data_free(p->notequal);
+      gal_list_data_free(p->equal);
+      gal_list_data_free(p->range);
+      p->range=p->equal=p->notequal=NULL;
+    }
   free(p->freeselect);
   gal_data_free(mask);
   gal_data_free(rowids);
@@ -564,18 +570,16 @@ static void
 table_sort(struct tableparams *p)
 {
   gal_data_t *perm;
-  size_t c=0, *s, *sf, dsize0=p->table->dsize[0];
-  int (*qsortfn)(const void *, const void *)=NULL;
+  size_t dsize0=p->table->dsize[0];
 
   /* In case there are no columns to sort, skip this function. */
   if(p->table->size==0 || p->table->array==NULL || p->table->dsize==NULL)
     return;
 
-  /* Allocate the permutation array and fill it. Note that we need 'dsize0'
-     because the first column may be a vector column (which is 2D). */
+  /* Allocate the permutation array. Note that we need 'dsize0' because
+     the first column may be a vector column (which is 2D). */
   perm=gal_data_alloc(NULL, GAL_TYPE_SIZE_T, 1, &dsize0, NULL, 0,
                       p->cp.minmapsize, p->cp.quietmmap, NULL, NULL, NULL);
-  sf=(s=perm->array)+perm->size; do *s=c++; while(++s<sf);
 
   /* For string columns, print a descriptive message. Note that some FITS
      tables were found that do actually have numbers stored in string
@@ -593,50 +597,13 @@ table_sort(struct tableparams *p)
           "section of the book/manual):\n\n"
           "    $ info gnuastro \"gnuastro text table format\"");
 
-  /* Set the proper qsort function. */
-  if(p->descending)
-    switch(p->sortcol->type)
-      {
-      case GAL_TYPE_UINT8:   qsortfn=gal_qsort_index_single_uint8_d;   break;
-      case GAL_TYPE_INT8:    qsortfn=gal_qsort_index_single_int8_d;    break;
-      case GAL_TYPE_UINT16:  qsortfn=gal_qsort_index_single_uint16_d;  break;
-      case GAL_TYPE_INT16:   qsortfn=gal_qsort_index_single_int16_d;   break;
-      case GAL_TYPE_UINT32:  qsortfn=gal_qsort_index_single_uint32_d;  break;
-      case GAL_TYPE_INT32:   qsortfn=gal_qsort_index_single_int32_d;   break;
-      case GAL_TYPE_UINT64:  qsortfn=gal_qsort_index_single_uint64_d;  break;
-      case GAL_TYPE_INT64:   qsortfn=gal_qsort_index_single_int64_d;   break;
-      case GAL_TYPE_FLOAT32: qsortfn=gal_qsort_index_single_float32_d; break;
-      case GAL_TYPE_FLOAT64: qsortfn=gal_qsort_index_single_float64_d; break;
-      default:
-        error(EXIT_FAILURE, 0, "%s: a bug! Please contact us at %s to fix "
-              "the problem. The code '%u' wasn't recognized as a data type",
-              __func__, PACKAGE_BUGREPORT, p->sortcol->type);
-      }
-  else
-    switch(p->sortcol->type)
-      {
-      case GAL_TYPE_UINT8:   qsortfn=gal_qsort_index_single_uint8_i;   break;
-      case GAL_TYPE_INT8:    qsortfn=gal_qsort_index_single_int8_i;    break;
-      case GAL_TYPE_UINT16:  qsortfn=gal_qsort_index_single_uint16_i;  break;
-      case GAL_TYPE_INT16:   qsortfn=gal_qsort_index_single_int16_i;   break;
-      case GAL_TYPE_UINT32:  qsortfn=gal_qsort_index_single_uint32_i;  break;
-      case GAL_TYPE_INT32:   qsortfn=gal_qsort_index_single_int32_i;   break;
-      case GAL_TYPE_UINT64:  qsortfn=gal_qsort_index_single_uint64_i;  break;
-      case GAL_TYPE_INT64:   qsortfn=gal_qsort_index_single_int64_i;   break;
-      case GAL_TYPE_FLOAT32: qsortfn=gal_qsort_index_single_float32_i; break;
-      case GAL_TYPE_FLOAT64: qsortfn=gal_qsort_index_single_float64_i; break;
-      default:
-        error(EXIT_FAILURE, 0, "%s: a bug! Please contact us at %s to fix "
-              "the problem. The code '%u' wasn't recognized as a data type",
-              __func__, PACKAGE_BUGREPORT, p->sortcol->type);
-      }
-
-  /* Sort the indexs from the values. */
-  gal_qsort_index_single=p->sortcol->array;
-  qsort(perm->array, perm->size, sizeof *s, qsortfn);
+  /* Find the indexs that sort the column. */
+  gal_statistics_sort_index(p->sortcol, perm->array, p->descending,
+                            p->cp.numthreads);
 
   /* For a check (only on float32 type 'sortcol'):
   {
+    size_t *s, *sf;
     float *f=p->sortcol->array;
     sf=(s=perm->array)+perm->size;
     do printf("%f\n", f[*s]); while(++s<sf);
@@ -645,7 +612,8 @@ table_sort(struct tableparams *p)
   */
 
   /* Sort all the output columns with this permutation. */
-  table_apply_permutation(p->table, perm->array, perm->size, 0);
+  table_apply_permutation(p->table, perm->array, perm->size, 0,
+                          p->cp.numthreads);
 
   /* Clean up. */
   gal_data_free(perm);
@@ -834,11 +802,37 @@ table_select_by_position(struct tableparams *p)
 
 
 
+/* When the input is processed in chunks, the rows of each chunk are read
+   from the '--catcolumnfile' tables. So we need to make sure they have
+   the same number of rows as the full input before starting. */
+static void
+table_catcolumn_check_rows(struct tableparams *p, char *filename,
+                           char *hdu)
+{
+  int tableformat;
+  gal_data_t *allcols;
+  size_t numcols, numrows;
+
+  allcols=gal_table_info(filename, hdu, NULL, &numcols, &numrows,
+                         &tableformat);
+  gal_data_array_free(allcols, numcols, 0);
+  if(numrows!=p->iter->numrows)
+    error(EXIT_FAILURE, 0, "%s: incorrect number of rows. The table "
+          "given to '--catcolumn' must have the same number of rows as "
+          "the main argument, but they have %zu and %zu rows "
+          "respectively", gal_fits_name_save_as_string(filename, hdu),
+          numrows, p->iter->numrows);
+}
+
+
+
+
+
 /* Import columns from another file/table into the working table. */
 static void
 table_catcolumn(struct tableparams *p)
 {
-  size_t counter=1;
+  size_t counter=1, numrows;
   gal_list_str_t *filell, *hdull;
   char *tmpname, *hdu=NULL, cstr[100];
   gal_data_t *col, *tocat, *final, *newcol;
@@ -860,11 +854,24 @@ table_catcolumn(struct tableparams *p)
         }
       else hdu=NULL;
 
-      /* Read the catcolumn table. */
-      tocat=gal_table_read(filell->v, hdu, NULL, p->catcolumns,
-                           cp->searchin, cp->ignorecase,
-                           cp->numthreads, cp->minmapsize,
-                           p->cp.quietmmap, NULL);
+      /* Read the catcolumn table. When the input is processed in chunks,
+         only read the rows of this chunk. */
+      if(p->iter)
+        {
+          numrows=p->table->dsize[0];
+          if(p->iter->nchunk==1) table_catcolumn_check_rows(p, filell->v,
+                                                            hdu);
+          tocat=gal_table_read_rows(filell->v, hdu, NULL, p->catcolumns,
+                                    cp->searchin, cp->ignorecase,
+                                    p->iter->rowstart+p->iter->next-numrows,
+                                    numrows, NULL, cp->numthreads,
+                                    cp->minmapsize, p->cp.quietmmap, NULL);
+        }
+      else
+        tocat=gal_table_read(filell->v, hdu, NULL, p->catcolumns,
+                             cp->searchin, cp->ignorecase,
+                             cp->numthreads, cp->minmapsize,
+                             p->cp.quietmmap, NULL);
 
       /* Check the number of rows. */
       if(tocat->dsize[0]!=p->table->dsize[0])
@@ -1492,8 +1499,12 @@ table_txt_formats(struct tableparams *p)
 /**************************************************************/
 /***************       Top function         *******************/
 /**************************************************************/
-void
-table(struct tableparams *p)
+/* Apply all the requested operations on 'p->table' and write it. When
+   the input is processed in chunks, this is called on each chunk; all
+   operations that need the full table have been disabled in this case
+   (see 'ui_stream_check'). */
+static void
+table_process(struct tableparams *p)
 {
   /* Concatenate the columns of tables (if required). */
   if(p->catcolumnfile) table_catcolumn(p);
@@ -1530,13 +1541,44 @@ table(struct tableparams *p)
   /* When any columns with blanks should be removed. */
   if(p->noblankend) table_noblankend(p);
 
-  /* Write the output or a warning/error (it can become NULL!) */
+  /* Write the output or a warning/error (it can become NULL!). The rows
+     of the chunks after the first are appended to the output. */
   if(p->table)
     {
       table_txt_formats(p);
-      gal_table_write(p->table, NULL, NULL, p->cp.tableformat, p->cp.output,
-                      "TABLE", p->colinfoinstdout);
+      if(p->iter && p->iter->nchunk>1)
+        gal_table_write_append(p->table, p->cp.output, p->cp.numthreads);
+      else
+        gal_table_write_threads(p->table, NULL, NULL, p->cp.tableformat,
+                                p->cp.output, "TABLE", p->colinfoinstdout,
+                                p->cp.numthreads);
     }
   else
     error(EXIT_FAILURE, 0, "no output columns");
 }
+
+
+
+
+
+void
+table(struct tableparams *p)
+{
+  /* Read the input in chunks and process each one separately. */
+  if(p->iter)
+    {
+      while( ui_stream_read(p) )
+        {
+          table_process(p);
+          gal_list_data_free(p->table);
+          p->table=NULL;
+        }
+      gal_list_data_free(p->notequal);
+      gal_list_data_free(p->equal);
+      gal_list_data_free(p->range);
+      p->range=p->equal=p->notequal=NULL;
+    }
+
+  /* The full table has already been read. */
+  else table_process(p);
+}
@@ -23,6 +23,10 @@ along with Gnuastro. If not, see <http://www.gnu.org/licenses/>.
 #ifndef TABLE_H
 #define TABLE_H
 
+gal_data_t *
+table_select_mask(struct tableparams *p, struct list_select *selectcol,
+                  size_t *dsize);
+
 void
 table(struct tableparams *p);
 
@@ -43,6 +43,7 @@ along with Gnuastro. If not, see <http://www.gnu.org/licenses/>.
 #include "main.h"
 
 #include "ui.h"
+#include "table.h"
 #include "arithmetic.h"
 #include "authors-cite.h"
 
@@ -124,6 +125,7 @@ ui_initialize_options(struct tableparams *p,
   p->txtf64precision     = GAL_BLANK_INT;
   p->head                = GAL_BLANK_SIZE_T;
   p->tail                = GAL_BLANK_SIZE_T;
+  p->rownum              = GAL_BLANK_SIZE_T;
 
   /* Modify common options. */
   for(i=0; !gal_options_is_last(&cp->coptions[i]); ++i)
@@ -140,6 +142,7 @@ ui_initialize_options(struct tableparams *p,
 
         /* Options to ignore. */
         case GAL_OPTIONS_KEY_TYPE:
+        case GAL_OPTIONS_KEY_COMPRESS:
           cp->coptions[i].flags=OPTION_HIDDEN;
           break;
         }
@@ -889,6 +892,91 @@ ui_noblank_prepare(struct tableparams *p, size_t numcols)
 
 
 
+/* When the input is a FITS table, the row-selection criteria can be
+   applied before reading the full table: only the columns that are needed
+   for the selection are read (in blocks of 'UI_SELECT_BLOCK' rows), and
+   the row numbers that pass all the criteria are kept in 'p->rowids'. The
+   output columns will then only be read on these rows. 'selectind' and
+   'selecttype' are respectively the input column indexs and types of the
+   'nselect' selection columns (in the order of 'table_select_mask').*/
+#define UI_SELECT_BLOCK 262144
+static void
+ui_select_rows_before_read(struct tableparams *p, gal_data_t *allcols,
+                           size_t numrows, size_t nselect,
+                           size_t *selectind, size_t *selecttype)
+{
+  uint8_t *u;
+  gal_data_t *cols, *tmp, *mask;
+  gal_list_sizet_t *indexll=NULL;
+  struct list_select *selectcol;
+  size_t i, b, nblock, ngood=0, nalloc=UI_SELECT_BLOCK, *ids=NULL;
+
+  /* The list of columns to read for the selection. */
+  for(i=0;i<nselect;++i) gal_list_sizet_add(&indexll, selectind[i]);
+  gal_list_sizet_reverse(&indexll);
+
+  /* Allocate space for the row numbers (it will grow if necessary). */
+  ids=gal_pointer_allocate(GAL_TYPE_SIZE_T, nalloc, 0, __func__, "ids");
+
+  /* Go over the rows in blocks. */
+  for(b=0; b<numrows; b+=UI_SELECT_BLOCK)
+    {
+      /* Read the selection columns of this block. */
+      nblock = numrows-b<UI_SELECT_BLOCK ? numrows-b : UI_SELECT_BLOCK;
+      cols=gal_fits_tab_read_rows(p->filename, p->cp.hdu, numrows, allcols,
+                                  indexll, b, nblock, NULL, p->cp.numthreads,
+                                  p->cp.minmapsize, p->cp.quietmmap);
+
+      /* Build the list of selection columns and find the rows to remove
+         (that have a value of 1 in the mask). */
+      i=0;
+      selectcol=NULL;
+      for(tmp=cols;tmp!=NULL;tmp=tmp->next)
+        ui_list_select_add(&selectcol, tmp, selecttype[i++]);
+      ui_list_select_reverse(&selectcol);
+      mask=table_select_mask(p, selectcol, &nblock);
+
+      /* Keep the row numbers that should be read. */
+      u=mask->array;
+      for(i=0;i<nblock;++i)
+        if(u[i]==0)
+          {
+            if(ngood==nalloc)
+              {
+                nalloc*=2;
+                errno=0;
+                ids=realloc(ids, nalloc*sizeof *ids);
+                if(ids==NULL)
+                  error(EXIT_FAILURE, errno, "%s: couldn't re-allocate "
+                        "%zu bytes for 'ids'", __func__,
+                        nalloc*sizeof *ids);
+              }
+            ids[ngood++]=b+i;
+          }
+
+      /* Clean up. */
+      gal_data_free(mask);
+      gal_list_data_free(cols);
+      ui_list_select_free(selectcol, 0);
+    }
+
+  /* Put the row numbers into a dataset (when no row passes the selection,
+     the dataset will be empty). */
+  i = ngood ? ngood : 1;
+  p->rowids=gal_data_alloc(NULL, GAL_TYPE_SIZE_T, 1, &i, NULL, 0, -1, 1,
+                           NULL, NULL, NULL);
+  memcpy(p->rowids->array, ids, ngood*sizeof *ids);
+  p->rowids->size=p->rowids->dsize[0]=ngood;
+
+  /* Clean up. */
+  free(ids);
+  gal_list_sizet_free(indexll);
+}
+
+
+
+
+
 /* See if row selection or sorting needs any extra columns to be read. */
 static void
 ui_check_select_sort_before(struct tableparams *p, gal_list_str_t *lines,
@@ -1136,6 +1224,18 @@ ui_check_select_sort_before(struct tableparams *p, gal_list_str_t *lines,
     }
 
 
+  /* If the input is a FITS table, apply the row-selection before reading
+     the output columns, so only the selected rows are read. When columns
+     from other tables are added, the number of rows must not change. */
+  if( p->selection
+      && p->streamrows==0
+      && p->catcolumnfile==NULL
+      && ( tableformat==GAL_TABLE_FORMAT_BFITS
+           || tableformat==GAL_TABLE_FORMAT_AFITS ) )
+    ui_select_rows_before_read(p, allcols, numrows, *nselect, selectind,
+                               selecttype);
+
+
   /* Clean up. */
   gal_list_sizet_free(indexll);
   if(selectind) free(selectind);
@@ -1230,6 +1330,114 @@ ui_check_select_sort_after(struct tableparams *p, size_t nselect,
 
 
 
+/* When the input is a FITS table and the output rows are only defined by
+   '--head', '--tail' or '--rowrange', set the range of rows to read from
+   the input (and disable the respective option, since it has been applied
+   at read time). */
+static void
+ui_rows_before_read(struct tableparams *p)
+{
+  double *darr;
+  int tableformat;
+  size_t numcols, numrows;
+  gal_data_t *allcols;
+
+  /* Get the table's basic information. */
+  allcols=gal_table_info(p->filename, p->cp.hdu, NULL, &numcols, &numrows,
+                         &tableformat);
+  gal_data_array_free(allcols, numcols, 0);
+  if( tableformat!=GAL_TABLE_FORMAT_BFITS
+      && tableformat!=GAL_TABLE_FORMAT_AFITS )
+    return;
+
+  /* Set the range of rows. Note that the values of '--rowrange' have
+     already been converted to count from zero in
+     'ui_read_check_only_options'. If they are larger than the number of
+     rows, we'll leave them to be checked with the full table (to print
+     the proper error message). */
+  if(p->head!=GAL_BLANK_SIZE_T)
+    {
+      p->rownum = p->head<numrows ? p->head : numrows;
+      p->head=GAL_BLANK_SIZE_T;
+    }
+  else if(p->tail!=GAL_BLANK_SIZE_T)
+    {
+      p->rowstart = numrows - (p->tail<numrows ? p->tail : numrows);
+      p->tail=GAL_BLANK_SIZE_T;
+    }
+  else
+    {
+      darr=p->rowrange->array;
+      if(darr[1]<numrows)
+        {
+          p->rowstart = darr[0];
+          p->rownum   = darr[1]-darr[0]+1;
+          gal_data_free(p->rowrange);
+          p->rowrange=NULL;
+        }
+    }
+}
+
+
+
+
+
+/* See if the input can be processed in chunks of '--streamrows' rows:
+   all the requested operations should only depend on the values within
+   each row. If it can't, '--streamrows' is ignored (with a warning) and
+   the full table will be read. */
+static void
+ui_stream_check(struct tableparams *p, gal_list_str_t *lines)
+{
+  char *reason=NULL;
+  gal_list_str_t *tmp;
+
+  /* Not requested. */
+  if(p->streamrows==0) return;
+
+  /* Find the reason (if any). */
+  if( lines || p->filename==NULL
+      || gal_fits_file_recognized(p->filename)==0 )
+    reason="the input is not a FITS file";
+  else if(p->sort)
+    reason="'--sort' needs all the rows";
+  else if(p->rowrandom)
+    reason="'--rowrandom' needs all the rows";
+  else if(p->catrowfile)
+    reason="'--catrowfile' adds rows to the end of the table";
+  else if( p->selection
+           && ( p->rowrange
+                || p->head!=GAL_BLANK_SIZE_T
+                || p->tail!=GAL_BLANK_SIZE_T ) )
+    reason="the rows given to '--head', '--tail' or '--rowrange' "
+      "depend on the selected rows";
+  else if( p->cp.output==NULL || gal_fits_name_is_fits(p->cp.output)==0 )
+    reason="the output is not a FITS file (the column widths of a "
+      "plain-text table depend on all the rows)";
+  else if( p->cp.tableformat==GAL_TABLE_FORMAT_AFITS )
+    reason="rows can't be appended to a FITS ASCII table";
+  else if( p->outcols && arithmetic_rowlocal(p)==0 )
+    reason="the column arithmetic needs all the rows";
+  else
+    for(tmp=p->catcolumnfile; tmp!=NULL; tmp=tmp->next)
+      if( gal_fits_file_recognized(tmp->v)==0 )
+        { reason="a file given to '--catcolumnfile' is not FITS"; break; }
+
+  /* If the input can't be streamed, let the user know. */
+  if(reason)
+    {
+      if(p->cp.quiet==0)
+        error(EXIT_SUCCESS, 0, "WARNING: '--streamrows' is ignored (the "
+              "full table will be read) because %s. To suppress this "
+              "warning, please run with '--quiet'", reason);
+      p->streamrows=0;
+    }
+}
+
+
+
+
+
 static void
 ui_preparations(struct tableparams *p)
 {
@@ -1258,6 +1466,10 @@ ui_preparations(struct tableparams *p)
                    || p->notequal || p->noblankll );
 
 
+  /* See if the input can be processed in chunks. */
+  ui_stream_check(p, lines);
+
+
   /* If row sorting or selection are requested, see if we should read any
      extra columns. */
   if(p->selection || p->sort)
@@ -1274,24 +1486,55 @@ ui_preparations(struct tableparams *p)
                   : NULL);
 
 
-  /* Read the necessary columns. */
-  p->table=gal_table_read(p->filename, cp->hdu, lines, p->columns,
-                          cp->searchin, cp->ignorecase, cp->numthreads,
-                          cp->minmapsize, p->cp.quietmmap, p->colmatch);
+  /* If only a contiguous range of rows is requested from a FITS table,
+     only read those rows. */
+  if( p->selection==0 && p->sort==NULL && p->rowrandom==0 && lines==NULL
+      && (p->catcolumnfile==NULL || p->streamrows) && p->catrowfile==NULL
+      && ( p->rowrange
+           || p->head!=GAL_BLANK_SIZE_T
+           || p->tail!=GAL_BLANK_SIZE_T ) )
+    ui_rows_before_read(p);
+
+
+  /* When the requested range of rows couldn't be set before reading (it
+     is larger than the table), the full table should be read to print
+     the proper error message. */
+  if( p->streamrows
+      && ( p->rowrange
+           || p->head!=GAL_BLANK_SIZE_T
+           || p->tail!=GAL_BLANK_SIZE_T ) )
+    p->streamrows=0;
+
+
+  /* Read the necessary columns, or prepare to read them in chunks. */
+  if(p->streamrows)
+    p->iter=gal_table_iter_init(p->filename, cp->hdu, p->columns,
+                                cp->searchin, cp->ignorecase, p->rowstart,
+                                p->rownum, NULL, p->streamrows,
+                                cp->numthreads, cp->minmapsize,
+                                p->cp.quietmmap, p->colmatch);
+  else
+    p->table=gal_table_read_rows(p->filename, cp->hdu, lines, p->columns,
+                                 cp->searchin, cp->ignorecase, p->rowstart,
+                                 p->rownum, p->rowids, cp->numthreads,
+                                 cp->minmapsize, p->cp.quietmmap,
+                                 p->colmatch);
   if(p->filename==NULL) p->filename="stdin";
   gal_list_str_free(lines, 1);
+  if(p->rowids) { gal_data_free(p->rowids); p->rowids=NULL; }
 
 
   /* If row sorting or selection are requested, keep them as separate
-     datasets.*/
-  if(p->selection || p->sort)
+     datasets. When the input is read in chunks, this is done on every
+     chunk (see 'ui_stream_read'). */
+  if( p->iter==NULL && (p->selection || p->sort) )
     ui_check_select_sort_after(p, nselect, origoutncols, sortindout,
                                selectindout, selecttypeout);
 
 
   /* If there was no actual data in the file, then inform the user and
      abort. */
-  if(p->table==NULL)
+  if(p->iter==NULL && p->table==NULL)
     error(EXIT_FAILURE, 0, "%s: no usable data rows (non-commented and "
           "non-blank lines)", p->filename);
 
@@ -1307,9 +1550,40 @@ ui_preparations(struct tableparams *p)
     p->rng=gal_checkset_gsl_rng(p->envseed, &p->rng_name, &p->rng_seed);
 
 
-  /* Clean up. */
-  if(selectindout) free(selectindout);
-  if(selecttypeout) free(selecttypeout);
+  /* Clean up (the selection columns are necessary for every chunk). */
+  if(p->iter)
+    {
+      p->nselect=nselect;
+      p->origoutncols=origoutncols;
+      p->selectindout=selectindout;
+      p->selecttypeout=selecttypeout;
+    }
+  else
+    {
+      if(selectindout) free(selectindout);
+      if(selecttypeout) free(selecttypeout);
+    }
+}
+
+
+
+
+
+/* Read the next chunk of the input table into 'p->table' (when the input
+   is processed in chunks). When there are no more rows, NULL is
+   returned. */
+gal_data_t *
+ui_stream_read(struct tableparams *p)
+{
+  /* Read the chunk. */
+  p->table=gal_table_iter_next(p->iter);
+
+  /* Keep the selection columns separately (similar to the full table). */
+  if(p->table && p->selection)
+    ui_check_select_sort_after(p, p->nselect, p->origoutncols,
+                               GAL_BLANK_SIZE_T, p->selectindout,
+                               p->selecttypeout);
+  return p->table;
 }
 
 
@@ -1438,6 +1712,9 @@ ui_free_report(struct tableparams *p)
   gal_list_data_free(p->colmetadata);
   gal_list_str_free(p->catcolumnhdu, 1);
   gal_list_str_free(p->catcolumnfile, 1);
+  if(p->selectindout) free(p->selectindout);
+  if(p->selecttypeout) free(p->selecttypeout);
+  gal_table_iter_free(p->iter);
 
   /* If a random number generator was allocated, free it. */
   if(p->rng) gsl_rng_free(p->rng);
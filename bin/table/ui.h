@@ -86,6 +86,7 @@ enum option_keys_enum
   UI_KEY_OUTPOLYGON,
   UI_KEY_FROMVECTOR,
   UI_KEY_CATCOLUMNRAWNAME,
+  UI_KEY_STREAMROWS,
 };
 
 
@@ -98,6 +99,9 @@ ui_read_check_inputs_setup(int argc, char *argv[], struct tableparams *p);
 void
 ui_list_select_free(struct list_select *list, int freevalue);
 
+gal_data_t *
+ui_stream_read(struct tableparams *p);
+
 void
 ui_free_report(struct tableparams *p);
 
@@ -673,10 +673,11 @@ ui_check_options_and_arguments(struct warpparams *p)
     }
 
   /* Read the input image as double type and its WCS structure. */
-  p->input=gal_array_read_one_ch_to_type(p->inputname, p->cp.hdu,
-                                         NULL, GAL_TYPE_FLOAT64,
-                                         p->cp.minmapsize,
-                                         p->cp.quietmmap);
+  p->input=gal_array_read_one_ch_to_type_threads(p->inputname, p->cp.hdu, NULL,
+                                                 GAL_TYPE_FLOAT64,
+                                                 p->cp.numthreads,
+                                                 p->cp.minmapsize,
+                                                 p->cp.quietmmap);
 
   /* Read the WCS and remove one-element wide dimension(s). */
   p->input->wcs=gal_wcs_read(p->inputname, p->cp.hdu,
@@ -424,7 +424,8 @@ warp_write_to_file(struct warpparams *p, int hasmatrix)
 
   /* Save the output and 'MAX-FRAC' if available. */
   for(tmp=p->output;tmp!=NULL;tmp=tmp->next)
-    gal_fits_img_write(tmp, p->cp.output, NULL, PROGRAM_NAME);
+    gal_fits_img_write_compress(tmp, p->cp.output, NULL, PROGRAM_NAME,
+                                p->cp.compress);
 
   /* Write the configuration keywords on HDU/extension '0'. */
   gal_fits_key_write_filename("input", p->inputname, &p->cp.okeys,
@@ -136,7 +136,8 @@ arithmetic_check_float_input(gal_data_t *in, int operator, char *numstr)
 /***********************************************************************/
 /* Change input data structure type. */
 static gal_data_t *
-arithmetic_change_type(gal_data_t *data, int operator, int flags)
+arithmetic_change_type(gal_data_t *data, int operator, int flags,
+                       size_t numthreads)
 {
   int type=-1;
   gal_data_t *out;
@@ -160,7 +161,7 @@ arithmetic_change_type(gal_data_t *data, int operator, int flags)
     }
 
   /* Copy to the new type. */
-  out=gal_data_copy_to_new_type(data, type);
+  out=gal_data_copy_to_new_type_threads(data, type, numthreads);
 
   /* Delete the input structure if the user asked for it. */
   if(flags & GAL_ARITHMETIC_FLAG_FREE)
@@ -3708,7 +3709,7 @@ gal_arithmetic(int operator, size_t numthreads, int flags, ...)
     case GAL_ARITHMETIC_OP_TO_FLOAT32:
     case GAL_ARITHMETIC_OP_TO_FLOAT64:
       d1 = va_arg(va, gal_data_t *);
-      out=arithmetic_change_type(d1, operator, flags);
+      out=arithmetic_change_type(d1, operator, flags, numthreads);
       break;
 
     /* Constants. */
@@ -32,6 +32,8 @@ along with Gnuastro. If not, see <http://www.gnu.org/licenses/>.
 #include <gnuastro/jpeg.h>
 #include <gnuastro/tiff.h>
 #include <gnuastro/array.h>
+#include <gnuastro/threads.h>
+#include <gnuastro/pointer.h>
 
 
 
@@ -101,12 +103,28 @@ gal_array_file_recognized(char *name)
 gal_data_t *
 gal_array_read(char *filename, char *extension, gal_list_str_t *lines,
                size_t minmapsize, int quietmmap)
+{
+  return gal_array_read_threads(filename, extension, lines, 1, minmapsize,
+                                quietmmap);
+}
+
+
+
+
+
+/* Similar to 'gal_array_read', but a tile-compressed FITS image will be
+   decompressed on 'numthreads' threads. */
+gal_data_t *
+gal_array_read_threads(char *filename, char *extension,
+                       gal_list_str_t *lines, size_t numthreads,
+                       size_t minmapsize, int quietmmap)
 {
   size_t ext;
 
   /* FITS  */
   if( gal_fits_file_recognized(filename) )
-    return gal_fits_img_read(filename, extension, minmapsize, quietmmap);
+    return gal_fits_img_read_threads(filename, extension, numthreads,
+                                     minmapsize, quietmmap);
 
   /* TIFF */
   else if ( gal_tiff_name_is_tiff(filename) )
@@ -140,10 +158,27 @@ gal_data_t *
 gal_array_read_to_type(char *filename, char *extension,
                        gal_list_str_t *lines, uint8_t type,
                        size_t minmapsize, int quietmmap)
+{
+  return gal_array_read_to_type_threads(filename, extension, lines, type,
+                                        1, minmapsize, quietmmap);
+}
+
+
+
+
+
+/* Similar to 'gal_array_read_to_type', but a tile-compressed FITS image
+   will be decompressed on 'numthreads' threads. */
+gal_data_t *
+gal_array_read_to_type_threads(char *filename, char *extension,
+                               gal_list_str_t *lines, uint8_t type,
+                               size_t numthreads, size_t minmapsize,
+                               int quietmmap)
 {
   gal_data_t *out=NULL;
-  gal_data_t *next, *in=gal_array_read(filename, extension, lines,
-                                       minmapsize, quietmmap);
+  gal_data_t *next, *in=gal_array_read_threads(filename, extension, lines,
+                                               numthreads, minmapsize,
+                                               quietmmap);
 
   /* Go over all the channels. */
   while(in)
@@ -167,10 +202,26 @@ gal_array_read_to_type(char *filename, char *extension,
 gal_data_t *
 gal_array_read_one_ch(char *filename, char *extension, gal_list_str_t *lines,
                       size_t minmapsize, int quietmmap)
+{
+  return gal_array_read_one_ch_threads(filename, extension, lines, 1,
+                                       minmapsize, quietmmap);
+}
+
+
+
+
+
+/* Similar to 'gal_array_read_one_ch', but a tile-compressed FITS image
+   will be decompressed on 'numthreads' threads. */
+gal_data_t *
+gal_array_read_one_ch_threads(char *filename, char *extension,
+                              gal_list_str_t *lines, size_t numthreads,
+                              size_t minmapsize, int quietmmap)
 {
   char *fname;
   gal_data_t *out;
-  out=gal_array_read(filename, extension, lines, minmapsize, quietmmap);
+  out=gal_array_read_threads(filename, extension, lines, numthreads,
+                             minmapsize, quietmmap);
 
   if(out->next)
     {
@@ -204,8 +255,130 @@ gal_array_read_one_ch_to_type(char *filename, char *extension,
                               gal_list_str_t *lines, uint8_t type,
                               size_t minmapsize, int quietmmap)
 {
-  gal_data_t *out=gal_array_read_one_ch(filename, extension, lines,
-                                        minmapsize, quietmmap);
+  return gal_array_read_one_ch_to_type_threads(filename, extension, lines,
+                                               type, 1, minmapsize,
+                                               quietmmap);
+}
+
+
+
+
+
+/* Similar to 'gal_array_read_one_ch_to_type', but a tile-compressed
+   FITS image will be decompressed on 'numthreads' threads. */
+gal_data_t *
+gal_array_read_one_ch_to_type_threads(char *filename, char *extension,
+                                      gal_list_str_t *lines, uint8_t type,
+                                      size_t numthreads, size_t minmapsize,
+                                      int quietmmap)
+{
+  gal_data_t *out=gal_array_read_one_ch_threads(filename, extension, lines,
+                                                numthreads, minmapsize,
+                                                quietmmap);
 
   return gal_data_copy_to_new_type_free(out, type);
 }
+
+
+
+
+
+/* Parameters for reading many files on multiple threads. */
+struct array_read_many_params
+{
+  char               **filenames;  /* Name of each input file.          */
+  char                    **hdus;  /* HDU/extension of each input.      */
+  gal_data_t               **out;  /* Dataset read from each input.     */
+  size_t              minmapsize;  /* Minimum size to use mmap.         */
+  int                  quietmmap;  /* Don't print mmap'd file names.    */
+};
+
+
+
+
+
+static void *
+array_read_many_on_thread(void *in_prm)
+{
+  /* Low-level definitions to be done first. */
+  struct gal_threads_params *tprm=(struct gal_threads_params *)in_prm;
+  struct array_read_many_params *p
+    = (struct array_read_many_params *)tprm->params;
+
+  /* Subsequent definitions. */
+  size_t i, ind;
+
+  /* Read each input that was assigned to this thread. Each input is read
+     on a single thread (the inputs are read in parallel instead). */
+  for(i=0; tprm->indexs[i] != GAL_BLANK_SIZE_T; ++i)
+    {
+      ind=tprm->indexs[i];
+      p->out[ind]=gal_array_read_one_ch(p->filenames[ind], p->hdus[ind],
+                                        NULL, p->minmapsize, p->quietmmap);
+    }
+
+  /* Wait for all threads to finish and return. */
+  if(tprm->b) pthread_barrier_wait(tprm->b);
+  return NULL;
+}
+
+
+
+
+
+/* Read the single-channel datasets in the given files and HDUs (one HDU
+   for each file, the same file may be given many times with different
+   HDUs) on 'numthreads' threads. When the per-file latency of the
+   file-system is significant (for example on network file-systems), this
+   is much faster than reading them one after the other. The output is a
+   list of datasets in the same order as the inputs. */
+gal_data_t *
+gal_array_read_one_ch_many(gal_list_str_t *filenames, gal_list_str_t *hdus,
+                           size_t numthreads, size_t minmapsize,
+                           int quietmmap)
+{
+  size_t i, num;
+  gal_list_str_t *f, *h;
+  gal_data_t *out=NULL;
+  struct array_read_many_params p;
+
+  /* Sanity check. */
+  num=gal_list_str_number(filenames);
+  if(gal_list_str_number(hdus)!=num)
+    error(EXIT_FAILURE, 0, "%s: the number of HDUs (%zu) and files (%zu) "
+          "must be the same", __func__, gal_list_str_number(hdus), num);
+  if(num==0) return NULL;
+
+  /* A zero number of threads is not meaningful. Multiple threads can
+     only be used when CFITSIO was configured in multi-thread mode. */
+#if GAL_CONFIG_HAVE_FITS_IS_REENTRANT == 1
+  if( numthreads==0 || fits_is_reentrant()==0 ) numthreads=1;
+#else
+  numthreads=1;
+#endif
+
+  /* Put the inputs in arrays. */
+  p.quietmmap=quietmmap;
+  p.minmapsize=minmapsize;
+  p.hdus=gal_pointer_allocate(GAL_TYPE_STRING, num, 0, __func__,
+                              "p.hdus");
+  p.filenames=gal_pointer_allocate(GAL_TYPE_STRING, num, 0, __func__,
+                                   "p.filenames");
+  p.out=gal_pointer_allocate(GAL_TYPE_STRING, num, 1, __func__, "p.out");
+  for(i=0, f=filenames, h=hdus; f!=NULL; f=f->next, h=h->next, ++i)
+    { p.filenames[i]=f->v; p.hdus[i]=h->v; }
+
+  /* Read the inputs. */
+  gal_threads_spin_off(array_read_many_on_thread, &p, num,
+                       numthreads<num ? numthreads : num, minmapsize,
+                       quietmmap);
+
+  /* Put the datasets into a list (in the same order as the inputs). */
+  for(i=num;i-->0;) gal_list_data_add(&out, p.out[i]);
+
+  /* Clean up and return. */
+  free(p.out);
+  free(p.hdus);
+  free(p.filenames);
+  return out;
+}
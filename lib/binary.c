@@ -46,210 +46,304 @@ along with Gnuastro. If not, see <http://www.gnu.org/licenses/>.
 /*********************************************************************/
 /*****************      Erosion and dilation      ********************/
 /*********************************************************************/
-static void
-binary_erode_dilate_1d(gal_data_t *input, int dilate0_erode1)
+/* In one and two dimensions, erosion and dilation are done on a
+   bit-packed copy of the dataset: each row is stored in 64-bit words
+   (one bit per pixel, the first pixel of each row is in the least
+   significant bit of its first word), so the neighbors of 64 pixels can
+   be checked with a few shift/and/or operations.
+
+   Two bit-planes are used: 'F' has a 1 for every pixel that has the value
+   that will spread (the "foreground" for dilation, or the "background"
+   for erosion) and 'B' has a 1 for every pixel that may change. All other
+   values (for example blank pixels) are zero in both planes, so they are
+   not affected and do not affect their neighbors (like the pixels outside
+   of the dataset). */
+struct binary_packed
 {
-  size_t i, nr=input->dsize[0];
-  uint8_t f, b, *pt, *fpt, *byt=input->array;
+  size_t       nr;               /* Number of rows.                     */
+  size_t       nc;               /* Number of columns (pixels in a row).*/
+  size_t       nw;               /* Number of words in a row.           */
+  uint64_t     *f;               /* Bit-plane of spreading value.       */
+  uint64_t     *b;               /* Bit-plane of pixels that may change.*/
+  uint64_t    *fn;               /* Space for 'f' of next iteration.    */
+};
 
-  /* Do a sanity check: */
-  if(dilate0_erode1!=1 && dilate0_erode1!=0)
-    error(EXIT_FAILURE, 0, "%s: a bug! Please contact us at %s so we can "
-          "fix this problem. The value to 'dilate0_erode1' is %u while it "
-          "should be 0 or 1", __func__, PACKAGE_BUGREPORT, dilate0_erode1);
 
-  /* Set the foreground and background values. */
-  if(dilate0_erode1==0) {f=1; b=0;}
-  else                  {f=0; b=1;}
 
-  /* Check the two extremes. */
-  if(byt[0]==b && byt[1]==f ) byt[0]=GAL_BINARY_TMP_VALUE;
-  if(nr>2)
-    if(byt[nr-1]==b && byt[nr-2]==f) byt[nr-1] = GAL_BINARY_TMP_VALUE;
 
-  /* Go over the full array. */
-  for(i=1;i<nr;++i)
-    if( byt[i]==b && ( byt[i-1]==f || byt[i+1]==f ) )
-      byt[i]=GAL_BINARY_TMP_VALUE;
 
-  /* Set all the changed pixels to the proper values: */
-  fpt=(pt=byt)+nr;
-  do *pt = *pt==GAL_BINARY_TMP_VALUE ? f : *pt; while(++pt<fpt);
+/* Fill the two bit-planes from the byte array. */
+static void
+binary_packed_pack(struct binary_packed *bp, uint8_t *byt, uint8_t f,
+                   uint8_t b)
+{
+  uint8_t *p;
+  uint64_t fw, bw;
+  size_t i, w, k, kmax;
+
+  for(i=0;i<bp->nr;++i)
+    for(w=0;w<bp->nw;++w)
+      {
+        fw=bw=0;
+        p=byt + i*bp->nc + w*64;
+        kmax = (w+1)*64 <= bp->nc ? 64 : bp->nc - w*64;
+        for(k=0;k<kmax;++k)
+          {
+            fw |= (uint64_t)(p[k]==f) << k;
+            bw |= (uint64_t)(p[k]==b) << k;
+          }
+        bp->f[ i*bp->nw + w ] = fw;
+        bp->b[ i*bp->nw + w ] = bw;
+      }
 }
 
 
 
 
 
+/* Write the bit-planes back into the byte array: only the pixels that
+   were 'f' or 'b' in the input are touched. */
 static void
-binary_erode_dilate_2d_4con(gal_data_t *input, int dilate0_erode1)
+binary_packed_unpack(struct binary_packed *bp, uint8_t *byt, uint8_t f,
+                     uint8_t b)
 {
-  uint8_t f, b, *pt, *fpt, *byt=input->array;
-  size_t i, j, ind, nr=input->dsize[0], nc=input->dsize[1];
+  uint8_t *p;
+  uint64_t fw, bw;
+  size_t i, w, k, kmax;
 
-  /* Do a sanity check: */
-  if(dilate0_erode1!=1 && dilate0_erode1!=0)
-    error(EXIT_FAILURE, 0, "%s: a bug! Please contact us at %s so we can "
-          "fix this problem. The value to 'dilate0_erode1' is %u while it "
-          "should be 0 or 1", __func__, PACKAGE_BUGREPORT, dilate0_erode1);
+  for(i=0;i<bp->nr;++i)
+    for(w=0;w<bp->nw;++w)
+      {
+        fw = bp->f[ i*bp->nw + w ];
+        bw = bp->b[ i*bp->nw + w ];
+        p=byt + i*bp->nc + w*64;
+        kmax = (w+1)*64 <= bp->nc ? 64 : bp->nc - w*64;
+        for(k=0;k<kmax;++k)
+          if( (fw>>k) & 1 )      p[k]=f;
+          else if( (bw>>k) & 1 ) p[k]=b;
+      }
+}
 
-  /* Set the foreground and background values. */
-  if(dilate0_erode1==0) {f=1; b=0;}
-  else                  {f=0; b=1;}
 
-  /* Check the 4 corners: */
-  if(byt[0]==b && (byt[1]==f || byt[nc]==f) )
-    byt[0]=GAL_BINARY_TMP_VALUE;
 
-  if(byt[nc-1]==b && (byt[nc-2]==f || byt[2*nc-1]==f))
-    byt[nc-1]=GAL_BINARY_TMP_VALUE;
 
-  if(byt[(nr-1)*nc]==b
-     && (byt[(nr-2)*nc]==f || byt[(nr-1)*nc+1]==f) )
-    byt[(nr-1)*nc]=GAL_BINARY_TMP_VALUE;
 
-  if(byt[nr*nc-1]==b
-     && (byt[nr*nc-2]==f || byt[nr*nc-1-nc]==f) )
-    byt[nr*nc-1]=GAL_BINARY_TMP_VALUE;
+/* The pixel itself and its left and right neighbors in word 'w' of a
+   row. The bits that are shifted out of a word are taken from the
+   neighboring words. */
+static inline uint64_t
+binary_packed_horizontal(uint64_t *row, size_t w, size_t nw)
+{
+  uint64_t left  = (row[w]<<1) | ( w>0    ? row[w-1]>>63 : 0 );
+  uint64_t right = (row[w]>>1) | ( w<nw-1 ? row[w+1]<<63 : 0 );
+  return row[w] | left | right;
+}
+
 
-  /* Check the 4 sides: */
-  for(j=1;j<nc-1;++j)
-    if(byt[j]==b
-       && (byt[j+1]==f || byt[j-1]==f || byt[j+nc]==f) )
-      byt[j]=GAL_BINARY_TMP_VALUE;
 
-  for(j=1;j<nc-1;++j)
-    {
-      ind=(nr-1)*nc+j;
-      if(byt[ind]==b
-         && (byt[ind+1]==f || byt[ind-1]==f || byt[ind-nc]==f) )
-        byt[ind]=GAL_BINARY_TMP_VALUE;
-    }
 
-  for(i=1;i<nr-1;++i)
-    {
-      ind=i*nc;
-      if(byt[ind]==b
-         && (byt[ind+1]==f || byt[ind+nc]==f || byt[ind-nc]==f) )
-        byt[ind]=GAL_BINARY_TMP_VALUE;
-    }
 
-  for(i=1;i<nr-1;++i)
+/* One erosion/dilation on the packed dataset: a 'B' pixel that has an 'F'
+   neighbor is changed to 'F'. Like the byte-array implementation, all
+   pixels are checked with the values of the previous iteration, so the
+   new 'F' plane is written in a separate array. Since 'F' and 'B' don't
+   overlap, the pixel itself can be included in the neighbors. The number
+   of changed words is returned. */
+static size_t
+binary_packed_iteration(struct binary_packed *bp, int connectivity)
+{
+  uint64_t *f=bp->f, *b=bp->b, *fn=bp->fn, *up, *row, *down, ngb, ch;
+  size_t i, w, nr=bp->nr, nw=bp->nw, numchanged=0;
+
+  for(i=0;i<nr;++i)
     {
-      ind=(i+1)*nc-1;
-      if(byt[ind]==b
-         && (byt[ind-1]==f || byt[ind+nc]==f || byt[ind-nc]==f) )
-        byt[ind]=GAL_BINARY_TMP_VALUE;
+      row  = f + i*nw;
+      up   = i>0    ? row-nw : NULL;
+      down = i<nr-1 ? row+nw : NULL;
+      for(w=0;w<nw;++w)
+        {
+          /* Find the pixels that have a spreading neighbor. */
+          ngb=binary_packed_horizontal(row, w, nw);
+          if(connectivity==1)
+            ngb |= (up ? up[w] : 0) | (down ? down[w] : 0);
+          else
+            ngb |= ( (up   ? binary_packed_horizontal(up,   w, nw) : 0)
+                     | (down ? binary_packed_horizontal(down, w, nw) : 0) );
+
+          /* Flip the changed pixels. */
+          ch = b[i*nw+w] & ngb;
+          b[i*nw+w]  &= ~ch;
+          fn[i*nw+w]  = row[w] | ch;
+          numchanged += ch!=0;
+        }
     }
 
-  /* Check the body: */
-  for(i=1;i<nr-1;++i)
-    for(j=1;j<nc-1;++j)
-      {
-        ind=i*nc+j;
-        if(byt[ind]==b
-           && (byt[ind-1]==f     || byt[ind+1]==f
-               || byt[ind+nc]==f || byt[ind-nc]==f) )
-          byt[ind]=GAL_BINARY_TMP_VALUE;
-      }
-
-  /* Set all the changed pixels to the proper values: */
-  fpt=(pt=byt)+nr*nc;
-  do *pt = *pt==GAL_BINARY_TMP_VALUE ? f : *pt; while(++pt<fpt);
+  /* Swap the two 'F' planes for the next iteration and return. */
+  bp->fn=f;
+  bp->f=fn;
+  return numchanged;
 }
 
 
 
 
 
-/* 8 connected dilation and erosion. b0_f1==0: Dilate the
-   foreground. b0_f1==1: Erode the foreground. */
+/* Do 'num' erosions or dilations on a 1D or 2D dataset. The dataset is
+   only packed and unpacked once, so the iterations don't need to go
+   through the full byte array. When an iteration doesn't change any
+   pixel, the following iterations won't either, so we can stop. */
 static void
-binary_erode_dilate_2d_8con(gal_data_t *input, unsigned char dilate0_erode1)
+binary_erode_dilate_packed(gal_data_t *input, size_t num,
+                           int connectivity, int dilate0_erode1)
 {
-  uint8_t f, b, *pt, *fpt, *byt=input->array;
-  size_t i, j, ind, nr=input->dsize[0], nc=input->dsize[1];
+  uint8_t f, b;
+  size_t counter;
+  struct binary_packed bp;
 
   /* Do a sanity check: */
   if(dilate0_erode1!=1 && dilate0_erode1!=0)
-    error(EXIT_FAILURE, 0, "%s: a bug! Please contact us at %s so we can fix "
-          "this problem. The value to dilate0_erode1 is %u while it should "
-          "be 0 or 1", __func__, PACKAGE_BUGREPORT, dilate0_erode1);
+    error(EXIT_FAILURE, 0, "%s: a bug! Please contact us at %s so we can "
+          "fix this problem. The value to 'dilate0_erode1' is %u while it "
+          "should be 0 or 1", __func__, PACKAGE_BUGREPORT, dilate0_erode1);
 
-  /* Set the foreground and background values: */
+  /* Set the foreground and background values. */
   if(dilate0_erode1==0) {f=1; b=0;}
   else                  {f=0; b=1;}
 
-  /* Check the 4 corners: */
-  if(byt[0]==b && (byt[1]==f
-                   || byt[nc]==f || byt[nc+1]==f) )
-    byt[0]=GAL_BINARY_TMP_VALUE;
-
-  if(byt[nc-1]==b && (byt[nc-2]==f
-                      || byt[2*nc-1]==f
-                      || byt[2*nc-2]==f) )
-    byt[nc-1]=GAL_BINARY_TMP_VALUE;
-
-  if(byt[(nr-1)*nc]==b
-     && ( byt[(nr-2)*nc]==f || byt[(nr-1)*nc+1]==f
-          || byt[(nr-2)*nc+1]==f) )
-    byt[(nr-1)*nc]=GAL_BINARY_TMP_VALUE;
-
-  if(byt[nr*nc-1]==b
-     && ( byt[nr*nc-2]==f || byt[nr*nc-1-nc]==f
-          || byt[nr*nc-2-nc]==f) )
-    byt[nr*nc-1]=GAL_BINARY_TMP_VALUE;
-
-  /* Check the 4 sides: */
-  for(j=1;j<nc-1;++j)
-    if(byt[j]==b
-       && ( byt[j+1]==f || byt[j-1]==f || byt[j+nc]==f
-            || byt[j-1+nc]==f || byt[j+1+nc]==f) )
-      byt[j]=GAL_BINARY_TMP_VALUE;
-
-  for(j=1;j<nc-1;++j)
-    {
-      ind=(nr-1)*nc+j;
-      if(byt[ind]==b
-         && ( byt[ind+1]==f || byt[ind-1]==f || byt[ind-nc]==f
-              || byt[ind-1-nc]==f || byt[ind+1-nc]==f) )
-        byt[ind]=GAL_BINARY_TMP_VALUE;
-    }
+  /* Set the sizes (a 1D dataset is treated as a single row) and allocate
+     the bit-planes. */
+  bp.nr = input->ndim==1 ? 1 : input->dsize[0];
+  bp.nc = input->dsize[input->ndim-1];
+  bp.nw = (bp.nc+63)/64;
+  bp.f  = gal_pointer_allocate(GAL_TYPE_UINT64, bp.nr*bp.nw, 0, __func__,
+                               "bp.f");
+  bp.b  = gal_pointer_allocate(GAL_TYPE_UINT64, bp.nr*bp.nw, 0, __func__,
+                               "bp.b");
+  bp.fn = gal_pointer_allocate(GAL_TYPE_UINT64, bp.nr*bp.nw, 0, __func__,
+                               "bp.fn");
+
+  /* Do the operation. */
+  binary_packed_pack(&bp, input->array, f, b);
+  for(counter=0;counter<num;++counter)
+    if( binary_packed_iteration(&bp, connectivity)==0 ) break;
+  binary_packed_unpack(&bp, input->array, f, b);
+
+  /* Clean up. */
+  free(bp.f);
+  free(bp.b);
+  free(bp.fn);
+}
 
-  for(i=1;i<nr-1;++i)
-    {
-      ind=i*nc;
-      if(byt[ind]==b
-         && ( byt[ind+1]==f || byt[ind+nc]==f || byt[ind-nc]==f
-              || byt[ind+1-nc]==f || byt[ind+1+nc]==f) )
-        byt[ind]=GAL_BINARY_TMP_VALUE;
-    }
 
-  for(i=1;i<nr-1;++i)
-    {
-      ind=(i+1)*nc-1;
-      if(byt[ind]==b
-         && (byt[ind-1]==f || byt[ind+nc]==f || byt[ind-nc]==f
-             || byt[ind-1-nc]==f || byt[ind-1+nc]==f) )
-        byt[ind]=GAL_BINARY_TMP_VALUE;
-    }
 
-  /* Check the body: */
-  for(i=1;i<nr-1;++i)
-    for(j=1;j<nc-1;++j)
+
+
+/* When the number of erosions/dilations is larger than this, and the
+   dataset only has 0 and 1 values, a distance transform is used instead
+   of iterating. */
+#define BINARY_DISTANCE_MIN_NUM 8
+
+
+
+
+
+/* Linear-time distance transform of a 1D or 2D dataset: the distance of
+   every pixel to the nearest pixel with a value of 'f'. With a
+   connectivity of 1, the distance is the Manhattan (city-block) distance
+   and with a connectivity of 2, it is the chessboard distance. These are
+   exactly the number of 4 or 8-connected erosions/dilations that are
+   necessary to reach each pixel when there are only 0 and 1 values in the
+   dataset (other values would block the erosions/dilations, so they
+   can't be used here). For these two metrics, two raster scans (one
+   forward, one backward) over the immediate neighbors are enough to find
+   the exact distance. Pixels with no 'f' pixel in the dataset will have
+   'UINT32_MAX'. */
+static uint32_t *
+binary_distance(gal_data_t *input, uint8_t f, int connectivity)
+{
+  uint8_t *byt=input->array;
+  uint32_t m, *d, inf=UINT32_MAX-1;
+  size_t i, j, ind, nr, nc, size=input->size;
+
+  /* Set the sizes (a 1D dataset is treated as a single row) and allocate
+     the distance array. */
+  nr = input->ndim==1 ? 1 : input->dsize[0];
+  nc = input->dsize[input->ndim-1];
+  d=gal_pointer_allocate(GAL_TYPE_UINT32, size, 0, __func__, "d");
+
+  /* Forward pass: neighbors above and to the left. */
+  for(i=0;i<nr;++i)
+    for(j=0;j<nc;++j)
       {
         ind=i*nc+j;
-        if(byt[ind]==b
-           && (byt[ind-1]==f        || byt[ind+1]==f
-               || byt[ind+nc]==f    || byt[ind-nc]==f
-               || byt[ind-1-nc]==f  || byt[ind+1+nc]==f
-               || byt[ind-1+nc]==f  || byt[ind+1-nc]==f) )
-          byt[ind]=GAL_BINARY_TMP_VALUE;
+        if(byt[ind]==f) { d[ind]=0; continue; }
+        m=inf;
+        if(j>0)    m = d[ind-1]  < m ? d[ind-1]  : m;
+        if(i>0)
+          {
+            m = d[ind-nc] < m ? d[ind-nc] : m;
+            if(connectivity==2)
+              {
+                if(j>0)    m = d[ind-nc-1] < m ? d[ind-nc-1] : m;
+                if(j<nc-1) m = d[ind-nc+1] < m ? d[ind-nc+1] : m;
+              }
+          }
+        d[ind] = m==inf ? inf : m+1;
       }
 
-  /* Set all the changed pixels to the proper values: */
-  fpt=(pt=byt)+nr*nc;
-  do *pt = *pt==GAL_BINARY_TMP_VALUE ? f : *pt; while(++pt<fpt);
+  /* Backward pass: neighbors below and to the right. */
+  for(i=nr;i-->0;)
+    for(j=nc;j-->0;)
+      {
+        ind=i*nc+j;
+        m=d[ind];
+        if(m==0) continue;
+        if(j<nc-1) m = d[ind+1]+1 < m ? d[ind+1]+1 : m;
+        if(i<nr-1)
+          {
+            m = d[ind+nc]+1 < m ? d[ind+nc]+1 : m;
+            if(connectivity==2)
+              {
+                if(j>0)    m = d[ind+nc-1]+1 < m ? d[ind+nc-1]+1 : m;
+                if(j<nc-1) m = d[ind+nc+1]+1 < m ? d[ind+nc+1]+1 : m;
+              }
+          }
+        d[ind]=m;
+      }
+
+  /* Pixels that are not reachable get the maximum value. */
+  for(i=0;i<size;++i) if(d[i]>=inf) d[i]=UINT32_MAX;
+  return d;
+}
+
+
+
+
+
+/* Do 'num' erosions or dilations with a single threshold on the distance
+   transform. Returns 0 (and does nothing) when the dataset has values
+   other than 0 and 1. */
+static int
+binary_erode_dilate_distance(gal_data_t *input, size_t num,
+                             int connectivity, int dilate0_erode1)
+{
+  uint32_t *d;
+  size_t i, size=input->size;
+  uint8_t f, *byt=input->array;
+
+  /* The distance transform can only be used with 0 and 1 values. */
+  for(i=0;i<size;++i) if(byt[i]>1) return 0;
+
+  /* Set the value that will spread and find the distances. */
+  f = dilate0_erode1 ? 0 : 1;
+  d=binary_distance(input, f, connectivity);
+
+  /* All the pixels that are within 'num' of a 'f' pixel, become 'f'. */
+  for(i=0;i<size;++i) byt[i] = d[i]<=num ? f : byt[i];
+
+  /* Clean up and return. */
+  free(d);
+  return 1;
 }
 
 
@@ -257,7 +351,8 @@ binary_erode_dilate_2d_8con(gal_data_t *input, unsigned char dilate0_erode1)
 
 
 /* This is a general erosion and dilation function. It is less efficient
-   than the more specialized cases above. */
+   than the bit-packed implementation above, but works on any
+   dimensionality. */
 static void
 binary_erode_dilate_general(gal_data_t *input, unsigned char dilate0_erode1,
                             int connectivity)
@@ -326,19 +421,15 @@ binary_erode_dilate(gal_data_t *input, size_t num, int connectivity,
   switch(binary->ndim)
     {
     case 1:
-      binary_erode_dilate_1d(binary, d0e1);
-      break;
-
     case 2:
-      for(counter=0;counter<num;++counter)
-        switch(connectivity)
-          {
-          case 1: binary_erode_dilate_2d_4con(binary, d0e1); break;
-          case 2: binary_erode_dilate_2d_8con(binary, d0e1); break;
-          default:
-            error(EXIT_FAILURE, 0, "%s: %d not acceptable for connectivity "
-                  "in a 2D dataset", __func__, connectivity);
-          }
+      if(binary->ndim==1) connectivity=1;
+      if(connectivity!=1 && connectivity!=2)
+        error(EXIT_FAILURE, 0, "%s: %d not acceptable for connectivity "
+              "in a 2D dataset", __func__, connectivity);
+      if( num<BINARY_DISTANCE_MIN_NUM
+          || binary_erode_dilate_distance(binary, num, connectivity,
+                                          d0e1)==0 )
+        binary_erode_dilate_packed(binary, num, connectivity, d0e1);
       break;
 
     case 3:
@@ -394,7 +485,7 @@ gal_binary_open(gal_data_t *input, size_t num, int connectivity,
   /* If 'inplace' was called, then 'out' is the same as 'input', if it
      wasn't, then 'out' is a newly allocated array. In any case, we should
      dilate in the same allocated space. */
-  gal_binary_dilate(input, num, connectivity, 1);
+  gal_binary_dilate(out, num, connectivity, 1);
 
   /* Return the output dataset. */
   return out;
@@ -422,8 +513,11 @@ gal_binary_open(gal_data_t *input, size_t num, int connectivity,
 /*********************************************************************/
 /*****************            Neighbors           ********************/
 /*********************************************************************/
-/* This is a general erosion and dilation function. It is less efficient
-   than the more specialized cases above. */
+/* For every non-zero (and non-blank) element of the binary input, count
+   the number of its neighbors (with the given connectivity) that are
+   non-zero. The output has a 'uint8' type; zero-valued input elements
+   will be zero in the output. When 'inplace!=0', the counts will be
+   written into the input's array. */
 gal_data_t *
 gal_binary_number_neighbors(gal_data_t *input, int connectivity, int inplace)
 {
@@ -494,7 +588,7 @@ gal_binary_connected_components(gal_data_t *binary, gal_data_t **out,
   uint8_t *b, *bf;
   gal_data_t *lab;
   size_t p, i, curlab=1;
-  gal_list_sizet_t *Q=NULL;
+  gal_list_sizet_ring_t Q;
   size_t *dinc=gal_dimension_increment(binary->ndim, binary->dsize);
 
   /* Two small sanity checks. */
@@ -547,6 +641,7 @@ gal_binary_connected_components(gal_data_t *binary, gal_data_t **out,
      going onto the next pixels. */
   l=lab->array;
   b=binary->array;
+  gal_list_sizet_ring_init(&Q, 1024);
   for(i=0;i<binary->size;++i)
     /* Check if this pixel is already labeled. */
     if( b[i] && l[i]==0 )
@@ -556,14 +651,14 @@ gal_binary_connected_components(gal_data_t *binary, gal_data_t **out,
         l[i]=curlab;
 
         /* Add this pixel to the queue of pixels to work with. */
-        gal_list_sizet_add(&Q, i);
+        gal_list_sizet_ring_add(&Q, i);
 
         /* While a pixel remains in the queue, continue labelling and
            searching for neighbors. */
-        while(Q!=NULL)
+        while(Q.num)
           {
             /* Pop an element from the queue. */
-            p=gal_list_sizet_pop(&Q);
+            p=gal_list_sizet_ring_pop_last(&Q);
 
             /* Go over all its neighbors and add them to the list if they
                haven't already been labeled. */
@@ -573,7 +668,7 @@ gal_binary_connected_components(gal_data_t *binary, gal_data_t **out,
                 if( b[ nind ] && l[ nind ]==0 )
                   {
                     l[ nind ] = curlab;
-                    gal_list_sizet_add(&Q, nind);
+                    gal_list_sizet_ring_add(&Q, nind);
                   }
               } );
           }
@@ -585,6 +680,7 @@ gal_binary_connected_components(gal_data_t *binary, gal_data_t **out,
 
 
   /* Clean up and return the total number. */
+  gal_list_sizet_ring_free(&Q);
   free(dinc);
   return curlab-1;
 }
@@ -603,7 +699,7 @@ gal_binary_connected_indexs(gal_data_t *binary, int connectivity)
   uint8_t *b, *bf;
   gal_data_t *lines=NULL;
   size_t p, i, onelabnum, *onelabarr;
-  gal_list_sizet_t *Q=NULL, *onelab=NULL;
+  gal_list_sizet_ring_t Q, onelab;
   size_t *dinc=gal_dimension_increment(binary->ndim, binary->dsize);
 
   /* Small sanity checks. */
@@ -614,8 +710,12 @@ gal_binary_connected_indexs(gal_data_t *binary, int connectivity)
     error(EXIT_FAILURE, 0, "%s: currently, the input data structure to "
           "must not be a tile", __func__);
 
-  /* Go over all the pixels and do a breadth-first search. */
+  /* Go over all the pixels and do a breadth-first search. Elements are
+     only added to 'onelab' (never popped), so they will be in the order
+     they were added. */
   b=binary->array;
+  gal_list_sizet_ring_init(&Q, 1024);
+  gal_list_sizet_ring_init(&onelab, 1024);
   for(i=0;i<binary->size;++i)
     /* A pixel that has already been recorded is given a value of
        'BINARY_CONINDEX_VAL'. */
@@ -623,15 +723,15 @@ gal_binary_connected_indexs(gal_data_t *binary, int connectivity)
       {
         /* Add this pixel to the queue of pixels to work with. */
 	b[i]=BINARY_CONINDEX_VAL;
-        gal_list_sizet_add(&Q, i);
-        gal_list_sizet_add(&onelab, i);
+        gal_list_sizet_ring_add(&Q, i);
+        gal_list_sizet_ring_add(&onelab, i);
 
         /* While a pixel remains in the queue, continue labelling and
            searching for neighbors. */
-        while(Q!=NULL)
+        while(Q.num)
           {
             /* Pop an element from the queue. */
-            p=gal_list_sizet_pop(&Q);
+            p=gal_list_sizet_ring_pop_last(&Q);
 
             /* Go over all its neighbors and add them to the list if they
                haven't already been labeled. */
@@ -641,20 +741,22 @@ gal_binary_connected_indexs(gal_data_t *binary, int connectivity)
                 if( b[nind]==1 )
                   {
 		    b[nind]=BINARY_CONINDEX_VAL;
-                    gal_list_sizet_add(&Q, nind);
-		    gal_list_sizet_add(&onelab, nind);
+                    gal_list_sizet_ring_add(&Q, nind);
+		    gal_list_sizet_ring_add(&onelab, nind);
                   }
               } );
           }
 
 	/* Parsing has finished, put all the indexs into an array. */
-	onelabarr=gal_list_sizet_to_array(onelab, 1, &onelabnum);
+	onelabnum=onelab.num;
+	onelabarr=gal_pointer_allocate(GAL_TYPE_SIZE_T, onelabnum, 0,
+				       __func__, "onelabarr");
+	memcpy(onelabarr, onelab.array, onelabnum*sizeof *onelabarr);
 	gal_list_data_add_alloc(&lines, onelabarr, GAL_TYPE_SIZE_T, 1,
 				&onelabnum, NULL, 0, -1, 1, NULL, NULL, NULL);
 
-	/* Clean up. */
-	gal_list_sizet_free(onelab);
-	onelab=NULL;
+	/* Reset the ring for the next component. */
+	onelab.num=onelab.first=0;
       }
 
   /* Reverse the order. */
@@ -676,6 +778,8 @@ gal_binary_connected_indexs(gal_data_t *binary, int connectivity)
   do if(*b==BINARY_CONINDEX_VAL) *b=1; while(++b<bf);
 
   /* Clean up and return the total number. */
+  gal_list_sizet_ring_free(&onelab);
+  gal_list_sizet_ring_free(&Q);
   free(dinc);
   return lines;
 }
@@ -692,7 +796,7 @@ gal_binary_connected_adjacency_matrix(gal_data_t *adjacency,
                                       size_t *numconnected)
 {
   gal_data_t *newlabs_d;
-  gal_list_sizet_t *Q=NULL;
+  gal_list_sizet_ring_t Q;
   int32_t *newlabs, curlab=1;
   uint8_t *adj=adjacency->array;
   size_t i, j, p, num=adjacency->dsize[0];
@@ -719,6 +823,7 @@ gal_binary_connected_adjacency_matrix(gal_data_t *adjacency,
                            adjacency->minmapsize, adjacency->quietmmap,
                            NULL, NULL, NULL);
   newlabs=newlabs_d->array;
+  gal_list_sizet_ring_init(&Q, num);
 
 
   /* Go over the input matrix and apply the same principle as we used to
@@ -728,13 +833,13 @@ gal_binary_connected_adjacency_matrix(gal_data_t *adjacency,
     if(newlabs[i]==0)
       {
         /* Add this old label to the list that must be corrected. */
-        gal_list_sizet_add(&Q, i);
+        gal_list_sizet_ring_add(&Q, i);
 
         /* Continue while the list has elements. */
-        while(Q!=NULL)
+        while(Q.num)
           {
             /* Pop the top old-label from the list. */
-            p=gal_list_sizet_pop(&Q);
+            p=gal_list_sizet_ring_pop_last(&Q);
 
             /* If it has already been labeled then ignore it. */
             if( newlabs[p]!=curlab )
@@ -747,7 +852,7 @@ gal_binary_connected_adjacency_matrix(gal_data_t *adjacency,
                    that are touching it. */
                 for(j=1;j<num;++j)
                   if( adj[ p*num+j ] && newlabs[j]==0 )
-                    gal_list_sizet_add(&Q, j);
+                    gal_list_sizet_ring_add(&Q, j);
               }
           }
 
@@ -760,7 +865,8 @@ gal_binary_connected_adjacency_matrix(gal_data_t *adjacency,
   for(i=1;i<num;++i) printf("%zu: %u\n", i, newlabs[i]);
   */
 
-  /* Return the output. */
+  /* Clean up and return the output. */
+  gal_list_sizet_ring_free(&Q);
   *numconnected = curlab-1;
   return newlabs_d;
 }
@@ -792,13 +898,14 @@ gal_binary_connected_adjacency_list(gal_list_sizet_t **listarr,
   size_t i, p;
   gal_list_sizet_t *tmp;
   gal_data_t *newlabs_d;
-  gal_list_sizet_t *Q=NULL;
+  gal_list_sizet_ring_t Q;
   int32_t *newlabs, curlab=1;
 
   /* Allocate (and clear) the output datastructure. */
   newlabs_d=gal_data_alloc(NULL, GAL_TYPE_INT32, 1, &number, NULL, 1,
                            minmapsize, quietmmap, NULL, NULL, NULL);
   newlabs=newlabs_d->array;
+  gal_list_sizet_ring_init(&Q, number);
 
   /* Go over the input matrix and apply the same principle as we used to
      identify connected components in an image: through a queue, find those
@@ -807,13 +914,13 @@ gal_binary_connected_adjacency_list(gal_list_sizet_t **listarr,
     if(newlabs[i]==0)
       {
         /* Add this old label to the list that must be corrected. */
-        gal_list_sizet_add(&Q, i);
+        gal_list_sizet_ring_add(&Q, i);
 
         /* Continue while the list has elements. */
-        while(Q!=NULL)
+        while(Q.num)
           {
             /* Pop the top old-label from the list. */
-            p=gal_list_sizet_pop(&Q);
+            p=gal_list_sizet_ring_pop_last(&Q);
 
             /* If it has already been labeled then ignore it. */
             if( newlabs[p]!=curlab )
@@ -826,7 +933,7 @@ gal_binary_connected_adjacency_list(gal_list_sizet_t **listarr,
                    touching it. */
                 for(tmp=listarr[p]; tmp!=NULL; tmp=tmp->next)
                   if( newlabs[tmp->v]==0 )
-                    gal_list_sizet_add(&Q, tmp->v);
+                    gal_list_sizet_ring_add(&Q, tmp->v);
               }
           }
 
@@ -839,7 +946,8 @@ gal_binary_connected_adjacency_list(gal_list_sizet_t **listarr,
   for(i=1;i<number;++i) printf("%zu: %u\n", i, newlabs[i]);
   */
 
-  /* Return the output. */
+  /* Clean up and return the output. */
+  gal_list_sizet_ring_free(&Q);
   *numconnected = curlab-1;
   return newlabs_d;
 }
@@ -1011,35 +1119,76 @@ gal_binary_holes_label(gal_data_t *input, int connectivity,
 
 
 
-/* Fill all the holes in an input unsigned char array.
+/* Flood the 0-valued pixels that are connected to 'start' with the
+   'GAL_BINARY_TMP_VALUE'. All the flooded pixels (including 'start') are
+   put in 'flooded' (which is reset first), so the return value is the
+   number of flooded pixels. Since nothing is popped from 'flooded', its
+   array can be parsed directly as a first-in-first-out queue. Each pixel
+   is only added once, so this is linear in the number of flooded
+   pixels. */
+static size_t
+binary_holes_flood(gal_data_t *input, int connectivity, size_t *dinc,
+                   size_t start, gal_list_sizet_ring_t *flooded)
+{
+  size_t ind, head=0;
+  uint8_t *byt=input->array;
 
-   The basic method is this:
+  /* Add the starting pixel. */
+  flooded->num=flooded->first=0;
+  byt[start]=GAL_BINARY_TMP_VALUE;
+  gal_list_sizet_ring_add(flooded, start);
+
+  /* Parse the queue until no more pixels are added. */
+  while(head<flooded->num)
+    {
+      ind=flooded->array[head++];
+      GAL_DIMENSION_NEIGHBOR_OP(ind, input->ndim, input->dsize, connectivity,
+                                dinc, {
+                                  if(byt[nind]==0)
+                                    {
+                                      byt[nind]=GAL_BINARY_TMP_VALUE;
+                                      gal_list_sizet_ring_add(flooded, nind);
+                                    }
+                                });
+    }
+
+  /* Return the number of flooded pixels. */
+  return flooded->num;
+}
 
-   1. An inverse image is created:
 
-        * For every pixel in the input that is 1, the inverse is 0.
 
-        * The inverse image has two extra pixels on each edge to
-          ensure that all the inv[i]==1 pixels around the image are
-          touching each other and a diagonal object passing through
-          the image does not cause the inv[i]==1 pixels on the edges
-          of the image to get a different label.
 
-   2. The 8 connected regions in this inverse image are found.
 
-   3. Since we had a 2 pixel padding on the edges of the image, we
-      know for sure that all labeled regions with a label of 1 are
-      actually connected 'holes' in the input image.
+/* Fill all the holes in an input unsigned char array.
+
+   A hole is a region of 0-valued pixels that is not connected (with the
+   given connectivity) to the edges of the dataset. The basic method is
+   this:
 
-      Any pixel with a label larger than 1, is therefore a bounded
-      hole that is not 8-connected to the rest of the holes.  */
+   1. All the 0-valued pixels on the edges of the dataset are flooded
+      (with a temporary value) along with any 0-valued pixel that is
+      connected to them. This is done in-place, so no padded copy of the
+      dataset is necessary.
+
+   2. Any 0-valued pixel that remains is within a hole and is set to 1.
+      When 'maxsize' is given, each hole is flooded separately to find its
+      size: only holes with a size smaller or equal to 'maxsize' are
+      filled.
+
+   3. The temporary value is set back to 0.
+
+   Blank pixels (or any other value that is not 0) are not flooded, so
+   they are treated like foreground pixels in defining the holes, but
+   they are never filled. */
 void
 gal_binary_holes_fill(gal_data_t *input, int connectivity, size_t maxsize)
 {
-  uint8_t *in;
-  uint32_t *i, *fi;
-  size_t numholes, *sizes;
-  gal_data_t *inv, *tile, *holelabs=NULL;
+  int edge;
+  uint8_t *byt;
+  size_t *dinc;
+  gal_list_sizet_ring_t flooded;
+  size_t i, d, j, h, numholepix, ndim=input->ndim, size=input->size;
 
   /* Small sanity checks. */
   if( input->type != GAL_TYPE_UINT8 )
@@ -1052,54 +1201,56 @@ gal_binary_holes_fill(gal_data_t *input, int connectivity, size_t maxsize)
           "(%zu)", __func__, connectivity, input->ndim);
 
 
-  /* Make the inverse image. */
-  inv=binary_make_padded_inverse(input, &tile);
+  /* Allocate the necessary arrays (the ring will grow when
+     necessary). */
+  byt=input->array;
+  gal_list_sizet_ring_init(&flooded, 1024);
+  dinc=gal_dimension_increment(ndim, input->dsize);
 
 
-  /* Label the holes */
-  numholes=gal_binary_connected_components(inv, &holelabs, connectivity);
+  /* Flood all the 0-valued pixels that are connected to the edges. */
+  for(i=0;i<size;++i)
+    if(byt[i]==0)
+      {
+        /* See if this pixel is on the edge of the dataset (along any
+           dimension). */
+        edge=0;
+        for(j=i, d=ndim; d-->0; j/=input->dsize[d])
+          if( j%input->dsize[d]==0 || j%input->dsize[d]==input->dsize[d]-1 )
+            { edge=1; break; }
+
+        /* If it is, flood it (we don't need the indexs). */
+        if(edge)
+          binary_holes_flood(input, connectivity, dinc, i, &flooded);
+      }
 
 
-  /* Any pixel with a label larger than 1 is a hole in the input image and
-     we should invert the respective pixel. To do it, we'll use the tile
-     that was defined before, just change its block and array.*/
-  in=input->array;
-  tile->array=gal_tile_block_relative_to_other(tile, holelabs);
-  tile->block=holelabs; /* has to be after correcting 'tile->array'. */
+  /* Fill the holes. */
+  for(i=0;i<size;++i)
+    if(byt[i]==0)
+      {
+        /* When there is no size limit, all remaining 0-valued pixels are
+           holes. */
+        if(maxsize==-1) byt[i]=1;
 
-  /* If the user wants to only fill holes to a certain size, then remove
-     those with a larger size. */
-  if(maxsize<-1)
-    {
-      /* Allocate space to keep the size of each hole: */
-      sizes=gal_pointer_allocate(GAL_TYPE_SIZE_T, numholes+1, 1, __func__,
-                                 "sizes");
-      fi=(i=holelabs->array)+holelabs->size; do ++sizes[*i]; while(++i<fi);
-
-      /* Set those labels with a larger size to 1 (treat it as
-         background). */
-      fi=(i=holelabs->array)+holelabs->size;
-      do
-        if(*i!=GAL_BLANK_INT32) *i = sizes[*i]>maxsize ? 1 : *i;
-      while(++i<fi);
-
-      /* Clean up. */
-      free(sizes);
-    }
+        /* With a size limit, flood this hole, then fill it if it is not
+           larger than the limit. */
+        else
+          {
+            numholepix=binary_holes_flood(input, connectivity, dinc, i,
+                                          &flooded);
+            if(numholepix<=maxsize)
+              for(h=0;h<numholepix;++h) byt[ flooded.array[h] ]=1;
+          }
+      }
 
-  /* The type of the tile is already known (it is 'int32_t') and we have no
-     output, so we'll just put 'int' as a place-holder. In this way we can
-     avoid the switch statement of GAL_TILE_PARSE_OPERATE, and directly use
-     the workhorse macro 'GAL_TILE_PO_OISET'. */
-  GAL_TILE_PO_OISET(int32_t, int, tile, NULL, 0, 0, {
-      *in = *i>1 && *i!=GAL_BLANK_INT32 ? 1 : *in;
-      ++in;
-    });
 
+  /* Set the flooded pixels back to 0. */
+  for(j=0;j<size;++j)
+    byt[j] = byt[j]==GAL_BINARY_TMP_VALUE ? 0 : byt[j];
 
-  /* Clean up and return. */
-  tile->array=NULL;
-  gal_data_free(inv);
-  gal_data_free(tile);
-  gal_data_free(holelabs);
+
+  /* Clean up. */
+  free(dinc);
+  gal_list_sizet_ring_free(&flooded);
 }
@@ -400,7 +400,10 @@ gal_blank_is(void *pointer, uint8_t type)
    flags, to avoid repeating parsing of the full dataset multiple times
    (when it occurs), please toggle the flags your self after the first
    check. */
+#define BLANK_PRESENT_CHUNK 256
 #define HAS_BLANK(IT) {                                                 \
+    int acc;                                                            \
+    size_t j, n;                                                        \
     IT b, *a=input->array, *af=a+input->size, *start;                   \
     gal_blank_write(&b, block->type);                                   \
                                                                         \
@@ -415,9 +418,17 @@ gal_blank_is(void *pointer, uint8_t type)
         if(input!=block)                                                \
           af = ( a = start + increment ) + input->dsize[input->ndim-1]; \
                                                                         \
-        /* Check for blank values. */                                   \
-        if(b==b) do if(*a==b)  { hasblank=1; break; } while(++a<af);    \
-        else     do if(*a!=*a) { hasblank=1; break; } while(++a<af);    \
+        /* Check for blank values. To let the compiler vectorize the */ \
+        /* check, it is done without a branch over chunks of memory. */ \
+        for(; a<af && !hasblank; a+=n)                                  \
+          {                                                             \
+            acc=0;                                                      \
+            n = af-a<BLANK_PRESENT_CHUNK ? af-a : BLANK_PRESENT_CHUNK;  \
+            if(b==b) for(j=0;j<n;++j) acc |= a[j]==b;                   \
+            else     for(j=0;j<n;++j) acc |= a[j]!=a[j];                \
+            hasblank=acc;                                               \
+          }                                                             \
+        if(hasblank) break;                                             \
                                                                         \
         /* Necessary when we are on a tile. */                          \
         if(input!=block)                                                \
@@ -551,6 +562,84 @@ gal_blank_number(gal_data_t *input, int updateflag)
 
 
 
+/* Allocate and return a bit-packed blank mask of the input (that should
+   be freed by the caller): element 'i' is blank when bit 'i%64' of word
+   'i/64' is 1. The inner loops over each word have no branches, so they
+   can be vectorized by the compiler. */
+#define BLANK_MASK(IT) {                                                \
+    IT b, *a=input->array;                                              \
+    gal_blank_write(&b, input->type);                                   \
+    for(w=0;w<nwords;++w)                                               \
+      {                                                                 \
+        bits=0;                                                         \
+        n = w<nwords-1 || input->size%64==0 ? 64 : input->size%64;      \
+        if(b==b) for(j=0;j<n;++j) bits |= (uint64_t)(a[j]==b)    << j;  \
+        else     for(j=0;j<n;++j) bits |= (uint64_t)(a[j]!=a[j]) << j;  \
+        mask[w]=bits;                                                   \
+        a+=n;                                                           \
+      }                                                                 \
+  }
+uint64_t *
+gal_blank_mask(gal_data_t *input)
+{
+  char **str;
+  uint64_t bits, *mask;
+  size_t i, j, n, w, nwords=GAL_BLANK_MASK_NWORDS(input->size);
+
+  /* This function currently assumes a contiguous patch of memory. */
+  if(input->block)
+    error(EXIT_FAILURE, 0, "%s: tiles are not supported, the mask can "
+          "only be built over a fully allocated dataset", __func__);
+
+  /* Allocate the mask (atleast one word, so the output is never NULL). */
+  mask=gal_pointer_allocate(GAL_TYPE_UINT64, nwords ? nwords : 1, 1,
+                            __func__, "mask");
+
+  /* Set the bits. */
+  if(input->size && input->array)
+    switch(input->type)
+      {
+      /* Numeric types */
+      case GAL_TYPE_UINT8:     BLANK_MASK( uint8_t  );    break;
+      case GAL_TYPE_INT8:      BLANK_MASK( int8_t   );    break;
+      case GAL_TYPE_UINT16:    BLANK_MASK( uint16_t );    break;
+      case GAL_TYPE_INT16:     BLANK_MASK( int16_t  );    break;
+      case GAL_TYPE_UINT32:    BLANK_MASK( uint32_t );    break;
+      case GAL_TYPE_INT32:     BLANK_MASK( int32_t  );    break;
+      case GAL_TYPE_UINT64:    BLANK_MASK( uint64_t );    break;
+      case GAL_TYPE_INT64:     BLANK_MASK( int64_t  );    break;
+      case GAL_TYPE_FLOAT32:   BLANK_MASK( float    );    break;
+      case GAL_TYPE_FLOAT64:   BLANK_MASK( double   );    break;
+
+      /* String. */
+      case GAL_TYPE_STRING:
+        str=input->array;
+        for(i=0;i<input->size;++i)
+          if( str[i]==NULL || !strcmp(str[i], GAL_BLANK_STRING) )
+            mask[i/64] |= (uint64_t)1 << (i%64);
+        break;
+
+      /* Currently unsupported types. */
+      case GAL_TYPE_BIT:
+      case GAL_TYPE_COMPLEX32:
+      case GAL_TYPE_COMPLEX64:
+        error(EXIT_FAILURE, 0, "%s: %s type not yet supported",
+              __func__, gal_type_name(input->type, 1));
+
+      /* Bad input. */
+      default:
+        error(EXIT_FAILURE, 0, "%s: type value (%d) not recognized",
+              __func__, input->type);
+      }
+
+  /* Return the mask. */
+  return mask;
+}
+
+
+
+
+
 /* Create a dataset of the the same size as the input, but with an uint8_t
    type that has a value of 1 for data that are blank and 0 for those that
    aren't. */
@@ -723,7 +812,9 @@ gal_blank_flag_apply(gal_data_t *input, gal_data_t *flag)
             __func__, input->type);
     }
 
-  /* Update the blank flags. */
+  /* Update the blank flags (the values have changed, so they have to be
+     checked again). */
+  input->flag &= ~(GAL_DATA_FLAG_BLANK_CH | GAL_DATA_FLAG_HASBLANK);
   gal_blank_present(input, 1);
 }
 
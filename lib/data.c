@@ -38,6 +38,7 @@ along with Gnuastro. If not, see <http://www.gnu.org/licenses/>.
 #include <gnuastro/blank.h>
 #include <gnuastro/table.h>
 #include <gnuastro/pointer.h>
+#include <gnuastro/threads.h>
 
 #include <gnuastro-internal/checkset.h>
 
@@ -680,20 +681,34 @@ data_copy_to_string(gal_data_t *from, gal_data_t *to)
 
 
 
+/* Copy/convert the input into the output. When the input is contiguous
+   (not a tile), only the 'num' elements starting from 'start' are
+   converted, this allows different threads to work on different parts of
+   the array.
+
+   When the types differ, the blank value of the input has to be
+   translated to the blank value of the output. But when the input is
+   known to have no blank values, or both types are floating point (where
+   the blank value is NaN in both and is preserved by the cast), a simple
+   cast is enough. Having no conditional in the loop allows the compiler
+   to vectorize it. */
 #define COPY_OT_IT_SET(OT, IT) {                                        \
-    OT ob, *restrict o=out->array;                                      \
+    OT ob, *restrict o=(OT *)(out->array)+start;                        \
     size_t increment=0, num_increment=1;                                \
     size_t mclen=0, contig_len=in->dsize[in->ndim-1];                   \
-    IT ib, *ist=NULL, *restrict i=in->array, *f=i+in->size;             \
-    size_t s_e_ind[2]={0,iblock->size-1}; /* -1: this is INCLUSIVE */   \
+    IT ib, *ist=NULL, *restrict i=(IT *)(in->array)+start, *f=i+num;    \
+    size_t s_e_ind[2]={0,num-1}; /* -1: this is INCLUSIVE */            \
                                                                         \
     /* If we are on a tile, the default values need to change. */       \
     if(in!=iblock)                                                      \
-      ist=gal_tile_start_end_ind_inclusive(in, iblock, s_e_ind);        \
+      {                                                                 \
+        s_e_ind[1]=iblock->size-1;                                      \
+        ist=gal_tile_start_end_ind_inclusive(in, iblock, s_e_ind);      \
+      }                                                                 \
                                                                         \
     /* Constant preparations before the loop. */                        \
     if(iblock->type==out->type)                                         \
-      mclen = in==iblock ? iblock->size : contig_len;                   \
+      mclen = in==iblock ? num : contig_len;                            \
     else                                                                \
       {                                                                 \
         gal_blank_write(&ob, out->type);                                \
@@ -715,7 +730,7 @@ data_copy_to_string(gal_data_t *from, gal_data_t *to)
             memcpy(o, i, mclen*gal_type_sizeof(iblock->type));          \
             o += mclen;                                                 \
           }                                                             \
-        else                                                            \
+        else if(checkblank)                                             \
           {                                                             \
             /* If the blank is a NaN value (only for floating point  */ \
             /* types), it will fail any comparison, so we'll exploit */ \
@@ -724,9 +739,10 @@ data_copy_to_string(gal_data_t *from, gal_data_t *to)
             if(ib==ib) do *o++ = *i==ib ? ob : *i; while(++i<f);        \
             else       do *o++ = *i!=*i ? ob : *i; while(++i<f);        \
           }                                                             \
+        else do *o++ = *i; while(++i<f);                                \
                                                                         \
         /* Update the increment from the start of the input. */         \
-        increment += ( in==iblock ? iblock->size                        \
+        increment += ( in==iblock ? num                                 \
                        : gal_tile_block_increment(iblock, in->dsize,    \
                                                   num_increment++,      \
                                                   NULL) );              \
@@ -771,6 +787,97 @@ data_copy_to_string(gal_data_t *from, gal_data_t *to)
 
 
 
+/* Copy the input's values into the already allocated output array. When
+   the input is contiguous, only 'num' elements starting from 'start' will
+   be copied (in a tile, the whole tile is copied and these are
+   ignored). */
+static void
+data_copy_array(gal_data_t *in, gal_data_t *out, size_t start, size_t num,
+                int checkblank)
+{
+  gal_data_t *iblock=gal_tile_block(in);
+
+  /* Nothing to do. */
+  if(num==0) return;
+
+  /* Do the copying. */
+  switch(out->type)
+    {
+    case GAL_TYPE_UINT8:   COPY_OT_SET( uint8_t  );      break;
+    case GAL_TYPE_INT8:    COPY_OT_SET( int8_t   );      break;
+    case GAL_TYPE_UINT16:  COPY_OT_SET( uint16_t );      break;
+    case GAL_TYPE_INT16:   COPY_OT_SET( int16_t  );      break;
+    case GAL_TYPE_UINT32:  COPY_OT_SET( uint32_t );      break;
+    case GAL_TYPE_INT32:   COPY_OT_SET( int32_t  );      break;
+    case GAL_TYPE_UINT64:  COPY_OT_SET( uint64_t );      break;
+    case GAL_TYPE_INT64:   COPY_OT_SET( int64_t  );      break;
+    case GAL_TYPE_FLOAT32: COPY_OT_SET( float    );      break;
+    case GAL_TYPE_FLOAT64: COPY_OT_SET( double   );      break;
+    case GAL_TYPE_STRING:  data_copy_to_string(in, out); break;
+
+    case GAL_TYPE_BIT:
+    case GAL_TYPE_STRLL:
+    case GAL_TYPE_COMPLEX32:
+    case GAL_TYPE_COMPLEX64:
+      error(EXIT_FAILURE, 0, "%s: copying to %s type not yet supported",
+            __func__, gal_type_name(out->type, 1));
+      break;
+
+    default:
+      error(EXIT_FAILURE, 0, "%s: type %d not recognized for 'out->type'",
+            __func__, out->type);
+    }
+}
+
+
+
+
+
+/* Minimum number of elements for each thread when converting a
+   contiguous array. Below this, the overhead of the threads will be more
+   than the conversion itself. */
+#define DATA_COPY_MIN_PER_THREAD 262144
+
+/* Parameters for converting a contiguous array on multiple threads. */
+struct data_copy_params
+{
+  gal_data_t        *in;     /* Input (contiguous) dataset.           */
+  gal_data_t       *out;     /* Output dataset (already allocated).   */
+  size_t        nchunks;     /* Number of chunks the array is cut to. */
+  int        checkblank;     /* Blank values need to be translated.   */
+};
+
+
+
+
+static void *
+data_copy_on_thread(void *in_prm)
+{
+  struct gal_threads_params *tprm=(struct gal_threads_params *)in_prm;
+  struct data_copy_params *p=(struct data_copy_params *)tprm->params;
+
+  size_t i, c, start, end, size=p->in->size;
+
+  /* Go over all the chunks that were assigned to this thread. Each chunk
+     is a contiguous range of the array, so the threads never write on the
+     same part of the output. */
+  for(i=0; tprm->indexs[i] != GAL_BLANK_SIZE_T; ++i)
+    {
+      c=tprm->indexs[i];
+      start = size * c / p->nchunks;
+      end   = size * (c+1) / p->nchunks;
+      data_copy_array(p->in, p->out, start, end-start, p->checkblank);
+    }
+
+  /* Wait for all the other threads to finish, then return. */
+  if(tprm->b) pthread_barrier_wait(tprm->b);
+  return NULL;
+}
+
+
+
+
+
 /* Wrapper for 'gal_data_copy_to_new_type', but will copy to the same type
    as the input. Recall that if the input is a tile (a part of the input,
    which is not-contiguous if it has more than one dimension), then the
@@ -791,6 +898,19 @@ gal_data_copy(gal_data_t *in)
    in the requested type. */
 gal_data_t *
 gal_data_copy_to_new_type(gal_data_t *in, uint8_t newtype)
+{
+  return gal_data_copy_to_new_type_threads(in, newtype, 1);
+}
+
+
+
+
+
+/* Similar to 'gal_data_copy_to_new_type', but large contiguous arrays
+   will be converted on 'numthreads' threads. */
+gal_data_t *
+gal_data_copy_to_new_type_threads(gal_data_t *in, uint8_t newtype,
+                                  size_t numthreads)
 {
   gal_data_t *out;
 
@@ -800,7 +920,7 @@ gal_data_copy_to_new_type(gal_data_t *in, uint8_t newtype)
                      in->unit, in->comment);
 
   /* Fill in the output array: */
-  gal_data_copy_to_allocated(in, out);
+  gal_data_copy_to_allocated_threads(in, out, numthreads);
 
   /* Return the created array */
   return out;
@@ -862,6 +982,51 @@ gal_data_copy_to_new_type_free(gal_data_t *in, uint8_t newtype)
 void
 gal_data_copy_to_allocated(gal_data_t *in, gal_data_t *out)
 {
+  gal_data_copy_to_allocated_threads(in, out, 1);
+}
+
+
+
+
+
+/* When the blank values of the input don't need to be translated during
+   the conversion, a simple cast can be used. */
+static int
+data_copy_check_blank(gal_data_t *in, gal_data_t *out)
+{
+  gal_data_t *iblock=gal_tile_block(in);
+
+  /* In floating point types, the blank value is NaN and the cast will
+     keep it as NaN. */
+  if(    ( iblock->type==GAL_TYPE_FLOAT32 || iblock->type==GAL_TYPE_FLOAT64 )
+      && ( out->type==GAL_TYPE_FLOAT32    || out->type==GAL_TYPE_FLOAT64    ) )
+    return 0;
+
+  /* The input (or its block) has already been checked for blank values
+     and it doesn't have any. */
+  if(    ( (in->flag     & GAL_DATA_FLAG_BLANK_CH)
+           && !(in->flag     & GAL_DATA_FLAG_HASBLANK) )
+      || ( (iblock->flag & GAL_DATA_FLAG_BLANK_CH)
+           && !(iblock->flag & GAL_DATA_FLAG_HASBLANK) ) )
+    return 0;
+
+  /* Blank values have to be checked. */
+  return 1;
+}
+
+
+
+
+
+/* Similar to 'gal_data_copy_to_allocated', but when the input is a large
+   contiguous array and the types differ, the conversion will be done on
+   'numthreads' threads (each thread converting a contiguous part of the
+   array). */
+void
+gal_data_copy_to_allocated_threads(gal_data_t *in, gal_data_t *out,
+                                   size_t numthreads)
+{
+  struct data_copy_params p;
   gal_data_t *iblock=gal_tile_block(in);
 
   /* Make sure the number of allocated elements (of whatever type) in the
@@ -891,34 +1056,26 @@ gal_data_copy_to_allocated(gal_data_t *in, gal_data_t *out)
   gal_checkset_allocate_copy(in->unit,    &out->unit);
   gal_checkset_allocate_copy(in->comment, &out->comment);
 
-  /* Do the copying. */
+  /* Do the copying. Threads are only useful when there is a conversion
+     (a single 'memcpy' is already limited by the memory bandwidth) and
+     each thread has a large enough range to work on. */
   if(in->array)
-    switch(out->type)
-      {
-      case GAL_TYPE_UINT8:   COPY_OT_SET( uint8_t  );      break;
-      case GAL_TYPE_INT8:    COPY_OT_SET( int8_t   );      break;
-      case GAL_TYPE_UINT16:  COPY_OT_SET( uint16_t );      break;
-      case GAL_TYPE_INT16:   COPY_OT_SET( int16_t  );      break;
-      case GAL_TYPE_UINT32:  COPY_OT_SET( uint32_t );      break;
-      case GAL_TYPE_INT32:   COPY_OT_SET( int32_t  );      break;
-      case GAL_TYPE_UINT64:  COPY_OT_SET( uint64_t );      break;
-      case GAL_TYPE_INT64:   COPY_OT_SET( int64_t  );      break;
-      case GAL_TYPE_FLOAT32: COPY_OT_SET( float    );      break;
-      case GAL_TYPE_FLOAT64: COPY_OT_SET( double   );      break;
-      case GAL_TYPE_STRING:  data_copy_to_string(in, out); break;
-
-      case GAL_TYPE_BIT:
-      case GAL_TYPE_STRLL:
-      case GAL_TYPE_COMPLEX32:
-      case GAL_TYPE_COMPLEX64:
-        error(EXIT_FAILURE, 0, "%s: copying to %s type not yet supported",
-              __func__, gal_type_name(out->type, 1));
-        break;
-
-      default:
-        error(EXIT_FAILURE, 0, "%s: type %d not recognized for 'out->type'",
-              __func__, out->type);
-      }
+    {
+      p.in=in;
+      p.out=out;
+      p.checkblank=data_copy_check_blank(in, out);
+      p.nchunks=in->size/DATA_COPY_MIN_PER_THREAD;
+      if(p.nchunks>numthreads) p.nchunks=numthreads;
+      if( p.nchunks>1
+          && in==iblock
+          && in->type!=out->type
+          && in->type!=GAL_TYPE_STRING
+          && out->type!=GAL_TYPE_STRING )
+        gal_threads_spin_off(data_copy_on_thread, &p, p.nchunks,
+                             p.nchunks, in->minmapsize, in->quietmmap);
+      else
+        data_copy_array(in, out, 0, in->size, p.checkblank);
+    }
   else out->array=NULL;
 
   /* Correct the sizes of the output to be the same as the input. If it is
@@ -23,13 +23,17 @@ along with Gnuastro. If not, see <http://www.gnu.org/licenses/>.
 #include <config.h>
 
 #include <time.h>
+#include <math.h>
 #include <errno.h>
 #include <error.h>
 #include <stdio.h>
 #include <ctype.h>
 #include <stdlib.h>
 #include <string.h>
+#include <fcntl.h>
 #include <unistd.h>
+#include <stat-time.h>
+#include <sys/stat.h>
 
 #include <gsl/gsl_version.h>
 
@@ -715,19 +719,180 @@ gal_fits_hdu_num(char *filename)
 
 
 
+/* Parameters for calculating the datasum on multiple threads. */
+struct fits_datasum_params
+{
+  int                   fd;  /* File descriptor of input.              */
+  char           *filename;  /* Name of input file (for errors).       */
+  off_t              start;  /* Byte offset of the data unit in file.  */
+  size_t              size;  /* Number of bytes in the data unit.      */
+  size_t           blksize;  /* Number of bytes in each block.         */
+  uint32_t           *sums;  /* Ones' complement sum of each block.    */
+};
+
+
+
+
+
+/* Fold the carries of a 64-bit sum of 32-bit words into a 32-bit ones'
+   complement sum (the FITS checksum convention). */
+static uint32_t
+fits_datasum_fold(uint64_t sum)
+{
+  while(sum>>32) sum = (sum & 0xffffffff) + (sum>>32);
+  return sum;
+}
+
+
+
+
+
+/* Ones' complement sum of the given blocks of the data unit. The data are
+   big-endian 32-bit integers. The ones' complement sum is associative, so
+   each block can be summed independently. Within each block, the 32-bit
+   words are accumulated in a 64-bit integer (the carries are only folded
+   at the end), so the loop has no dependency between iterations other than
+   the addition (which the compiler can vectorize). */
+static void *
+fits_datasum_on_thread(void *in_prm)
+{
+  /* Low-level definitions to be done first. */
+  struct gal_threads_params *tprm=(struct gal_threads_params *)in_prm;
+  struct fits_datasum_params *p=(struct fits_datasum_params *)tprm->params;
+
+  /* Subsequent definitions. */
+  ssize_t r;
+  uint64_t sum;
+  size_t i, j, len, done;
+  unsigned char *buf, *b;
+
+  /* Allocate the buffer of this thread. */
+  buf=gal_pointer_allocate(GAL_TYPE_UINT8, p->blksize, 0, __func__, "buf");
+
+  /* Go over all the blocks that were assigned to this thread. */
+  for(i=0; tprm->indexs[i] != GAL_BLANK_SIZE_T; ++i)
+    {
+      /* Read this block (the data unit's size is always a multiple of
+         2880, so every block has a multiple of 4 bytes). */
+      len = ( (tprm->indexs[i]+1)*p->blksize > p->size
+              ? p->size - tprm->indexs[i]*p->blksize
+              : p->blksize );
+      for(done=0; done<len; done+=r)
+        {
+          errno=0;
+          r=pread(p->fd, buf+done, len-done,
+                  p->start + tprm->indexs[i]*p->blksize + done);
+          if(r<=0)
+            error(EXIT_FAILURE, r ? errno : 0, "%s: couldn't read %zu "
+                  "bytes of the data unit (for the datasum)", p->filename,
+                  len);
+        }
+
+      /* Sum the big-endian 32-bit words. */
+      sum=0;
+      for(j=0; j<len; j+=4)
+        {
+          b=buf+j;
+          sum += ( (uint32_t)b[0]<<24 | (uint32_t)b[1]<<16
+                   | (uint32_t)b[2]<<8 | (uint32_t)b[3] );
+        }
+      p->sums[ tprm->indexs[i] ] = fits_datasum_fold(sum);
+    }
+
+  /* Clean up, wait for all threads to finish, then return. */
+  free(buf);
+  if(tprm->b) pthread_barrier_wait(tprm->b);
+  return NULL;
+}
+
+
+
+
+
+/* Calculate the datasum of the data unit in the given bytes of the file
+   directly (without CFITSIO) on multiple threads. If the file on the disk
+   isn't a plain FITS file (for example it is compressed with gzip and
+   CFITSIO has decompressed it in memory), this function will return 0
+   and put nothing in 'datasum'. */
+static int
+fits_datasum_direct(char *filename, LONGLONG headstart, LONGLONG datastart,
+                    LONGLONG dataend, size_t numthreads,
+                    unsigned long *datasum)
+{
+  uint64_t sum=0;
+  size_t i, nblocks;
+  char first[8]={0};
+  struct fits_datasum_params p;
+
+  /* Open the file and make sure the header is at the expected place. */
+  p.fd=open(filename, O_RDONLY);
+  if(p.fd<0) return 0;
+  if( pread(p.fd, first, 8, headstart)!=8
+      || ( strncmp(first, "SIMPLE  ", 8) && strncmp(first, "XTENSION", 8) ) )
+    { close(p.fd); return 0; }
+
+  /* Set the parameters. */
+  p.filename=filename;
+  p.start=datastart;
+  p.size=dataend-datastart;
+  p.blksize=2880*1024;
+  nblocks=(p.size+p.blksize-1)/p.blksize;
+  p.sums=gal_pointer_allocate(GAL_TYPE_UINT32, nblocks ? nblocks : 1, 1,
+                              __func__, "p.sums");
+
+  /* Sum each block on a separate thread. */
+  if(nblocks)
+    gal_threads_spin_off(fits_datasum_on_thread, &p, nblocks,
+                         numthreads<nblocks ? numthreads : nblocks, -1, 1);
+
+  /* Add the sums of all the blocks. */
+  for(i=0;i<nblocks;++i) sum+=p.sums[i];
+  *datasum=fits_datasum_fold(sum);
+
+  /* Clean up and return. */
+  free(p.sums);
+  close(p.fd);
+  return 1;
+}
+
+
+
+
+
 /* Calculate the datasum of the given HDU in the given file. */
 unsigned long
 gal_fits_hdu_datasum(char *filename, char *hdu)
+{
+  return gal_fits_hdu_datasum_threads(filename, hdu, 1);
+}
+
+
+
+
+
+/* Similar to 'gal_fits_hdu_datasum', but when the file is a plain FITS
+   file on the disk, the data unit is read directly and summed on
+   'numthreads' threads. Otherwise, CFITSIO is used. */
+unsigned long
+gal_fits_hdu_datasum_threads(char *filename, char *hdu, size_t numthreads)
 {
   int status=0;
   fitsfile *fptr;
   unsigned long datasum;
+  LONGLONG headstart, datastart, dataend;
+
+  /* A zero number of threads is not meaningful. */
+  if(numthreads==0) numthreads=1;
 
   /* Read the desired extension (necessary for reading the rest). */
   fptr=gal_fits_hdu_open(filename, hdu, READONLY, 1);
 
   /* Calculate the datasum. */
-  datasum=gal_fits_hdu_datasum_ptr(fptr);
+  fits_get_hduaddrll(fptr, &headstart, &datastart, &dataend, &status);
+  gal_fits_io_error(status, "finding the data unit");
+  if( fits_datasum_direct(filename, headstart, datastart, dataend,
+                          numthreads, &datasum)==0 )
+    datasum=gal_fits_hdu_datasum_ptr(fptr);
 
   /* Close the file and return. */
   fits_close_file(fptr, &status);
@@ -739,6 +904,89 @@ gal_fits_hdu_datasum(char *filename, char *hdu)
 
 
 
+/* Same as 'gal_fits_hdu_datasum_threads', but the datasum is kept in (and read
+   from) the 'cachename' file. Each line of the cache contains the device,
+   inode, size and modification time of the file, followed by the datasum
+   and the HDU. If a line with the same properties is found (the last one
+   is used), the file hasn't been changed and the datasum is returned
+   without reading the file. Otherwise, the datasum is calculated and
+   appended to the cache (with one 'write', so concurrent processes don't
+   interfere with each other). */
+unsigned long
+gal_fits_hdu_datasum_cached(char *filename, char *hdu, char *cachename,
+                            size_t numthreads)
+{
+  FILE *fp;
+  char *line=NULL;
+  struct stat st;
+  struct timespec mtime;
+  int fd, found=0, hdustart;
+  unsigned long datasum, cached;
+  uintmax_t dev, ino, cdev, cino;
+  size_t len, linelen=0, hdulen=strlen(hdu);
+  intmax_t size, msec, mnsec, csize, cmsec, cmnsec;
+
+  /* Without a cache, just calculate the datasum. */
+  if(cachename==NULL)
+    return gal_fits_hdu_datasum_threads(filename, hdu, numthreads);
+
+  /* Get the properties of the file. */
+  errno=0;
+  if( stat(filename, &st) )
+    error(EXIT_FAILURE, errno, "%s", filename);
+  mtime=get_stat_mtime(&st);
+  dev=st.st_dev;              ino=st.st_ino;
+  size=st.st_size;            msec=mtime.tv_sec;
+  mnsec=mtime.tv_nsec;
+
+  /* Look into the cache (if it exists). */
+  fp=fopen(cachename, "r");
+  if(fp)
+    {
+      while( getline(&line, &linelen, fp)!=-1 )
+        {
+          /* Parse the line and remove the new-line character. */
+          len=strlen(line);
+          if(len && line[len-1]=='\n') line[--len]='\0';
+          if( sscanf(line, "%ju %ju %jd %jd %jd %lu %n", &cdev, &cino,
+                     &csize, &cmsec, &cmnsec, &cached, &hdustart)!=6 )
+            continue;
+
+          /* If this line corresponds to the file, use it. */
+          if( cdev==dev && cino==ino && csize==size && cmsec==msec
+              && cmnsec==mnsec && len-hdustart==hdulen
+              && !strcmp(line+hdustart, hdu) )
+            { found=1; datasum=cached; }
+        }
+      free(line);
+      fclose(fp);
+    }
+  if(found) return datasum;
+
+  /* Calculate the datasum and add it to the cache. */
+  datasum=gal_fits_hdu_datasum_threads(filename, hdu, numthreads);
+  if( asprintf(&line, "%ju %ju %jd %jd %jd %lu %s\n", dev, ino, size,
+               msec, mnsec, datasum, hdu)<0 )
+    error(EXIT_FAILURE, 0, "%s: asprintf allocation", __func__);
+  errno=0;
+  fd=open(cachename, O_WRONLY | O_APPEND | O_CREAT, 0644);
+  if(fd<0)
+    error(EXIT_FAILURE, errno, "%s: couldn't open datasum cache",
+          cachename);
+  len=strlen(line);
+  if( write(fd, line, len)!=len )
+    error(EXIT_FAILURE, errno, "%s: couldn't write to datasum cache",
+          cachename);
+  close(fd);
+  free(line);
+  return datasum;
+}
+
+
+
+
+
+
 /* Calculate the FITS standard datasum for the opened FITS pointer. */
 unsigned long
 gal_fits_hdu_datasum_ptr(fitsfile *fptr)
@@ -1259,6 +1507,136 @@ gal_fits_key_date_to_seconds(char *fitsdate, char **subsecstr,
 
 
 
+/* Prepare the given keyword's dataset for reading its value (which is
+   necessary for both 'gal_fits_key_read_from_ptr' and
+   'gal_fits_header_key_read'). The returned pointer is where the value
+   should be written. If no type was requested, the value will be read as a
+   string and 'typewasinvalid' will be set to 1. */
+static void *
+fits_key_read_prepare(gal_data_t *tmp, int readcomment, int readunit,
+                      int *typewasinvalid)
+{
+  char **strarray;
+  void *valueptr;
+
+  /* Initialize the status: */
+  tmp->status=0;
+
+  /* For each keyword, this function stores one value currently. So
+     set the size and ndim to 1. But first allocate dsize if it
+     wasn't already allocated. */
+  if(tmp->dsize==NULL)
+    tmp->dsize=gal_pointer_allocate(GAL_TYPE_SIZE_T, 1, 0, __func__,
+                                    "tmp->dsize");
+  tmp->ndim=tmp->size=tmp->dsize[0]=1;
+
+  /* If no type has been given, temporarily set it to a string, we
+     will then deduce the type afterwards. */
+  *typewasinvalid=0;
+  if(tmp->type==GAL_TYPE_INVALID)
+    {
+      *typewasinvalid=1;
+      tmp->type=GAL_TYPE_STRING;
+    }
+
+  /* When the type is a string, 'tmp->array' is an array of pointers
+     to a separately allocated piece of memory. So we have to
+     allocate that space here. If its not a string, then the
+     allocated space above is enough to keep the value.*/
+  switch(tmp->type)
+    {
+    case GAL_TYPE_STRING:
+      tmp->array=strarray=( tmp->array
+                            ? tmp->array
+                            : gal_pointer_allocate(tmp->type, 1, 0,
+                                                   __func__,
+                                                   "tmp->array") );
+      errno=0;
+      valueptr=strarray[0]=malloc(FLEN_VALUE * sizeof *strarray[0]);
+      if(strarray[0]==NULL)
+        error(EXIT_FAILURE, errno, "%s: %zu bytes for strarray[0]",
+              __func__, FLEN_VALUE * sizeof *strarray[0]);
+      break;
+
+    default:
+      tmp->array=valueptr=( tmp->array
+                            ? tmp->array
+                            : gal_pointer_allocate(tmp->type, 1, 0,
+                                                   __func__,
+                                                   "tmp->array") );
+    }
+
+  /* Allocate space for the keyword comment if necessary.*/
+  if(readcomment)
+    {
+      errno=0;
+      tmp->comment=calloc(FLEN_COMMENT, sizeof *tmp->comment);
+      if(tmp->comment==NULL)
+        error(EXIT_FAILURE, errno, "%s: %zu bytes for tmp->comment",
+              __func__, FLEN_COMMENT * sizeof *tmp->comment);
+    }
+  else
+    tmp->comment=NULL;
+
+  /* Allocate space for the keyword unit if necessary. Note that
+     since there is no precise CFITSIO length for units, we will use
+     the 'FLEN_COMMENT' length for units too (theoretically, the unit
+     might take the full remaining area in the keyword). */
+  if(readunit)
+    {
+      errno=0;
+      tmp->unit=calloc(FLEN_COMMENT, sizeof *tmp->unit);
+      if(tmp->unit==NULL)
+        error(EXIT_FAILURE, errno, "%s: %zu bytes for tmp->unit",
+              __func__, FLEN_COMMENT * sizeof *tmp->unit);
+    }
+  else
+    tmp->unit=NULL;
+
+  /* Return the pointer to keep the value. */
+  return valueptr;
+}
+
+
+
+
+
+/* Clean up the keyword's dataset after its value has been read. */
+static void
+fits_key_read_finish(gal_data_t *tmp, void *valueptr, int typewasinvalid)
+{
+  void *numptr;
+  uint8_t numtype;
+
+  /* If the unit string is empty, free the space and set it to NULL. */
+  if(tmp->unit && tmp->unit[0]=='\0') {free(tmp->unit); tmp->unit=NULL;}
+
+  /* Correct the type if no type was requested and the key has been
+     successfully read. */
+  if(tmp->status==0 && typewasinvalid)
+    {
+      /* If the string can be parsed as a number, the number will be
+         allocated and placed in 'numptr', otherwise, 'numptr' will
+         be NULL. */
+      numptr=gal_type_string_to_number(valueptr, &numtype);
+      if(numptr)
+        {
+          free(valueptr);
+          free(tmp->array);
+          tmp->array=numptr;
+          tmp->type=numtype;
+        }
+    }
+
+  /* If the comment was empty, free the space and set it to NULL. */
+  if(tmp->comment && tmp->comment[0]=='\0')
+    {free(tmp->comment); tmp->comment=NULL;}
+}
+
+
+
+
+
 /* Read the keyword values from a FITS pointer. The input should be a
    linked list of 'gal_data_t'. Before calling this function, you just have
    to set the 'name' and desired 'type' values of each element in the list
@@ -1314,121 +1692,29 @@ void
 gal_fits_key_read_from_ptr(fitsfile *fptr, gal_data_t *keysll,
                            int readcomment, int readunit)
 {
-  uint8_t numtype;
+  void *valueptr;
   gal_data_t *tmp;
-  char **strarray;
   int typewasinvalid;
-  void *numptr, *valueptr;
 
   /* Get the desired keywords. */
   for(tmp=keysll;tmp!=NULL;tmp=tmp->next)
     if(tmp->name)
       {
-        /* Initialize the status: */
-        tmp->status=0;
-
-        /* For each keyword, this function stores one value currently. So
-           set the size and ndim to 1. But first allocate dsize if it
-           wasn't already allocated. */
-        if(tmp->dsize==NULL)
-          tmp->dsize=gal_pointer_allocate(GAL_TYPE_SIZE_T, 1, 0, __func__,
-                                          "tmp->dsize");
-        tmp->ndim=tmp->size=tmp->dsize[0]=1;
-
-        /* If no type has been given, temporarily set it to a string, we
-           will then deduce the type afterwards. */
-        typewasinvalid=0;
-        if(tmp->type==GAL_TYPE_INVALID)
-          {
-            typewasinvalid=1;
-            tmp->type=GAL_TYPE_STRING;
-          }
-
-        /* When the type is a string, 'tmp->array' is an array of pointers
-           to a separately allocated piece of memory. So we have to
-           allocate that space here. If its not a string, then the
-           allocated space above is enough to keep the value.*/
-        switch(tmp->type)
-          {
-          case GAL_TYPE_STRING:
-            tmp->array=strarray=( tmp->array
-                                  ? tmp->array
-                                  : gal_pointer_allocate(tmp->type, 1, 0,
-                                                         __func__,
-                                                         "tmp->array") );
-            errno=0;
-            valueptr=strarray[0]=malloc(FLEN_VALUE * sizeof *strarray[0]);
-            if(strarray[0]==NULL)
-              error(EXIT_FAILURE, errno, "%s: %zu bytes for strarray[0]",
-                    __func__, FLEN_VALUE * sizeof *strarray[0]);
-            break;
+        /* Allocate the necessary spaces. */
+        valueptr=fits_key_read_prepare(tmp, readcomment, readunit,
+                                       &typewasinvalid);
 
-          default:
-            tmp->array=valueptr=( tmp->array
-                                  ? tmp->array
-                                  : gal_pointer_allocate(tmp->type, 1, 0,
-                                                         __func__,
-                                                         "tmp->array") );
-          }
-
-        /* Allocate space for the keyword comment if necessary.*/
-        if(readcomment)
-          {
-            errno=0;
-            tmp->comment=calloc(FLEN_COMMENT, sizeof *tmp->comment);
-            if(tmp->comment==NULL)
-              error(EXIT_FAILURE, errno, "%s: %zu bytes for tmp->comment",
-                    __func__, FLEN_COMMENT * sizeof *tmp->comment);
-          }
-        else
-          tmp->comment=NULL;
-
-        /* Allocate space for the keyword unit if necessary. Note that
-           since there is no precise CFITSIO length for units, we will use
-           the 'FLEN_COMMENT' length for units too (theoretically, the unit
-           might take the full remaining area in the keyword). Also note
-           that the unit is only optional, so it needs a separate CFITSIO
-           function call which is done here.*/
-        if(readunit)
-          {
-            /* Allocate space for the unit and read it in. */
-            errno=0;
-            tmp->unit=calloc(FLEN_COMMENT, sizeof *tmp->unit);
-            if(tmp->unit==NULL)
-              error(EXIT_FAILURE, errno, "%s: %zu bytes for tmp->unit",
-                    __func__, FLEN_COMMENT * sizeof *tmp->unit);
-            fits_read_key_unit(fptr, tmp->name, tmp->unit, &tmp->status);
-
-            /* If the string is empty, free the space and set it to NULL. */
-            if(tmp->unit[0]=='\0') {free(tmp->unit); tmp->unit=NULL;}
-          }
-        else
-          tmp->unit=NULL;
+        /* The unit is only optional, so it needs a separate CFITSIO
+           function call. */
+        if(tmp->unit)
+          fits_read_key_unit(fptr, tmp->name, tmp->unit, &tmp->status);
 
         /* Read the keyword and place its value in the pointer. */
         fits_read_key(fptr, gal_fits_type_to_datatype(tmp->type),
                       tmp->name, valueptr, tmp->comment, &tmp->status);
 
-        /* Correct the type if no type was requested and the key has been
-           successfully read. */
-        if(tmp->status==0 && typewasinvalid)
-          {
-            /* If the string can be parsed as a number, the number will be
-               allocated and placed in 'numptr', otherwise, 'numptr' will
-               be NULL. */
-            numptr=gal_type_string_to_number(valueptr, &numtype);
-            if(numptr)
-              {
-                free(valueptr);
-                free(tmp->array);
-                tmp->array=numptr;
-                tmp->type=numtype;
-              }
-          }
-
-        /* If the comment was empty, free the space and set it to NULL. */
-        if(tmp->comment && tmp->comment[0]=='\0')
-          {free(tmp->comment); tmp->comment=NULL;}
+        /* Correct the type and clean up. */
+        fits_key_read_finish(tmp, valueptr, typewasinvalid);
       }
 }
 
@@ -2288,115 +2574,136 @@ gal_fits_key_write_config(gal_fits_list_key_t **keylist, char *title,
 
 
 
-/* From an input list of FITS files and a HDU, select those that have a
-   certain value(s) in a certain keyword.*/
-gal_list_str_t *
-gal_fits_with_keyvalue(gal_list_str_t *files, char *hdu, char *name,
-                       gal_list_str_t *values)
-{
-  int status=0;
-  fitsfile *fptr;
-  char keyvalue[FLEN_VALUE];
-  gal_list_str_t *f, *v, *out=NULL;
 
-  /* Go over the list of files and see if they have the requested
-     keyword(s). */
-  for(f=files; f!=NULL; f=f->next)
-    {
-      /* Open the file. */
-      fptr=gal_fits_hdu_open(f->v, hdu, READONLY, 0);
 
-      /* Only attempt to read the value if the requested HDU could be
-         opened ('fptr!=NULL'). */
-      if(fptr)
-        {
-          /* Check if the keyword actually exists. */
-          if( gal_fits_key_exists_fptr(fptr, name) )
-            {
-              /* Read the keyword. Note that we aren't checking for the
-                 'status' here. If for any reason CFITSIO couldn't read the
-                 value and status if non-zero, the next step won't consider
-                 the file any more. */
-              status=0;
-              fits_read_key(fptr, TSTRING, name, &keyvalue, NULL,
-                            &status);
-
-              /* If the value corresponds to any of the user's values for
-                 this keyword, add it to the list of output names. */
-              if(status==0)
-                for(v=values; v!=NULL; v=v->next)
-                  {
-                    if( strcmp(v->v, keyvalue)==0 )
-                      { gal_list_str_add(&out, f->v, 1); break; }
-                  }
-            }
 
-          /* Close the file. */
-          if( fits_close_file(fptr, &status) )
-            gal_fits_io_error(status, NULL);
-        }
-    }
 
-  /* Reverse the list to be in same order as input and return. */
-  gal_list_str_reverse(&out);
-  return out;
-}
 
 
 
 
 
-/* From an input list of FITS files and a HDU, select those that have a
-   certain value(s) in a certain keyword.*/
-gal_list_str_t *
-gal_fits_unique_keyvalues(gal_list_str_t *files, char *hdu, char *name)
+
+
+
+
+
+
+/**************************************************************/
+/**********            Parsed headers              ************/
+/**************************************************************/
+/* Hash of a keyword name (FNV-1a). FITS keyword names are case
+   insensitive, so the upper-case characters are used. */
+static size_t
+fits_header_hash(char *name)
 {
-  fitsfile *fptr;
-  int status=0, newvalue;
-  char *keyv, keyvalue[FLEN_VALUE];
-  gal_list_str_t *f, *v, *out=NULL;
+  char *c;
+  uint64_t h=14695981039346656037ULL;
+  for(c=name; *c!='\0'; ++c)
+    { h ^= (unsigned char)toupper(*c); h *= 1099511628211ULL; }
+  return h;
+}
 
-  /* Go over the list of files and see if they have the requested
-     keyword(s). */
-  for(f=files; f!=NULL; f=f->next)
+
+
+
+
+/* Parse the full header string (as returned by 'fits_hdr2str') into the
+   parsed header structure and build the hash table of keyword names. */
+static gal_fits_header_t *
+fits_header_parse(char *fullheader, int nkeys)
+{
+  gal_fits_header_t *out;
+  int status, namelen, i;
+  size_t n=0, h, j, len, used=0, nhash=8, *offs;
+  char *b, card[FLEN_CARD], name[FLEN_KEYWORD], value[FLEN_VALUE];
+  char comment[FLEN_COMMENT];
+
+  /* Allocate the output structure and a temporary space to keep the
+     strings (each keyword's name, value and comment are shorter than a
+     card, so three times the card length is enough for all of them with
+     their terminating null characters). The strings of each keyword are
+     kept one after the other, and their offsets are kept in 'offs'. */
+  errno=0;
+  out=calloc(1, sizeof *out);
+  if(out==NULL)
+    error(EXIT_FAILURE, errno, "%s: %zu bytes for 'out'", __func__,
+          sizeof *out);
+  b=gal_pointer_allocate(GAL_TYPE_UINT8, 3*FLEN_CARD*(nkeys ? nkeys : 1),
+                         0, __func__, "b");
+  offs=gal_pointer_allocate(GAL_TYPE_SIZE_T, 3*(nkeys ? nkeys : 1), 0,
+                            __func__, "offs");
+
+  /* Parse each card. */
+  for(i=0;i<nkeys;++i)
     {
-      /* Open the file. */
-      fptr=gal_fits_hdu_open(f->v, hdu, READONLY, 0);
+      /* Put this card in a null-terminated string. */
+      strncpy(card, fullheader+i*(FLEN_CARD-1), FLEN_CARD-1);
+      card[FLEN_CARD-1]='\0';
 
-      /* Only attempt to read the value if the requested HDU could be
-         opened ('fptr!=NULL'). */
-      if(fptr)
-        {
-          /* Check if the keyword actually exists. */
-          if( gal_fits_key_exists_fptr(fptr, name) )
-            {
-              /* Read the keyword. Note that we aren't checking for the
-                 'status' here. If for any reason CFITSIO couldn't read the
-                 value and status if non-zero, the next step won't consider
-                 the file any more. */
-              status=0;
-              fits_read_key(fptr, TSTRING, name, &keyvalue, NULL,
-                            &status);
-
-              /* If the value is new, add it to the list. */
-              if(status==0)
-                {
-                  newvalue=1;
-                  keyv=gal_txt_trim_space(keyvalue);
-                  for(v=out; v!=NULL; v=v->next)
-                    { if( strcmp(v->v, keyv)==0 ) newvalue=0; }
-                  if(newvalue) gal_list_str_add(&out, keyv, 1);
-                }
-            }
+      /* Get the name and value. If the card can't be parsed, ignore it
+         (a malformed card will be reported by CFITSIO when it is read
+         in any other way). */
+      status=0;
+      fits_get_keyname(card, name, &namelen, &status);
+      if(status) continue;
+      if( !strcmp(name, "END") ) break;
+      fits_parse_value(card, value, comment, &status);
+      if(status) continue;
+
+      /* Keep the strings. */
+      offs[3*n]=used;   len=strlen(name)+1;    memcpy(b+used, name, len);
+      used+=len;
+      offs[3*n+1]=used; len=strlen(value)+1;   memcpy(b+used, value, len);
+      used+=len;
+      offs[3*n+2]=used; len=strlen(comment)+1; memcpy(b+used, comment, len);
+      used+=len;
+      ++n;
+    }
 
-          /* Close the file. */
-          if( fits_close_file(fptr, &status) )
-            gal_fits_io_error(status, NULL);
-        }
+  /* Move the strings into a buffer that is only as large as necessary
+     (many headers may be kept in memory) and set the pointers. */
+  out->ncards=n;
+  out->buffer=gal_pointer_allocate(GAL_TYPE_UINT8, used ? used : 1, 0,
+                                   __func__, "out->buffer");
+  memcpy(out->buffer, b, used);
+  out->names=gal_pointer_allocate(GAL_TYPE_STRING, n ? n : 1, 0,
+                                  __func__, "out->names");
+  out->values=gal_pointer_allocate(GAL_TYPE_STRING, n ? n : 1, 0,
+                                   __func__, "out->values");
+  out->comments=gal_pointer_allocate(GAL_TYPE_STRING, n ? n : 1, 0,
+                                     __func__, "out->comments");
+  for(h=0;h<n;++h)
+    {
+      out->names[h]    = out->buffer + offs[3*h];
+      out->values[h]   = out->buffer + offs[3*h+1];
+      out->comments[h] = out->buffer + offs[3*h+2];
     }
+  free(offs);
+  free(b);
+
+  /* Build the hash table (with open addressing and linear probing). Its
+     size is a power of two that is at least twice the number of keywords
+     (so it is never more than half full). Only the first occurrence of
+     each keyword is kept (which is what 'fits_read_key' will return from
+     a newly opened HDU). */
+  while(nhash<2*n) nhash*=2;
+  out->nhash=nhash;
+  out->hash=gal_pointer_allocate(GAL_TYPE_SIZE_T, nhash, 0, __func__,
+                                 "out->hash");
+  for(h=0;h<nhash;++h) out->hash[h]=GAL_BLANK_SIZE_T;
+  for(j=0;j<n;++j)
+    if(out->names[j][0]!='\0')
+      {
+        for(h=fits_header_hash(out->names[j]) & (nhash-1);
+            out->hash[h]!=GAL_BLANK_SIZE_T;
+            h=(h+1) & (nhash-1))
+          if( !strcasecmp(out->names[ out->hash[h] ], out->names[j]) )
+            break;
+        if(out->hash[h]==GAL_BLANK_SIZE_T) out->hash[h]=j;
+      }
 
-  /* Reverse the list to be in same order as input and return. */
-  gal_list_str_reverse(&out);
+  /* Return the parsed header. */
   return out;
 }
 
@@ -2404,52 +2711,605 @@ gal_fits_unique_keyvalues(gal_list_str_t *files, char *hdu, char *name)
 
 
 
+/* Read all the keywords of the HDU that is already opened in 'fptr' into
+   a parsed header (with a single CFITSIO call). */
+gal_fits_header_t *
+gal_fits_header_read_from_ptr(fitsfile *fptr)
+{
+  int nkeys, status=0;
+  char *fullheader;
+  gal_fits_header_t *out;
 
+  /* Read the full header as a single string. */
+  if( fits_hdr2str(fptr, 0, NULL, 0, &fullheader, &nkeys, &status) )
+    gal_fits_io_error(status, NULL);
 
+  /* Parse the header. */
+  out=fits_header_parse(fullheader, nkeys);
 
+  /* Clean up and return. */
+  if( fits_free_memory(fullheader, &status) )
+    gal_fits_io_error(status, "problem in freeing the memory used to "
+                      "keep all the headers");
+  return out;
+}
 
 
 
 
 
+/* Read all the keywords of the given HDU into a parsed header. If the HDU
+   can't be opened and 'exitonerror==0', this function will return NULL
+   (otherwise it will abort with an error). */
+gal_fits_header_t *
+gal_fits_header_read(char *filename, char *hdu, int exitonerror)
+{
+  int status=0;
+  fitsfile *fptr;
+  gal_fits_header_t *out;
 
+  /* Open the HDU. */
+  fptr=gal_fits_hdu_open(filename, hdu, READONLY, exitonerror);
+  if(fptr==NULL) return NULL;
 
+  /* Read the header and keep the file name and HDU. */
+  out=gal_fits_header_read_from_ptr(fptr);
+  gal_checkset_allocate_copy(filename, &out->filename);
+  gal_checkset_allocate_copy(hdu, &out->hdu);
 
+  /* Close the file and return. */
+  if( fits_close_file(fptr, &status) )
+    gal_fits_io_error(status, NULL);
+  return out;
+}
 
 
 
 
 
-/*************************************************************
- ***********            Array functions            ***********
- *************************************************************/
+/* Parameters for reading the headers of many files on multiple
+   threads. */
+struct fits_header_read_params
+{
+  char                  **files;  /* Names of the input files.          */
+  char                     *hdu;  /* HDU in all the files.              */
+  gal_fits_header_t       **out;  /* Parsed header of each file.        */
+};
 
-/* Note that the FITS standard defines any array as an 'image',
-   irrespective of how many dimensions it has. This function will return
-   the Gnuastro-type, the number of dimensions and size along each
-   dimension of the image along with its name and units if necessary (not
-   NULL). Note that '*dsize' will be allocated here, so it must not point
-   to any already allocated space. */
-void
-gal_fits_img_info(fitsfile *fptr, int *type, size_t *ndim, size_t **dsize,
-                  char **name, char **unit)
+
+
+
+
+static void *
+fits_header_read_on_thread(void *in_prm)
 {
-  double bscale=NAN;
-  size_t i, dsize_key=1;
-  char **str, *bzero_str=NULL;
-  int bitpix, status=0, naxis;
-  gal_data_t *key, *keysll=NULL;
-  long naxes[GAL_FITS_MAX_NDIM];
+  /* Low-level definitions to be done first. */
+  struct gal_threads_params *tprm=(struct gal_threads_params *)in_prm;
+  struct fits_header_read_params *p
+    = (struct fits_header_read_params *)tprm->params;
 
-  /* Get the BITPIX, number of dimensions and size of each dimension. */
-  if( fits_get_img_param(fptr, GAL_FITS_MAX_NDIM, &bitpix, &naxis,
-                         naxes, &status) )
-    gal_fits_io_error(status, NULL);
-  *ndim=naxis;
+  /* Subsequent definitions. */
+  size_t i, ind;
 
+  /* Read the header of each file that was assigned to this thread. */
+  for(i=0; tprm->indexs[i] != GAL_BLANK_SIZE_T; ++i)
+    {
+      ind=tprm->indexs[i];
+      p->out[ind]=gal_fits_header_read(p->files[ind], p->hdu, 0);
+    }
 
-  /* Convert bitpix to Gnuastro's known types. */
-  *type=gal_fits_bitpix_to_type(bitpix);
+  /* Wait for all threads to finish and return. */
+  if(tprm->b) pthread_barrier_wait(tprm->b);
+  return NULL;
+}
+
+
+
+
+
+/* Read the headers of the given HDU in all the given files on multiple
+   threads. The returned array has one element for each file (in the same
+   order). When the HDU of a file couldn't be opened, its element will be
+   NULL. The output can be freed with 'gal_fits_header_array_free'. */
+gal_fits_header_t **
+gal_fits_header_read_many(gal_list_str_t *files, char *hdu,
+                          size_t numthreads)
+{
+  size_t i, num;
+  gal_list_str_t *f;
+  struct fits_header_read_params p;
+
+  /* A zero number of threads is not meaningful. Multiple threads can
+     only be used when CFITSIO was configured in multi-thread mode (see
+     'gal_fits_tab_read_rows'). */
+#if GAL_CONFIG_HAVE_FITS_IS_REENTRANT == 1
+  if( numthreads==0 || fits_is_reentrant()==0 ) numthreads=1;
+#else
+  numthreads=1;
+#endif
+
+  /* Put the file names into an array and allocate the output. */
+  num=gal_list_str_number(files);
+  p.hdu=hdu;
+  p.files=gal_pointer_allocate(GAL_TYPE_STRING, num ? num : 1, 0,
+                               __func__, "p.files");
+  p.out=gal_pointer_allocate(GAL_TYPE_STRING, num ? num : 1, 1,
+                             __func__, "p.out");
+  for(i=0, f=files; f!=NULL; f=f->next) p.files[i++]=f->v;
+
+  /* Read the headers. */
+  if(num)
+    gal_threads_spin_off(fits_header_read_on_thread, &p, num,
+                         numthreads<num ? numthreads : num, -1, 1);
+
+  /* Clean up and return. */
+  free(p.files);
+  return p.out;
+}
+
+
+
+
+
+/* Return the parsed header of the given file and HDU from the 'cache' list
+   (a 'NULL' pointer for an empty cache). If it isn't already in the cache,
+   it will be read and added to the start of the cache. The cache is only
+   valid as long as the files aren't modified; it can be freed with
+   'gal_fits_header_list_free'. */
+gal_fits_header_t *
+gal_fits_header_cache(gal_fits_header_t **cache, char *filename, char *hdu,
+                      int exitonerror)
+{
+  gal_fits_header_t *h;
+
+  /* See if this file and HDU is already in the cache. */
+  for(h=*cache; h!=NULL; h=h->next)
+    if( h->filename && h->hdu && !strcmp(h->filename, filename)
+        && !strcmp(h->hdu, hdu) )
+      return h;
+
+  /* Read the header and add it to the cache. */
+  h=gal_fits_header_read(filename, hdu, exitonerror);
+  if(h) { h->next=*cache; *cache=h; }
+  return h;
+}
+
+
+
+
+
+/* Index of the given keyword in the parsed header (in the 'names', 'values'
+   and 'comments' arrays), or 'GAL_BLANK_SIZE_T' when the keyword doesn't
+   exist. Similar to CFITSIO, the name is case-insensitive. */
+size_t
+gal_fits_header_index(gal_fits_header_t *header, char *name)
+{
+  size_t h, mask=header->nhash-1;
+
+  for(h=fits_header_hash(name) & mask;
+      header->hash[h]!=GAL_BLANK_SIZE_T;
+      h=(h+1) & mask)
+    if( !strcasecmp(header->names[ header->hash[h] ], name) )
+      return header->hash[h];
+  return GAL_BLANK_SIZE_T;
+}
+
+
+
+
+
+/* Write the string value of a keyword into 'out' (that has 'FLEN_VALUE'
+   elements), similar to how CFITSIO returns strings: the quotes around
+   strings are removed (and any doubled quote inside of them is changed to
+   a single quote) along with their trailing white space. */
+static void
+fits_header_value_to_str(char *value, char *out)
+{
+  char *c, *o=out;
+
+  /* If the value isn't a string, just copy it. */
+  if(value[0]!='\'') { strcpy(out, value); return; }
+
+  /* Remove the quotes. */
+  for(c=value+1; *c!='\0'; ++c)
+    {
+      if(*c=='\'')
+        {
+          if(c[1]=='\'') ++c;
+          else break;
+        }
+      *o++=*c;
+    }
+
+  /* Remove the trailing white space. */
+  while(o>out && o[-1]==' ') --o;
+  *o='\0';
+}
+
+
+
+
+
+/* Parse 'str' as a base-10 integer of the given type into 'valueptr'.
+   Similar to CFITSIO, when the value is written as a floating point
+   number, it is truncated. The returned value is the CFITSIO status:
+   'BAD_C2I' when 'str' isn't a number and 'NUM_OVERFLOW' when the value
+   is not in the range of 'type'. */
+static int
+fits_header_value_read_int(char *str, uint8_t type, void *valueptr)
+{
+  double d;
+  char *tailptr;
+  long long ll=0, min;
+  int isneg, overflow=0;
+  unsigned long long ull=0, max;
+
+  /* The range of the requested type. */
+  switch(type)
+    {
+    case GAL_TYPE_UINT8:  min=0;         max=UINT8_MAX;  break;
+    case GAL_TYPE_INT8:   min=INT8_MIN;  max=INT8_MAX;   break;
+    case GAL_TYPE_UINT16: min=0;         max=UINT16_MAX; break;
+    case GAL_TYPE_INT16:  min=INT16_MIN; max=INT16_MAX;  break;
+    case GAL_TYPE_UINT32: min=0;         max=UINT32_MAX; break;
+    case GAL_TYPE_INT32:  min=INT32_MIN; max=INT32_MAX;  break;
+    case GAL_TYPE_UINT64: min=0;         max=UINT64_MAX; break;
+    case GAL_TYPE_INT64:  min=INT64_MIN; max=INT64_MAX;  break;
+    default:
+      error(EXIT_FAILURE, 0, "%s: a bug! Please contact us at %s to fix "
+            "the problem. Type code %d is not an integer", __func__,
+            PACKAGE_BUGREPORT, type);
+      return 0;
+    }
+
+  /* Parse the string. A leading zero is not an octal prefix in FITS, so
+     the base is always 10. To avoid the wrapping of 'strtoull' on
+     negative numbers, they are parsed with 'strtoll'. */
+  while(isspace(*str)) ++str;
+  isneg = *str=='-';
+  errno=0;
+  if(isneg) ll=strtoll(str, &tailptr, 10);
+  else      ull=strtoull(str, &tailptr, 10);
+  if(errno==ERANGE) overflow=1;
+  if(tailptr==str || *tailptr!='\0')
+    {
+      /* Not an integer: try a decimal floating point number (and
+         truncate it). */
+      if( strpbrk(str, "xX") ) return BAD_C2I;
+      d=strtod(str, &tailptr);
+      if(tailptr==str || *tailptr!='\0' || isnan(d)) return BAD_C2I;
+      overflow=0;
+      if(isneg)
+        {
+          if(d < -9223372036854775808.0) overflow=1;
+          else ll=(long long)d;
+        }
+      else
+        {
+          if(d >= 18446744073709551616.0) overflow=1;
+          else ull=(unsigned long long)d;
+        }
+    }
+
+  /* Check the range (a negative value that truncated to zero is fine). */
+  if(overflow) return NUM_OVERFLOW;
+  if(isneg) { if(ll<min) return NUM_OVERFLOW; }
+  else if(ull>max) return NUM_OVERFLOW;
+
+  /* Write the value ('ull' is within the range of signed types here). */
+  if(!isneg) ll=ull;
+  switch(type)
+    {
+    case GAL_TYPE_UINT8:  *(uint8_t  *)valueptr = ull; break;
+    case GAL_TYPE_INT8:   *(int8_t   *)valueptr = ll;  break;
+    case GAL_TYPE_UINT16: *(uint16_t *)valueptr = ull; break;
+    case GAL_TYPE_INT16:  *(int16_t  *)valueptr = ll;  break;
+    case GAL_TYPE_UINT32: *(uint32_t *)valueptr = ull; break;
+    case GAL_TYPE_INT32:  *(int32_t  *)valueptr = ll;  break;
+    case GAL_TYPE_UINT64: *(uint64_t *)valueptr = ull; break;
+    case GAL_TYPE_INT64:  *(int64_t  *)valueptr = ll;  break;
+    }
+  return 0;
+}
+
+
+
+
+
+/* Read the value of the keyword with index 'ind' of the parsed header into
+   'valueptr' (with the given type). The returned value is the CFITSIO
+   status of reading this keyword. */
+static int
+fits_header_value_read(gal_fits_header_t *header, size_t ind,
+                       uint8_t type, void *valueptr)
+{
+  char *c, str[FLEN_VALUE];
+
+  /* A keyword without a value. */
+  if(header->values[ind][0]=='\0')
+    {
+      if(type==GAL_TYPE_STRING) { *(char *)valueptr='\0'; return 0; }
+      else                      return VALUE_UNDEFINED;
+    }
+
+  /* Read the value as a string (without its quotes). */
+  fits_header_value_to_str(header->values[ind], str);
+  if(type==GAL_TYPE_STRING) { strcpy(valueptr, str); return 0; }
+
+  /* Numbers: logical values are converted to 1 or 0 and FITS allows the
+     'D' exponent of Fortran for double precision numbers. */
+  if( !strcmp(str, "T") || !strcmp(str, "F") )
+    strcpy(str, str[0]=='T' ? "1" : "0");
+  for(c=str; *c!='\0'; ++c) if(*c=='D' || *c=='d') *c='E';
+
+  /* Integers are parsed separately to check their range. */
+  if( gal_type_is_int(type) )
+    return fits_header_value_read_int(str, type, valueptr);
+  return gal_type_from_string(&valueptr, str, type) ? BAD_C2D : 0;
+}
+
+
+
+
+
+/* Similar to 'gal_fits_key_read_from_ptr', but read the keywords from an
+   already parsed header (without any CFITSIO calls). */
+void
+gal_fits_header_key_read(gal_fits_header_t *header, gal_data_t *keysll,
+                         int readcomment, int readunit)
+{
+  size_t ind;
+  char *c, *end;
+  void *valueptr;
+  gal_data_t *tmp;
+  int typewasinvalid;
+
+  /* Get the desired keywords. */
+  for(tmp=keysll;tmp!=NULL;tmp=tmp->next)
+    if(tmp->name)
+      {
+        /* Allocate the necessary spaces. */
+        valueptr=fits_key_read_prepare(tmp, readcomment, readunit,
+                                       &typewasinvalid);
+
+        /* Find the keyword. */
+        ind=gal_fits_header_index(header, tmp->name);
+        if(ind==GAL_BLANK_SIZE_T)
+          tmp->status=KEY_NO_EXIST;
+        else
+          {
+            /* Read the value. */
+            tmp->status=fits_header_value_read(header, ind, tmp->type,
+                                               valueptr);
+
+            /* Copy the comment. */
+            if(tmp->comment) strcpy(tmp->comment, header->comments[ind]);
+
+            /* Similar to CFITSIO, the unit is the string within square
+               brackets at the start of the comment. */
+            c=header->comments[ind];
+            if(tmp->unit && c[0]=='[' && (end=strchr(c, ']'))!=NULL )
+              {
+                strncpy(tmp->unit, c+1, end-c-1);
+                tmp->unit[end-c-1]='\0';
+              }
+          }
+
+        /* Correct the type and clean up. */
+        fits_key_read_finish(tmp, valueptr, typewasinvalid);
+      }
+}
+
+
+
+
+
+/* Free a parsed header. */
+void
+gal_fits_header_free(gal_fits_header_t *header)
+{
+  if(header==NULL) return;
+  free(header->hdu);
+  free(header->hash);
+  free(header->names);
+  free(header->values);
+  free(header->buffer);
+  free(header->comments);
+  free(header->filename);
+  free(header);
+}
+
+
+
+
+
+/* Free a list of parsed headers (for example a cache). */
+void
+gal_fits_header_list_free(gal_fits_header_t *list)
+{
+  gal_fits_header_t *tmp;
+  while(list!=NULL)
+    {
+      tmp=list->next;
+      gal_fits_header_free(list);
+      list=tmp;
+    }
+}
+
+
+
+
+
+/* Free an array of parsed headers (for example the output of
+   'gal_fits_header_read_many'). */
+void
+gal_fits_header_array_free(gal_fits_header_t **headers, size_t num)
+{
+  size_t i;
+  for(i=0;i<num;++i) gal_fits_header_free(headers[i]);
+  free(headers);
+}
+
+
+
+
+
+/* From an input list of FITS files and a HDU, select those that have a
+   certain value(s) in a certain keyword. */
+gal_list_str_t *
+gal_fits_with_keyvalue(gal_list_str_t *files, char *hdu, char *name,
+                       gal_list_str_t *values)
+{
+  return gal_fits_with_keyvalue_threads(files, hdu, name, values, 1);
+}
+
+
+
+
+
+/* Similar to 'gal_fits_with_keyvalue', but the headers of the files are
+   read on 'numthreads' threads. */
+gal_list_str_t *
+gal_fits_with_keyvalue_threads(gal_list_str_t *files, char *hdu,
+                               char *name, gal_list_str_t *values,
+                               size_t numthreads)
+{
+  size_t i, ind, num;
+  gal_fits_header_t **headers;
+  char keyvalue[FLEN_VALUE];
+  gal_list_str_t *f, *v, *out=NULL;
+
+  /* Read the headers of all the files. */
+  num=gal_list_str_number(files);
+  headers=gal_fits_header_read_many(files, hdu, numthreads);
+
+  /* Go over the list of files and see if they have the requested
+     keyword(s). Files where the requested HDU couldn't be opened have a
+     NULL header. */
+  for(i=0, f=files; f!=NULL; f=f->next, ++i)
+    if( headers[i]
+        && (ind=gal_fits_header_index(headers[i], name))!=GAL_BLANK_SIZE_T )
+      {
+        /* If the value corresponds to any of the user's values for this
+           keyword, add it to the list of output names. */
+        fits_header_value_to_str(headers[i]->values[ind], keyvalue);
+        for(v=values; v!=NULL; v=v->next)
+          if( strcmp(v->v, keyvalue)==0 )
+            { gal_list_str_add(&out, f->v, 1); break; }
+      }
+
+  /* Clean up, reverse the list to be in same order as input and
+     return. */
+  gal_fits_header_array_free(headers, num);
+  gal_list_str_reverse(&out);
+  return out;
+}
+
+
+
+
+
+/* From an input list of FITS files and a HDU, return the unique values of
+   a certain keyword. */
+gal_list_str_t *
+gal_fits_unique_keyvalues(gal_list_str_t *files, char *hdu, char *name)
+{
+  return gal_fits_unique_keyvalues_threads(files, hdu, name, 1);
+}
+
+
+
+
+
+/* Similar to 'gal_fits_unique_keyvalues', but the headers of the files
+   are read on 'numthreads' threads. */
+gal_list_str_t *
+gal_fits_unique_keyvalues_threads(gal_list_str_t *files, char *hdu,
+                                  char *name, size_t numthreads)
+{
+  int newvalue;
+  size_t i, ind, num;
+  gal_fits_header_t **headers;
+  gal_list_str_t *f, *v, *out=NULL;
+  char *keyv, keyvalue[FLEN_VALUE];
+
+  /* Read the headers of all the files. */
+  num=gal_list_str_number(files);
+  headers=gal_fits_header_read_many(files, hdu, numthreads);
+
+  /* Go over the list of files and see if they have the requested
+     keyword(s). Files where the requested HDU couldn't be opened have a
+     NULL header. */
+  for(i=0, f=files; f!=NULL; f=f->next, ++i)
+    if( headers[i]
+        && (ind=gal_fits_header_index(headers[i], name))!=GAL_BLANK_SIZE_T )
+      {
+        /* If the value is new, add it to the list. */
+        newvalue=1;
+        fits_header_value_to_str(headers[i]->values[ind], keyvalue);
+        keyv=gal_txt_trim_space(keyvalue);
+        for(v=out; v!=NULL; v=v->next)
+          { if( strcmp(v->v, keyv)==0 ) newvalue=0; }
+        if(newvalue) gal_list_str_add(&out, keyv, 1);
+      }
+
+  /* Clean up, reverse the list to be in same order as input and
+     return. */
+  gal_fits_header_array_free(headers, num);
+  gal_list_str_reverse(&out);
+  return out;
+}
+
+
+
+
+
+
+
+
+
+
+
+
+
+
+
+
+
+
+
+
+
+/*************************************************************
+ ***********            Array functions            ***********
+ *************************************************************/
+
+/* Note that the FITS standard defines any array as an 'image',
+   irrespective of how many dimensions it has. This function will return
+   the Gnuastro-type, the number of dimensions and size along each
+   dimension of the image along with its name and units if necessary (not
+   NULL). Note that '*dsize' will be allocated here, so it must not point
+   to any already allocated space. */
+void
+gal_fits_img_info(fitsfile *fptr, int *type, size_t *ndim, size_t **dsize,
+                  char **name, char **unit)
+{
+  double bscale=NAN;
+  size_t i, dsize_key=1;
+  char **str, *bzero_str=NULL;
+  int bitpix, status=0, naxis;
+  gal_data_t *key, *keysll=NULL;
+  long naxes[GAL_FITS_MAX_NDIM];
+
+  /* Get the BITPIX, number of dimensions and size of each dimension. */
+  if( fits_get_img_param(fptr, GAL_FITS_MAX_NDIM, &bitpix, &naxis,
+                         naxes, &status) )
+    gal_fits_io_error(status, NULL);
+  *ndim=naxis;
+
+
+  /* Convert bitpix to Gnuastro's known types. */
+  *type=gal_fits_bitpix_to_type(bitpix);
 
 
   /* Define the names of the possibly existing important keywords about the
@@ -2533,10 +3393,153 @@ gal_fits_img_info_dim(char *filename, char *hdu, size_t *ndim)
 
 
 
-/* Read a FITS image HDU into a Gnuastro data structure. */
-gal_data_t *
-gal_fits_img_read(char *filename, char *hdu, size_t minmapsize,
-                  int quietmmap)
+/* Parameters for reading a tile-compressed image on multiple threads. */
+struct fits_img_read_params
+{
+  char        *filename;  /* Name of FITS file with the image.        */
+  char             *hdu;  /* HDU of the image.                        */
+  gal_data_t       *img;  /* Allocated output image.                  */
+  void           *blank;  /* Blank value in the image's type.         */
+  size_t      slicesize;  /* Elements in each slice of slowest axis.  */
+  size_t        tilelen;  /* Slices in each row of tiles.             */
+  size_t       numtrows;  /* Number of rows of tiles.                 */
+  size_t      numblocks;  /* Number of blocks of rows of tiles.       */
+};
+
+
+
+
+
+/* Read one contiguous block of rows of tiles in a tile-compressed image
+   (through a separate CFITSIO pointer in each thread). Each tile is
+   compressed independently, so CFITSIO will only decompress the tiles
+   that overlap with the requested pixels. */
+static void *
+fits_img_read_on_thread(void *in_prm)
+{
+  /* Low-level definitions to be done first. */
+  struct gal_threads_params *tprm=(struct gal_threads_params *)in_prm;
+  struct fits_img_read_params *p=
+    (struct fits_img_read_params *)tprm->params;
+
+  /* Subsequent definitions. */
+  long *fpixel;
+  fitsfile *fptr;
+  gal_data_t *img=p->img;
+  int status=0, anyblank;
+  size_t i, d, first, last, ndim=img->ndim;
+
+  /* Open the image and allocate the first pixel array (see
+     'fits_img_read'). */
+  fptr=gal_fits_hdu_open(p->filename, p->hdu, READONLY, 1);
+  fpixel=gal_pointer_allocate(GAL_TYPE_INT64, ndim, 0, __func__, "fpixel");
+
+  /* Go over all the blocks that were assigned to this thread. */
+  for(i=0; tprm->indexs[i] != GAL_BLANK_SIZE_T; ++i)
+    {
+      /* The first and last (not inclusive) slices along the slowest
+         axis in this block. */
+      first = tprm->indexs[i]     * p->numtrows / p->numblocks * p->tilelen;
+      last  = (tprm->indexs[i]+1) * p->numtrows / p->numblocks * p->tilelen;
+      if(last>img->dsize[0]) last=img->dsize[0];
+      if(first>=last) continue;
+
+      /* Read the pixels of this block into their place in the image. */
+      for(d=0;d<ndim-1;++d) fpixel[d]=1;
+      fpixel[ndim-1]=first+1;
+      fits_read_pix(fptr, gal_fits_type_to_datatype(img->type), fpixel,
+                    (last-first)*p->slicesize, p->blank,
+                    gal_pointer_increment(img->array, first*p->slicesize,
+                                          img->type),
+                    &anyblank, &status);
+      gal_fits_io_error(status, NULL);
+    }
+
+  /* Clean up and close the file. */
+  free(fpixel);
+  fits_close_file(fptr, &status);
+  gal_fits_io_error(status, NULL);
+
+  /* Wait for all the other threads to finish, then return. */
+  if(tprm->b) pthread_barrier_wait(tprm->b);
+  return NULL;
+}
+
+
+
+
+
+/* If the image is tile-compressed, read it on multiple threads (in blocks
+   of rows of tiles along the slowest axis, each read through a separate
+   CFITSIO pointer). Returns 1 if the image was read and 0 otherwise (when
+   it should be read in one call to 'fits_read_pix'). */
+static int
+fits_img_read_threads(fitsfile *fptr, char *filename, char *hdu,
+                      gal_data_t *img, void *blank, size_t numthreads)
+{
+  long tilelen;
+  size_t d, ndim=img->ndim;
+  struct fits_img_read_params p;
+  char keyname[FLEN_KEYWORD];
+  int status=0, iscompressed;
+
+  /* Multiple threads can only be used when CFITSIO was configured in
+     multi-thread mode (see 'gal_fits_tab_read_rows'). */
+#if GAL_CONFIG_HAVE_FITS_IS_REENTRANT == 1
+  if( fits_is_reentrant()==0 ) numthreads=1;
+#else
+  numthreads=1;
+#endif
+  if(numthreads<2 || img->size==0) return 0;
+
+  /* Only tile-compressed images are considered: an uncompressed image is
+     already read with a single (sequential) read of the file. */
+  iscompressed=fits_is_compressed_image(fptr, &status);
+  gal_fits_io_error(status, NULL);
+  if(iscompressed==0) return 0;
+
+  /* Get the length of the tiles along the slowest axis (the last in FITS)
+     from the 'ZTILEn' keyword. When it isn't present, the standard
+     default is to compress each row (along the first FITS axis) into a
+     separate tile, so the length along the slowest axis is 1. */
+  sprintf(keyname, "ZTILE%zu", ndim);
+  fits_read_key(fptr, TLONG, keyname, &tilelen, NULL, &status);
+  if(status==KEY_NO_EXIST) { status=0; tilelen=1; }
+  gal_fits_io_error(status, NULL);
+  p.tilelen = tilelen>0 ? tilelen : 1;
+
+  /* Set the basic parameters. */
+  p.img=img;
+  p.hdu=hdu;
+  p.blank=blank;
+  p.filename=filename;
+  p.slicesize=1; for(d=1;d<ndim;++d) p.slicesize*=img->dsize[d];
+  p.numtrows=(img->dsize[0]+p.tilelen-1)/p.tilelen;
+  if(p.numtrows<2) return 0;
+
+  /* Read each block of rows of tiles on a separate thread. */
+  p.numblocks = p.numtrows<numthreads ? p.numtrows : numthreads;
+  gal_threads_spin_off(fits_img_read_on_thread, &p, p.numblocks,
+                       p.numblocks, img->minmapsize, img->quietmmap);
+  return 1;
+}
+
+
+
+
+
+/* Read a FITS image HDU into a Gnuastro data structure. When 'totype' is
+   64-bit floating point and the HDU's values are 32-bit floating point
+   (also when BSCALE is present), CFITSIO can directly convert them while
+   reading (in the same pass that it applies BSCALE and BZERO). This
+   avoids a separate pass over the full image (and the extra copy in
+   memory). In other cases, the blank values may need translation (which
+   is only done by 'gal_data_copy_to_new_type'), or the values may not be
+   representable in 'totype' (which CFITSIO will report as an error), so
+   they will be read in their own type. */
+static gal_data_t *
+fits_img_read(char *filename, char *hdu, uint8_t totype, size_t numthreads,
+              size_t minmapsize, int quietmmap)
 {
   void *blank;
   long *fpixel;
@@ -2567,6 +3570,11 @@ gal_fits_img_read(char *filename, char *hdu, size_t minmapsize,
           hdu);
 
 
+  /* If the requested type can be read directly, use it. */
+  if(type==GAL_TYPE_FLOAT32 && totype==GAL_TYPE_FLOAT64)
+    type=totype;
+
+
   /* Set the fpixel array (first pixel in all dimensions). Note that the
      'long' type will not be larger than 64-bits, so, we'll just assume it
      is 64-bits for space allocation. On 32-bit systems, this won't be a
@@ -2586,10 +3594,15 @@ gal_fits_img_read(char *filename, char *hdu, size_t minmapsize,
   free(dsize);
 
 
-  /* Read the image into the allocated array: */
-  fits_read_pix(fptr, gal_fits_type_to_datatype(type), fpixel,
-                img->size, blank, img->array, &anyblank, &status);
-  if(status) gal_fits_io_error(status, NULL);
+  /* Read the image into the allocated array (tile-compressed images can
+     be decompressed on multiple threads). */
+  if( fits_img_read_threads(fptr, filename, hdu, img, blank,
+                            numthreads)==0 )
+    {
+      fits_read_pix(fptr, gal_fits_type_to_datatype(type), fpixel,
+                    img->size, blank, img->array, &anyblank, &status);
+      if(status) gal_fits_io_error(status, NULL);
+    }
   free(fpixel);
   free(blank);
 
@@ -2607,19 +3620,64 @@ gal_fits_img_read(char *filename, char *hdu, size_t minmapsize,
 
 
 
+/* Read a FITS image HDU into a Gnuastro data structure (in the same type
+   as the HDU). */
+gal_data_t *
+gal_fits_img_read(char *filename, char *hdu, size_t minmapsize,
+                  int quietmmap)
+{
+  return gal_fits_img_read_threads(filename, hdu, 1, minmapsize,
+                                   quietmmap);
+}
+
+
+
+
+
+/* Similar to 'gal_fits_img_read', but a tile-compressed HDU will be
+   decompressed on 'numthreads' threads. */
+gal_data_t *
+gal_fits_img_read_threads(char *filename, char *hdu, size_t numthreads,
+                          size_t minmapsize, int quietmmap)
+{
+  return fits_img_read(filename, hdu, GAL_TYPE_INVALID, numthreads,
+                       minmapsize, quietmmap);
+}
+
+
+
+
+
 /* The user has specified an input file + extension, and your program needs
    this input to be a special type. For such cases, this function can be
    used to convert the input file to the desired type. */
 gal_data_t *
 gal_fits_img_read_to_type(char *inputname, char *hdu, uint8_t type,
                           size_t minmapsize, int quietmmap)
+{
+  return gal_fits_img_read_to_type_threads(inputname, hdu, type, 1,
+                                           minmapsize, quietmmap);
+}
+
+
+
+
+
+/* Similar to 'gal_fits_img_read_to_type', but a tile-compressed HDU will
+   be decompressed on 'numthreads' threads. */
+gal_data_t *
+gal_fits_img_read_to_type_threads(char *inputname, char *hdu, uint8_t type,
+                                  size_t numthreads, size_t minmapsize,
+                                  int quietmmap)
 {
   gal_data_t *in, *converted;
 
-  /* Read the specified input image HDU. */
-  in=gal_fits_img_read(inputname, hdu, minmapsize, quietmmap);
+  /* Read the specified input image HDU (if possible, CFITSIO will
+     directly read it into the requested type). */
+  in=fits_img_read(inputname, hdu, type, numthreads, minmapsize,
+                   quietmmap);
 
-  /* If the input had another type, convert it to float. */
+  /* If the input had another type, convert it. */
   if(in->type!=type)
     {
       converted=gal_data_copy_to_new_type(in, type);
@@ -2692,13 +3750,107 @@ gal_fits_img_read_kernel(char *filename, char *hdu, size_t minmapsize,
 
 
 
+/* Prepare CFITSIO to write the next image HDU (of the given type and
+   dimensions) as a tile-compressed image (with the default tiles: one
+   tile for each row along the first FITS axis). This has to be called
+   before 'fits_create_img'. Floating point images are compressed
+   losslessly (without quantization), which is only possible with the GZIP
+   algorithms. */
+void
+gal_fits_img_compress_set(fitsfile *fptr, uint8_t type, size_t ndim,
+                          uint8_t compress, char *filename)
+{
+  int status=0, ctype=0;
+
+  /* Set the CFITSIO compression algorithm. */
+  switch(compress)
+    {
+    case GAL_FITS_COMPRESS_NONE:      return;
+    case GAL_FITS_COMPRESS_RICE:      ctype=RICE_1;      break;
+    case GAL_FITS_COMPRESS_GZIP:      ctype=GZIP_1;      break;
+    case GAL_FITS_COMPRESS_GZIP2:     ctype=GZIP_2;      break;
+    case GAL_FITS_COMPRESS_HCOMPRESS: ctype=HCOMPRESS_1; break;
+    case GAL_FITS_COMPRESS_PLIO:      ctype=PLIO_1;      break;
+    default:
+      error(EXIT_FAILURE, 0, "%s: a bug! Please contact us at %s to fix "
+            "the problem. The code %u is not recognized as a compression "
+            "algorithm", __func__, PACKAGE_BUGREPORT, compress);
+    }
+
+  /* Sanity checks. */
+  if(ctype==HCOMPRESS_1 && ndim!=2)
+    error(EXIT_FAILURE, 0, "%s: the HCOMPRESS algorithm can only be used "
+          "on 2D images, but the image to write has %zu dimensions",
+          filename, ndim);
+
+  /* Floating point values can only be compressed losslessly with GZIP.
+     The other algorithms need the values to be quantized into integers
+     (which will loose information). */
+  if(type==GAL_TYPE_FLOAT32 || type==GAL_TYPE_FLOAT64)
+    {
+      if(ctype!=GZIP_2) ctype=GZIP_1;
+      fits_set_quantize_level(fptr, 0.0f, &status);
+    }
+
+  /* Set the compression algorithm. */
+  fits_set_compression_type(fptr, ctype, &status);
+  gal_fits_io_error(status, "setting the image compression");
+}
+
+
+
+
+
+/* Write the 'BLANK' keyword of an image that has blank pixels. Floating
+   point types don't need it (blank pixels are NaN). */
+static void
+fits_img_write_blank(fitsfile *fptr, gal_data_t *towrite, int datatype)
+{
+  int status=0;
+  void *blank;
+
+  switch(towrite->type)
+    {
+    case GAL_TYPE_FLOAT32:
+    case GAL_TYPE_FLOAT64:
+      /* Do nothing! Since there are much fewer floating point types
+         (that don't need any BLANK keyword), we are checking them.*/
+      break;
+
+    default:
+      blank=gal_fits_key_img_blank(towrite->type);
+      if(fits_write_key(fptr, datatype, "BLANK", blank,
+                        "Pixels with no data.", &status) )
+        gal_fits_io_error(status, "adding the BLANK keyword");
+      free(blank);
+    }
+}
+
+
+
+
+
 /* This function will write all the data array information (including its
    WCS information) into a FITS file, but will not close it. Instead it
    will pass along the FITS pointer for further modification. */
 fitsfile *
 gal_fits_img_write_to_ptr(gal_data_t *input, char *filename)
 {
-  void *blank;
+  return gal_fits_img_write_to_ptr_compress(input, filename,
+                                            GAL_FITS_COMPRESS_NONE);
+}
+
+
+
+
+
+/* Similar to 'gal_fits_img_write_to_ptr', but when 'compress' isn't
+   'GAL_FITS_COMPRESS_NONE', the image will be written as a
+   tile-compressed image. */
+fitsfile *
+gal_fits_img_write_to_ptr_compress(gal_data_t *input, char *filename,
+                                   uint8_t compress)
+{
   int64_t *i64;
   char *u64key;
   fitsfile *fptr;
@@ -2738,7 +3890,8 @@ gal_fits_img_write_to_ptr(gal_data_t *input, char *filename)
      UINT64, TLONGLONG is only for (signed) INT64. So if the dataset has
      that type, we'll have to convert it to 'INT64' and in the mean-time
      shift its zero, we will then have to write the BZERO and BSCALE
-     keywords accordingly. */
+     keywords accordingly. Because the BZERO keyword has to be written
+     manually after the data, such images are not compressed. */
   if(block->type==GAL_TYPE_UINT64)
     {
       /* Allocate the necessary space. */
@@ -2763,6 +3916,7 @@ gal_fits_img_write_to_ptr(gal_data_t *input, char *filename)
       datatype=TLONGLONG;
       fits_create_img(fptr, LONGLONG_IMG, ndim, naxes, &status);
       gal_fits_io_error(status, NULL);
+      if(hasblank) fits_img_write_blank(fptr, towrite, datatype);
 
       /* Write the image into the file. */
       fits_write_img(fptr, datatype, fpixel, i64data->size, i64data->array,
@@ -2786,10 +3940,16 @@ gal_fits_img_write_to_ptr(gal_data_t *input, char *filename)
       /* Set the datatype */
       datatype=gal_fits_type_to_datatype(block->type);
 
-      /* Create the FITS file. */
+      /* Set the compression (if requested). */
+      gal_fits_img_compress_set(fptr, towrite->type, ndim, compress,
+                                filename);
+
+      /* Create the FITS file. The 'BLANK' keyword has to be written
+         before the data, so it is used when the data are compressed. */
       fits_create_img(fptr, gal_fits_type_to_bitpix(towrite->type),
                       ndim, naxes, &status);
       gal_fits_io_error(status, NULL);
+      if(hasblank) fits_img_write_blank(fptr, towrite, datatype);
 
       /* Write the image into the file. */
       fits_write_img(fptr, datatype, fpixel, towrite->size, towrite->array,
@@ -2807,26 +3967,6 @@ gal_fits_img_write_to_ptr(gal_data_t *input, char *filename)
   status=0;
 
 
-  /* If we have blank pixels, we need to define a BLANK keyword when we are
-     dealing with integer types. */
-  if(hasblank)
-    switch(towrite->type)
-      {
-      case GAL_TYPE_FLOAT32:
-      case GAL_TYPE_FLOAT64:
-        /* Do nothing! Since there are much fewer floating point types
-           (that don't need any BLANK keyword), we are checking them.*/
-        break;
-
-      default:
-        blank=gal_fits_key_img_blank(towrite->type);
-        if(fits_write_key(fptr, datatype, "BLANK", blank,
-                          "Pixels with no data.", &status) )
-          gal_fits_io_error(status, "adding the BLANK keyword");
-        free(blank);
-      }
-
-
   /* Write the extension name to the header. */
   if(towrite->name)
     fits_write_key(fptr, TSTRING, "EXTNAME", towrite->name, "", &status);
@@ -2861,12 +4001,27 @@ gal_fits_img_write_to_ptr(gal_data_t *input, char *filename)
 void
 gal_fits_img_write(gal_data_t *data, char *filename,
                    gal_fits_list_key_t *headers, char *program_string)
+{
+  gal_fits_img_write_compress(data, filename, headers, program_string,
+                              GAL_FITS_COMPRESS_NONE);
+}
+
+
+
+
+
+/* Similar to 'gal_fits_img_write', but the image will be tile-compressed
+   with the given algorithm. */
+void
+gal_fits_img_write_compress(gal_data_t *data, char *filename,
+                            gal_fits_list_key_t *headers,
+                            char *program_string, uint8_t compress)
 {
   int status=0;
   fitsfile *fptr;
 
   /* Write the data array into a FITS file and keep it open: */
-  fptr=gal_fits_img_write_to_ptr(data, filename);
+  fptr=gal_fits_img_write_to_ptr_compress(data, filename, compress);
 
   /* Write all the headers and the version information. */
   gal_fits_key_write_version_in_ptr(&headers, program_string, fptr);
@@ -2884,6 +4039,23 @@ void
 gal_fits_img_write_to_type(gal_data_t *data, char *filename,
                            gal_fits_list_key_t *headers,
                            char *program_string, int type)
+{
+  gal_fits_img_write_to_type_compress(data, filename, headers,
+                                      program_string, type,
+                                      GAL_FITS_COMPRESS_NONE);
+}
+
+
+
+
+
+/* Similar to 'gal_fits_img_write_to_type', but the image will be
+   tile-compressed with the given algorithm. */
+void
+gal_fits_img_write_to_type_compress(gal_data_t *data, char *filename,
+                                    gal_fits_list_key_t *headers,
+                                    char *program_string, int type,
+                                    uint8_t compress)
 {
   /* If the input dataset is not the correct type, then convert it,
      otherwise, use the input data structure. */
@@ -2892,7 +4064,8 @@ gal_fits_img_write_to_type(gal_data_t *data, char *filename,
                          : gal_data_copy_to_new_type(data, type));
 
   /* Write the converted dataset into an image. */
-  gal_fits_img_write(towrite, filename, headers, program_string);
+  gal_fits_img_write_compress(towrite, filename, headers, program_string,
+                              compress);
 
   /* Free the dataset if it was allocated. */
   if(towrite!=data) gal_data_free(towrite);
@@ -2919,6 +4092,26 @@ gal_fits_img_write_corr_wcs_str(gal_data_t *input, char *filename,
                                 char *wcsstr, int nkeyrec, double *crpix,
                                 gal_fits_list_key_t *headers,
                                 char *program_string)
+{
+  gal_fits_img_write_corr_wcs_str_compress(input, filename, wcsstr,
+                                           nkeyrec, crpix, headers,
+                                           program_string,
+                                           GAL_FITS_COMPRESS_NONE);
+}
+
+
+
+
+
+/* Similar to 'gal_fits_img_write_corr_wcs_str', but the image will be
+   tile-compressed with the given algorithm. */
+void
+gal_fits_img_write_corr_wcs_str_compress(gal_data_t *input, char *filename,
+                                         char *wcsstr, int nkeyrec,
+                                         double *crpix,
+                                         gal_fits_list_key_t *headers,
+                                         char *program_string,
+                                         uint8_t compress)
 {
   int status=0;
   fitsfile *fptr;
@@ -2929,7 +4122,7 @@ gal_fits_img_write_corr_wcs_str(gal_data_t *input, char *filename,
           __func__);
 
   /* Write the data array into a FITS file and keep it open. */
-  fptr=gal_fits_img_write_to_ptr(input, filename);
+  fptr=gal_fits_img_write_to_ptr_compress(input, filename, compress);
 
   /* Write the WCS headers into the FITS file. */
   gal_fits_key_write_wcsstr(fptr, NULL, wcsstr, nkeyrec);
@@ -2974,6 +4167,294 @@ gal_fits_img_write_corr_wcs_str(gal_data_t *input, char *filename,
 
 
 
+/**************************************************************/
+/**********          Asynchronous writing          ************/
+/**************************************************************/
+/* One pending HDU in the asynchronous writer's queue. */
+struct fits_writer_hdu
+{
+  gal_data_t                 *data;  /* Dataset to write.              */
+  uint8_t                    owned;  /* ==1: free 'data' when written. */
+  uint8_t                   shared;  /* ==1: 'data->array' not owned.  */
+  char                   *filename;  /* Name of output file.           */
+  gal_fits_list_key_t     *headers;  /* Keywords to write (freed).     */
+  char             *program_string;  /* Name of program.               */
+  uint8_t                 compress;  /* Tile compression algorithm.    */
+  struct fits_writer_hdu     *next;  /* Next pending HDU.              */
+};
+
+
+
+
+
+/* Asynchronous writer of FITS images (with a dedicated I/O thread). */
+struct gal_fits_writer_t
+{
+  int                        async;  /* ==1: write on a separate thread.*/
+  int                       finish;  /* ==1: no more HDUs will come.   */
+  size_t                  maxqueue;  /* Maximum number of pending HDUs.*/
+  size_t                    queued;  /* Number of pending HDUs.        */
+  struct fits_writer_hdu    *first;  /* First pending HDU.             */
+  struct fits_writer_hdu     *last;  /* Last pending HDU.              */
+  pthread_t                 thread;  /* The I/O thread.                */
+  pthread_mutex_t            mutex;  /* Protect the queue.             */
+  pthread_cond_t           changed;  /* Signal changes in the queue.   */
+};
+
+
+
+
+
+/* Write one pending HDU and free its resources (except the HDU structure
+   itself, which may still be in the queue). */
+static void
+fits_writer_hdu_write(struct fits_writer_hdu *hdu)
+{
+  /* Write the image ('gal_fits_img_write_compress' frees the headers). */
+  gal_fits_img_write_compress(hdu->data, hdu->filename, hdu->headers,
+                              hdu->program_string, hdu->compress);
+
+  /* Clean up. When the array belongs to the caller, we should only free
+     the meta-data that were allocated in 'gal_fits_writer_img'. */
+  if(hdu->owned)
+    {
+      if(hdu->shared) hdu->data->array=NULL;
+      gal_data_free(hdu->data);
+    }
+  free(hdu->program_string);
+  free(hdu->filename);
+}
+
+
+
+
+
+/* The I/O thread: write the pending HDUs (in the same order they were
+   given) until the queue is empty and no more HDUs will come. */
+static void *
+fits_writer_thread(void *in_prm)
+{
+  gal_fits_writer_t *w=(gal_fits_writer_t *)in_prm;
+  struct fits_writer_hdu *hdu;
+
+  pthread_mutex_lock(&w->mutex);
+  while(1)
+    {
+      /* Wait until there is something to do. */
+      while(w->first==NULL && w->finish==0)
+        pthread_cond_wait(&w->changed, &w->mutex);
+      if(w->first==NULL) break;
+
+      /* Write the first pending HDU without holding the lock (so new HDUs
+         can be added in the meantime). It is only removed from the queue
+         after it is written, so 'gal_fits_writer_wait' will not return
+         while it is being written. */
+      hdu=w->first;
+      pthread_mutex_unlock(&w->mutex);
+      fits_writer_hdu_write(hdu);
+      pthread_mutex_lock(&w->mutex);
+
+      /* Remove it from the queue and let any waiting caller know. */
+      w->first=hdu->next;
+      if(w->first==NULL) w->last=NULL;
+      --w->queued;
+      pthread_cond_broadcast(&w->changed);
+      free(hdu);
+    }
+  pthread_mutex_unlock(&w->mutex);
+  return NULL;
+}
+
+
+
+
+
+/* Start an asynchronous writer of FITS images. At most 'maxqueue' HDUs
+   can be pending (with 'maxqueue==2', while one HDU is being written, the
+   caller can prepare the next: double-buffering). When the writer isn't
+   asynchronous ('async==0'), each HDU is written immediately by
+   'gal_fits_writer_img'. Since the I/O thread calls CFITSIO while other
+   threads may also be using it, the writer will only be asynchronous when
+   CFITSIO was configured in multi-thread mode. */
+gal_fits_writer_t *
+gal_fits_writer_start(size_t maxqueue, int async)
+{
+  int err;
+  gal_fits_writer_t *w;
+
+  /* Allocate the writer. */
+  errno=0;
+  w=calloc(1, sizeof *w);
+  if(w==NULL)
+    error(EXIT_FAILURE, errno, "%s: %zu bytes for 'w'", __func__,
+          sizeof *w);
+  w->maxqueue = maxqueue ? maxqueue : 1;
+
+  /* See if the writer can be asynchronous. */
+#if GAL_CONFIG_HAVE_FITS_IS_REENTRANT == 1
+  w->async = async && fits_is_reentrant();
+#else
+  w->async = 0;
+#endif
+  if(w->async==0) return w;
+
+  /* Initialize the synchronization structures and start the I/O
+     thread. */
+  if( (err=pthread_mutex_init(&w->mutex, NULL)) )
+    error(EXIT_FAILURE, err, "%s: can't initialize mutex", __func__);
+  if( (err=pthread_cond_init(&w->changed, NULL)) )
+    error(EXIT_FAILURE, err, "%s: can't initialize condition variable",
+          __func__);
+  if( (err=pthread_create(&w->thread, NULL, fits_writer_thread, w)) )
+    error(EXIT_FAILURE, err, "%s: can't create I/O thread", __func__);
+  return w;
+}
+
+
+
+
+
+/* Add 'data' (with the given keywords) as a new HDU of 'filename' to the
+   writer's queue. The HDUs are written in the same order they are given,
+   so multiple HDUs of one file are safe. 'mode' defines the ownership of
+   'data' (the 'headers' will always be freed by the writer):
+
+     GAL_FITS_WRITER_BORROW: the dataset's array is directly written, so
+           the caller must not change or free it until the writer is
+           synchronized with 'gal_fits_writer_wait' or
+           'gal_fits_writer_finish'. Its meta-data (for example the name)
+           are copied here, so they can be changed immediately.
+
+     GAL_FITS_WRITER_COPY: the dataset is copied here (so the caller can
+           immediately modify or free it).
+
+     GAL_FITS_WRITER_FREE: the writer will free the dataset after writing
+           it.
+
+   This function will block while the queue is full. */
+void
+gal_fits_writer_img(gal_fits_writer_t *w, gal_data_t *data, char *filename,
+                    gal_fits_list_key_t *headers, char *program_string,
+                    uint8_t compress, uint8_t mode)
+{
+  struct fits_writer_hdu *hdu;
+
+  /* Allocate the pending HDU. */
+  errno=0;
+  hdu=calloc(1, sizeof *hdu);
+  if(hdu==NULL)
+    error(EXIT_FAILURE, errno, "%s: %zu bytes for 'hdu'", __func__,
+          sizeof *hdu);
+  hdu->headers=headers;
+  hdu->compress=compress;
+  gal_checkset_allocate_copy(filename, &hdu->filename);
+  gal_checkset_allocate_copy(program_string, &hdu->program_string);
+
+  /* Set the dataset to write. A tile can't share its parent's array (it
+     isn't contiguous), so it is always copied. */
+  if( mode==GAL_FITS_WRITER_BORROW && gal_tile_block(data)!=data )
+    mode=GAL_FITS_WRITER_COPY;
+  switch(mode)
+    {
+    case GAL_FITS_WRITER_BORROW:
+      hdu->owned=hdu->shared=1;
+      hdu->data=gal_data_alloc(data->array, data->type, data->ndim,
+                               data->dsize, data->wcs, 0, -1, 1,
+                               data->name, data->unit, data->comment);
+      hdu->data->nwcs=data->nwcs;
+      break;
+    case GAL_FITS_WRITER_COPY:
+      hdu->owned=1;
+      hdu->data=gal_data_copy(data);
+      break;
+    case GAL_FITS_WRITER_FREE:
+      hdu->owned=1;
+      hdu->data=data;
+      break;
+    default:
+      error(EXIT_FAILURE, 0, "%s: a bug! Please contact us at %s to fix "
+            "the problem. The code %u is not a recognized writer mode",
+            __func__, PACKAGE_BUGREPORT, mode);
+    }
+
+  /* When the writer isn't asynchronous, write the HDU immediately. */
+  if(w->async==0) { fits_writer_hdu_write(hdu); free(hdu); return; }
+
+  /* Wait until there is space in the queue, then add the HDU. */
+  pthread_mutex_lock(&w->mutex);
+  while(w->queued>=w->maxqueue)
+    pthread_cond_wait(&w->changed, &w->mutex);
+  if(w->last) w->last->next=hdu; else w->first=hdu;
+  w->last=hdu;
+  ++w->queued;
+  pthread_cond_broadcast(&w->changed);
+  pthread_mutex_unlock(&w->mutex);
+}
+
+
+
+
+
+/* Wait until all the pending HDUs have been written. Afterwards, the
+   borrowed datasets can be modified or freed and the files that were
+   written can be opened by the caller. */
+void
+gal_fits_writer_wait(gal_fits_writer_t *w)
+{
+  if(w->async==0) return;
+  pthread_mutex_lock(&w->mutex);
+  while(w->queued)
+    pthread_cond_wait(&w->changed, &w->mutex);
+  pthread_mutex_unlock(&w->mutex);
+}
+
+
+
+
+
+/* Write all the pending HDUs, stop the I/O thread and free the writer. */
+void
+gal_fits_writer_finish(gal_fits_writer_t *w)
+{
+  int err;
+
+  /* Let the I/O thread know that no more HDUs will come and wait for it
+     to finish. */
+  if(w->async)
+    {
+      pthread_mutex_lock(&w->mutex);
+      w->finish=1;
+      pthread_cond_broadcast(&w->changed);
+      pthread_mutex_unlock(&w->mutex);
+      if( (err=pthread_join(w->thread, NULL)) )
+        error(EXIT_FAILURE, err, "%s: can't join I/O thread", __func__);
+      pthread_mutex_destroy(&w->mutex);
+      pthread_cond_destroy(&w->changed);
+    }
+
+  /* Clean up. */
+  free(w);
+}
+
+
+
+
+
+
+
+
+
+
+
+
+
+
+
+
+
+
+
+
 /**************************************************************/
 /**********                 Table                  ************/
 /**************************************************************/
@@ -3498,8 +4979,9 @@ gal_fits_tab_info(char *filename, char *hdu, size_t *numcols,
 static void
 fits_tab_read_ascii_float_special(char *filename, char *hdu,
                                   fitsfile *fptr, gal_data_t *out,
-                                  size_t colnum, size_t numrows,
-                                  size_t minmapsize, int quietmmap)
+                                  size_t colnum, size_t firstrow,
+                                  size_t numrows, size_t minmapsize,
+                                  int quietmmap)
 {
   double tmp;
   char **strarr;
@@ -3524,7 +5006,7 @@ fits_tab_read_ascii_float_special(char *filename, char *hdu,
     }
 
   /* Read the column as a string. */
-  fits_read_col(fptr, TSTRING, colnum, 1, 1, out->size, NULL,
+  fits_read_col(fptr, TSTRING, colnum, firstrow+1, 1, out->size, NULL,
                 strrows->array, &anynul, &status);
   gal_fits_io_error(status, NULL);
 
@@ -3540,30 +5022,233 @@ fits_tab_read_ascii_float_special(char *filename, char *hdu,
       if(out->type==GAL_TYPE_FLOAT32)
         ((float *)(out->array))[i]=tmp;
       else
-        ((double *)(out->array))[i]=tmp;
+        ((double *)(out->array))[i]=tmp;
+    }
+
+  /* Clean up. */
+  gal_data_free(strrows);
+}
+
+
+
+
+
+/* Maximum number of rows to read at once when only some rows of a
+   column are requested. */
+#define FITS_TAB_READ_BLOCK 65536
+
+/* Read one column of the table in parallel. */
+struct fits_tab_read_onecol_params
+{
+  char              *filename;  /* Name of FITS file with table.     */
+  char                   *hdu;  /* HDU of input table.               */
+  size_t              numrows;  /* Number of rows in table to read.  */
+  size_t             rowstart;  /* First row to read (from 0).       */
+  size_t              *rowids;  /* Only read these rows (if !NULL).  */
+  size_t              numcols;  /* Number of columns.                */
+  size_t           minmapsize;  /* Minimum space to memory-map.      */
+  int               quietmmap;  /* Don't print memory-mapping info.  */
+  gal_data_t         *allcols;  /* Information of all columns.       */
+  gal_data_t       **colarray;  /* Array of pointers to all columns. */
+  gal_list_sizet_t   *indexll;  /* Index of columns to read.         */
+};
+
+
+
+
+
+/* Allocate the output dataset for column 'indin' with 'numrows' rows. */
+static gal_data_t *
+fits_tab_read_col_alloc(struct fits_tab_read_onecol_params *p,
+                        size_t indin, size_t numrows)
+{
+  char **strarr;
+  gal_data_t *col;
+  size_t j, ndim, strw, dsize[2];
+  uint8_t type=p->allcols[indin].type;
+  size_t repeat=p->allcols[indin].minmapsize;
+
+  /* Allocate the necessary space for this column. */
+  if(type!=GAL_TYPE_STRING && repeat>1)
+    { ndim=2; dsize[0]=numrows; dsize[1]=repeat; }
+  else
+    { ndim=1; dsize[0]=numrows; }
+  col=gal_data_alloc(NULL, type, ndim, dsize, NULL, 0, p->minmapsize,
+                     p->quietmmap, p->allcols[indin].name,
+                     p->allcols[indin].unit, p->allcols[indin].comment);
+
+  /* For a string column, we need an allocated array for each element,
+     even in binary values. This value should be stored in the disp_width
+     element of the data structure, which is done automatically in
+     'gal_fits_table_info'. */
+  if(col->type==GAL_TYPE_STRING)
+    {
+      /* Since the column may contain blank values, and the blank string
+         is pre-defined in Gnuastro, we need to be sure that for each row,
+         a blank string can fit. */
+      strw = ( strlen(GAL_BLANK_STRING) > p->allcols[indin].disp_width
+               ? strlen(GAL_BLANK_STRING)
+               : p->allcols[indin].disp_width );
+
+      /* Allocate the space for each row's strings. */
+      strarr=col->array;
+      for(j=0;j<numrows;++j)
+        {
+          errno=0;
+          strarr[j]=calloc(strw+1, sizeof *strarr[0]); /* +1 for '\0' */
+          if(strarr[j]==NULL)
+            error(EXIT_FAILURE, errno, "%s: allocating %zu bytes for "
+                  "strarr[%zu]", __func__, (strw+1) * sizeof *strarr[j],
+                  j);
+        }
+    }
+
+  /* Return the allocated column. */
+  return col;
+}
+
+
+
+
+
+/* Read the rows starting from 'firstrow' (counting from zero) of column
+   'indin' into 'col' (the number of rows is the size of 'col'). */
+static void
+fits_tab_read_col_rows(struct fits_tab_read_onecol_params *p,
+                       fitsfile *fptr, int hdutype, size_t indin,
+                       size_t firstrow, gal_data_t *col)
+{
+  char **strarr;
+  void *blank, *blankuse;
+  int isfloat, anynul=0, status=0;
+
+  /* If this column has a 'repeat' of zero, then just set all its elements
+     to its relevant blank type and don't call CFITSIO (there is nothing
+     for it to read, and it will crash with "FITSIO status = 308: bad first
+     element number First element to write is too large: 1; max allowed
+     value is 0"). */
+  if(p->allcols[indin].flag & GAL_TABLEINTERN_FLAG_TFORM_REPEAT_IS_ZERO)
+    { gal_blank_initialize(col); return; }
+
+  /* Allocate a blank value for the given type and read/store the column
+     using CFITSIO.
+
+     * For binary tables, we only need blank values for integer
+       types. For binary floating point types, the FITS standard defines
+       blanks as NaN (same as almost any other software like
+       Gnuastro). However if a blank value is specified, CFITSIO will
+       convert other special numbers like 'inf' to NaN also. We want to be
+       able to distringuish 'inf' and NaN here, so for floating point
+       types in binary tables, we won't define any blank value. In ASCII
+       tables, CFITSIO doesn't read the 'NAN' values (that it has written
+       itself) unless we specify a blank pointer/value.
+
+     * 'fits_read_col' takes the pointer to the thing that should be
+       placed in a blank column (for strings, the 'char *') pointer.
+       However, for strings, 'gal_blank_alloc_write' will return a 'char
+       **' pointer! So for strings, we need to dereference the blank. This
+       is why we need 'blankuse'. */
+  isfloat = ( col->type==GAL_TYPE_FLOAT32
+              || col->type==GAL_TYPE_FLOAT64 );
+  blank = ( ( hdutype==BINARY_TBL && isfloat )
+            ? NULL
+            : gal_blank_alloc_write(col->type) );
+  blankuse = ( col->type==GAL_TYPE_STRING
+               ? *((char **)blank)
+               : blank);
+  fits_read_col(fptr, gal_fits_type_to_datatype(col->type), indin+1,
+                firstrow+1, 1, col->size, blankuse, col->array, &anynul,
+                &status);
+
+  /* In the ASCII table format some things need to be checked. */
+  if( hdutype==ASCII_TBL )
+    {
+      /* CFITSIO might not be able to read 'INF' or '-INF'. In this case,
+        it will set status to 'BAD_C2D' or 'BAD_C2F'. So, we'll use our
+        own parser for the column values. */
+      if(isfloat && (status==BAD_C2D || status==BAD_C2F) )
+        {
+          fits_tab_read_ascii_float_special(p->filename, p->hdu, fptr, col,
+                                            indin+1, firstrow,
+                                            col->dsize[0], p->minmapsize,
+                                            p->quietmmap);
+          status=0;
+        }
+    }
+  gal_fits_io_error(status, NULL); /* After 'status' correction. */
+
+  /* Clean up and sanity check (just note that the blank value for
+     strings, is an array of strings, so we need to free the contents
+     before freeing itself). */
+  if(col->type==GAL_TYPE_STRING)
+    {strarr=blank; free(strarr[0]);}
+  if(blank) free(blank);
+}
+
+
+
+
+
+/* Read only the rows in 'p->rowids' (that are sorted in increasing order)
+   of column 'indin' into 'col'. The rows are read in blocks that start
+   at a requested row (so blocks with no requested rows are not read at
+   all), then the requested rows are copied into the output. */
+static void
+fits_tab_read_col_rowids(struct fits_tab_read_onecol_params *p,
+                         fitsfile *fptr, int hdutype, size_t indin,
+                         gal_data_t *col)
+{
+  gal_data_t *block;
+  char **ostr, **bstr;
+  size_t i=0, j, first, last, nrows, nblock, rowsize;
+
+  /* Allocate the block (for string columns, the strings have the same
+     allocated width in the output). */
+  nblock = ( col->dsize[0] < FITS_TAB_READ_BLOCK
+             ? col->dsize[0] : FITS_TAB_READ_BLOCK );
+  block=fits_tab_read_col_alloc(p, indin, nblock);
+  rowsize = gal_type_sizeof(col->type) * (col->size/col->dsize[0]);
+
+  /* Go over the requested rows. */
+  while(i<col->dsize[0])
+    {
+      /* Find the rows that fit into this block. */
+      first=p->rowids[i];
+      for(j=i; j<col->dsize[0] && p->rowids[j]-first<nblock; ++j) {}
+      last=p->rowids[j-1];
+      nrows=last-first+1;
+
+      /* Read the rows into the block (the number of rows to read is
+         taken from the size of the dataset). */
+      block->dsize[0]=nrows;
+      block->size=nrows*(block->ndim==2 ? block->dsize[1] : 1);
+      fits_tab_read_col_rows(p, fptr, hdutype, indin, first, block);
+
+      /* Copy the requested rows into the output. */
+      if(col->type==GAL_TYPE_STRING)
+        {
+          ostr=col->array;
+          bstr=block->array;
+          for(;i<j;++i) strcpy(ostr[i], bstr[ p->rowids[i]-first ]);
+        }
+      else
+        for(;i<j;++i)
+          memcpy( (char *)(col->array)+i*rowsize,
+                  (char *)(block->array)+(p->rowids[i]-first)*rowsize,
+                  rowsize );
     }
 
-  /* Clean up. */
-  gal_data_free(strrows);
+  /* Clean up (the block's size should be reset so all the strings are
+     freed). */
+  block->dsize[0]=nblock;
+  block->size=nblock*(block->ndim==2 ? block->dsize[1] : 1);
+  gal_data_free(block);
 }
 
 
 
 
 
-/* Read one column of the table in parallel. */
-struct fits_tab_read_onecol_params
-{
-  char              *filename;  /* Name of FITS file with table.     */
-  char                   *hdu;  /* HDU of input table.               */
-  size_t              numrows;  /* Number of rows in table to read.  */
-  size_t              numcols;  /* Number of columns.                */
-  size_t           minmapsize;  /* Minimum space to memory-map.      */
-  int               quietmmap;  /* Don't print memory-mapping info.  */
-  gal_data_t         *allcols;  /* Information of all columns.       */
-  gal_data_t       **colarray;  /* Array of pointers to all columns. */
-  gal_list_sizet_t   *indexll;  /* Index of columns to read.         */
-};
 void *
 fits_tab_read_onecol(void *in_prm)
 {
@@ -3573,15 +5258,11 @@ fits_tab_read_onecol(void *in_prm)
     = (struct fits_tab_read_onecol_params *)tprm->params;
 
   /* Subsequent definitions. */
-  uint8_t type;
-  char **strarr;
   fitsfile *fptr;
   gal_data_t *col;
-  size_t dsize[2];
   gal_list_sizet_t *tmp;
-  void *blank, *blankuse;
-  int isfloat, hdutype, anynul=0, status=0;
-  size_t i, j, c, ndim, strw, repeat, indout, indin=GAL_BLANK_SIZE_T;
+  int hdutype, status=0;
+  size_t i, c, indout, indin=GAL_BLANK_SIZE_T;
 
   /* Open the FITS file */
   fptr=gal_fits_hdu_open_format(p->filename, p->hdu, 1);
@@ -3601,113 +5282,12 @@ fits_tab_read_onecol(void *in_prm)
       for(tmp=p->indexll;tmp!=NULL;tmp=tmp->next)
         { if(c==indout) { indin=tmp->v; break; } ++c; }
 
-      /* Allocate the necessary space for this column. */
-      type=p->allcols[indin].type;
-      repeat=p->allcols[indin].minmapsize;
-      if(type!=GAL_TYPE_STRING && repeat>1)
-        { ndim=2; dsize[0]=p->numrows; dsize[1]=repeat; }
-      else
-        { ndim=1; dsize[0]=p->numrows; }
-      col=gal_data_alloc(NULL, type, ndim, dsize, NULL, 0,
-                         p->minmapsize, p->quietmmap,
-                         p->allcols[indin].name,
-                         p->allcols[indin].unit,
-                         p->allcols[indin].comment);
-
-      /* For a string column, we need an allocated array for each element,
-         even in binary values. This value should be stored in the
-         disp_width element of the data structure, which is done
-         automatically in 'gal_fits_table_info'. */
-      if(col->type==GAL_TYPE_STRING)
-        {
-          /* Since the column may contain blank values, and the blank
-             string is pre-defined in Gnuastro, we need to be sure that for
-             each row, a blank string can fit. */
-          strw = ( strlen(GAL_BLANK_STRING) > p->allcols[indin].disp_width
-                   ? strlen(GAL_BLANK_STRING)
-                   : p->allcols[indin].disp_width );
-
-          /* Allocate the space for each row's strings. */
-          strarr=col->array;
-          for(j=0;j<p->numrows;++j)
-            {
-              errno=0;
-              strarr[j]=calloc(strw+1, sizeof *strarr[0]); /* +1 for '\0' */
-              if(strarr[j]==NULL)
-                error(EXIT_FAILURE, errno, "%s: allocating %zu bytes for "
-                      "strarr[%zu]", __func__,
-                      (p->allcols[indin].disp_width+1) * sizeof *strarr[j],
-                      j);
-            }
-        }
-
-      /* If this column has a 'repeat' of zero, then just set all its
-         elements to its relevant blank type and don't call CFITSIO (there
-         is nothing for it to read, and it will crash with "FITSIO status =
-         308: bad first element number First element to write is too large:
-         1; max allowed value is 0"). */
-      if(p->allcols[indin].flag & GAL_TABLEINTERN_FLAG_TFORM_REPEAT_IS_ZERO)
-        gal_blank_initialize(col);
-
-      /* The column has non-zero width, read its contents. */
+      /* Allocate the column and read the requested rows into it. */
+      col=fits_tab_read_col_alloc(p, indin, p->numrows);
+      if(p->rowids)
+        fits_tab_read_col_rowids(p, fptr, hdutype, indin, col);
       else
-        {
-          /* Allocate a blank value for the given type and read/store the
-             column using CFITSIO.
-
-             * For binary tables, we only need blank values for integer
-               types. For binary floating point types, the FITS standard
-               defines blanks as NaN (same as almost any other software
-               like Gnuastro). However if a blank value is specified,
-               CFITSIO will convert other special numbers like 'inf' to NaN
-               also. We want to be able to distringuish 'inf' and NaN here,
-               so for floating point types in binary tables, we won't
-               define any blank value. In ASCII tables, CFITSIO doesn't
-               read the 'NAN' values (that it has written itself) unless we
-               specify a blank pointer/value.
-
-             * 'fits_read_col' takes the pointer to the thing that should
-               be placed in a blank column (for strings, the 'char *')
-               pointer. However, for strings, 'gal_blank_alloc_write' will
-               return a 'char **' pointer! So for strings, we need to
-               dereference the blank. This is why we need 'blankuse'. */
-          isfloat = ( col->type==GAL_TYPE_FLOAT32
-                      || col->type==GAL_TYPE_FLOAT64 );
-          blank = ( ( hdutype==BINARY_TBL && isfloat )
-                    ? NULL
-                    : gal_blank_alloc_write(col->type) );
-          blankuse = ( col->type==GAL_TYPE_STRING
-                       ? *((char **)blank)
-                       : blank);
-          fits_read_col(fptr, gal_fits_type_to_datatype(col->type),
-                        indin+1, 1, 1, col->size, blankuse, col->array,
-                        &anynul, &status);
-
-          /* In the ASCII table format some things need to be checked. */
-          if( hdutype==ASCII_TBL )
-            {
-              /* CFITSIO might not be able to read 'INF' or '-INF'. In this
-                case, it will set status to 'BAD_C2D' or 'BAD_C2F'. So,
-                we'll use our own parser for the column values. */
-              if(isfloat && (status==BAD_C2D || status==BAD_C2F) )
-                {
-                  fits_tab_read_ascii_float_special(p->filename, p->hdu,
-                                                    fptr, col, indin+1,
-                                                    p->numrows,
-                                                    p->minmapsize,
-                                                    p->quietmmap);
-                  status=0;
-                }
-            }
-          gal_fits_io_error(status, NULL); /* After 'status' correction. */
-
-          /* Clean up and sanity check (just note that the blank value for
-             strings, is an array of strings, so we need to free the
-             contents before freeing itself). */
-          if(col->type==GAL_TYPE_STRING)
-            {strarr=blank; free(strarr[0]);}
-          if(blank) free(blank);
-        }
+        fits_tab_read_col_rows(p, fptr, hdutype, indin, p->rowstart, col);
 
       /* Everything is fine, put this column in the output array. */
       p->colarray[indout]=col;
@@ -3727,13 +5307,18 @@ fits_tab_read_onecol(void *in_prm)
 
 
 
-/* Read the column indexs into a dataset. */
+/* Read the given rows of the columns in 'indexll' into a list of
+   datasets. When 'rowids==NULL', 'rownum' rows starting from 'rowstart'
+   (counting from zero) will be read. Otherwise, only the rows in the
+   'rowids' dataset (that must be sorted in increasing order) are
+   read. */
 gal_data_t *
-gal_fits_tab_read(char *filename, char *hdu, size_t numrows,
-                  gal_data_t *allcols, gal_list_sizet_t *indexll,
-                  size_t numthreads, size_t minmapsize, int quietmmap)
+gal_fits_tab_read_rows(char *filename, char *hdu, size_t numrows,
+                       gal_data_t *allcols, gal_list_sizet_t *indexll,
+                       size_t rowstart, size_t rownum, gal_data_t *rowids,
+                       size_t numthreads, size_t minmapsize, int quietmmap)
 {
-  size_t i;
+  size_t i, *r;
   gal_data_t *out=NULL;
   gal_list_sizet_t *ind;
   struct fits_tab_read_onecol_params p;
@@ -3747,8 +5332,28 @@ gal_fits_tab_read(char *filename, char *hdu, size_t numrows,
   size_t nthreads=1;
 #endif
 
+  /* Make sure the requested rows are within the table. */
+  if(rowids)
+    {
+      if(rowids->type!=GAL_TYPE_SIZE_T)
+        error(EXIT_FAILURE, 0, "%s: 'rowids' should have a 'size_t' type",
+              __func__);
+      r=rowids->array;
+      for(i=0;i<rowids->size;++i)
+        if( r[i]>=numrows || (i && r[i]<=r[i-1]) )
+          error(EXIT_FAILURE, 0, "%s: the row numbers in 'rowids' should "
+                "be in increasing order and smaller than the number of "
+                "rows (%zu), but element %zu is %zu", __func__, numrows,
+                i, r[i]);
+      rownum=rowids->size;
+    }
+  else if( rowstart>numrows || rownum>numrows-rowstart )
+    error(EXIT_FAILURE, 0, "%s: %zu rows starting from row %zu are "
+          "requested, but the table only has %zu rows", __func__, rownum,
+          rowstart, numrows);
+
   /* We actually do have columns to read. */
-  if(numrows)
+  if(rownum)
     {
       /* Allocate array of output columns (to keep each read column in its
          proper place as they are read in parallel). */
@@ -3762,11 +5367,13 @@ gal_fits_tab_read(char *filename, char *hdu, size_t numrows,
       /* Prepare for parallelization and spin-off the threads. */
       p.hdu = hdu;
       p.allcols = allcols;
-      p.numrows = numrows;
+      p.numrows = rownum;
       p.indexll = indexll;
+      p.rowstart = rowstart;
       p.filename = filename;
       p.quietmmap = quietmmap;
       p.minmapsize = minmapsize;
+      p.rowids = rowids ? rowids->array : NULL;
       gal_threads_spin_off(fits_tab_read_onecol, &p, p.numcols, nthreads,
                            minmapsize, quietmmap);
 
@@ -3778,19 +5385,19 @@ gal_fits_tab_read(char *filename, char *hdu, size_t numrows,
       free(p.colarray);
     }
 
-  /* There are no rows to read ('numrows==NULL'). Make an empty-sized
+  /* There are no rows to read ('rownum==0'). Make an empty-sized
      array. */
   else
     {
       /* We are setting a 1-element array to avoid any allocation
          errors. Then we are freeing the allocated spaces and correcting
          the sizes. */
-      numrows=1;
+      rownum=1;
       for(ind=indexll; ind!=NULL; ind=ind->next)
         {
           /* Do the allocation. */
           gal_list_data_add_alloc(&out, NULL, allcols[ind->v].type, 1,
-                                  &numrows, NULL, 0, minmapsize, quietmmap,
+                                  &rownum, NULL, 0, minmapsize, quietmmap,
                                   allcols[ind->v].name,
                                   allcols[ind->v].unit,
                                   allcols[ind->v].comment);
@@ -3811,6 +5418,22 @@ gal_fits_tab_read(char *filename, char *hdu, size_t numrows,
 
 
 
+/* Read the column indexs into a dataset. */
+gal_data_t *
+gal_fits_tab_read(char *filename, char *hdu, size_t numrows,
+                  gal_data_t *allcols, gal_list_sizet_t *indexll,
+                  size_t numthreads, size_t minmapsize, int quietmmap)
+{
+  return gal_fits_tab_read_rows(filename, hdu, numrows, allcols, indexll,
+                                0, numrows, NULL, numthreads, minmapsize,
+                                quietmmap);
+}
+
+
+
+
+
+
 /* This function will allocate new copies for all elements to have the same
    length as the maximum length and set all trailing elements to '\0' for
    those that are shorter than the length. The return value is the
@@ -4199,29 +5822,17 @@ fits_tab_write_colvec_ascii(fitsfile *fptr, gal_data_t *vector,
 
 
 
-/* Write a single column into the FITS table. */
+/* Write the values of one column into the table, starting from row
+   'firstrow' (counting from 1), with the blank value that was written in
+   the 'TNULLn' keyword. */
 static void
-fits_tab_write_col(fitsfile *fptr, gal_data_t *col, int tableformat,
-                   size_t *colind, char *tform, char *filename)
+fits_tab_write_col_values(fitsfile *fptr, gal_data_t *col, int tableformat,
+                          size_t colnum, LONGLONG firstrow)
 {
   int status=0;
   char **strarr;
   void *blank=NULL;
 
-  /* If this is a FITS ASCII table, and the column is vector, we need to
-     write it as separate single-value columns and write those, then we can
-     safely return (no more need to continue). */
-  if(tableformat==GAL_TABLE_FORMAT_AFITS && col->ndim>1)
-    {
-      *colind=fits_tab_write_colvec_ascii(fptr, col, *colind, tform,
-                                          filename);
-      return;
-    }
-
-  /* Write the blank value into the header and return a pointer to
-     it. Otherwise, */
-  fits_write_tnull_tcomm(fptr, col, tableformat, *colind+1, tform);
-
   /* Set the blank pointer if its necessary. Note that strings don't need a
      blank pointer in a FITS ASCII table. */
   blank = ( gal_blank_present(col, 0)
@@ -4247,18 +5858,42 @@ fits_tab_write_col(fitsfile *fptr, gal_data_t *col, int tableformat,
       break;
     }
 
-  /* Write the full column into the table. */
+  /* Write the column into the table. */
   fits_write_colnull(fptr, gal_fits_type_to_datatype(col->type),
-                     *colind+1, 1, 1, col->size, col->array, blank,
+                     colnum, firstrow, 1, col->size, col->array, blank,
                      &status);
   gal_fits_io_error(status, NULL);
 
-  /* Clean up and Increment the column counter. */
+  /* Clean up. */
   if(blank)
     {
       if(col->type==GAL_TYPE_STRING) {strarr=blank; free(strarr[0]);}
       free(blank);
     }
+}
+
+
+
+
+
+/* Write a single column into the FITS table. */
+static void
+fits_tab_write_col(fitsfile *fptr, gal_data_t *col, int tableformat,
+                   size_t *colind, char *tform, char *filename)
+{
+  /* If this is a FITS ASCII table, and the column is vector, we need to
+     write it as separate single-value columns and write those, then we can
+     safely return (no more need to continue). */
+  if(tableformat==GAL_TABLE_FORMAT_AFITS && col->ndim>1)
+    {
+      *colind=fits_tab_write_colvec_ascii(fptr, col, *colind, tform,
+                                          filename);
+      return;
+    }
+
+  /* Write the blank value into the header, then the values. */
+  fits_write_tnull_tcomm(fptr, col, tableformat, *colind+1, tform);
+  fits_tab_write_col_values(fptr, col, tableformat, *colind+1, 1);
 
   /* Increment the 'colind' for the next column. */
   *colind+=1;
@@ -4268,12 +5903,341 @@ fits_tab_write_col(fitsfile *fptr, gal_data_t *col, int tableformat,
 
 
 
+/* Parameters to write a FITS binary table in blocks of rows. */
+#define FITS_TAB_WRITE_BLOCK_BYTES 1048576
+struct fits_tab_write_params
+{
+  gal_data_t         **cols;  /* Array of pointers to the columns.       */
+  size_t            numcols;  /* Number of columns.                      */
+  size_t          *colstart;  /* Starting byte of each column in a row.  */
+  size_t          *colwidth;  /* Number of bytes of each column in a row.*/
+  uint8_t         *strblank;  /* ==1: string column has blank elements.  */
+  size_t           rowbytes;  /* Number of bytes in each row.            */
+  size_t            numrows;  /* Total number of rows.                   */
+  size_t           rowstart;  /* First row of the current batch.         */
+  size_t           blocklen;  /* Number of rows in each block.           */
+  uint8_t              *buf;  /* Buffer for all the blocks of the batch. */
+  int                  swap;  /* ==1: host is little-endian.             */
+};
+
+
+
+
+
+/* Return 1 if the columns can be written directly as raw bytes (see
+   'fits_tab_write_rows'). */
+static int
+fits_tab_write_raw_possible(gal_data_t *cols, int tableformat)
+{
+  gal_data_t *col;
+
+  /* This is only relevant for binary tables. */
+  if(tableformat!=GAL_TABLE_FORMAT_BFITS) return 0;
+
+  /* Check the types of all the columns. */
+  for(col=cols; col!=NULL; col=col->next)
+    {
+      if(col->size==0 || col->ndim>2) return 0;
+      switch(col->type)
+        {
+        case GAL_TYPE_UINT8:   case GAL_TYPE_INT8:
+        case GAL_TYPE_UINT16:  case GAL_TYPE_INT16:
+        case GAL_TYPE_UINT32:  case GAL_TYPE_INT32:
+        case GAL_TYPE_INT64:   case GAL_TYPE_FLOAT32:
+        case GAL_TYPE_FLOAT64: case GAL_TYPE_STRING:
+          break;
+        default:
+          return 0;
+        }
+    }
+  return 1;
+}
+
+
+
+
+
+/* Convert the rows of one column (with a numeric type) into the raw FITS
+   binary table format. FITS is big-endian and the types that are not
+   native to FITS ('int8', 'uint16' and 'uint32') are stored as the other
+   signedness with a 'TZEROn' keyword (that is written by CFITSIO when the
+   table is created). For example for 'uint16', 'TZERO=32768', so the
+   stored value is the input minus 32768, or equivalently, the input with
+   its most significant bit flipped. */
+static void
+fits_tab_write_raw_col(struct fits_tab_write_params *p, size_t c,
+                       uint8_t *out, size_t first, size_t last)
+{
+  gal_data_t *col=p->cols[c];
+  size_t r, k, tsize=gal_type_sizeof(col->type);
+  size_t width=p->colwidth[c], nelem=width/tsize;
+  uint8_t *o, *in=(uint8_t *)(col->array)+first*width;
+  uint8_t flip = ( col->type==GAL_TYPE_INT8
+                   || col->type==GAL_TYPE_UINT16
+                   || col->type==GAL_TYPE_UINT32 ) ? 0x80 : 0;
+
+  for(r=first; r<last; ++r, in+=width, out+=p->rowbytes)
+    {
+      /* Put the bytes in big-endian order. */
+      if(p->swap && tsize>1)
+        for(k=0;k<nelem;++k)
+          {
+            o=out+k*tsize;
+            switch(tsize)
+              {
+              case 2:
+                o[0]=in[k*2+1]; o[1]=in[k*2];
+                break;
+              case 4:
+                o[0]=in[k*4+3]; o[1]=in[k*4+2];
+                o[2]=in[k*4+1]; o[3]=in[k*4];
+                break;
+              case 8:
+                o[0]=in[k*8+7]; o[1]=in[k*8+6];
+                o[2]=in[k*8+5]; o[3]=in[k*8+4];
+                o[4]=in[k*8+3]; o[5]=in[k*8+2];
+                o[6]=in[k*8+1]; o[7]=in[k*8];
+                break;
+              }
+          }
+      else
+        memcpy(out, in, width);
+
+      /* The most significant byte is now the first byte of each
+         element. */
+      if(flip)
+        for(k=0;k<nelem;++k) out[k*tsize] ^= flip;
+    }
+}
+
+
+
+
+
+/* Fill one block of rows (in row-major order) in the batch buffer. */
+static void
+fits_tab_write_block(struct fits_tab_write_params *p, size_t block)
+{
+  char **strarr;
+  size_t c, r, len, first, last;
+  uint8_t *out, *start=p->buf+block*p->blocklen*p->rowbytes;
+
+  /* Set the range of rows to fill. */
+  first=p->rowstart+block*p->blocklen;
+  if(first>=p->numrows) return;
+  last = ( first+p->blocklen<p->numrows
+           ? first+p->blocklen
+           : p->numrows );
+
+  /* Go over the columns and put their values in the rows. */
+  for(c=0;c<p->numcols;++c)
+    {
+      out=start+p->colstart[c];
+      if(p->cols[c]->type==GAL_TYPE_STRING)
+        {
+          /* The extra space after each string is filled with '\0'.
+             Similar to CFITSIO, blank strings are written as an empty
+             (null) string. */
+          strarr=p->cols[c]->array;
+          for(r=first; r<last; ++r, out+=p->rowbytes)
+            {
+              if( p->strblank[c] && !strcmp(strarr[r], GAL_BLANK_STRING) )
+                len=0;
+              else
+                {
+                  len=strlen(strarr[r]);
+                  if(len>p->colwidth[c]) len=p->colwidth[c];
+                  memcpy(out, strarr[r], len);
+                }
+              memset(out+len, 0, p->colwidth[c]-len);
+            }
+        }
+      else
+        fits_tab_write_raw_col(p, c, out, first, last);
+    }
+}
+
+
+
+
+
+static void *
+fits_tab_write_on_thread(void *in_prm)
+{
+  struct gal_threads_params *tprm=(struct gal_threads_params *)in_prm;
+  struct fits_tab_write_params *p=(struct fits_tab_write_params *)tprm->params;
+
+  size_t i;
+
+  /* Fill all the blocks that were assigned to this thread. */
+  for(i=0; tprm->indexs[i] != GAL_BLANK_SIZE_T; ++i)
+    fits_tab_write_block(p, tprm->indexs[i]);
+
+  /* Wait for all the other threads to finish, then return. */
+  if(tprm->b) pthread_barrier_wait(tprm->b);
+  return NULL;
+}
+
+
+
+
+
+/* Write the data of all the columns of a binary table in row-major
+   blocks, starting after the first 'firstrow' rows of the table. FITS
+   binary tables are stored row by row, so writing each column separately
+   (with 'fits_write_col') will go over the whole table for each
+   column. Here, a batch of row-blocks is filled in the final (raw) format
+   on separate threads, then the batch is written into the file with a
+   single call to 'fits_write_tblbytes'. This should only be called when
+   'fits_tab_write_raw_possible' returns 1. */
+static void
+fits_tab_write_rows(fitsfile *fptr, gal_data_t *cols, size_t numcols,
+                    size_t numrows, size_t firstrow, size_t numthreads)
+{
+  gal_data_t *col;
+  uint16_t one=1;
+  char *mmapname=NULL;
+  long repeat, width, naxis1, optrows;
+  struct fits_tab_write_params p;
+  int status=0, typecode, coltype;
+  size_t i, nblocks, batchrows, colwidth, minmapsize=-1;
+
+  /* Allocate the column arrays. */
+  errno=0;
+  p.numcols=numcols;
+  p.cols=malloc(numcols*sizeof *p.cols);
+  if(p.cols==NULL)
+    error(EXIT_FAILURE, errno, "%s: %zu bytes for 'p.cols'", __func__,
+          numcols*sizeof *p.cols);
+  p.colstart=gal_pointer_allocate(GAL_TYPE_SIZE_T, numcols, 0, __func__,
+                                  "p.colstart");
+  p.colwidth=gal_pointer_allocate(GAL_TYPE_SIZE_T, numcols, 0, __func__,
+                                  "p.colwidth");
+  p.strblank=gal_pointer_allocate(GAL_TYPE_UINT8, numcols, 1, __func__,
+                                  "p.strblank");
+
+  /* Set the position and width of each column within a row (from the
+     table in the file) and make sure it corresponds to the column. */
+  i=0;
+  p.rowbytes=0;
+  for(col=cols; col!=NULL; col=col->next)
+    {
+      /* Get the type and width of this column in the file. */
+      if( fits_get_eqcoltype(fptr, i+1, &typecode, &repeat, &width,
+                             &status) )
+        gal_fits_io_error(status, NULL);
+      coltype=gal_fits_datatype_to_type(typecode, 1);
+
+      /* Set the width of the column in each row. */
+      if(col->type==GAL_TYPE_STRING)
+        {
+          colwidth=repeat;
+          p.strblank[i]=gal_blank_present(col, 0);
+        }
+      else
+        colwidth = ( gal_type_sizeof(col->type)
+                     * (col->ndim==1 ? 1 : col->dsize[1]) );
+
+      /* Make sure the column in the file is the same. */
+      if( coltype!=col->type
+          || (col->type!=GAL_TYPE_STRING && colwidth!=repeat*width) )
+        error(EXIT_FAILURE, 0, "%s: column %zu has a type of '%s' (with "
+              "%zu bytes in each row), but in the file, it has a type of "
+              "'%s' (with %ld bytes in each row)", __func__, i+1,
+              gal_type_name(col->type, 1), colwidth,
+              gal_type_name(coltype, 1), repeat*width);
+
+      /* The buffer should respect the smallest 'minmapsize'. */
+      if(col->minmapsize<minmapsize) minmapsize=col->minmapsize;
+
+      /* Keep the information. */
+      p.cols[i]=col;
+      p.colwidth[i]=colwidth;
+      p.colstart[i]=p.rowbytes;
+      p.rowbytes+=p.colwidth[i++];
+    }
+
+  /* Make sure the width of the rows is the same as CFITSIO's. */
+  if( fits_read_key(fptr, TLONG, "NAXIS1", &naxis1, NULL, &status) )
+    gal_fits_io_error(status, NULL);
+  if( (size_t)naxis1!=p.rowbytes )
+    error(EXIT_FAILURE, 0, "%s: a bug! Please contact us at '%s' to fix "
+          "the problem. The width of each row is %zu bytes, but CFITSIO "
+          "has set it to %ld bytes", __func__, PACKAGE_BUGREPORT,
+          p.rowbytes, naxis1);
+
+  /* Set the number of rows in each block: the optimal number of rows for
+     CFITSIO's buffers, or larger to be efficient in threads. */
+  if( fits_get_rowsize(fptr, &optrows, &status) )
+    gal_fits_io_error(status, NULL);
+  p.blocklen = optrows>0 ? optrows : 1;
+  if(p.blocklen*p.rowbytes < FITS_TAB_WRITE_BLOCK_BYTES)
+    p.blocklen=FITS_TAB_WRITE_BLOCK_BYTES/p.rowbytes+1;
+
+  /* Set the number of blocks in each batch and allocate the buffer for
+     the batch. */
+  p.numrows=numrows;
+  p.swap=*((uint8_t *)(&one));
+  nblocks=(numrows+p.blocklen-1)/p.blocklen;
+  if(numthreads==0) numthreads=1;
+  if(nblocks>numthreads) nblocks=numthreads;
+  p.buf=gal_pointer_allocate_ram_or_mmap(GAL_TYPE_UINT8,
+                                         nblocks*p.blocklen*p.rowbytes, 0,
+                                         minmapsize, &mmapname,
+                                         cols->quietmmap, __func__,
+                                         "p.buf");
+
+  /* Fill each batch of blocks and write it. */
+  for(p.rowstart=0; p.rowstart<numrows; p.rowstart+=nblocks*p.blocklen)
+    {
+      if(nblocks>1)
+        gal_threads_spin_off(fits_tab_write_on_thread, &p, nblocks,
+                             nblocks, -1, 1);
+      else
+        fits_tab_write_block(&p, 0);
+      batchrows = ( p.rowstart+nblocks*p.blocklen<numrows
+                    ? nblocks*p.blocklen
+                    : numrows-p.rowstart );
+      fits_write_tblbytes(fptr, firstrow+p.rowstart+1, 1,
+                          batchrows*p.rowbytes, p.buf, &status);
+      gal_fits_io_error(status, NULL);
+    }
+
+  /* Clean up. */
+  if(mmapname) gal_pointer_mmap_free(&mmapname, cols->quietmmap);
+  else         free(p.buf);
+  free(p.cols);
+  free(p.colstart);
+  free(p.colwidth);
+  free(p.strblank);
+}
+
+
+
+
+
 /* Write the given columns (a linked list of 'gal_data_t') into a FITS
    table.*/
 void
 gal_fits_tab_write(gal_data_t *cols, gal_list_str_t *comments,
                    int tableformat, char *filename, char *extname,
                    struct gal_fits_list_key_t **keylist)
+{
+  gal_fits_tab_write_threads(cols, comments, tableformat, filename,
+                             extname, keylist, 1);
+}
+
+
+
+
+
+/* Similar to 'gal_fits_tab_write', but the blocks of rows in binary
+   tables are prepared on 'numthreads' threads. */
+void
+gal_fits_tab_write_threads(gal_data_t *cols, gal_list_str_t *comments,
+                           int tableformat, char *filename, char *extname,
+                           struct gal_fits_list_key_t **keylist,
+                           size_t numthreads)
 {
   fitsfile *fptr;
   gal_data_t *col;
@@ -4316,10 +6280,25 @@ gal_fits_tab_write(gal_data_t *cols, gal_list_str_t *comments,
   gal_fits_io_error(status, NULL);
 
   /* Write the columns into the file and also write the blank values into
-     the header when necessary. */
-  i=0;
-  for(col=cols; col!=NULL; col=col->next)/*'i' is increment in the func.*/
-    fits_tab_write_col(fptr, col, tableformat, &i, tform[i], filename);
+     the header when necessary. When possible, the blank values of all
+     columns are written first, then all the columns are written together
+     (row by row). */
+  if( fits_tab_write_raw_possible(cols, tableformat) )
+    {
+      i=0;
+      for(col=cols; col!=NULL; col=col->next)
+        {
+          fits_write_tnull_tcomm(fptr, col, tableformat, i+1, tform[i]);
+          ++i;
+        }
+      fits_tab_write_rows(fptr, cols, numcols, numrows, 0, numthreads);
+    }
+  else
+    {
+      i=0;
+      for(col=cols; col!=NULL; col=col->next)/*'i' is increment in func.*/
+        fits_tab_write_col(fptr, col, tableformat, &i, tform[i], filename);
+    }
 
   /* Write the requested keywords. */
   if(keylist)
@@ -4341,3 +6320,94 @@ gal_fits_tab_write(gal_data_t *cols, gal_list_str_t *comments,
   fits_close_file(fptr, &status);
   gal_fits_io_error(status, NULL);
 }
+
+
+
+
+
+/* Append the rows of the given columns to the end of the binary table in
+   the last HDU of 'filename' (that should have the same columns, for
+   example, written by 'gal_fits_tab_write'). If the strings of a string
+   column are longer than the width of the column in the file, the column
+   will be widened. */
+void
+gal_fits_tab_append(gal_data_t *cols, char *filename, size_t numthreads)
+{
+  char **strarr;
+  fitsfile *fptr;
+  gal_data_t *col;
+  long repeat, width;
+  LONGLONG oldnumrows;
+  size_t i, r, len, maxlen, numcols=0, numrows;
+  int status=0, nhdu, hdutype, ncolsfile, typecode;
+
+  /* Make sure the input is valid. */
+  if(cols==NULL) error(EXIT_FAILURE, 0, "%s: input is NULL", __func__);
+  numrows = cols->dsize ? cols->dsize[0] : 0;
+  for(col=cols; col!=NULL; col=col->next)
+    {
+      ++numcols;
+      if( (col->dsize ? col->dsize[0] : 0) != numrows )
+        error(EXIT_FAILURE, 0, "%s: the number of records/rows in the "
+              "input columns are not equal! The first column has %zu "
+              "rows, while column %zu has %zu rows", __func__, numrows,
+              numcols, col->dsize ? col->dsize[0] : 0);
+    }
+  if(numrows==0) return;
+
+  /* Open the file and go to the last HDU. */
+  if( fits_open_file(&fptr, filename, READWRITE, &status) )
+    gal_fits_io_error(status, NULL);
+  fits_get_num_hdus(fptr, &nhdu, &status);
+  fits_movabs_hdu(fptr, nhdu, &hdutype, &status);
+  fits_get_num_cols(fptr, &ncolsfile, &status);
+  fits_get_num_rowsll(fptr, &oldnumrows, &status);
+  gal_fits_io_error(status, NULL);
+  if(hdutype!=BINARY_TBL)
+    error(EXIT_FAILURE, 0, "%s: rows can only be appended to a binary "
+          "table, but the last HDU is not a binary table",
+          gal_fits_name_save_as_string(filename, NULL));
+  if( (size_t)ncolsfile!=numcols )
+    error(EXIT_FAILURE, 0, "%s: the table in the last HDU has %d "
+          "columns, but %zu columns should be appended",
+          gal_fits_name_save_as_string(filename, NULL), ncolsfile,
+          numcols);
+
+  /* If a string is longer than the width of its column, widen the
+     column. */
+  i=0;
+  for(col=cols; col!=NULL; col=col->next)
+    {
+      ++i;
+      if(col->type!=GAL_TYPE_STRING) continue;
+      maxlen=0;
+      strarr=col->array;
+      for(r=0;r<col->size;++r)
+        if( (len=strlen(strarr[r]))>maxlen ) maxlen=len;
+      if( fits_get_coltype(fptr, i, &typecode, &repeat, &width, &status) )
+        gal_fits_io_error(status, NULL);
+      if( maxlen>(size_t)repeat
+          && fits_modify_vector_len(fptr, i, maxlen, &status) )
+        gal_fits_io_error(status, NULL);
+    }
+
+  /* Add the new rows to the end of the table and write them. When the
+     columns can't be written as raw bytes (for example 'uint64' columns),
+     CFITSIO's writer is used for each column. */
+  if( fits_insert_rows(fptr, oldnumrows, numrows, &status) )
+    gal_fits_io_error(status, NULL);
+  if( fits_tab_write_raw_possible(cols, GAL_TABLE_FORMAT_BFITS) )
+    fits_tab_write_rows(fptr, cols, numcols, numrows, oldnumrows,
+                        numthreads);
+  else
+    {
+      i=0;
+      for(col=cols; col!=NULL; col=col->next)
+        fits_tab_write_col_values(fptr, col, GAL_TABLE_FORMAT_BFITS, ++i,
+                                  oldnumrows+1);
+    }
+
+  /* Close the file. */
+  fits_close_file(fptr, &status);
+  gal_fits_io_error(status, NULL);
+}
@@ -289,6 +289,20 @@ struct argp_option gal_commonopts_options[] =
       GAL_OPTIONS_NOT_SET,
       gal_options_read_wcslinearmatrix
     },
+    {
+      "compress",
+      GAL_OPTIONS_KEY_COMPRESS,
+      "STR",
+      0,
+      "Tile-compress output image: 'rice', 'gzip', ...",
+      GAL_OPTIONS_GROUP_OUTPUT,
+      &cp->compress,
+      GAL_TYPE_STRING,
+      GAL_OPTIONS_RANGE_ANY,
+      GAL_OPTIONS_NOT_MANDATORY,
+      GAL_OPTIONS_NOT_SET,
+      gal_options_read_compress
+    },
     {
       "dontdelete",
       GAL_OPTIONS_KEY_DONTDELETE,
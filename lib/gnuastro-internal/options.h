@@ -127,6 +127,7 @@ enum options_common_keys
   GAL_OPTIONS_KEY_INTERPMETRIC,
   GAL_OPTIONS_KEY_INTERPNUMNGB,
   GAL_OPTIONS_KEY_WCSLINEARMATRIX,
+  GAL_OPTIONS_KEY_COMPRESS,
 };
 
 
@@ -198,6 +199,7 @@ struct gal_options_common_params
   uint8_t                 type; /* Data type of output.                   */
   uint8_t          tableformat; /* Internal code for output table format. */
   uint8_t      wcslinearmatrix; /* WCS matrix to use (PC or CD).          */
+  uint8_t             compress; /* Tile compression of output images.     */
   uint8_t           dontdelete; /* ==1: Don't delete existing file.       */
   uint8_t         keepinputdir; /* Keep input directory for auto output.  */
 
@@ -289,6 +291,10 @@ void *
 gal_options_read_wcslinearmatrix(struct argp_option *option, char *arg,
                                  char *filename, size_t lineno, void *junk);
 
+void *
+gal_options_read_compress(struct argp_option *option, char *arg,
+                          char *filename, size_t lineno, void *junk);
+
 void *
 gal_options_read_tableformat(struct argp_option *option, char *arg,
                              char *filename, size_t lineno, void *junk);
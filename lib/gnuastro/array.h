@@ -65,20 +65,47 @@ gal_data_t *
 gal_array_read(char *filename, char *extension, gal_list_str_t *lines,
                size_t minmapsize, int quietmmap);
 
+gal_data_t *
+gal_array_read_threads(char *filename, char *extension,
+                       gal_list_str_t *lines, size_t numthreads,
+                       size_t minmapsize, int quietmmap);
+
 gal_data_t *
 gal_array_read_to_type(char *filename, char *extension,
                        gal_list_str_t *lines, uint8_t type,
                        size_t minmapsize, int quietmmap);
 
+gal_data_t *
+gal_array_read_to_type_threads(char *filename, char *extension,
+                               gal_list_str_t *lines, uint8_t type,
+                               size_t numthreads, size_t minmapsize,
+                               int quietmmap);
+
 gal_data_t *
 gal_array_read_one_ch(char *filename, char *extension, gal_list_str_t *lines,
                       size_t minmapsize, int quietmmap);
 
+gal_data_t *
+gal_array_read_one_ch_threads(char *filename, char *extension,
+                              gal_list_str_t *lines, size_t numthreads,
+                              size_t minmapsize, int quietmmap);
+
 gal_data_t *
 gal_array_read_one_ch_to_type(char *filename, char *extension,
                               gal_list_str_t *lines, uint8_t type,
                               size_t minmapsize, int quietmmap);
 
+gal_data_t *
+gal_array_read_one_ch_to_type_threads(char *filename, char *extension,
+                                      gal_list_str_t *lines, uint8_t type,
+                                      size_t numthreads, size_t minmapsize,
+                                      int quietmmap);
+
+gal_data_t *
+gal_array_read_one_ch_many(gal_list_str_t *filenames, gal_list_str_t *hdus,
+                           size_t numthreads, size_t minmapsize,
+                           int quietmmap);
+
 
 __END_C_DECLS    /* From C++ preparations */
 
@@ -100,6 +100,14 @@ __BEGIN_C_DECLS  /* From C++ preparations */
 #endif
 
 
+/* Bit-packed blank masks (see 'gal_blank_mask'): the number of 64-bit
+   words that are necessary for a dataset with 'SIZE' elements, and if
+   element 'IND' is blank. */
+#define GAL_BLANK_MASK_NWORDS(SIZE) ( (SIZE)/64 + ((SIZE)%64!=0) )
+#define GAL_BLANK_MASK_IS(MASK, IND) ( ( (MASK)[(IND)/64]             \
+                                         >> ((IND)%64) ) & 1 )
+
+
 /* Functions. */
 void
 gal_blank_write(void *pointer, uint8_t type);
@@ -125,6 +133,9 @@ gal_blank_present(gal_data_t *input, int updateflag);
 size_t
 gal_blank_number(gal_data_t *input, int updateflag);
 
+uint64_t *
+gal_blank_mask(gal_data_t *input);
+
 gal_data_t *
 gal_blank_flag(gal_data_t *data);
 
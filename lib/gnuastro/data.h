@@ -284,12 +284,20 @@ gal_data_copy(gal_data_t *in);
 gal_data_t *
 gal_data_copy_to_new_type(gal_data_t *in, uint8_t newtype);
 
+gal_data_t *
+gal_data_copy_to_new_type_threads(gal_data_t *in, uint8_t newtype,
+                                  size_t numthreads);
+
 gal_data_t *
 gal_data_copy_to_new_type_free(gal_data_t *in, uint8_t newtype);
 
 void
 gal_data_copy_to_allocated(gal_data_t *in, gal_data_t *out);
 
+void
+gal_data_copy_to_allocated_threads(gal_data_t *in, gal_data_t *out,
+                                   size_t numthreads);
+
 gal_data_t *
 gal_data_copy_string_to_number(char *string);
 
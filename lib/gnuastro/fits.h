@@ -74,6 +74,22 @@ __BEGIN_C_DECLS  /* From C++ preparations */
 
 
 
+/* Tile compression algorithms for writing images (see
+   'gal_fits_img_write'). */
+enum gal_fits_compress_types
+{
+  GAL_FITS_COMPRESS_NONE,        /* No compression (=0 by C standard). */
+  GAL_FITS_COMPRESS_RICE,        /* Rice algorithm.                    */
+  GAL_FITS_COMPRESS_GZIP,        /* GZIP algorithm.                    */
+  GAL_FITS_COMPRESS_GZIP2,       /* GZIP with shuffled bytes.          */
+  GAL_FITS_COMPRESS_HCOMPRESS,   /* H-transform (only 2D images).      */
+  GAL_FITS_COMPRESS_PLIO,        /* IRAF's PLIO (only integers).       */
+
+  GAL_FITS_COMPRESS_INVALID,     /* For sanity checks (keep last).     */
+};
+
+
+
 /* To create a linked list of headers. */
 typedef struct gal_fits_list_key_t
 {
@@ -95,6 +111,40 @@ typedef struct gal_fits_list_key_t
 
 
 
+/* All the keywords of one HDU, parsed once and indexed by name. */
+typedef struct gal_fits_header_t
+{
+  char                  *filename;  /* Name of the file (if known).    */
+  char                       *hdu;  /* HDU in the file (if known).     */
+  size_t                   ncards;  /* Number of keywords.             */
+  char                    **names;  /* Name of each keyword.           */
+  char                   **values;  /* Value of each (as in the card). */
+  char                 **comments;  /* Comment of each keyword.        */
+  size_t                    nhash;  /* Number of slots in hash table.  */
+  size_t                    *hash;  /* Keyword index in each slot.     */
+  char                    *buffer;  /* Space for all the strings.      */
+  struct gal_fits_header_t  *next;  /* Next header (for caching).      */
+} gal_fits_header_t;
+
+
+
+/* Ownership of a dataset that is given to the asynchronous writer. */
+enum gal_fits_writer_modes
+{
+  GAL_FITS_WRITER_INVALID,     /* For sanity checks (=0 by C standard). */
+  GAL_FITS_WRITER_BORROW,      /* Caller keeps it (unchanged until sync).*/
+  GAL_FITS_WRITER_COPY,        /* Writer copies it before returning.    */
+  GAL_FITS_WRITER_FREE,        /* Writer frees it after writing.        */
+};
+
+
+
+/* Asynchronous writer of FITS images (with a dedicated I/O thread). Its
+   contents are private (only used in 'lib/fits.c'). */
+typedef struct gal_fits_writer_t gal_fits_writer_t;
+
+
+
 /* table.h needs 'gal_fits_list_key_t'. */
 #include <gnuastro/table.h>
 
@@ -162,6 +212,13 @@ gal_fits_hdu_num(char *filename);
 unsigned long
 gal_fits_hdu_datasum(char *filename, char *hdu);
 
+unsigned long
+gal_fits_hdu_datasum_threads(char *filename, char *hdu, size_t numthreads);
+
+unsigned long
+gal_fits_hdu_datasum_cached(char *filename, char *hdu, char *cachename,
+                            size_t numthreads);
+
 unsigned long
 gal_fits_hdu_datasum_ptr(fitsfile *fptr);
 
@@ -268,13 +325,59 @@ void
 gal_fits_key_write_config(gal_fits_list_key_t **keylist, char *title,
                           char *extname, char *filename, char *hdu);
 
+
+
+
+
+/**************************************************************/
+/**********            Parsed headers              ************/
+/**************************************************************/
+gal_fits_header_t *
+gal_fits_header_read_from_ptr(fitsfile *fptr);
+
+gal_fits_header_t *
+gal_fits_header_read(char *filename, char *hdu, int exitonerror);
+
+gal_fits_header_t **
+gal_fits_header_read_many(gal_list_str_t *files, char *hdu,
+                          size_t numthreads);
+
+gal_fits_header_t *
+gal_fits_header_cache(gal_fits_header_t **cache, char *filename, char *hdu,
+                      int exitonerror);
+
+size_t
+gal_fits_header_index(gal_fits_header_t *header, char *name);
+
+void
+gal_fits_header_key_read(gal_fits_header_t *header, gal_data_t *keysll,
+                         int readcomment, int readunit);
+
+void
+gal_fits_header_free(gal_fits_header_t *header);
+
+void
+gal_fits_header_list_free(gal_fits_header_t *list);
+
+void
+gal_fits_header_array_free(gal_fits_header_t **headers, size_t num);
+
 gal_list_str_t *
 gal_fits_with_keyvalue(gal_list_str_t *files, char *hdu, char *name,
                        gal_list_str_t *values);
 
+gal_list_str_t *
+gal_fits_with_keyvalue_threads(gal_list_str_t *files, char *hdu,
+                               char *name, gal_list_str_t *values,
+                               size_t numthreads);
+
 gal_list_str_t *
 gal_fits_unique_keyvalues(gal_list_str_t *files, char *hdu, char *name);
 
+gal_list_str_t *
+gal_fits_unique_keyvalues_threads(gal_list_str_t *files, char *hdu,
+                                  char *name, size_t numthreads);
+
 
 
 
@@ -290,34 +393,92 @@ size_t *
 gal_fits_img_info_dim(char *filename, char *hdu, size_t *ndim);
 
 gal_data_t *
-gal_fits_img_read(char *filename, char *hdu, size_t minmapsize, int quietmmap);
+gal_fits_img_read(char *filename, char *hdu, size_t minmapsize,
+                  int quietmmap);
+
+gal_data_t *
+gal_fits_img_read_threads(char *filename, char *hdu, size_t numthreads,
+                          size_t minmapsize, int quietmmap);
 
 gal_data_t *
 gal_fits_img_read_to_type(char *inputname, char *hdu, uint8_t type,
                           size_t minmapsize, int quietmmap);
 
+gal_data_t *
+gal_fits_img_read_to_type_threads(char *inputname, char *hdu, uint8_t type,
+                                  size_t numthreads, size_t minmapsize,
+                                  int quietmmap);
+
 gal_data_t *
 gal_fits_img_read_kernel(char *filename, char *hdu, size_t minmapsize,
                          int quietmmap);
 
+void
+gal_fits_img_compress_set(fitsfile *fptr, uint8_t type, size_t ndim,
+                          uint8_t compress, char *filename);
+
 fitsfile *
 gal_fits_img_write_to_ptr(gal_data_t *data, char *filename);
 
+fitsfile *
+gal_fits_img_write_to_ptr_compress(gal_data_t *data, char *filename,
+                                   uint8_t compress);
+
 void
 gal_fits_img_write(gal_data_t *data, char *filename,
                    gal_fits_list_key_t *headers, char *program_string);
 
+void
+gal_fits_img_write_compress(gal_data_t *data, char *filename,
+                            gal_fits_list_key_t *headers,
+                            char *program_string, uint8_t compress);
+
 void
 gal_fits_img_write_to_type(gal_data_t *data, char *filename,
                            gal_fits_list_key_t *headers,
                            char *program_string, int type);
 
+void
+gal_fits_img_write_to_type_compress(gal_data_t *data, char *filename,
+                                    gal_fits_list_key_t *headers,
+                                    char *program_string, int type,
+                                    uint8_t compress);
+
 void
 gal_fits_img_write_corr_wcs_str(gal_data_t *input, char *filename,
                                 char *wcsheader, int nkeyrec, double *crpix,
                                 gal_fits_list_key_t *headers,
                                 char *program_string);
 
+void
+gal_fits_img_write_corr_wcs_str_compress(gal_data_t *input, char *filename,
+                                         char *wcsheader, int nkeyrec,
+                                         double *crpix,
+                                         gal_fits_list_key_t *headers,
+                                         char *program_string,
+                                         uint8_t compress);
+
+
+
+
+
+/**************************************************************/
+/**********          Asynchronous writing          ************/
+/**************************************************************/
+gal_fits_writer_t *
+gal_fits_writer_start(size_t maxqueue, int async);
+
+void
+gal_fits_writer_img(gal_fits_writer_t *writer, gal_data_t *data,
+                    char *filename, gal_fits_list_key_t *headers,
+                    char *program_string, uint8_t compress, uint8_t mode);
+
+void
+gal_fits_writer_wait(gal_fits_writer_t *writer);
+
+void
+gal_fits_writer_finish(gal_fits_writer_t *writer);
+
 
 
 
@@ -340,11 +501,26 @@ gal_fits_tab_read(char *filename, char *hdu, size_t numrows,
                   gal_data_t *allcols, gal_list_sizet_t *indexll,
                   size_t numthreads, size_t minmapsize, int quietmmap);
 
+gal_data_t *
+gal_fits_tab_read_rows(char *filename, char *hdu, size_t numrows,
+                       gal_data_t *allcols, gal_list_sizet_t *indexll,
+                       size_t rowstart, size_t rownum, gal_data_t *rowids,
+                       size_t numthreads, size_t minmapsize, int quietmmap);
+
 void
 gal_fits_tab_write(gal_data_t *cols, gal_list_str_t *comments,
                    int tableformat, char *filename, char *extname,
                    struct gal_fits_list_key_t **keywords);
 
+void
+gal_fits_tab_write_threads(gal_data_t *cols, gal_list_str_t *comments,
+                           int tableformat, char *filename, char *extname,
+                           struct gal_fits_list_key_t **keywords,
+                           size_t numthreads);
+
+void
+gal_fits_tab_append(gal_data_t *cols, char *filename, size_t numthreads);
+
 
 
 __END_C_DECLS    /* From C++ preparations */
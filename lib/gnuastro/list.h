@@ -332,6 +332,70 @@ gal_list_dosizet_free(gal_list_dosizet_t *largest);
 
 
 
+/****************************************************************
+ ***********   Array-based (ring buffer) size_t     **************
+ ****************************************************************/
+typedef struct gal_list_sizet_ring_t
+{
+  size_t *array;                  /* Allocated space for elements.   */
+  size_t  size;                   /* Number of allocated elements.   */
+  size_t first;                   /* Index of first element.         */
+  size_t   num;                   /* Number of elements in ring.     */
+} gal_list_sizet_ring_t;
+
+void
+gal_list_sizet_ring_init(gal_list_sizet_ring_t *ring, size_t initsize);
+
+void
+gal_list_sizet_ring_add(gal_list_sizet_ring_t *ring, size_t value);
+
+size_t
+gal_list_sizet_ring_pop_first(gal_list_sizet_ring_t *ring);
+
+size_t
+gal_list_sizet_ring_pop_last(gal_list_sizet_ring_t *ring);
+
+void
+gal_list_sizet_ring_free(gal_list_sizet_ring_t *ring);
+
+
+
+
+
+/****************************************************************
+ ***********    Array-based (heap) ordered size_t    *************
+ ****************************************************************/
+typedef struct gal_list_sizet_heap_t
+{
+  size_t     *v;                  /* The actual values.              */
+  float      *s;                  /* The parameters to sort by.      */
+  size_t     *o;                  /* Order of addition (for ties).   */
+  size_t   size;                  /* Number of allocated elements.   */
+  size_t    num;                  /* Number of elements in heap.     */
+  size_t  added;                  /* Total number of added elements. */
+} gal_list_sizet_heap_t;
+
+void
+gal_list_sizet_heap_init(gal_list_sizet_heap_t *heap, size_t initsize);
+
+void
+gal_list_sizet_heap_add(gal_list_sizet_heap_t *heap, size_t value,
+                        float tosort);
+
+size_t
+gal_list_sizet_heap_pop_smallest(gal_list_sizet_heap_t *heap,
+                                 float *tosort);
+
+void
+gal_list_sizet_heap_reset(gal_list_sizet_heap_t *heap);
+
+void
+gal_list_sizet_heap_free(gal_list_sizet_heap_t *heap);
+
+
+
+
+
 /****************************************************************
  *****************        gal_data_t         ********************
  ****************************************************************/
@@ -51,6 +51,13 @@ gal_match_sort_based(gal_data_t *coord1, gal_data_t *coord2,
                       int inplace, size_t minmapsize, int quietmmap,
                       size_t *nummatched);
 
+gal_data_t *
+gal_match_sort_based_threads(gal_data_t *coord1, gal_data_t *coord2,
+                             double *aperture, int sorted_by_first,
+                             int inplace, size_t numthreads,
+                             size_t minmapsize, int quietmmap,
+                             size_t *nummatched);
+
 gal_data_t *
 gal_match_kdtree(gal_data_t *coord1, gal_data_t *coord2,
                  gal_data_t *coord1_kdtree, size_t kdtree_root,
@@ -67,6 +67,10 @@ gal_permutation_apply_onlydim0(gal_data_t *input, size_t *permutation);
 void
 gal_permutation_apply_inverse(gal_data_t *input, size_t *permutation);
 
+void
+gal_permutation_apply_columns(gal_data_t *columns, size_t *permutation,
+                              int inverse, size_t numthreads);
+
 
 
 
@@ -142,12 +142,19 @@ gal_statistics_mode_mirror_plots(gal_data_t *input, gal_data_t *value,
 int
 gal_statistics_is_sorted(gal_data_t *input, int updateflags);
 
+void
+gal_statistics_sort(gal_data_t *input, int decreasing, size_t numthreads);
+
 void
 gal_statistics_sort_increasing(gal_data_t *input);
 
 void
 gal_statistics_sort_decreasing(gal_data_t *input);
 
+void
+gal_statistics_sort_index(gal_data_t *input, size_t *index,
+                          int decreasing, size_t numthreads);
+
 gal_data_t *
 gal_statistics_no_blank_sorted(gal_data_t *input, int inplace);
 
@@ -123,6 +123,31 @@ enum gal_table_where_to_search
 
 
 
+/* Structure to read a table in chunks of rows (see 'gal_table_iter_init'
+   and 'gal_table_iter_next'). */
+typedef struct gal_table_iter_t
+{
+  char                *filename;  /* Name of the input file.             */
+  char                     *hdu;  /* HDU of the input table.             */
+  gal_data_t           *allcols;  /* Information of all the columns.     */
+  size_t                numcols;  /* Number of columns in the table.     */
+  size_t                numrows;  /* Number of rows in the table.        */
+  gal_list_sizet_t     *indexll;  /* Indexs of the columns to read.      */
+  size_t               rowstart;  /* First row to read.                  */
+  size_t                 rownum;  /* Number of rows to read.             */
+  gal_data_t            *rowids;  /* Only read these rows (if !NULL).    */
+  size_t              chunksize;  /* Number of rows in each chunk.       */
+  size_t                   next;  /* Counter of the next row to read.    */
+  size_t                 nchunk;  /* Number of chunks read until now.    */
+  size_t             numthreads;  /* Number of threads to read columns.  */
+  size_t             minmapsize;  /* Minimum size to use memory-mapping. */
+  int                 quietmmap;  /* Don't print memory-mapping info.    */
+} gal_table_iter_t;
+
+
+
+
+
 /************************************************************************/
 /***************            Internal conversions          ***************/
 /************************************************************************/
@@ -155,11 +180,31 @@ gal_table_read(char *filename, char *hdu, gal_list_str_t *lines,
                size_t numthreads, size_t minmapsize, int quietmmap,
                size_t *colmatch);
 
+gal_data_t *
+gal_table_read_rows(char *filename, char *hdu, gal_list_str_t *lines,
+                    gal_list_str_t *cols, int searchin, int ignorecase,
+                    size_t rowstart, size_t rownum, gal_data_t *rowids,
+                    size_t numthreads, size_t minmapsize, int quietmmap,
+                    size_t *colmatch);
+
 gal_list_sizet_t *
 gal_table_list_of_indexs(gal_list_str_t *cols, gal_data_t *allcols,
                          size_t numcols, int searchin, int ignorecase,
                          char *filename, char *hdu, size_t *colmatch);
 
+gal_table_iter_t *
+gal_table_iter_init(char *filename, char *hdu, gal_list_str_t *cols,
+                    int searchin, int ignorecase, size_t rowstart,
+                    size_t rownum, gal_data_t *rowids, size_t chunksize,
+                    size_t numthreads, size_t minmapsize, int quietmmap,
+                    size_t *colmatch);
+
+gal_data_t *
+gal_table_iter_next(gal_table_iter_t *iter);
+
+void
+gal_table_iter_free(gal_table_iter_t *iter);
+
 
 
 /************************************************************************/
@@ -174,6 +219,16 @@ gal_table_write(gal_data_t *cols, struct gal_fits_list_key_t **keylist,
                 gal_list_str_t *comments, int tableformat, char *filename,
                 char *extname, uint8_t colinfoinstdout);
 
+void
+gal_table_write_threads(gal_data_t *cols,
+                        struct gal_fits_list_key_t **keylist,
+                        gal_list_str_t *comments, int tableformat,
+                        char *filename, char *extname,
+                        uint8_t colinfoinstdout, size_t numthreads);
+
+void
+gal_table_write_append(gal_data_t *cols, char *filename, size_t numthreads);
+
 void
 gal_table_write_log(gal_data_t *logll, char *program_string,
                     time_t *rawtime, gal_list_str_t *comments,
@@ -101,6 +101,32 @@ gal_tile_block_blank_flag(gal_data_t *tile_ll, size_t numthreads);
 
 
 
+/***********************************************************************/
+/**************           Contiguous spans            ******************/
+/***********************************************************************/
+/* Function called on each contiguous span of a tile: 'in' and 'other'
+   point to the first element of the span in the two datasets ('other'
+   is NULL when it isn't given) and 'num' is the number of elements. */
+typedef void (*gal_tile_span_func_t)(void *in, void *other, size_t num,
+                                     void *params);
+
+void
+gal_tile_span_parse(gal_data_t *in, gal_data_t *other,
+                    gal_tile_span_func_t func, void *params);
+
+size_t
+gal_tile_span_number(gal_data_t *in);
+
+size_t
+gal_tile_span_sums(gal_data_t *in, double *sum, double *sumsq);
+
+size_t
+gal_tile_span_minmax(gal_data_t *in, void *min, void *max);
+
+
+
+
+
 /***********************************************************************/
 /**************           Tile full dataset         ********************/
 /***********************************************************************/
@@ -149,6 +175,11 @@ gal_tile_full_two_layers(gal_data_t *input,
 void
 gal_tile_full_permutation(struct gal_tile_two_layer_params *tl);
 
+gal_data_t *
+gal_tile_full_values_for_write(gal_data_t *tilevalues,
+                               struct gal_tile_two_layer_params *tl,
+                               int withblank);
+
 void
 gal_tile_full_values_write(gal_data_t *tilevalues,
                            struct gal_tile_two_layer_params *tl,
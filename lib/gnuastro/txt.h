@@ -98,6 +98,12 @@ gal_txt_table_read(char *filename, gal_list_str_t *lines, size_t numrows,
                    gal_data_t *colinfo, gal_list_sizet_t *indexll,
                    size_t minmapsize, int quietmmap);
 
+gal_data_t *
+gal_txt_table_read_threads(char *filename, gal_list_str_t *lines,
+                           size_t numrows, gal_data_t *colinfo,
+                           gal_list_sizet_t *indexll, size_t numthreads,
+                           size_t minmapsize, int quietmmap);
+
 gal_data_t *
 gal_txt_image_read(char *filename, gal_list_str_t *lines, size_t minmapsize,
                    int quietmmap);
@@ -110,6 +116,13 @@ gal_txt_write(gal_data_t *input, struct gal_fits_list_key_t **keylist,
               gal_list_str_t *comment, char *filename,
               uint8_t colinfoinstdout, int tab0_img1);
 
+void
+gal_txt_write_threads(gal_data_t *input,
+                      struct gal_fits_list_key_t **keylist,
+                      gal_list_str_t *comment, char *filename,
+                      uint8_t colinfoinstdout, int tab0_img1,
+                      size_t numthreads);
+
 
 
 __END_C_DECLS    /* From C++ preparations */
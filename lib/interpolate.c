@@ -22,6 +22,7 @@ along with Gnuastro. If not, see <http://www.gnu.org/licenses/>.
 **********************************************************************/
 #include <config.h>
 
+#include <math.h>
 #include <stdio.h>
 #include <errno.h>
 #include <error.h>
@@ -46,11 +47,24 @@ along with Gnuastro. If not, see <http://www.gnu.org/licenses/>.
 /*********************************************************************/
 /********************      Nearest neighbor       ********************/
 /***************         (Dimension agnostic)         ****************/
-/*********************************************************************/
-/* These are bit-flags, so we're using hexadecimal notation. */
-#define INTERPOLATE_FLAGS_NO          0
-#define INTERPOLATE_FLAGS_NGB_CHECKED 0x1
-#define INTERPOLATE_FLAGS_BLANK       0x2
+/* The non-blank elements of each grid (the full input, or one channel
+   when the channels are interpolated separately) are indexed into cells
+   of 'width' elements along each dimension. To find the nearest
+   neighbors of an element, we only need to parse the cells around it
+   (in growing square/cube rings) until no element outside the parsed
+   cells can be closer than the farthest of the already found
+   neighbors. The index is built once and shared by all threads, so the
+   cost of each element is independent of the size of the input. */
+struct interpolate_index
+{
+  size_t                       ndim;  /* Number of dimensions.           */
+  size_t                     *dsize;  /* Size of each grid along dims.   */
+  size_t                      width;  /* Width of each cell (all dims).  */
+  size_t                    *cdsize;  /* Number of cells along each dim. */
+  size_t                   numcells;  /* Number of cells in each grid.   */
+  size_t                     *start;  /* Start of each cell in 'elems'.  */
+  size_t                     *elems;  /* Non-blank indexs, sorted by cell.*/
+};
 
 
 
@@ -63,11 +77,11 @@ struct interpolate_ngb_params
   gal_data_t                    *input;
   size_t                           num;
   gal_data_t                      *out;
-  gal_data_t                   *blanks;
+  uint64_t                     *blanks;
   size_t                  numneighbors;
-  uint8_t                *thread_flags;
   int                        onlyblank;
   gal_list_void_t            *ngb_vals;
+  struct interpolate_index       index;
   float (*metric)(size_t *, size_t *, size_t );
 
   struct gal_tile_two_layer_params *tl;
@@ -77,6 +91,273 @@ struct interpolate_ngb_params
 
 
 
+/* Index of the cell with the given cell coordinates. */
+static size_t
+interpolate_index_cell(struct interpolate_index *ind, size_t *ccoord)
+{
+  size_t d, cell=0;
+  for(d=0;d<ind->ndim;++d) cell = cell * ind->cdsize[d] + ccoord[d];
+  return cell;
+}
+
+
+
+
+
+/* Index of the cell that contains the element with index 'index' of a
+   grid ('coord' is allocated space for 'ndim' elements). */
+static size_t
+interpolate_index_cell_of(struct interpolate_index *ind, size_t index,
+                          size_t *coord)
+{
+  size_t d;
+  gal_dimension_index_to_coord(index, ind->ndim, ind->dsize, coord);
+  for(d=0;d<ind->ndim;++d) coord[d] /= ind->width;
+  return interpolate_index_cell(ind, coord);
+}
+
+
+
+
+
+/* Build the index of the non-blank elements in all the 'numgrids' grids
+   (each with 'gsize' elements), that are contiguous in the bit-packed
+   'blanks' mask. */
+static void
+interpolate_index_make(struct interpolate_index *ind, uint64_t *blanks,
+                       size_t ndim, size_t *dsize, size_t gsize,
+                       size_t numgrids, size_t numneighbors)
+{
+  size_t d, g, i, k, *pos, *coord, numnonblank=0, maxdsize=0;
+  size_t size=gsize*numgrids;
+
+  /* Count the number of non-blank elements. */
+  for(i=0;i<size;++i) numnonblank += !GAL_BLANK_MASK_IS(blanks, i);
+
+  /* Set the width of the cells: on average, each cell should contain
+     about as many non-blank elements as the number of neighbors. */
+  for(d=0;d<ndim;++d) if(dsize[d]>maxdsize) maxdsize=dsize[d];
+  ind->width = ( numnonblank
+                 ? pow( (double)numneighbors * size / numnonblank,
+                        1.0f/ndim )
+                 : maxdsize );
+  if(ind->width==0) ind->width=1;
+  if(ind->width>maxdsize) ind->width=maxdsize;
+
+  /* Set the cell dimensions. */
+  ind->ndim=ndim;
+  ind->dsize=dsize;
+  ind->numcells=1;
+  ind->cdsize=gal_pointer_allocate(GAL_TYPE_SIZE_T, ndim, 0, __func__,
+                                   "ind->cdsize");
+  for(d=0;d<ndim;++d)
+    {
+      ind->cdsize[d] = (dsize[d] + ind->width - 1) / ind->width;
+      ind->numcells *= ind->cdsize[d];
+    }
+
+  /* Count the non-blank elements of each cell (the count of each cell is
+     put in the slot after it to easily convert it to the starting
+     position). */
+  coord=gal_pointer_allocate(GAL_TYPE_SIZE_T, ndim, 0, __func__, "coord");
+  ind->start=gal_pointer_allocate(GAL_TYPE_SIZE_T,
+                                  numgrids*(ind->numcells+1), 1,
+                                  __func__, "ind->start");
+  for(g=0;g<numgrids;++g)
+    for(i=0;i<gsize;++i)
+      if( !GAL_BLANK_MASK_IS(blanks, g*gsize+i) )
+        ++ind->start[ g*(ind->numcells+1)
+                      + interpolate_index_cell_of(ind, i, coord) + 1 ];
+
+  /* Cumulative sum: the first slot of each grid will be the end of the
+     previous grid. */
+  for(k=1;k<numgrids*(ind->numcells+1);++k)
+    ind->start[k] += ind->start[k-1];
+
+  /* Put the index of each non-blank element in its cell. Because we parse
+     the elements in order, the elements of each cell are sorted. */
+  pos=gal_pointer_allocate(GAL_TYPE_SIZE_T, numgrids*(ind->numcells+1), 0,
+                           __func__, "pos");
+  memcpy(pos, ind->start, numgrids*(ind->numcells+1)*sizeof *pos);
+  ind->elems=gal_pointer_allocate(GAL_TYPE_SIZE_T,
+                                  numnonblank ? numnonblank : 1, 0,
+                                  __func__, "ind->elems");
+  for(g=0;g<numgrids;++g)
+    for(i=0;i<gsize;++i)
+      if( !GAL_BLANK_MASK_IS(blanks, g*gsize+i) )
+        ind->elems[ pos[ g*(ind->numcells+1)
+                         + interpolate_index_cell_of(ind, i, coord) ]++ ] = i;
+
+  /* Clean up. */
+  free(pos);
+  free(coord);
+}
+
+
+
+
+
+static void
+interpolate_index_free(struct interpolate_index *ind)
+{
+  free(ind->elems);
+  free(ind->start);
+  free(ind->cdsize);
+}
+
+
+
+
+
+/* Consider all the elements of the given cell as neighbors of the element
+   at 'icoord'. The 'num' nearest neighbors found so far are in 'nind' and
+   'ndist', sorted by distance (ties are sorted by index). The new number
+   of neighbors is returned. */
+static size_t
+interpolate_nearest_cell(struct interpolate_ngb_params *prm, size_t grid,
+                         size_t cell, size_t *icoord, size_t *ncoord,
+                         size_t *nind, float *ndist, size_t num)
+{
+  float dist;
+  struct interpolate_index *ind=&prm->index;
+  size_t j, e, k=prm->numneighbors, *start=ind->start+grid*(ind->numcells+1);
+  size_t *el=ind->elems+start[cell], *elf=ind->elems+start[cell+1];
+
+  for(;el<elf;++el)
+    {
+      /* Distance of this element. */
+      e=*el;
+      gal_dimension_index_to_coord(e, ind->ndim, ind->dsize, ncoord);
+      dist=prm->metric(icoord, ncoord, ind->ndim);
+
+      /* If it is closer than the farthest neighbor (or we don't have
+         enough neighbors yet), insert it in its sorted position. When
+         the list is full, the farthest neighbor is removed. */
+      if( num<k || dist<ndist[num-1]
+          || (dist==ndist[num-1] && e<nind[num-1]) )
+        {
+          j = num<k ? num++ : num-1;
+          while( j>0 && ( ndist[j-1]>dist
+                          || (ndist[j-1]==dist && nind[j-1]>e) ) )
+            { nind[j]=nind[j-1]; ndist[j]=ndist[j-1]; --j; }
+          nind[j]=e;
+          ndist[j]=dist;
+        }
+    }
+  return num;
+}
+
+
+
+
+
+/* Find the nearest non-blank neighbors of the element with coordinates
+   'icoord' in the grid 'grid'. 'scratch' has space for '5*ndim'
+   elements. The number of found neighbors is returned, it is only
+   smaller than 'prm->numneighbors' when the grid doesn't have enough
+   non-blank elements. */
+static size_t
+interpolate_nearest(struct interpolate_ngb_params *prm, size_t grid,
+                    size_t *icoord, size_t *nind, float *ndist,
+                    size_t *scratch)
+{
+  struct interpolate_index *ind=&prm->index;
+  size_t d, r, plo, phi, bound, complete, onring, num=0;
+  size_t ndim=ind->ndim, last=ndim-1, *dsize=ind->dsize, *cdsize=ind->cdsize;
+  size_t *cq=scratch, *lo=scratch+ndim, *hi=scratch+2*ndim;
+  size_t *cc=scratch+3*ndim, *ncoord=scratch+4*ndim;
+
+  /* Coordinates of the cell containing the element. */
+  for(d=0;d<ndim;++d) cq[d]=icoord[d]/ind->width;
+
+  /* Parse the rings of cells around the central cell. */
+  for(r=0;1;++r)
+    {
+      /* The box of cells that contains this ring. */
+      for(d=0;d<ndim;++d)
+        {
+          lo[d] = cq[d]>=r ? cq[d]-r : 0;
+          hi[d] = cq[d]+r<cdsize[d] ? cq[d]+r : cdsize[d]-1;
+          cc[d] = lo[d];
+        }
+
+      /* Go over the cells of the ring: the first 'ndim-1' dimensions are
+         parsed over the whole box, but in the last dimension, only the
+         two cells at the ring's edge need to be checked when the other
+         coordinates aren't on the ring's edge. */
+      do
+        {
+          onring = (r==0);
+          for(d=0;d<last;++d)
+            if( cc[d]+r==cq[d] || cc[d]==cq[d]+r ) { onring=1; break; }
+          if(onring)
+            for(cc[last]=lo[last]; cc[last]<=hi[last]; ++cc[last])
+              num=interpolate_nearest_cell(prm, grid,
+                                           interpolate_index_cell(ind, cc),
+                                           icoord, ncoord, nind, ndist,
+                                           num);
+          else
+            {
+              if(cq[last]>=r)
+                {
+                  cc[last]=cq[last]-r;
+                  num=interpolate_nearest_cell(prm, grid,
+                                               interpolate_index_cell(ind,
+                                                                      cc),
+                                               icoord, ncoord, nind, ndist,
+                                               num);
+                }
+              if(cq[last]+r<cdsize[last])
+                {
+                  cc[last]=cq[last]+r;
+                  num=interpolate_nearest_cell(prm, grid,
+                                               interpolate_index_cell(ind,
+                                                                      cc),
+                                               icoord, ncoord, nind, ndist,
+                                               num);
+                }
+            }
+
+          /* Increment the coordinates of the first 'ndim-1' dimensions
+             (like an odometer). */
+          for(d=last; d>0; --d)
+            if( ++cc[d-1] <= hi[d-1] ) break;
+            else cc[d-1]=lo[d-1];
+        }
+      while(d>0);
+
+      /* Any element outside of this box is atleast 'bound' elements away
+         from this element along one dimension, so its distance (in both
+         the radial and Manhattan metrics) is also atleast 'bound'. */
+      complete=1;
+      bound=GAL_BLANK_SIZE_T;
+      for(d=0;d<ndim;++d)
+        {
+          plo = lo[d] * ind->width;
+          phi = (hi[d]+1) * ind->width - 1;
+          if(phi>=dsize[d]) phi=dsize[d]-1;
+          if(plo>0)
+            { complete=0; if(icoord[d]-plo+1<bound) bound=icoord[d]-plo+1; }
+          if(phi<dsize[d]-1)
+            { complete=0; if(phi-icoord[d]+1<bound) bound=phi-icoord[d]+1; }
+        }
+
+      /* See if we are done: either all the cells have been checked, or
+         no element outside of the box can be nearer than the farthest
+         neighbor we currently have (note that an element with an equal
+         distance and a smaller index would have to be used). */
+      if( complete
+          || (num==prm->numneighbors && ndist[num-1]<(float)bound) )
+        break;
+    }
+
+  return num;
+}
+
+
+
+
+
 /* Run the interpolation on many threads. */
 static void *
 interpolate_neighbors_on_thread(void *in_prm)
@@ -93,35 +374,19 @@ interpolate_neighbors_on_thread(void *in_prm)
 
   /* Rest of variables. */
   void *nv;
-  float dist, pdist;
-  uint8_t *b, *bf, *bb;
+  float *ndist;
   gal_list_void_t *tvll;
-  size_t ngb_counter, pind;
-  gal_list_dosizet_t *lQ, *sQ;
-  size_t i, index, fullind, chstart=0, ndim=input->ndim;
+  size_t i, n, grid, index, fullind, numfound, chstart=0, ndim=input->ndim;
   gal_data_t *tin, *tout, *tnear, *value=NULL, *nearest=NULL;
-  size_t size = (correct_index ? tl->tottilesinch : input->size);
   size_t *dsize = (correct_index ? tl->numtilesinch : input->dsize);
   size_t *icoord=gal_pointer_allocate(GAL_TYPE_SIZE_T, ndim, 0, __func__,
                                       "icoord");
-  size_t *ncoord=gal_pointer_allocate(GAL_TYPE_SIZE_T, ndim, 0, __func__,
-                                      "ncoord");
-  uint8_t *flag, *fullflag=&prm->thread_flags[tprm->id*input->size];
-
-  /* Based on the above. */
-  size_t *dinc=gal_dimension_increment(ndim, dsize);
-
-
-  /* Initialize the flags array. We need two flags during this processing:
-     1) to see if there are blanks. 2) to see if a neighbor has been
-     checked. These are both binary (0 or 1). So to avoid wasting space, we
-     will use bits to store them. We start with only setting the blank flag
-     once for the whole thread. Then for each interpolated pixel, we reset
-     the neighbor-check flag. */
-  flag=fullflag;
-  bb=prm->blanks->array;
-  bf=(b=fullflag)+input->size;
-  do *b = *bb++ ? INTERPOLATE_FLAGS_BLANK : 0; while(++b<bf);
+  size_t *scratch=gal_pointer_allocate(GAL_TYPE_SIZE_T, 5*ndim, 0,
+                                       __func__, "scratch");
+  size_t *nind=gal_pointer_allocate(GAL_TYPE_SIZE_T, prm->numneighbors, 0,
+                                    __func__, "nind");
+  ndist=gal_pointer_allocate(GAL_TYPE_FLOAT32, prm->numneighbors, 0,
+                             __func__, "ndist");
 
 
   /* Put the allocated space to keep the neighbor values into a structure
@@ -147,10 +412,9 @@ interpolate_neighbors_on_thread(void *in_prm)
 
 
       /* If the caller only wanted to interpolate over blank values and
-         this value is not blank (we know from the flags), then just set
-         the output value at this element to the input value and go to the
-         next element. */
-      if(prm->onlyblank && !(fullflag[fullind] & INTERPOLATE_FLAGS_BLANK) )
+         this value is not blank, then just set the output value at this
+         element to the input value and go to the next element. */
+      if(prm->onlyblank && !GAL_BLANK_MASK_IS(prm->blanks, fullind))
         {
           tin=input;
           for(tout=prm->out; tout!=NULL; tout=tout->next)
@@ -176,97 +440,36 @@ interpolate_neighbors_on_thread(void *in_prm)
           /* Index of this tile in its channel. */
           index = fullind % tl->tottilesinch;
 
-          /* Index of the first tile in this channel. */
-          chstart = (fullind / tl->tottilesinch) * tl->tottilesinch;
-
-          /* Set the channel's starting pointer for the flags. */
-          flag = gal_pointer_increment(fullflag, chstart, GAL_TYPE_UINT8);
+          /* Channel of this tile and the index of its first tile. */
+          grid = fullind / tl->tottilesinch;
+          chstart = grid * tl->tottilesinch;
         }
       else
         {
-          chstart=0;
+          grid=chstart=0;
           index=fullind;
         }
 
 
-      /* Reset all checked bits in the flags array to 0. */
-      ngb_counter=0;
-      bf=(b=flag)+size;
-      do *b &= ~(INTERPOLATE_FLAGS_NGB_CHECKED); while(++b<bf);
-
-
-      /* Get the coordinates of this pixel (to be interpolated). */
+      /* Find the nearest neighbors of this element. */
       gal_dimension_index_to_coord(index, ndim, dsize, icoord);
+      numfound=interpolate_nearest(prm, grid, icoord, nind, ndist, scratch);
+      if(numfound<prm->numneighbors)
+        error(EXIT_FAILURE, 0, "%s: only %zu neighbors found while "
+              "you had asked to use %zu neighbors for close neighbor "
+              "interpolation", __func__, numfound, prm->numneighbors);
 
 
-      /* Start parsing the neighbors. We will use a two-way ordered linked
-         list structure. To start from the nearest and go out to the
-         farthest. */
-      lQ=sQ=NULL;
-      gal_list_dosizet_add(&lQ, &sQ, index, 0.0f);
-      while(sQ)
+      /* Copy the values of the neighbors. */
+      tin=input;
+      for(tnear=nearest; tnear!=NULL; tnear=tnear->next)
         {
-          /* Pop-out (p) an index from the queue: */
-          pind=gal_list_dosizet_pop_smallest(&lQ, &sQ, &pdist);
-
-          /* If this isn't a blank value then add its values to the list of
-             neighbor values. Note that we didn't check whether the values
-             were blank or not when adding this pixel to the queue. */
-          if( !(flag[pind] & INTERPOLATE_FLAGS_BLANK) )
-            {
-              tin=input;
-              for(tnear=nearest; tnear!=NULL; tnear=tnear->next)
-                {
-                  memcpy(gal_pointer_increment(tnear->array, ngb_counter,
-                                               tin->type),
-                         gal_pointer_increment(tin->array, chstart+pind,
-                                               tin->type),
-                         gal_type_sizeof(tin->type));
-                  tin=tin->next;
-                }
-
-              /* If we have filled all the elements clean up the linked
-                 list and break out. */
-              if(++ngb_counter>=prm->numneighbors)
-                {
-                  if(lQ) gal_list_dosizet_free(lQ);
-                  break;
-                }
-            }
-
-          /* Go over all the neighbors of this popped pixel and add them to
-             the list of neighbors to be checked. */
-          GAL_DIMENSION_NEIGHBOR_OP(pind, ndim, dsize, 1, dinc,
-           {
-             /* Only look at neighbors that have not been checked. VERY
-                IMPORTANT: we must not check for blank values here,
-                otherwise we won't be able to parse over extended blank
-                regions. */
-             if( !(flag[nind] & INTERPOLATE_FLAGS_NGB_CHECKED) )
-               {
-                 /* Get the coordinates of this neighbor. */
-                 gal_dimension_index_to_coord(nind, ndim, dsize, ncoord);
-
-                 /* Distance of this neighbor to the one to be filled. */
-                 dist=prm->metric(icoord, ncoord, ndim);
-
-                 /* Add this neighbor to the list. */
-                 gal_list_dosizet_add(&lQ, &sQ, nind, dist);
-
-                 /* Flag this neighbor as checked. */
-                 flag[nind] |= INTERPOLATE_FLAGS_NGB_CHECKED;
-               }
-           } );
-
-          /* If there are no more meshes to add to the queue, then this
-             shows, there were not enough points for
-             interpolation. Normally, this loop should only be exited
-             through the 'currentnum>=numnearest' check above. */
-          if(sQ==NULL)
-            error(EXIT_FAILURE, 0, "%s: only %zu neighbors found while "
-                  "you had asked to use %zu neighbors for close neighbor "
-                  "interpolation", __func__, ngb_counter,
-                  prm->numneighbors);
+          for(n=0;n<prm->numneighbors;++n)
+            memcpy(gal_pointer_increment(tnear->array, n, tin->type),
+                   gal_pointer_increment(tin->array, chstart+nind[n],
+                                         tin->type),
+                   gal_type_sizeof(tin->type));
+          tin=tin->next;
         }
 
       /* Calculate the desired statistic, and write it in the output. */
@@ -309,9 +512,10 @@ interpolate_neighbors_on_thread(void *in_prm)
   /* Clean up. */
   for(tnear=nearest; tnear!=NULL; tnear=tnear->next) tnear->array=NULL;
   gal_list_data_free(nearest);
+  free(scratch);
   free(icoord);
-  free(ncoord);
-  free(dinc);
+  free(ndist);
+  free(nind);
 
 
   /* Wait for all the other threads to finish and return. */
@@ -406,10 +610,6 @@ gal_interpolate_neighbors(gal_data_t *input,
     }
 
 
-  /* Flag the blank values. */
-  prm.blanks=gal_blank_flag(input);
-
-
   /* If the input is from a tile structure and the user has asked to ignore
      channels, then re-order the values. */
   if(permute)
@@ -419,7 +619,6 @@ gal_interpolate_neighbors(gal_data_t *input,
 
       /* Re-order values to ignore channels (if necessary). */
       gal_permutation_apply(input, tl->permutation);
-      gal_permutation_apply(prm.blanks, tl->permutation);
 
       /* If this is a linked list, then permute remaining nodes. */
       if(aslinkedlist)
@@ -464,11 +663,17 @@ gal_interpolate_neighbors(gal_data_t *input,
   gal_list_void_reverse(&prm.ngb_vals);
 
 
-  /* Allocate space for all the flag values of all the threads here (memory
-     in each thread is limited) and this is cleaner. */
-  prm.thread_flags=gal_pointer_allocate(GAL_TYPE_UINT8,
-                                        numthreads*input->size, 0, __func__,
-                                        "prm.thread_flags");
+  /* Flag the blank values and index the non-blank elements (this is done
+     after the permutation, so they correspond to the order that the
+     elements are used). */
+  prm.blanks=gal_blank_mask(input);
+  if(tl && tl->totchannels>1 && !tl->workoverch)
+    interpolate_index_make(&prm.index, prm.blanks, input->ndim,
+                           tl->numtilesinch, tl->tottilesinch,
+                           tl->totchannels, numneighbors);
+  else
+    interpolate_index_make(&prm.index, prm.blanks, input->ndim,
+                           input->dsize, input->size, 1, numneighbors);
 
 
   /* Spin off the threads. */
@@ -498,8 +703,8 @@ gal_interpolate_neighbors(gal_data_t *input,
 
 
   /* Clean up and return. */
-  free(prm.thread_flags);
-  gal_data_free(prm.blanks);
+  interpolate_index_free(&prm.index);
+  free(prm.blanks);
   gal_list_void_free(prm.ngb_vals, 1);
   return prm.out;
 }
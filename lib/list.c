@@ -22,6 +22,7 @@ along with Gnuastro. If not, see <http://www.gnu.org/licenses/>.
 **********************************************************************/
 #include <config.h>
 
+#include <math.h>
 #include <stdio.h>
 #include <errno.h>
 #include <error.h>
@@ -1397,6 +1398,305 @@ gal_list_dosizet_free(gal_list_dosizet_t *largest)
 
 
 
+/*********************************************************************/
+/*************    Array-based (ring buffer) size_t   *****************/
+/*********************************************************************/
+/* The linked lists above need one allocation for every new node. In hot
+   loops (for example parsing the neighbors of millions of pixels), this
+   can be very expensive. The ring buffer below keeps all the elements in
+   one array (that grows by a factor of two when it is full), so it can
+   be used as a last-in-first-out (stack) or first-in-first-out (queue)
+   list with no allocation for each element. Once allocated, the same ring
+   can be used many times (for example by each thread). */
+void
+gal_list_sizet_ring_init(gal_list_sizet_ring_t *ring, size_t initsize)
+{
+  ring->num=ring->first=0;
+  ring->size = initsize ? initsize : 1;
+  ring->array=gal_pointer_allocate(GAL_TYPE_SIZE_T, ring->size, 0,
+                                   __func__, "ring->array");
+}
+
+
+
+
+
+/* Double the allocated space of the ring, while putting the elements at
+   the start of the new array. */
+static void
+list_sizet_ring_grow(gal_list_sizet_ring_t *ring)
+{
+  size_t i, *array;
+
+  /* Allocate the new space and copy the elements in order. */
+  array=gal_pointer_allocate(GAL_TYPE_SIZE_T, 2*ring->size, 0, __func__,
+                             "array");
+  for(i=0;i<ring->num;++i)
+    array[i]=ring->array[ (ring->first+i) % ring->size ];
+
+  /* Replace the old array. */
+  free(ring->array);
+  ring->first=0;
+  ring->array=array;
+  ring->size*=2;
+}
+
+
+
+
+
+/* Add a new element to the end of the ring. */
+void
+gal_list_sizet_ring_add(gal_list_sizet_ring_t *ring, size_t value)
+{
+  if(ring->num==ring->size) list_sizet_ring_grow(ring);
+  ring->array[ (ring->first + ring->num++) % ring->size ] = value;
+}
+
+
+
+
+
+/* Pop the first element of the ring (first-in-first-out). If the ring is
+   empty, 'GAL_BLANK_SIZE_T' is returned. */
+size_t
+gal_list_sizet_ring_pop_first(gal_list_sizet_ring_t *ring)
+{
+  size_t out;
+  if(ring->num==0) return GAL_BLANK_SIZE_T;
+  out=ring->array[ring->first];
+  ring->first = (ring->first+1) % ring->size;
+  --ring->num;
+  return out;
+}
+
+
+
+
+
+/* Pop the last element of the ring (last-in-first-out). If the ring is
+   empty, 'GAL_BLANK_SIZE_T' is returned. */
+size_t
+gal_list_sizet_ring_pop_last(gal_list_sizet_ring_t *ring)
+{
+  if(ring->num==0) return GAL_BLANK_SIZE_T;
+  --ring->num;
+  return ring->array[ (ring->first + ring->num) % ring->size ];
+}
+
+
+
+
+
+/* Free the allocated space within the ring (not the ring itself). */
+void
+gal_list_sizet_ring_free(gal_list_sizet_ring_t *ring)
+{
+  free(ring->array);
+  ring->array=NULL;
+  ring->size=ring->num=ring->first=0;
+}
+
+
+
+
+
+
+
+
+
+
+
+
+
+
+
+
+
+
+
+
+/*********************************************************************/
+/*************    Array-based (heap) ordered size_t  *****************/
+/*********************************************************************/
+/* A binary min-heap that can be used instead of the doubly linked
+   ordered list ('gal_list_dosizet_t'): adding and popping an element both
+   take 'log(n)' operations (instead of 'n' operations to add an element
+   in the ordered list), and no allocation is necessary for each
+   element. When two elements have the same 'tosort' value, the one that
+   was added first is popped first (like 'gal_list_dosizet_t').  */
+void
+gal_list_sizet_heap_init(gal_list_sizet_heap_t *heap, size_t initsize)
+{
+  heap->num=heap->added=0;
+  heap->size = initsize ? initsize : 1;
+  heap->v=gal_pointer_allocate(GAL_TYPE_SIZE_T, heap->size, 0, __func__,
+                               "heap->v");
+  heap->o=gal_pointer_allocate(GAL_TYPE_SIZE_T, heap->size, 0, __func__,
+                               "heap->o");
+  heap->s=gal_pointer_allocate(GAL_TYPE_FLOAT32, heap->size, 0, __func__,
+                               "heap->s");
+}
+
+
+
+
+
+/* Re-allocate the given array. */
+static void *
+list_realloc(void *array, size_t nbytes, char *name)
+{
+  void *out;
+  errno=0;
+  out=realloc(array, nbytes);
+  if(out==NULL)
+    error(EXIT_FAILURE, errno, "%s: couldn't re-allocate %zu bytes for "
+          "'%s'", __func__, nbytes, name);
+  return out;
+}
+
+
+
+
+
+/* If element 'a' should be popped before element 'b'. */
+#define LIST_HEAP_BEFORE(H, A, B) ( (H)->s[A] < (H)->s[B]                  \
+                                    || ( (H)->s[A] == (H)->s[B]            \
+                                         && (H)->o[A] < (H)->o[B] ) )
+
+static void
+list_sizet_heap_swap(gal_list_sizet_heap_t *heap, size_t a, size_t b)
+{
+  float ts;
+  size_t tv, to;
+  tv=heap->v[a]; heap->v[a]=heap->v[b]; heap->v[b]=tv;
+  to=heap->o[a]; heap->o[a]=heap->o[b]; heap->o[b]=to;
+  ts=heap->s[a]; heap->s[a]=heap->s[b]; heap->s[b]=ts;
+}
+
+
+
+
+
+void
+gal_list_sizet_heap_add(gal_list_sizet_heap_t *heap, size_t value,
+                        float tosort)
+{
+  size_t i, parent;
+
+  /* Make sure there is enough space. */
+  if(heap->num==heap->size)
+    {
+      heap->size*=2;
+      heap->v=list_realloc(heap->v, heap->size*sizeof *heap->v, "heap->v");
+      heap->o=list_realloc(heap->o, heap->size*sizeof *heap->o, "heap->o");
+      heap->s=list_realloc(heap->s, heap->size*sizeof *heap->s, "heap->s");
+    }
+
+  /* Put the new element at the end and move it up as much as
+     necessary. */
+  i=heap->num++;
+  heap->v[i]=value;
+  heap->s[i]=tosort;
+  heap->o[i]=heap->added++;
+  while(i>0)
+    {
+      parent=(i-1)/2;
+      if( LIST_HEAP_BEFORE(heap, i, parent) )
+        { list_sizet_heap_swap(heap, i, parent); i=parent; }
+      else break;
+    }
+}
+
+
+
+
+
+/* Pop the element with the smallest 'tosort' value. If the heap is empty,
+   'GAL_BLANK_SIZE_T' is returned (and 'tosort' will be NaN). */
+size_t
+gal_list_sizet_heap_pop_smallest(gal_list_sizet_heap_t *heap,
+                                 float *tosort)
+{
+  size_t out, i=0, l, r, m;
+
+  /* If the heap is empty, return a blank value. */
+  if(heap->num==0) { *tosort=NAN; return GAL_BLANK_SIZE_T; }
+
+  /* Keep the output and put the last element on the top. */
+  out=heap->v[0];
+  *tosort=heap->s[0];
+  if(--heap->num)
+    {
+      heap->v[0]=heap->v[heap->num];
+      heap->o[0]=heap->o[heap->num];
+      heap->s[0]=heap->s[heap->num];
+    }
+
+  /* Move the top element down as much as necessary. */
+  while(1)
+    {
+      m=i;
+      l=2*i+1;
+      r=2*i+2;
+      if(l<heap->num && LIST_HEAP_BEFORE(heap, l, m)) m=l;
+      if(r<heap->num && LIST_HEAP_BEFORE(heap, r, m)) m=r;
+      if(m==i) break;
+      list_sizet_heap_swap(heap, i, m);
+      i=m;
+    }
+
+  /* Return the popped value. */
+  return out;
+}
+
+
+
+
+
+/* Remove all the elements (but keep the allocated space for later
+   usage). */
+void
+gal_list_sizet_heap_reset(gal_list_sizet_heap_t *heap)
+{
+  heap->num=heap->added=0;
+}
+
+
+
+
+
+/* Free the allocated space within the heap (not the heap itself). */
+void
+gal_list_sizet_heap_free(gal_list_sizet_heap_t *heap)
+{
+  free(heap->v);
+  free(heap->o);
+  free(heap->s);
+  heap->v=heap->o=NULL;
+  heap->s=NULL;
+  heap->size=heap->num=heap->added=0;
+}
+
+
+
+
+
+
+
+
+
+
+
+
+
+
+
+
+
+
+
+
 /*********************************************************************/
 /*************    Data structure as a linked list   ******************/
 /*********************************************************************/
@@ -29,13 +29,12 @@ along with Gnuastro. If not, see <http://www.gnu.org/licenses/>.
 #include <float.h>
 #include <stdlib.h>
 
-#include <gsl/gsl_sort.h>
-
 #include <gnuastro/box.h>
 #include <gnuastro/list.h>
 #include <gnuastro/blank.h>
 #include <gnuastro/binary.h>
 #include <gnuastro/kdtree.h>
+#include <gnuastro/match.h>
 #include <gnuastro/pointer.h>
 #include <gnuastro/threads.h>
 #include <gnuastro/statistics.h>
@@ -609,16 +608,17 @@ match_sort_based_sanity_check(gal_data_t *coord1, gal_data_t *coord2,
 /* To keep things clean, the sorting of each input array will be done in
    this function. */
 static size_t *
-match_sort_based_prepare_sort(gal_data_t *coords, size_t minmapsize)
+match_sort_based_prepare_sort(gal_data_t *coords, size_t numthreads,
+                              size_t minmapsize)
 {
   size_t i;
   double *darr;
-  gal_data_t *tmp;
   size_t *permutation=gal_pointer_allocate(GAL_TYPE_SIZE_T, coords->size,
                                            0, __func__, "permutation");
 
-  /* Unfortunately 'gsl_sort_index' doesn't account for NaN elements. So we
-     need to set them to the maximum possible floating point value. */
+  /* NaN elements can't be compared during the matching. So we need to set
+     them to the maximum possible floating point value (this will also
+     put them at the end of the sorted array). */
   if( gal_blank_present(coords, 1) )
     {
       darr=coords->array;
@@ -628,7 +628,7 @@ match_sort_based_prepare_sort(gal_data_t *coords, size_t minmapsize)
 
   /* Get the permutation necessary to sort all the columns (based on the
      first column). */
-  gsl_sort_index(permutation, coords->array, 1, coords->size);
+  gal_statistics_sort_index(coords, permutation, 0, numthreads);
 
   /* For a check.
   if(coords->size>1)
@@ -636,8 +636,7 @@ match_sort_based_prepare_sort(gal_data_t *coords, size_t minmapsize)
   */
 
   /* Sort all the coordinates. */
-  for(tmp=coords; tmp!=NULL; tmp=tmp->next)
-    gal_permutation_apply(tmp, permutation);
+  gal_permutation_apply_columns(coords, permutation, 0, numthreads);
 
   /* For a check.
   if(coords->size>1)
@@ -668,7 +667,7 @@ match_sort_based_prepare(gal_data_t *coord1, gal_data_t *coord2,
                           int sorted_by_first, int inplace, int allf64,
                           gal_data_t **A_out, gal_data_t **B_out,
                           size_t **A_perm, size_t **B_perm,
-                          size_t minmapsize)
+                          size_t numthreads, size_t minmapsize)
 {
   gal_data_t *c, *tmp, *A=NULL, *B=NULL;
 
@@ -716,8 +715,10 @@ match_sort_based_prepare(gal_data_t *coord1, gal_data_t *coord2,
         }
 
       /* Sort each dataset by the first coordinate. */
-      *A_perm = match_sort_based_prepare_sort(*A_out, minmapsize);
-      *B_perm = match_sort_based_prepare_sort(*B_out, minmapsize);
+      *A_perm = match_sort_based_prepare_sort(*A_out, numthreads,
+                                              minmapsize);
+      *B_perm = match_sort_based_prepare_sort(*B_out, numthreads,
+                                              minmapsize);
     }
 }
 
@@ -889,6 +890,24 @@ gal_match_sort_based(gal_data_t *coord1, gal_data_t *coord2,
                       double *aperture, int sorted_by_first,
                       int inplace, size_t minmapsize, int quietmmap,
                       size_t *nummatched)
+{
+  return gal_match_sort_based_threads(coord1, coord2, aperture,
+                                      sorted_by_first, inplace, 1,
+                                      minmapsize, quietmmap, nummatched);
+}
+
+
+
+
+
+/* Similar to 'gal_match_sort_based', but the initial sorting of the
+   inputs will be done on 'numthreads' threads. */
+gal_data_t *
+gal_match_sort_based_threads(gal_data_t *coord1, gal_data_t *coord2,
+                             double *aperture, int sorted_by_first,
+                             int inplace, size_t numthreads,
+                             size_t minmapsize, int quietmmap,
+                             size_t *nummatched)
 {
   int allf64=1;
   gal_data_t *A, *B, *out;
@@ -901,7 +920,7 @@ gal_match_sort_based(gal_data_t *coord1, gal_data_t *coord2,
                                  &allf64);
   match_sort_based_prepare(coord1, coord2, sorted_by_first, inplace,
                             allf64, &A, &B, &A_perm, &B_perm,
-                            minmapsize);
+                            numthreads, minmapsize);
 
 
   /* Allocate the 'bina' array (an array of lists). Let's call the first
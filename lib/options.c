@@ -589,6 +589,67 @@ gal_options_read_wcslinearmatrix(struct argp_option *option, char *arg,
 
 
 
+void *
+gal_options_read_compress(struct argp_option *option, char *arg,
+                          char *filename, size_t lineno, void *junk)
+{
+  char *str=NULL;
+  uint8_t value=GAL_FITS_COMPRESS_INVALID;
+  if(lineno==-1)
+    {
+      /* The output must be an allocated string (will be 'free'd later). */
+      value=*(uint8_t *)(option->value);
+      switch(value)
+        {
+        case GAL_FITS_COMPRESS_NONE:
+          gal_checkset_allocate_copy("none", &str);      break;
+        case GAL_FITS_COMPRESS_RICE:
+          gal_checkset_allocate_copy("rice", &str);      break;
+        case GAL_FITS_COMPRESS_GZIP:
+          gal_checkset_allocate_copy("gzip", &str);      break;
+        case GAL_FITS_COMPRESS_GZIP2:
+          gal_checkset_allocate_copy("gzip2", &str);     break;
+        case GAL_FITS_COMPRESS_HCOMPRESS:
+          gal_checkset_allocate_copy("hcompress", &str); break;
+        case GAL_FITS_COMPRESS_PLIO:
+          gal_checkset_allocate_copy("plio", &str);      break;
+        default:
+          error(EXIT_FAILURE, 0, "%s: a bug! Please contact us at '%s' "
+                "to fix the problem. %u is not a recognized image "
+                "compression code", __func__, PACKAGE_BUGREPORT, value);
+        }
+      return str;
+    }
+  else
+    {
+      /* If the option is already set, just return. */
+      if(option->set) return NULL;
+
+      /* Read the value. */
+      if(      !strcmp(arg, "none")      ) value=GAL_FITS_COMPRESS_NONE;
+      else if( !strcmp(arg, "rice")      ) value=GAL_FITS_COMPRESS_RICE;
+      else if( !strcmp(arg, "gzip")      ) value=GAL_FITS_COMPRESS_GZIP;
+      else if( !strcmp(arg, "gzip2")     ) value=GAL_FITS_COMPRESS_GZIP2;
+      else if( !strcmp(arg, "hcompress") ) value=GAL_FITS_COMPRESS_HCOMPRESS;
+      else if( !strcmp(arg, "plio")      ) value=GAL_FITS_COMPRESS_PLIO;
+      else
+        error_at_line(EXIT_FAILURE, 0, filename, lineno, "'%s' (value "
+                      "to '%s' option) couldn't be recognized as a known "
+                      "image compression algorithm. Acceptable values are "
+                      "'none', 'rice', 'gzip', 'gzip2', 'hcompress' or "
+                      "'plio'", arg, option->name);
+      *(uint8_t *)(option->value)=value;
+
+      /* For no un-used variable warning. This function doesn't need the
+         pointer.*/
+      return junk=NULL;
+    }
+}
+
+
+
+
+
 void *
 gal_options_read_tableformat(struct argp_option *option, char *arg,
                              char *filename, size_t lineno, void *junk)
@@ -23,9 +23,14 @@ along with Gnuastro. If not, see <http://www.gnu.org/licenses/>.
 #include <config.h>
 
 #include <stdio.h>
+#include <errno.h>
+#include <error.h>
 #include <string.h>
 #include <stdlib.h>
 
+#include <gnuastro/tile.h>
+#include <gnuastro/blank.h>
+#include <gnuastro/threads.h>
 #include <gnuastro/pointer.h>
 #include <gnuastro/permutation.h>
 
@@ -208,3 +213,179 @@ gal_permutation_apply(gal_data_t *input, size_t *permutation)
 void
 gal_permutation_apply_onlydim0(gal_data_t *input, size_t *permutation)
 { permutation_apply_raw(input, permutation, 1); }
+
+
+
+
+
+/* Number of rows in each block of the multi-threaded permutation. */
+#define PERMUTATION_BLOCK 16384
+
+
+
+
+/* Parameters for the multi-threaded (out-of-place) permutation. */
+struct permutation_params
+{
+  gal_data_t   **cols;  /* Datasets to permute.                         */
+  uint8_t      **tmps;  /* Temporary array for each dataset.            */
+  size_t      *widths;  /* Width (in bytes) of one row of each dataset. */
+  size_t        ncols;  /* Number of datasets.                          */
+  size_t        *perm;  /* The permutation.                             */
+  size_t         size;  /* Number of rows (elements in 'perm').         */
+  int         inverse;  /* Apply the inverse permutation.               */
+  int        copyback;  /* ==1: copy the temporary arrays to the input. */
+};
+
+
+
+
+
+/* Gather (or scatter for the inverse permutation) one block of rows into
+   the temporary array. For the common widths, the copy is done through a
+   type of the same width so the compiler doesn't need to call 'memcpy'
+   for every element. */
+#define PERMUTATION_GATHER(IT) {                                            \
+    IT *restrict o=(IT *)tmp, *restrict a=(IT *)arr;                        \
+    if(p->inverse) for(i=start;i<end;++i) o[ perm[i] ] = a[i];              \
+    else           for(i=start;i<end;++i) o[i] = a[ perm[i] ];              \
+  }
+
+static void *
+permutation_apply_on_thread(void *in_prm)
+{
+  struct gal_threads_params *tprm=(struct gal_threads_params *)in_prm;
+  struct permutation_params *p=(struct permutation_params *)tprm->params;
+
+  size_t *perm=p->perm;
+  uint8_t *restrict arr, *restrict tmp;
+  size_t i, b, c, w, start, end;
+
+  /* Go over all the blocks of rows that were assigned to this thread. */
+  for(b=0; tprm->indexs[b] != GAL_BLANK_SIZE_T; ++b)
+    {
+      /* Range of rows in this block. */
+      start = tprm->indexs[b] * PERMUTATION_BLOCK;
+      end   = start + PERMUTATION_BLOCK;
+      if(end>p->size) end=p->size;
+
+      /* Parse the datasets: the permutation of this block is read once
+         and used for all of them. */
+      for(c=0;c<p->ncols;++c)
+        {
+          w=p->widths[c];
+          tmp=p->tmps[c];
+          arr=p->cols[c]->array;
+          if(p->copyback)
+            memcpy(arr+start*w, tmp+start*w, (end-start)*w);
+          else
+            switch(w)
+              {
+              case 1: PERMUTATION_GATHER( uint8_t  );  break;
+              case 2: PERMUTATION_GATHER( uint16_t );  break;
+              case 4: PERMUTATION_GATHER( uint32_t );  break;
+              case 8: PERMUTATION_GATHER( uint64_t );  break;
+              default:
+                if(p->inverse)
+                  for(i=start;i<end;++i)
+                    memcpy(tmp+perm[i]*w, arr+i*w, w);
+                else
+                  for(i=start;i<end;++i)
+                    memcpy(tmp+i*w, arr+perm[i]*w, w);
+              }
+        }
+    }
+
+  /* Wait for all the other threads to finish, then return. */
+  if(tprm->b) pthread_barrier_wait(tprm->b);
+  return NULL;
+}
+
+
+
+
+
+/* Apply the permutation (or its inverse) on all the datasets in the
+   'columns' list (the 0-th dimension of each is permuted, like a table's
+   columns, see 'gal_permutation_apply_onlydim0').
+
+   Following the permutation's cycles (like the functions above) doesn't
+   need any extra memory, but each step depends on the previous step's
+   random access into the array, so on large arrays it is dominated by
+   cache misses. Here, each dataset is first gathered into a temporary
+   array (where the reads are independent of each other and the writes
+   are sequential), then copied back. The rows are divided into blocks
+   that are distributed between the threads and all the datasets are
+   permuted in the same pass over the permutation. The temporary arrays
+   respect each dataset's 'minmapsize'. */
+void
+gal_permutation_apply_columns(gal_data_t *columns, size_t *permutation,
+                              int inverse, size_t numthreads)
+{
+  gal_data_t *col;
+  char **mmapnames;
+  size_t c, nblocks, minmapsize=-1;
+  struct permutation_params p={0};
+
+  /* If permutation is NULL, then it is assumed that the data doesn't need
+     to be re-ordered. */
+  if(permutation==NULL || columns==NULL) return;
+
+  /* Count the datasets and do the sanity checks. */
+  for(col=columns; col!=NULL; col=col->next)
+    {
+      if(gal_tile_block(col)!=col)
+        error(EXIT_FAILURE, 0, "%s: tiles are not supported", __func__);
+      if(col->dsize[0]!=columns->dsize[0])
+        error(EXIT_FAILURE, 0, "%s: all the datasets must have the same "
+              "number of elements in their 0-th dimension (rows), but "
+              "they have %zu and %zu", __func__, columns->dsize[0],
+              col->dsize[0]);
+      if(col->minmapsize<minmapsize) minmapsize=col->minmapsize;
+      ++p.ncols;
+    }
+
+  /* Allocate the arrays of the parameters structure. */
+  p.cols=gal_data_array_ptr_calloc(p.ncols);
+  p.tmps=gal_pointer_allocate(GAL_TYPE_STRING, p.ncols, 0, __func__,
+                              "p.tmps");
+  p.widths=gal_pointer_allocate(GAL_TYPE_SIZE_T, p.ncols, 0, __func__,
+                                "p.widths");
+  mmapnames=gal_pointer_allocate(GAL_TYPE_STRING, p.ncols, 1, __func__,
+                                 "mmapnames");
+
+  /* Set the parameters of each dataset and allocate its temporary
+     space. */
+  for(c=0, col=columns; col!=NULL; col=col->next, ++c)
+    {
+      p.cols[c]=col;
+      p.widths[c]=gal_type_sizeof(col->type) * (col->size/col->dsize[0]);
+      p.tmps[c]=gal_pointer_allocate_ram_or_mmap(col->type, col->size, 0,
+                                                 col->minmapsize,
+                                                 &mmapnames[c],
+                                                 col->quietmmap, __func__,
+                                                 "p.tmps[c]");
+    }
+
+  /* Gather the rows into the temporary arrays, then copy them back. */
+  p.perm=permutation;
+  p.inverse=inverse;
+  p.size=columns->dsize[0];
+  nblocks = p.size/PERMUTATION_BLOCK + (p.size%PERMUTATION_BLOCK ? 1 : 0);
+  if(nblocks)
+    for(p.copyback=0; p.copyback<2; ++p.copyback)
+      gal_threads_spin_off(permutation_apply_on_thread, &p, nblocks,
+                           numthreads, minmapsize, columns->quietmmap);
+
+  /* Clean up. */
+  for(c=0;c<p.ncols;++c)
+    {
+      if(mmapnames[c])
+        gal_pointer_mmap_free(&mmapnames[c], p.cols[c]->quietmmap);
+      else free(p.tmps[c]);
+    }
+  free(mmapnames);
+  free(p.widths);
+  free(p.tmps);
+  free(p.cols);
+}
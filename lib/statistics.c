@@ -37,6 +37,7 @@ along with Gnuastro. If not, see <http://www.gnu.org/licenses/>.
 #include <gnuastro/blank.h>
 #include <gnuastro/qsort.h>
 #include <gnuastro/pointer.h>
+#include <gnuastro/threads.h>
 #include <gnuastro/arithmetic.h>
 #include <gnuastro/statistics.h>
 
@@ -59,19 +60,13 @@ along with Gnuastro. If not, see <http://www.gnu.org/licenses/>.
 gal_data_t *
 gal_statistics_number(gal_data_t *input)
 {
-  size_t counter=0, dsize=1;
+  size_t dsize=1;
   gal_data_t *out=gal_data_alloc(NULL, GAL_TYPE_SIZE_T, 1, &dsize,
                                  NULL, 1, -1, 1, NULL, NULL, NULL);
 
-  /* If there is no blank values in the input, then the total number is
-     just the size. */
-  if(gal_blank_present(input, 0)) /* '{}' necessary for 'else'. */
-    { GAL_TILE_PARSE_OPERATE(input, NULL, 0, 1, {++counter;}); }
-  else
-    counter = input->size;
-
-  /* Write the value into memory. */
-  *((size_t *)(out->array)) = counter;
+  /* Write the number of non-blank elements into memory (if there are no
+     blank values, it is just the size). */
+  *((size_t *)(out->array)) = gal_tile_span_number(input);
   return out;
 }
 
@@ -89,15 +84,7 @@ gal_statistics_minimum(gal_data_t *input)
                                  &dsize, NULL, 1, -1, 1, NULL, NULL, NULL);
 
   /* See if the input actually has any elements. */
-  if(input->size)
-    {
-      /* Initialize the output with the maximum possible value. */
-      gal_type_max(out->type, out->array);
-
-      /* Parse the full input. */
-      GAL_TILE_PARSE_OPERATE( input, out, 0, 1,
-                              {*o = *i < *o ? *i : *o; ++n;} );
-    }
+  if(input->size) n=gal_tile_span_minmax(input, out->array, NULL);
 
   /* If there were no usable elements, set the output to blank, then
      return. */
@@ -118,15 +105,7 @@ gal_statistics_maximum(gal_data_t *input)
   gal_data_t *out=gal_data_alloc(NULL, gal_tile_block(input)->type, 1,
                                  &dsize, NULL, 1, -1, 1, NULL, NULL, NULL);
   /* See if the input actually has any elements. */
-  if(input->size)
-    {
-      /* Initialize the output with the minimum possible value. */
-      gal_type_min(out->type, out->array);
-
-      /* Parse the full input. */
-      GAL_TILE_PARSE_OPERATE(input, out, 0, 1,
-                             {*o = *i > *o ? *i : *o; ++n;});
-    }
+  if(input->size) n=gal_tile_span_minmax(input, NULL, out->array);
 
   /* If there were no usable elements, set the output to blank, then
      return. */
@@ -148,10 +127,7 @@ gal_statistics_sum(gal_data_t *input)
                                  NULL, 1, -1, 1, NULL, NULL, NULL);
 
   /* See if the input actually has any elements. */
-  if(input->size)
-    /* Parse the dataset. Note that in 'gal_data_alloc' we set the 'clear'
-       flag to 1, so it will be 0.0f. */
-    GAL_TILE_PARSE_OPERATE(input, out, 0, 1, {++n; *o += *i;});
+  if(input->size) n=gal_tile_span_sums(input, out->array, NULL);
 
   /* If there were no usable elements, set the output to blank, then
      return. */
@@ -173,10 +149,7 @@ gal_statistics_mean(gal_data_t *input)
                                  NULL, 1, -1, 1, NULL, NULL, NULL);
 
   /* See if the input actually has any elements. */
-  if(input->size)
-    /* Parse the dataset. Note that in 'gal_data_alloc' we set the 'clear'
-       flag to 1, so it will be 0.0f. */
-    GAL_TILE_PARSE_OPERATE(input, out, 0, 1, {++n; *o += *i;});
+  if(input->size) n=gal_tile_span_sums(input, out->array, NULL);
 
   /* Above, we calculated the sum and number, so if there were any elements
      in the dataset ('n!=0'), divide the sum by the number, otherwise, put
@@ -227,7 +200,7 @@ gal_data_t *
 gal_statistics_std(gal_data_t *input)
 {
   size_t dsize=1, n=0;
-  double v, *o, s=0.0f, s2=0.0f;
+  double *o, s=0.0f, s2=0.0f;
   gal_data_t *out=gal_data_alloc(NULL, GAL_TYPE_FLOAT64, 1, &dsize,
                                  NULL, 1, -1, 1, NULL, NULL, NULL);
 
@@ -246,12 +219,10 @@ gal_statistics_std(gal_data_t *input)
     /* More than one element. */
     default:
 
-      /* Parse the data to measure 's' and 's2'. Its important to put each
-         value into a 'double' type variable ('v') before multiplying (for
-         's2') because the multiplication of integer types close to their
-         limits will cause overflow and thus an unreasonable output). */
-      GAL_TILE_PARSE_OPERATE(input, out, 0, 1,
-                             {++n; v=*i; s+=v; s2+=v*v;});
+      /* Parse the data to measure 's' and 's2' (each value is converted
+         to 'double' before multiplying, to avoid overflow of integer
+         types close to their limits). */
+      n=gal_tile_span_sums(input, &s, &s2);
 
       /* Write the standard deviation. */
       o[0] = gal_statistics_std_from_sums(s, s2, n);
@@ -273,7 +244,7 @@ gal_data_t *
 gal_statistics_mean_std(gal_data_t *input)
 {
   size_t dsize=2, n=0;
-  double v, *o, s=0.0f, s2=0.0f;
+  double *o, s=0.0f, s2=0.0f;
   gal_data_t *out=gal_data_alloc(NULL, GAL_TYPE_FLOAT64, 1, &dsize,
                                  NULL, 1, -1, 1, NULL, NULL, NULL);
 
@@ -288,19 +259,17 @@ gal_statistics_mean_std(gal_data_t *input)
        deviation should be 0. But due to floating-point errors, it will
        probably not be. So we'll manually set it to zero. */
     case 1:
-      GAL_TILE_PARSE_OPERATE(input, out, 0, 1, {s+=*i;});
+      gal_tile_span_sums(input, &s, NULL);
       o[0]=s; o[1]=0;
       break;
 
     /* More than one element. */
     default:
 
-      /* Parse the data. Its important to put each value into a 'double'
-         type variable ('v') before multiplying (for 's2') because the
-         multiplication of integer types close to their limits will cause
-         overflow and thus an unreasonable output). */
-      GAL_TILE_PARSE_OPERATE(input, out, 0, 1,
-                             {++n; v=*i; s+=v; s2+=v*v;});
+      /* Parse the data (each value is converted to 'double' before
+         multiplying, to avoid overflow of integer types close to their
+         limits). */
+      n=gal_tile_span_sums(input, &s, &s2);
 
       /* Write the mean */
       o[0]=s/n;
@@ -1485,47 +1454,370 @@ gal_statistics_is_sorted(gal_data_t *input, int updateflags)
 
 
 
+/* Radix sort.
+
+   The values are first transformed into unsigned integer "keys" of the
+   same width, where the order of the keys is the same as the requested
+   order of the values:
+
+     - Unsigned integers don't need any change.
+     - Signed integers: the sign bit is flipped.
+     - Floating point: for positive values the sign bit is flipped and for
+       negative values all the bits are flipped. NaN values get the
+       largest possible key, so like the comparison functions of
+       'qsort.h', they will be at the end of the sorted array (in both
+       increasing and decreasing orders).
+     - For a decreasing order, all the bits of the non-NaN keys are
+       flipped.
+
+   The keys are then sorted with a "Least Significant Digit" (LSD) radix
+   sort, one byte at a time. LSD radix sort is stable, so when the sorted
+   indexs are requested, elements with the same value will keep their
+   original order. For large arrays, each pass is done on multiple threads:
+   each thread first builds the histogram of its part of the array, then
+   (after the starting position of each digit in each thread is known),
+   copies its elements into their new place. */
+#define STATISTICS_RADIX_MIN         1024
+#define STATISTICS_RADIX_MIN_THREAD  1048576
+
+struct statistics_radix_params
+{
+  uint8_t      width;    /* Width of each key in bytes.                */
+  void         *keys;    /* Keys to sort.                              */
+  void      *keystmp;    /* Temporary space for the keys.              */
+  size_t       *inds;    /* Indexs to sort with the keys (can be NULL).*/
+  size_t    *indstmp;    /* Temporary space for the indexs.            */
+  size_t        size;    /* Number of elements.                        */
+  size_t     nchunks;    /* Number of chunks (one for each thread).    */
+  size_t       shift;    /* Shift (in bits) to the current digit.      */
+  size_t       *hist;    /* Histogram (256 elements for each chunk).   */
+  int        scatter;    /* ==0: build histogram, ==1: scatter.        */
+};
+
+
+
+
+
+/* Apply the histogram or scatter step on one chunk of the array. */
+#define STATISTICS_RADIX_CHUNK(UT) {                                    \
+    UT *k=p->keys, *kt=p->keystmp;                                      \
+    if(p->scatter)                                                      \
+      {                                                                 \
+        if(p->inds)                                                     \
+          for(i=start;i<end;++i)                                        \
+            {                                                           \
+              o = h[ (k[i]>>p->shift) & 0xff ]++;                       \
+              kt[o]=k[i];                                               \
+              p->indstmp[o]=p->inds[i];                                 \
+            }                                                           \
+        else                                                            \
+          for(i=start;i<end;++i)                                        \
+            kt[ h[ (k[i]>>p->shift) & 0xff ]++ ] = k[i];                \
+      }                                                                 \
+    else                                                                \
+      {                                                                 \
+        memset(h, 0, 256*sizeof *h);                                    \
+        for(i=start;i<end;++i) ++h[ (k[i]>>p->shift) & 0xff ];          \
+      }                                                                 \
+  }
+
+static void
+statistics_radix_chunk(struct statistics_radix_params *p, size_t c)
+{
+  size_t i, o, *h=p->hist+256*c;
+  size_t start=p->size*c/p->nchunks, end=p->size*(c+1)/p->nchunks;
+
+  switch(p->width)
+    {
+    case 1: STATISTICS_RADIX_CHUNK( uint8_t  );  break;
+    case 2: STATISTICS_RADIX_CHUNK( uint16_t );  break;
+    case 4: STATISTICS_RADIX_CHUNK( uint32_t );  break;
+    case 8: STATISTICS_RADIX_CHUNK( uint64_t );  break;
+    default:
+      error(EXIT_FAILURE, 0, "%s: a bug! Please contact us at %s to fix "
+            "the problem. Width %u is not recognized", __func__,
+            PACKAGE_BUGREPORT, p->width);
+    }
+}
+
+
+
+
+
+static void *
+statistics_radix_on_thread(void *in_prm)
+{
+  struct gal_threads_params *tprm=(struct gal_threads_params *)in_prm;
+  struct statistics_radix_params *p=tprm->params;
+  size_t i;
+
+  /* Do the job on each chunk. */
+  for(i=0; tprm->indexs[i] != GAL_BLANK_SIZE_T; ++i)
+    statistics_radix_chunk(p, tprm->indexs[i]);
+
+  /* Wait for all the other threads to finish, then return. */
+  if(tprm->b) pthread_barrier_wait(tprm->b);
+  return NULL;
+}
+
+
+
+
+
+/* Sort the keys (and the indexs, if they are given) in 'p'. The sorted
+   keys (and indexs) will be in the same arrays as the input. */
+static void
+statistics_radix_sort(struct statistics_radix_params *p, size_t numthreads,
+                      size_t minmapsize, int quietmmap)
+{
+  void *vtmp;
+  size_t *stmp;
+  int inkeys=1;
+  size_t c, d, o, sum, maxsum;
+  char *kmmap=NULL, *immap=NULL;
+  void *keys=p->keys, *keystmp;
+  size_t *inds=p->inds, *indstmp=NULL;
+
+  /* Set the number of chunks (one for each thread) and allocate the
+     histogram of each. */
+  p->nchunks=p->size/STATISTICS_RADIX_MIN_THREAD;
+  if(p->nchunks>numthreads) p->nchunks=numthreads;
+  if(p->nchunks==0) p->nchunks=1;
+  p->hist=gal_pointer_allocate(GAL_TYPE_SIZE_T, 256*p->nchunks, 0,
+                               __func__, "p->hist");
+
+  /* Allocate the temporary arrays. */
+  keystmp=gal_pointer_allocate_ram_or_mmap(GAL_TYPE_UINT8,
+                                           p->size*p->width, 0, minmapsize,
+                                           &kmmap, quietmmap, __func__,
+                                           "keystmp");
+  if(inds)
+    indstmp=gal_pointer_allocate_ram_or_mmap(GAL_TYPE_SIZE_T, p->size, 0,
+                                             minmapsize, &immap, quietmmap,
+                                             __func__, "indstmp");
+  p->keystmp=keystmp;
+  p->indstmp=indstmp;
+
+  /* Sort by each byte, starting from the least significant. */
+  for(p->shift=0; p->shift<8*p->width; p->shift+=8)
+    {
+      /* Build the histogram of this digit in each chunk. */
+      p->scatter=0;
+      if(p->nchunks>1)
+        gal_threads_spin_off(statistics_radix_on_thread, p, p->nchunks,
+                             p->nchunks, minmapsize, quietmmap);
+      else statistics_radix_chunk(p, 0);
+
+      /* Convert the histograms to the starting position of each digit in
+         each chunk. If all the elements have the same digit, this pass
+         won't change anything, so it can be ignored. */
+      sum=maxsum=0;
+      for(d=0;d<256;++d)
+        {
+          o=sum;
+          for(c=0;c<p->nchunks;++c)
+            { o+=p->hist[256*c+d]; }
+          if(o-sum>maxsum) maxsum=o-sum;
+          for(c=0;c<p->nchunks;++c)
+            { o=p->hist[256*c+d]; p->hist[256*c+d]=sum; sum+=o; }
+        }
+      if(maxsum==p->size) continue;
+
+      /* Put each element in its place and swap the arrays. */
+      p->scatter=1;
+      if(p->nchunks>1)
+        gal_threads_spin_off(statistics_radix_on_thread, p, p->nchunks,
+                             p->nchunks, minmapsize, quietmmap);
+      else statistics_radix_chunk(p, 0);
+      vtmp=p->keys; p->keys=p->keystmp; p->keystmp=vtmp;
+      stmp=p->inds; p->inds=p->indstmp; p->indstmp=stmp;
+      inkeys=!inkeys;
+    }
+
+  /* If the final result is in the temporary arrays, copy it back. */
+  if(!inkeys)
+    {
+      memcpy(keys, keystmp, p->size*p->width);
+      if(inds) memcpy(inds, indstmp, p->size*sizeof *inds);
+    }
+  p->keys=keys;
+  p->inds=inds;
+
+  /* Clean up. */
+  free(p->hist);
+  if(kmmap) gal_pointer_mmap_free(&kmmap, quietmmap); else free(keystmp);
+  if(indstmp)
+    { if(immap) gal_pointer_mmap_free(&immap, quietmmap);
+      else free(indstmp); }
+}
+
+
+
+
+
+/* Convert the values in 'in' to the keys in 'keys' ('keys' can be the
+   same array as 'in', see the description above). With 'fromkeys!=0',
+   the reverse conversion is done (the keys in 'keys' will be converted
+   back to values in 'in'). 'NANBITS' is only relevant for floating point
+   types: it is the bit pattern of positive infinity, any value larger
+   than it (after removing the sign bit) is a NaN. When 'canonzero' is
+   non-zero, negative zero will be given the same key as zero. */
+#define STATISTICS_RADIX_KEY(UT, ISSIGNED, ISFLOAT, NANBITS) {          \
+    UT *a=in, *k=keys, b;                                               \
+    UT sb=(UT)1<<(8*sizeof(UT)-1), ones=(UT)(-1), inf=NANBITS;          \
+    UT flip = decreasing ? ones : 0;                                    \
+    if(fromkeys)                                                        \
+      for(i=0;i<size;++i)                                               \
+        {                                                               \
+          b=k[i];                                                       \
+          if(ISFLOAT)                                                   \
+            a[i] = ( b==ones                                            \
+                     ? (inf | (inf>>1))  /* A quiet NaN. */             \
+                     : ( (b^=flip) & sb ? b^sb : ~b ) );                \
+          else a[i] = ISSIGNED ? (b^flip)^sb : b^flip;                  \
+        }                                                               \
+    else                                                                \
+      for(i=0;i<size;++i)                                               \
+        {                                                               \
+          b=a[i];                                                       \
+          if(ISFLOAT)                                                   \
+            {                                                           \
+              if( (b & ~sb) > inf ) k[i]=ones;                          \
+              else                                                      \
+                {                                                       \
+                  if(canonzero && b==sb) b=0;                           \
+                  k[i] = ( b & sb ? ~b : b|sb ) ^ flip;                 \
+                }                                                       \
+            }                                                           \
+          else k[i] = ISSIGNED ? (b^sb)^flip : b^flip;                  \
+        }                                                               \
+  }
+
+static void
+statistics_radix_keys(void *in, void *keys, uint8_t type, size_t size,
+                      int decreasing, int canonzero, int fromkeys)
+{
+  size_t i;
+  switch(type)
+    {
+    case GAL_TYPE_UINT8:
+      STATISTICS_RADIX_KEY(uint8_t,  0, 0, 0);                        break;
+    case GAL_TYPE_INT8:
+      STATISTICS_RADIX_KEY(uint8_t,  1, 0, 0);                        break;
+    case GAL_TYPE_UINT16:
+      STATISTICS_RADIX_KEY(uint16_t, 0, 0, 0);                        break;
+    case GAL_TYPE_INT16:
+      STATISTICS_RADIX_KEY(uint16_t, 1, 0, 0);                        break;
+    case GAL_TYPE_UINT32:
+      STATISTICS_RADIX_KEY(uint32_t, 0, 0, 0);                        break;
+    case GAL_TYPE_INT32:
+      STATISTICS_RADIX_KEY(uint32_t, 1, 0, 0);                        break;
+    case GAL_TYPE_UINT64:
+      STATISTICS_RADIX_KEY(uint64_t, 0, 0, 0);                        break;
+    case GAL_TYPE_INT64:
+      STATISTICS_RADIX_KEY(uint64_t, 1, 0, 0);                        break;
+    case GAL_TYPE_FLOAT32:
+      STATISTICS_RADIX_KEY(uint32_t, 1, 1, 0x7f800000);               break;
+    case GAL_TYPE_FLOAT64:
+      STATISTICS_RADIX_KEY(uint64_t, 1, 1, 0x7ff0000000000000);       break;
+    default:
+      error(EXIT_FAILURE, 0, "%s: type code %d not recognized",
+            __func__, type);
+    }
+}
+
+
+
+
+
 /* This function is ignorant to blank values, if you want to make sure
-   there is no blank values, you can call 'gal_blank_remove' first. */
+   there is no blank values, you can call 'gal_blank_remove' first. For
+   small arrays, 'qsort' is used, otherwise the array is sorted with a
+   radix sort (see above). */
 #define STATISTICS_SORT(QSORT_F) {                                      \
     qsort(input->array, input->size, gal_type_sizeof(input->type), QSORT_F); \
   }
 void
-gal_statistics_sort_increasing(gal_data_t *input)
+gal_statistics_sort(gal_data_t *input, int decreasing, size_t numthreads)
 {
-  /* Do the sorting. */
-  if(input->size)
-    switch(input->type)
-      {
-      case GAL_TYPE_UINT8:
-        STATISTICS_SORT(gal_qsort_uint8_i);    break;
-      case GAL_TYPE_INT8:
-        STATISTICS_SORT(gal_qsort_int8_i);     break;
-      case GAL_TYPE_UINT16:
-        STATISTICS_SORT(gal_qsort_uint16_i);   break;
-      case GAL_TYPE_INT16:
-        STATISTICS_SORT(gal_qsort_int16_i);    break;
-      case GAL_TYPE_UINT32:
-        STATISTICS_SORT(gal_qsort_uint32_i);   break;
-      case GAL_TYPE_INT32:
-        STATISTICS_SORT(gal_qsort_int32_i);    break;
-      case GAL_TYPE_UINT64:
-        STATISTICS_SORT(gal_qsort_uint64_i);   break;
-      case GAL_TYPE_INT64:
-        STATISTICS_SORT(gal_qsort_int64_i);    break;
-      case GAL_TYPE_FLOAT32:
-        STATISTICS_SORT(gal_qsort_float32_i);  break;
-      case GAL_TYPE_FLOAT64:
-        STATISTICS_SORT(gal_qsort_float64_i);  break;
-      default:
-        error(EXIT_FAILURE, 0, "%s: type code %d not recognized",
-              __func__, input->type);
-      }
+  struct statistics_radix_params p={0};
+
+  /* Large arrays: use radix sort. The keys are written in the input array
+     (in-place). */
+  if(input->size>=STATISTICS_RADIX_MIN)
+    {
+      p.size=input->size;
+      p.keys=input->array;
+      p.width=gal_type_sizeof(input->type);
+      statistics_radix_keys(input->array, input->array, input->type,
+                            input->size, decreasing, 0, 0);
+      statistics_radix_sort(&p, numthreads, input->minmapsize,
+                            input->quietmmap);
+      statistics_radix_keys(input->array, input->array, input->type,
+                            input->size, decreasing, 0, 1);
+    }
+
+  /* Small arrays: use 'qsort'. */
+  else if(input->size)
+    {
+      if(decreasing)
+        switch(input->type)
+          {
+          case GAL_TYPE_UINT8:   STATISTICS_SORT(gal_qsort_uint8_d);   break;
+          case GAL_TYPE_INT8:    STATISTICS_SORT(gal_qsort_int8_d);    break;
+          case GAL_TYPE_UINT16:  STATISTICS_SORT(gal_qsort_uint16_d);  break;
+          case GAL_TYPE_INT16:   STATISTICS_SORT(gal_qsort_int16_d);   break;
+          case GAL_TYPE_UINT32:  STATISTICS_SORT(gal_qsort_uint32_d);  break;
+          case GAL_TYPE_INT32:   STATISTICS_SORT(gal_qsort_int32_d);   break;
+          case GAL_TYPE_UINT64:  STATISTICS_SORT(gal_qsort_uint64_d);  break;
+          case GAL_TYPE_INT64:   STATISTICS_SORT(gal_qsort_int64_d);   break;
+          case GAL_TYPE_FLOAT32: STATISTICS_SORT(gal_qsort_float32_d); break;
+          case GAL_TYPE_FLOAT64: STATISTICS_SORT(gal_qsort_float64_d); break;
+          default:
+            error(EXIT_FAILURE, 0, "%s: type code %d not recognized",
+                  __func__, input->type);
+          }
+      else
+        switch(input->type)
+          {
+          case GAL_TYPE_UINT8:   STATISTICS_SORT(gal_qsort_uint8_i);   break;
+          case GAL_TYPE_INT8:    STATISTICS_SORT(gal_qsort_int8_i);    break;
+          case GAL_TYPE_UINT16:  STATISTICS_SORT(gal_qsort_uint16_i);  break;
+          case GAL_TYPE_INT16:   STATISTICS_SORT(gal_qsort_int16_i);   break;
+          case GAL_TYPE_UINT32:  STATISTICS_SORT(gal_qsort_uint32_i);  break;
+          case GAL_TYPE_INT32:   STATISTICS_SORT(gal_qsort_int32_i);   break;
+          case GAL_TYPE_UINT64:  STATISTICS_SORT(gal_qsort_uint64_i);  break;
+          case GAL_TYPE_INT64:   STATISTICS_SORT(gal_qsort_int64_i);   break;
+          case GAL_TYPE_FLOAT32: STATISTICS_SORT(gal_qsort_float32_i); break;
+          case GAL_TYPE_FLOAT64: STATISTICS_SORT(gal_qsort_float64_i); break;
+          default:
+            error(EXIT_FAILURE, 0, "%s: type code %d not recognized",
+                  __func__, input->type);
+          }
+    }
 
   /* Set the flags. */
   input->flag |=  GAL_DATA_FLAG_SORT_CH;
-  input->flag |=  GAL_DATA_FLAG_SORTED_I;
-  input->flag &= ~GAL_DATA_FLAG_SORTED_D;
+  if(decreasing)
+    {
+      input->flag |=  GAL_DATA_FLAG_SORTED_D;
+      input->flag &= ~GAL_DATA_FLAG_SORTED_I;
+    }
+  else
+    {
+      input->flag |=  GAL_DATA_FLAG_SORTED_I;
+      input->flag &= ~GAL_DATA_FLAG_SORTED_D;
+    }
+}
+
+
+
+
+
+void
+gal_statistics_sort_increasing(gal_data_t *input)
+{
+  gal_statistics_sort(input, 0, 1);
 }
 
 
@@ -1536,39 +1828,50 @@ gal_statistics_sort_increasing(gal_data_t *input)
 void
 gal_statistics_sort_decreasing(gal_data_t *input)
 {
-  /* Do the sorting. */
-  if(input->size)
-    switch(input->type)
-      {
-      case GAL_TYPE_UINT8:
-        STATISTICS_SORT(gal_qsort_uint8_d);    break;
-      case GAL_TYPE_INT8:
-        STATISTICS_SORT(gal_qsort_int8_d);     break;
-      case GAL_TYPE_UINT16:
-        STATISTICS_SORT(gal_qsort_uint16_d);   break;
-      case GAL_TYPE_INT16:
-        STATISTICS_SORT(gal_qsort_int16_d);    break;
-      case GAL_TYPE_UINT32:
-        STATISTICS_SORT(gal_qsort_uint32_d);   break;
-      case GAL_TYPE_INT32:
-        STATISTICS_SORT(gal_qsort_int32_d);    break;
-      case GAL_TYPE_UINT64:
-        STATISTICS_SORT(gal_qsort_uint64_d);   break;
-      case GAL_TYPE_INT64:
-        STATISTICS_SORT(gal_qsort_int64_d);    break;
-      case GAL_TYPE_FLOAT32:
-        STATISTICS_SORT(gal_qsort_float32_d);  break;
-      case GAL_TYPE_FLOAT64:
-        STATISTICS_SORT(gal_qsort_float64_d);  break;
-      default:
-        error(EXIT_FAILURE, 0, "%s: type code %d not recognized",
-              __func__, input->type);
-      }
+  gal_statistics_sort(input, 1, 1);
+}
 
-  /* Set the flags. */
-  input->flag |=  GAL_DATA_FLAG_SORT_CH;
-  input->flag |=  GAL_DATA_FLAG_SORTED_D;
-  input->flag &= ~GAL_DATA_FLAG_SORTED_I;
+
+
+
+
+/* Write the indexs that sort 'input' into the already allocated 'index'
+   array (with 'input->size' elements). The input is not modified. Since
+   the radix sort is stable, elements with equal values will keep their
+   original order (like the blank values at the end). */
+void
+gal_statistics_sort_index(gal_data_t *input, size_t *index,
+                          int decreasing, size_t numthreads)
+{
+  size_t i;
+  char *mmapname=NULL;
+  struct statistics_radix_params p={0};
+
+  /* Sanity check. */
+  if(input!=gal_tile_block(input))
+    error(EXIT_FAILURE, 0, "%s: tiles are not supported", __func__);
+
+  /* Initialize the indexs. */
+  for(i=0;i<input->size;++i) index[i]=i;
+
+  /* Build the keys (negative zero is converted to zero so it is not
+     placed before positive zeros) and sort them with the indexs. */
+  p.inds=index;
+  p.size=input->size;
+  p.width=gal_type_sizeof(input->type);
+  if(p.size==0) return;
+  p.keys=gal_pointer_allocate_ram_or_mmap(GAL_TYPE_UINT8, p.size*p.width,
+                                          0, input->minmapsize, &mmapname,
+                                          input->quietmmap, __func__,
+                                          "p.keys");
+  statistics_radix_keys(input->array, p.keys, input->type, input->size,
+                        decreasing, 1, 0);
+  statistics_radix_sort(&p, numthreads, input->minmapsize,
+                        input->quietmmap);
+
+  /* Clean up. */
+  if(mmapname) gal_pointer_mmap_free(&mmapname, input->quietmmap);
+  else free(p.keys);
 }
 
 
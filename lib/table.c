@@ -463,6 +463,88 @@ gal_table_list_of_indexs(gal_list_str_t *cols, gal_data_t *allcols,
 
 
 
+/* Make sure the requested rows are within a table of 'numrows' rows (the
+   same checks as 'gal_fits_tab_read_rows'): when 'rowids' is given, it
+   should have a 'size_t' type and be strictly increasing. */
+static void
+table_check_rows(size_t numrows, size_t rowstart, size_t rownum,
+                 gal_data_t *rowids)
+{
+  size_t i, *r;
+
+  if(rowids)
+    {
+      if(rowids->type!=GAL_TYPE_SIZE_T)
+        error(EXIT_FAILURE, 0, "%s: 'rowids' should have a 'size_t' type",
+              __func__);
+      r=rowids->array;
+      for(i=0;i<rowids->size;++i)
+        if( r[i]>=numrows || (i && r[i]<=r[i-1]) )
+          error(EXIT_FAILURE, 0, "%s: the row numbers in 'rowids' should "
+                "be in increasing order and smaller than the number of "
+                "rows (%zu), but element %zu is %zu", __func__, numrows,
+                i, r[i]);
+    }
+  else if( rowstart>numrows || rownum>numrows-rowstart )
+    error(EXIT_FAILURE, 0, "%s: %zu rows starting from row %zu are "
+          "requested, but the table only has %zu rows", __func__, rownum,
+          rowstart, numrows);
+}
+
+
+
+
+
+/* Only keep the given rows of the columns (the rows are moved to the top
+   of each column). When 'rowids==NULL', the 'rownum' rows that start from
+   'rowstart' are kept. Otherwise, the 'nrowids' rows in 'rowids' (that
+   should be sorted in increasing order) are kept. */
+static void
+table_keep_rows(gal_data_t *cols, size_t rowstart, size_t rownum,
+                size_t *rowids, size_t nrowids)
+{
+  char **strarr;
+  gal_data_t *col;
+  size_t i, j, rowsize, nkeep = rowids ? nrowids : rownum;
+
+  for(col=cols; col!=NULL; col=col->next)
+    {
+      /* Empty columns don't need any change. */
+      if(col->size==0 || col->array==NULL) continue;
+
+      /* For strings, free the rows that are not kept (the pointers of
+         the kept rows will be moved like other types). */
+      if(col->type==GAL_TYPE_STRING)
+        {
+          j=0;
+          strarr=col->array;
+          for(i=0;i<col->dsize[0];++i)
+            {
+              if( rowids
+                  ? (j<nrowids && rowids[j]==i)
+                  : (i>=rowstart && i<rowstart+rownum) )
+                ++j;
+              else { free(strarr[i]); strarr[i]=NULL; }
+            }
+        }
+
+      /* Move the kept rows to the top of the column. */
+      rowsize=gal_type_sizeof(col->type) * (col->size/col->dsize[0]);
+      for(i=0;i<nkeep;++i)
+        if( (j = rowids ? rowids[i] : rowstart+i) != i )
+          memcpy( (char *)(col->array) + i*rowsize,
+                  (char *)(col->array) + j*rowsize, rowsize );
+
+      /* Correct the sizes. */
+      col->size = nkeep * (col->size/col->dsize[0]);
+      col->dsize[0] = nkeep;
+    }
+}
+
+
+
+
+
 /* Read the specified columns in a table (named 'filename') into a linked
    list of data structures. If the file is FITS, then 'hdu' will also be
    used, otherwise, 'hdu' is ignored. The information to search for columns
@@ -478,12 +560,17 @@ gal_table_list_of_indexs(gal_list_str_t *cols, gal_data_t *allcols,
    columns, in this case, the order of output columns that correspond to
    that one input, are in order of the table (which column was read first).
    So the first requested column is the first popped data structure and so
-   on. */
+   on.
+
+   Only the requested rows are read (see 'gal_fits_tab_read_rows'). Plain
+   text tables have to be fully parsed in any case, so the other rows are
+   removed after reading. */
 gal_data_t *
-gal_table_read(char *filename, char *hdu, gal_list_str_t *lines,
-               gal_list_str_t *cols, int searchin, int ignorecase,
-               size_t numthreads, size_t minmapsize, int quietmmap,
-               size_t *colmatch)
+gal_table_read_rows(char *filename, char *hdu, gal_list_str_t *lines,
+                    gal_list_str_t *cols, int searchin, int ignorecase,
+                    size_t rowstart, size_t rownum, gal_data_t *rowids,
+                    size_t numthreads, size_t minmapsize, int quietmmap,
+                    size_t *colmatch)
 {
   int tableformat;
   gal_list_sizet_t *indexll;
@@ -497,6 +584,10 @@ gal_table_read(char *filename, char *hdu, gal_list_str_t *lines,
   /* If there was no actual data in the file, then return NULL. */
   if(allcols==NULL) return NULL;
 
+  /* A blank 'rownum' is used to read all the rows after 'rowstart'. */
+  if(rowids==NULL && rownum==GAL_BLANK_SIZE_T)
+    rownum = rowstart<numrows ? numrows-rowstart : 0;
+
   /* Get the list of indexs in the same order as the input list. */
   indexll=gal_table_list_of_indexs(cols, allcols, numcols, searchin,
                                    ignorecase, filename, hdu, colmatch);
@@ -507,14 +598,21 @@ gal_table_read(char *filename, char *hdu, gal_list_str_t *lines,
   switch(tableformat)
     {
     case GAL_TABLE_FORMAT_TXT:
-      out=gal_txt_table_read(filename, lines, numrows, allcols, indexll,
-                             minmapsize, quietmmap);
+      table_check_rows(numrows, rowstart, rownum, rowids);
+      out=gal_txt_table_read_threads(filename, lines, numrows, allcols,
+                                     indexll, numthreads, minmapsize,
+                                     quietmmap);
+      if( rowids || rowstart || rownum!=numrows )
+        table_keep_rows(out, rowstart, rownum,
+                        rowids ? rowids->array : NULL,
+                        rowids ? rowids->size : 0);
       break;
 
     case GAL_TABLE_FORMAT_AFITS:
     case GAL_TABLE_FORMAT_BFITS:
-      out=gal_fits_tab_read(filename, hdu, numrows, allcols, indexll,
-                            numthreads, minmapsize, quietmmap);
+      out=gal_fits_tab_read_rows(filename, hdu, numrows, allcols, indexll,
+                                 rowstart, rownum, rowids, numthreads,
+                                 minmapsize, quietmmap);
       break;
 
     default:
@@ -536,6 +634,148 @@ gal_table_read(char *filename, char *hdu, gal_list_str_t *lines,
 
 
 
+/* Read all the rows of the requested columns. */
+gal_data_t *
+gal_table_read(char *filename, char *hdu, gal_list_str_t *lines,
+               gal_list_str_t *cols, int searchin, int ignorecase,
+               size_t numthreads, size_t minmapsize, int quietmmap,
+               size_t *colmatch)
+{
+  return gal_table_read_rows(filename, hdu, lines, cols, searchin,
+                             ignorecase, 0, GAL_BLANK_SIZE_T, NULL,
+                             numthreads, minmapsize, quietmmap, colmatch);
+}
+
+
+
+
+
+/* Prepare for reading the requested columns of a FITS table in chunks of
+   'chunksize' rows (each chunk is returned by 'gal_table_iter_next'). The
+   rows to read are defined like 'gal_table_read_rows'. When 'rowids' is
+   given, it is used directly (not copied), so it should not be freed
+   before the iterator. */
+gal_table_iter_t *
+gal_table_iter_init(char *filename, char *hdu, gal_list_str_t *cols,
+                    int searchin, int ignorecase, size_t rowstart,
+                    size_t rownum, gal_data_t *rowids, size_t chunksize,
+                    size_t numthreads, size_t minmapsize, int quietmmap,
+                    size_t *colmatch)
+{
+  int tableformat;
+  gal_table_iter_t *iter;
+
+  /* Allocate the iterator. */
+  errno=0;
+  iter=malloc(sizeof *iter);
+  if(iter==NULL)
+    error(EXIT_FAILURE, errno, "%s: %zu bytes for 'iter'", __func__,
+          sizeof *iter);
+
+  /* Get the information of all the columns. */
+  iter->allcols=gal_table_info(filename, hdu, NULL, &iter->numcols,
+                               &iter->numrows, &tableformat);
+  if( tableformat!=GAL_TABLE_FORMAT_AFITS
+      && tableformat!=GAL_TABLE_FORMAT_BFITS )
+    error(EXIT_FAILURE, 0, "%s: only FITS tables can be read in chunks, "
+          "but '%s' is a plain-text table", __func__, filename);
+  if(chunksize==0)
+    error(EXIT_FAILURE, 0, "%s: 'chunksize' must be larger than zero",
+          __func__);
+
+  /* Set the rows to read. */
+  if(rowids==NULL)
+    {
+      if(rownum==GAL_BLANK_SIZE_T)
+        rownum = rowstart<iter->numrows ? iter->numrows-rowstart : 0;
+      if( rowstart>iter->numrows || rownum>iter->numrows-rowstart )
+        error(EXIT_FAILURE, 0, "%s: %zu rows starting from row %zu are "
+              "requested, but the table only has %zu rows", __func__,
+              rownum, rowstart, iter->numrows);
+    }
+
+  /* Find the indexs of the requested columns. */
+  iter->indexll=gal_table_list_of_indexs(cols, iter->allcols, iter->numcols,
+                                         searchin, ignorecase, filename,
+                                         hdu, colmatch);
+
+  /* Set the remaining parameters. */
+  iter->next       = 0;
+  iter->nchunk     = 0;
+  iter->hdu        = hdu;
+  iter->rowids     = rowids;
+  iter->rownum     = rowids ? rowids->size : rownum;
+  iter->rowstart   = rowids ? 0 : rowstart;
+  iter->filename   = filename;
+  iter->chunksize  = chunksize;
+  iter->quietmmap  = quietmmap;
+  iter->numthreads = numthreads;
+  iter->minmapsize = minmapsize;
+  return iter;
+}
+
+
+
+
+
+/* Read the next chunk of rows (as a list of columns). The first call will
+   always return a list (even if no rows are to be read, where the columns
+   will be empty), afterwards, NULL is returned when there are no more
+   rows to read. */
+gal_data_t *
+gal_table_iter_next(gal_table_iter_t *iter)
+{
+  gal_data_t *out, *ids=NULL;
+  size_t num, *rowids=iter->rowids ? iter->rowids->array : NULL;
+
+  /* See if there are any more rows to read. */
+  if(iter->nchunk && iter->next>=iter->rownum) return NULL;
+
+  /* Number of rows to read in this chunk. */
+  num = ( iter->rownum-iter->next < iter->chunksize
+          ? iter->rownum-iter->next
+          : iter->chunksize );
+
+  /* When only certain rows are desired, define a dataset over the row
+     numbers of this chunk (not allocating a new array). */
+  if(rowids)
+    ids=gal_data_alloc(rowids+iter->next, GAL_TYPE_SIZE_T, 1, &num, NULL,
+                       0, -1, 1, NULL, NULL, NULL);
+
+  /* Read the columns. */
+  out=gal_fits_tab_read_rows(iter->filename, iter->hdu, iter->numrows,
+                             iter->allcols, iter->indexll,
+                             iter->rowstart+iter->next, num, ids,
+                             iter->numthreads, iter->minmapsize,
+                             iter->quietmmap);
+
+  /* Clean up and return. */
+  if(ids) { ids->array=NULL; gal_data_free(ids); }
+  iter->next+=num;
+  ++iter->nchunk;
+  return out;
+}
+
+
+
+
+
+void
+gal_table_iter_free(gal_table_iter_t *iter)
+{
+  size_t i;
+  if(iter==NULL) return;
+  for(i=0;i<iter->numcols;++i)
+    gal_data_free_contents(&iter->allcols[i]);
+  free(iter->allcols);
+  gal_list_sizet_free(iter->indexll);
+  free(iter);
+}
+
+
+
+
+
 
 
 
@@ -595,6 +835,23 @@ void
 gal_table_write(gal_data_t *cols, struct gal_fits_list_key_t **keylist,
                 gal_list_str_t *comments, int tableformat, char *filename,
                 char *extname, uint8_t colinfoinstdout)
+{
+  gal_table_write_threads(cols, keylist, comments, tableformat, filename,
+                          extname, colinfoinstdout, 1);
+}
+
+
+
+
+
+/* Similar to 'gal_table_write', but large tables are prepared on
+   'numthreads' threads. */
+void
+gal_table_write_threads(gal_data_t *cols,
+                        struct gal_fits_list_key_t **keylist,
+                        gal_list_str_t *comments, int tableformat,
+                        char *filename, char *extname,
+                        uint8_t colinfoinstdout, size_t numthreads)
 {
   /* If a filename was given, then the tableformat is relevant and must be
      used. When the filename is empty, a text table must be printed on the
@@ -602,15 +859,36 @@ gal_table_write(gal_data_t *cols, struct gal_fits_list_key_t **keylist,
   if(filename)
     {
       if(gal_fits_name_is_fits(filename))
-        gal_fits_tab_write(cols, comments, tableformat, filename, extname,
-                           keylist);
+        gal_fits_tab_write_threads(cols, comments, tableformat, filename,
+                                   extname, keylist, numthreads);
       else
-        gal_txt_write(cols, keylist, comments, filename,
-                      colinfoinstdout, 0);
+        gal_txt_write_threads(cols, keylist, comments, filename,
+                              colinfoinstdout, 0, numthreads);
     }
   else
     /* Write to standard output. */
-    gal_txt_write(cols, keylist, comments, filename, colinfoinstdout, 0);
+    gal_txt_write_threads(cols, keylist, comments, filename,
+                          colinfoinstdout, 0, numthreads);
+}
+
+
+
+
+
+/* Append the rows in 'cols' to the end of the table that has already
+   been written into 'filename' (for example with 'gal_table_write'). The
+   rows are added to the table in the last HDU. Only FITS files are
+   supported: the widths of the columns in a plain-text table (and its
+   metadata) depend on the values of all the rows, so they can't be
+   written in parts. */
+void
+gal_table_write_append(gal_data_t *cols, char *filename, size_t numthreads)
+{
+  if(filename==NULL || gal_fits_name_is_fits(filename)==0)
+    error(EXIT_FAILURE, 0, "%s: rows can only be appended to a FITS "
+          "table, but '%s' is not a FITS file", __func__,
+          filename ? filename : "the standard output");
+  gal_fits_tab_append(cols, filename, numthreads);
 }
 
 
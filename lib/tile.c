@@ -22,6 +22,7 @@ along with Gnuastro. If not, see <http://www.gnu.org/licenses/>.
 **********************************************************************/
 #include <config.h>
 
+#include <math.h>
 #include <stdio.h>
 #include <errno.h>
 #include <error.h>
@@ -33,7 +34,6 @@ along with Gnuastro. If not, see <http://www.gnu.org/licenses/>.
 #include <gnuastro/blank.h>
 #include <gnuastro/threads.h>
 #include <gnuastro/pointer.h>
-#include <gnuastro/convolve.h>
 #include <gnuastro/dimension.h>
 #include <gnuastro/interpolate.h>
 #include <gnuastro/permutation.h>
@@ -584,6 +584,314 @@ gal_tile_block_blank_flag(gal_data_t *tile_ll, size_t numthreads)
 
 
 
+
+/***********************************************************************/
+/**************           Contiguous spans            ******************/
+/***********************************************************************/
+/* Call 'func' on every contiguous span (along the fastest dimension) of
+   'in'. When 'other' is not NULL, it is parsed at the same time: if it is
+   a fully allocated block, it must have the same size as 'in's block and
+   the span in 'other' starts at the same offset as 'in'. If it is a tile,
+   it must have the same size as 'in' and its own spans are used. */
+void
+gal_tile_span_parse(gal_data_t *in, gal_data_t *other,
+                    gal_tile_span_func_t func, void *params)
+{
+  char *ist, *ost=NULL;
+  size_t s_e_ind[2], row, numrows, span, ioffset;
+  size_t i_increment=0, num_i_inc=1, o_increment=0, num_o_inc=1;
+  gal_data_t *iblock=gal_tile_block(in);
+  gal_data_t *oblock=other ? gal_tile_block(other) : NULL;
+  size_t isize=gal_type_sizeof(iblock->type);
+  size_t osize=other ? gal_type_sizeof(oblock->type) : 0;
+
+  /* Sanity checks. */
+  if(in->size==0) return;
+  if(other)
+    {
+      if(other==oblock)
+        {
+          if( gal_dimension_is_different(iblock, oblock) )
+            error(EXIT_FAILURE, 0, "%s: when 'other' is a block, it must "
+                  "have the same size as the block of 'in', but they are "
+                  "not: %zu and %zu elements respectively", __func__,
+                  iblock->size, oblock->size);
+        }
+      else if( gal_dimension_is_different(in, other) )
+        error(EXIT_FAILURE, 0, "%s: when 'other' is a tile, it must have "
+              "the same size as 'in' (in all dimensions), but they are "
+              "not: %zu and %zu elements respectively", __func__,
+              in->size, other->size);
+    }
+
+  /* When both are contiguous, the whole dataset is one span. */
+  if(in==iblock && (other==NULL || other==oblock))
+    {
+      func(in->array, other ? other->array : NULL, in->size, params);
+      return;
+    }
+
+  /* Starting pointers. */
+  ist = ( in==iblock
+          ? in->array
+          : gal_tile_start_end_ind_inclusive(in, iblock, s_e_ind) );
+  if(other && other!=oblock)
+    ost=gal_tile_start_end_ind_inclusive(other, oblock, s_e_ind);
+
+  /* Go over the rows (the last dimension is contiguous). */
+  span=in->dsize[in->ndim-1];
+  numrows=in->size/span;
+  for(row=0;row<numrows;++row)
+    {
+      /* Offset of this span from the start of 'in's block. */
+      ioffset=(ist - (char *)(iblock->array))/isize + i_increment;
+
+      /* Call the function. */
+      func( (char *)(iblock->array) + ioffset*isize,
+            ( other
+              ? ( other==oblock
+                  ? (char *)(oblock->array) + ioffset*osize
+                  : ost + o_increment*osize )
+              : NULL ),
+            span, params );
+
+      /* Go to the next row. */
+      if(row<numrows-1)
+        {
+          i_increment += ( in==iblock
+                           ? span
+                           : gal_tile_block_increment(iblock, in->dsize,
+                                                      num_i_inc++, NULL) );
+          if(other && other!=oblock)
+            o_increment += gal_tile_block_increment(oblock, other->dsize,
+                                                    num_o_inc++, NULL);
+        }
+    }
+}
+
+
+
+
+
+/* For the reduction kernels. */
+struct tile_span_params
+{
+  uint8_t                   type;   /* Type of the input's block.         */
+  int                   hasblank;   /* If the input has blank values.     */
+  int                    dosumsq;   /* Also measure the sum of squares.   */
+  size_t                  number;   /* Number of non-blank elements.      */
+  double                     sum;   /* Sum of non-blank elements.         */
+  double                   sumsq;   /* Sum of squares.                    */
+  void                      *min;   /* Minimum (in the input's type).     */
+  void                      *max;   /* Maximum (in the input's type).     */
+};
+
+
+
+
+
+/* The kernels below are written as plain loops over a contiguous span
+   without branches in the loop body (a blank element is given a neutral
+   value with a conditional expression), so the compiler can vectorize
+   them. Note that for floating point types, the blank value is NaN, so
+   'v==v' is used to check for blanks. */
+#define TILE_SPAN_NUMBER(IT) {                                          \
+    IT b, *a=in;                                                        \
+    size_t j, n=0;                                                      \
+    gal_blank_write(&b, prm->type);                                     \
+    if(b==b) for(j=0;j<num;++j) n += a[j]!=b;                           \
+    else     for(j=0;j<num;++j) n += a[j]==a[j];                        \
+    prm->number+=n;                                                     \
+  }
+
+#define TILE_SPAN_SUMS(IT) {                                            \
+    IT b, *a=in;                                                        \
+    size_t j, n=0;                                                      \
+    double v, s=prm->sum, s2=prm->sumsq;                                \
+    gal_blank_write(&b, prm->type);                                     \
+    if(prm->hasblank)                                                   \
+      {                                                                 \
+        if(b==b)                                                        \
+          for(j=0;j<num;++j)                                            \
+            { v = a[j]!=b ? a[j] : 0; n += a[j]!=b; s+=v; s2+=v*v; }    \
+        else                                                            \
+          for(j=0;j<num;++j)                                            \
+            { v = a[j]==a[j] ? a[j] : 0; n += a[j]==a[j]; s+=v; s2+=v*v; } \
+      }                                                                 \
+    else                                                                \
+      {                                                                 \
+        n=num;                                                          \
+        if(prm->dosumsq) for(j=0;j<num;++j) { v=a[j]; s+=v; s2+=v*v; }  \
+        else             for(j=0;j<num;++j)   s+=a[j];                  \
+      }                                                                 \
+    prm->sum=s;                                                         \
+    prm->sumsq=s2;                                                      \
+    prm->number+=n;                                                     \
+  }
+
+#define TILE_SPAN_MINMAX(IT) {                                          \
+    IT b, *a=in, mn=*(IT *)(prm->min), mx=*(IT *)(prm->max);            \
+    size_t j, n=0;                                                      \
+    gal_blank_write(&b, prm->type);                                     \
+    if(prm->hasblank && b==b)                                           \
+      for(j=0;j<num;++j)                                                \
+        {                                                               \
+          mn = a[j]!=b && a[j]<mn ? a[j] : mn;                          \
+          mx = a[j]!=b && a[j]>mx ? a[j] : mx;                          \
+          n += a[j]!=b;                                                 \
+        }                                                               \
+    else                                                                \
+      {                                                                 \
+        /* A NaN will fail both comparisons. */                         \
+        for(j=0;j<num;++j)                                              \
+          {                                                             \
+            mn = a[j]<mn ? a[j] : mn;                                   \
+            mx = a[j]>mx ? a[j] : mx;                                   \
+          }                                                             \
+        if(prm->hasblank) for(j=0;j<num;++j) n += a[j]==a[j];           \
+        else              n=num;                                        \
+      }                                                                 \
+    *(IT *)(prm->min)=mn;                                               \
+    *(IT *)(prm->max)=mx;                                               \
+    prm->number+=n;                                                     \
+  }
+
+
+
+
+
+/* Select the kernel for the given type. */
+#define TILE_SPAN_TYPE(KERNEL) {                                        \
+    switch(prm->type)                                                   \
+      {                                                                 \
+      case GAL_TYPE_UINT8:   KERNEL(uint8_t);   break;                  \
+      case GAL_TYPE_INT8:    KERNEL(int8_t);    break;                  \
+      case GAL_TYPE_UINT16:  KERNEL(uint16_t);  break;                  \
+      case GAL_TYPE_INT16:   KERNEL(int16_t);   break;                  \
+      case GAL_TYPE_UINT32:  KERNEL(uint32_t);  break;                  \
+      case GAL_TYPE_INT32:   KERNEL(int32_t);   break;                  \
+      case GAL_TYPE_UINT64:  KERNEL(uint64_t);  break;                  \
+      case GAL_TYPE_INT64:   KERNEL(int64_t);   break;                  \
+      case GAL_TYPE_FLOAT32: KERNEL(float);     break;                  \
+      case GAL_TYPE_FLOAT64: KERNEL(double);    break;                  \
+      default:                                                          \
+        error(EXIT_FAILURE, 0, "%s: type code %d not recognized",       \
+              __func__, prm->type);                                     \
+      }                                                                 \
+  }
+
+static void
+tile_span_number(void *in, void *other, size_t num, void *params)
+{
+  struct tile_span_params *prm=(struct tile_span_params *)params;
+  TILE_SPAN_TYPE(TILE_SPAN_NUMBER);
+}
+
+static void
+tile_span_sums(void *in, void *other, size_t num, void *params)
+{
+  struct tile_span_params *prm=(struct tile_span_params *)params;
+  TILE_SPAN_TYPE(TILE_SPAN_SUMS);
+}
+
+static void
+tile_span_minmax(void *in, void *other, size_t num, void *params)
+{
+  struct tile_span_params *prm=(struct tile_span_params *)params;
+  TILE_SPAN_TYPE(TILE_SPAN_MINMAX);
+}
+
+
+
+
+
+/* Number of non-blank elements in the tile (or block). */
+size_t
+gal_tile_span_number(gal_data_t *in)
+{
+  struct tile_span_params prm={0};
+
+  /* If there are no blank values, we don't need to parse the data. */
+  if( gal_blank_present(in, 0)==0 ) return in->size;
+
+  /* Parse the spans. */
+  prm.type=gal_tile_block(in)->type;
+  gal_tile_span_parse(in, NULL, tile_span_number, &prm);
+  return prm.number;
+}
+
+
+
+
+
+/* Sum (and sum of squares if 'sumsq!=NULL') of the non-blank elements in
+   the tile (or block). The number of non-blank elements is returned. */
+size_t
+gal_tile_span_sums(gal_data_t *in, double *sum, double *sumsq)
+{
+  struct tile_span_params prm={0};
+
+  /* Parse the spans. */
+  prm.dosumsq=sumsq!=NULL;
+  prm.hasblank=gal_blank_present(in, 0);
+  prm.type=gal_tile_block(in)->type;
+  gal_tile_span_parse(in, NULL, tile_span_sums, &prm);
+
+  /* Write the outputs. */
+  if(sum)   *sum=prm.sum;
+  if(sumsq) *sumsq=prm.sumsq;
+  return prm.number;
+}
+
+
+
+
+
+/* Minimum and maximum of the non-blank elements in the tile (or block),
+   they are written in the space that 'min' and 'max' point to (in the
+   type of the input). If there are no non-blank elements, they will be
+   the maximum and minimum of the type respectively. The number of
+   non-blank elements is returned. */
+size_t
+gal_tile_span_minmax(gal_data_t *in, void *min, void *max)
+{
+  struct tile_span_params prm={0};
+  union { int64_t i; uint64_t u; double d; } mn, mx;  /* Aligned for all.*/
+
+  /* Initialize the minimum and maximum (when the caller doesn't need one
+     of them, the local space is used: it is large enough and aligned for
+     all the numeric types). */
+  prm.type=gal_tile_block(in)->type;
+  prm.min = min ? min : (void *)&mn;
+  prm.max = max ? max : (void *)&mx;
+  gal_type_max(prm.type, prm.min);
+  gal_type_min(prm.type, prm.max);
+
+  /* Parse the spans. */
+  prm.hasblank=gal_blank_present(in, 0);
+  gal_tile_span_parse(in, NULL, tile_span_minmax, &prm);
+  return prm.number;
+}
+
+
+
+
+
+
+
+
+
+
+
+
+
+
+
+
+
+
+
+
 
 /***********************************************************************/
 /**************           Tile full dataset         ********************/
@@ -1100,17 +1408,18 @@ gal_tile_full_permutation(struct gal_tile_two_layer_params *tl)
 
 
 
-/* Write one value for each tile into a file.
+/* Prepare the dataset that should be written for one value for each tile
+   (see 'gal_tile_full_values_write'). The output may be 'tilevalues'
+   itself, so the caller should only free it when it is different.
 
    IMPORTANT: it is assumed that the values are in the same order as the
    tiles.
 
                       tile[i]  -->   tilevalues[i]                       */
-void
-gal_tile_full_values_write(gal_data_t *tilevalues,
-                           struct gal_tile_two_layer_params *tl,
-                           int withblank, char *filename,
-                           gal_fits_list_key_t *keys, char *program_string)
+gal_data_t *
+gal_tile_full_values_for_write(gal_data_t *tilevalues,
+                               struct gal_tile_two_layer_params *tl,
+                               int withblank)
 {
   gal_data_t *disp;
 
@@ -1137,6 +1446,29 @@ gal_tile_full_values_write(gal_data_t *tilevalues,
     disp=gal_tile_block_write_const_value(tilevalues, tl->tiles,
                                           withblank, 0);
 
+  /* Return the dataset to write. */
+  return disp;
+}
+
+
+
+
+
+/* Write one value for each tile into a file.
+
+   IMPORTANT: it is assumed that the values are in the same order as the
+   tiles.
+
+                      tile[i]  -->   tilevalues[i]                       */
+void
+gal_tile_full_values_write(gal_data_t *tilevalues,
+                           struct gal_tile_two_layer_params *tl,
+                           int withblank, char *filename,
+                           gal_fits_list_key_t *keys, char *program_string)
+{
+  gal_data_t *disp=gal_tile_full_values_for_write(tilevalues, tl,
+                                                  withblank);
+
   /* Write the array as a file and then clean up (if necessary). */
   gal_fits_img_write(disp, filename, keys, program_string);
   if(disp!=tilevalues) gal_data_free(disp);
@@ -1146,16 +1478,94 @@ gal_tile_full_values_write(gal_data_t *tilevalues,
 
 
 
-/* Smooth the given values with a flat kernel of the given width. */
+/* Parameters for the separable running-sum smoothing. */
+struct tile_smooth_params
+{
+  size_t                      ndim;  /* Number of dimensions.            */
+  size_t                       dim;  /* Dimension of this pass.          */
+  size_t                      half;  /* Half of the smoothing width.     */
+  size_t                    *hdsize;  /* Size of each host (channel/all). */
+  size_t                  hostsize;  /* Number of elements in each host. */
+  size_t              linesperhost;  /* Lines along 'dim' in each host.  */
+  double                     *isum;  /* Input sum of (non-NaN) values.   */
+  double                     *inum;  /* Input number of non-NaN values.  */
+  double                     *osum;  /* Output sum of values.            */
+  double                     *onum;  /* Output number of values.         */
+};
+
+
+
+
+
+/* Running sum (over the given half-width) of the sum and number of
+   non-blank values along one dimension. Every line is independent, so
+   each thread is given a set of lines. */
+static void *
+tile_full_values_smooth_on_thread(void *in_prm)
+{
+  struct gal_threads_params *tprm=(struct gal_threads_params *)in_prm;
+  struct tile_smooth_params *prm=(struct tile_smooth_params *)tprm->params;
+
+  double s, c;
+  size_t i, j, d, n, line, host, base, stride=1, h=prm->half;
+  double *isum=prm->isum, *inum=prm->inum, *osum=prm->osum, *onum=prm->onum;
+
+  /* Distance between two consecutive elements along this dimension. */
+  for(d=prm->dim+1; d<prm->ndim; ++d) stride *= prm->hdsize[d];
+  n=prm->hdsize[prm->dim];
+
+  /* Go over all the lines given to this thread. */
+  for(i=0; tprm->indexs[i] != GAL_BLANK_SIZE_T; ++i)
+    {
+      /* Index of the first element in this line. */
+      host = tprm->indexs[i] / prm->linesperhost;
+      line = tprm->indexs[i] % prm->linesperhost;
+      base = ( host * prm->hostsize
+               + (line / stride) * n * stride + line % stride );
+
+      /* Initial window (for the first element of the line). */
+      s=c=0.0;
+      for(j=0; j<=h && j<n; ++j)
+        { s+=isum[base+j*stride]; c+=inum[base+j*stride]; }
+
+      /* Slide the window over the line. */
+      for(j=0;j<n;++j)
+        {
+          osum[base+j*stride]=s;
+          onum[base+j*stride]=c;
+          if(j+h+1<n)
+            { s+=isum[base+(j+h+1)*stride]; c+=inum[base+(j+h+1)*stride]; }
+          if(j>=h)
+            { s-=isum[base+(j-h)*stride];   c-=inum[base+(j-h)*stride];   }
+        }
+    }
+
+  /* Wait for all the other threads to finish and return. */
+  if(tprm->b) pthread_barrier_wait(tprm->b);
+  return NULL;
+}
+
+
+
+
+
+/* Smooth the given values with a flat kernel of the given width. The
+   smoothed value of each element is the mean of the non-blank values
+   within the box around it (cut at the edges of its channel, or of the
+   whole grid when 'tl->workoverch' is set). Blank elements remain
+   blank. Since the box is separable, its sum (and the number of non-blank
+   elements in it) are found with a running sum along each dimension, so
+   the cost of each element is independent of 'width'. */
 gal_data_t *
 gal_tile_full_values_smooth(gal_data_t *tilevalues,
                             struct gal_tile_two_layer_params *tl,
                             size_t width, size_t numthreads)
 {
-  size_t *kdsize, knum, i;
-  gal_data_t *kernel, *smoothed;
-  struct gal_tile_two_layer_params ttl={0};
-  int permute=tl->ndim>1 && tl->totchannels>1;
+  float *in, *o;
+  double *tmp, *sum, *num;
+  gal_data_t *input, *smoothed;
+  struct tile_smooth_params prm;
+  size_t i, d, numhosts, *perm=NULL, size=tilevalues->size;
 
 
   /* Check if the width is odd. */
@@ -1164,50 +1574,87 @@ gal_tile_full_values_smooth(gal_data_t *tilevalues,
           "an odd number", __func__, width);
 
 
-  /* Prepare the kernel size along every dimension. */
-  kdsize=gal_pointer_allocate(GAL_TYPE_SIZE_T, tl->ndim, 0, __func__,
-                              "kdsize");
-  for(i=0;i<tl->ndim;++i) kdsize[i]=width;
-
-
-  /* Make the kernel. */
-  kernel=gal_data_alloc(NULL, GAL_TYPE_FLOAT32, tilevalues->ndim,
-                        kdsize, NULL, 0, -1, 1, NULL, NULL, NULL);
-  knum=gal_dimension_total_size(tl->ndim, kernel->dsize);
-  for(i=0;i<knum;++i) ((float *)(kernel->array))[i]=1/((double)knum);
-
-  /* Permute (if necessary). */
-  if(permute)
+  /* Set the hosts: when the channels are to be treated separately, each
+     channel is one host and the values of each channel are already
+     contiguous in memory. Otherwise, the whole grid is one host and we
+     need the permutation to read and write the values in their spatial
+     order (it is not applied on the input). */
+  if(tl->workoverch || tl->totchannels==1)
     {
-      gal_tile_full_permutation(tl);
-      gal_permutation_apply(tilevalues, tl->permutation);
+      numhosts=1;
+      prm.hdsize=tilevalues->dsize;
+      if(tl->ndim>1 && tl->totchannels>1)
+        { gal_tile_full_permutation(tl); perm=tl->permutation; }
     }
-
-  /* Do the smoothing. */
-  if(tl->workoverch)
-    smoothed=gal_convolve_spatial(tilevalues, kernel, numthreads, 1, 1);
   else
     {
-      /* Create the tile structure. */
-      ttl.tilesize=tl->numtilesinch;
-      ttl.numchannels=tl->numchannels;
-      gal_tile_full_sanity_check("IMPOSSIBLE", "IMP_HDU", tilevalues, &ttl);
-      gal_tile_full_two_layers(tilevalues, &ttl);
-
-      /* Do the convolution separately on each channel. */
-      smoothed=gal_convolve_spatial(ttl.tiles, kernel, numthreads, 1, 0);
-
-      /* Clean up. */
-      ttl.tilesize=ttl.numchannels=NULL;
-      gal_tile_full_free_contents(&ttl);
+      numhosts=tl->totchannels;
+      prm.hdsize=tl->numtilesinch;
+    }
+  prm.ndim=tl->ndim;
+  prm.half=width/2;
+  prm.hostsize=size/numhosts;
+
+
+  /* Allocate the output and the sum and number arrays (two of each, to
+     use alternatively as input and output of each dimension's pass). */
+  input = ( tilevalues->type==GAL_TYPE_FLOAT32
+            ? tilevalues
+            : gal_data_copy_to_new_type(tilevalues, GAL_TYPE_FLOAT32) );
+  smoothed=gal_data_alloc(NULL, GAL_TYPE_FLOAT32, input->ndim, input->dsize,
+                          input->wcs, 0, input->minmapsize,
+                          input->quietmmap, NULL, input->unit, NULL);
+  smoothed->flag = ( input->flag
+                     | ( GAL_DATA_FLAG_BLANK_CH | GAL_DATA_FLAG_HASBLANK ) );
+  prm.isum=gal_pointer_allocate(GAL_TYPE_FLOAT64, size, 0, __func__,
+                                "prm.isum");
+  prm.inum=gal_pointer_allocate(GAL_TYPE_FLOAT64, size, 0, __func__,
+                                "prm.inum");
+  prm.osum=gal_pointer_allocate(GAL_TYPE_FLOAT64, size, 0, __func__,
+                                "prm.osum");
+  prm.onum=gal_pointer_allocate(GAL_TYPE_FLOAT64, size, 0, __func__,
+                                "prm.onum");
+
+
+  /* Initialize the sums (blank values are ignored). */
+  in=input->array;
+  for(i=0;i<size;++i)
+    {
+      o = perm ? &in[perm[i]] : &in[i];
+      prm.isum[i] = isnan(*o) ? 0.0 : *o;
+      prm.inum[i] = !isnan(*o);
     }
 
-  /* Reverse the permutation. */
-  if(permute) gal_permutation_apply_inverse(smoothed, tl->permutation);
+
+  /* Do the running sum along each dimension. */
+  for(d=0;d<tl->ndim;++d)
+    {
+      prm.dim=d;
+      prm.linesperhost=prm.hostsize/prm.hdsize[d];
+      gal_threads_spin_off(tile_full_values_smooth_on_thread, &prm,
+                           numhosts*prm.linesperhost, numthreads,
+                           input->minmapsize, input->quietmmap);
+      tmp=prm.isum; prm.isum=prm.osum; prm.osum=tmp;
+      tmp=prm.inum; prm.inum=prm.onum; prm.onum=tmp;
+    }
+
+
+  /* Write the mean into the output (after the last pass, the results are
+     in 'isum' and 'inum'). */
+  sum=prm.isum;
+  num=prm.inum;
+  o=smoothed->array;
+  for(i=0;i<size;++i)
+    if(perm) o[perm[i]] = isnan(in[perm[i]]) ? NAN : sum[i]/num[i];
+    else     o[i]       = isnan(in[i])       ? NAN : sum[i]/num[i];
+
 
   /* Clean up and return; */
-  free(kdsize);
-  gal_data_free(kernel);
+  free(prm.isum);
+  free(prm.inum);
+  free(prm.osum);
+  free(prm.onum);
+  if(input!=tilevalues) gal_data_free(input);
   return smoothed;
 }
 
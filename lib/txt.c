@@ -23,13 +23,17 @@ along with Gnuastro. If not, see <http://www.gnu.org/licenses/>.
 #include <config.h>
 
 #include <math.h>
+#include <float.h>
 #include <ctype.h>
 #include <stdio.h>
+#include <fcntl.h>
 #include <errno.h>
 #include <error.h>
 #include <unistd.h>
 #include <string.h>
 #include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 #include <gnuastro/txt.h>
 #include <gnuastro/list.h>
@@ -37,6 +41,7 @@ along with Gnuastro. If not, see <http://www.gnu.org/licenses/>.
 #include <gnuastro/blank.h>
 #include <gnuastro/table.h>
 #include <gnuastro/pointer.h>
+#include <gnuastro/threads.h>
 #include <gnuastro/statistics.h>
 
 #include <gnuastro-internal/checkset.h>
@@ -854,6 +859,115 @@ txt_blocklist_number(gal_data_t *list)
 
 
 
+/* Fast parsing of numbers. The tokens of a text table are usually simple
+   decimal numbers, these functions parse such tokens directly and fall
+   back to the C library's 'strtol', 'strtoul' or 'strtod' for anything
+   else (for example leading white space, hexadecimal numbers, numbers
+   that are too long or celestial coordinates). So the output (and the
+   'tailptr' that is used to check if the full token was a number) are
+   identical to the C library functions. */
+static long
+txt_strtol(char *token, char **tailptr)
+{
+  int negative=0;
+  unsigned long v=0;
+  char *c=token, *digits;
+
+  /* Read the sign and the digits (at most 18, so there is no overflow). */
+  if(*c=='-' || *c=='+') negative = *c++=='-';
+  if( !isdigit(*c) ) return strtol(token, tailptr, 10);
+  digits=c;
+  do v = v*10 + (*c-'0'); while( isdigit(*++c) && c-digits<18 );
+
+  /* If the token wasn't fully parsed, let 'strtol' deal with it. */
+  if(*c!='\0') return strtol(token, tailptr, 10);
+  *tailptr=c;
+  return negative ? -(long)v : (long)v;
+}
+
+
+
+
+
+static unsigned long
+txt_strtoul(char *token, char **tailptr)
+{
+  char *c=token;
+  unsigned long v=0;
+
+  /* Only digits are parsed here (at most 19, so there is no overflow). */
+  if( !isdigit(*c) ) return strtoul(token, tailptr, 10);
+  do v = v*10 + (*c-'0'); while( isdigit(*++c) && c-token<19 );
+  if(*c!='\0') return strtoul(token, tailptr, 10);
+  *tailptr=c;
+  return v;
+}
+
+
+
+
+
+/* The decimal digits are accumulated into an integer (the mantissa). When
+   the mantissa has at most 53 bits and the power of ten is within
+   +/-22, both are exactly representable in a 'double', so a single
+   multiplication or division gives the correctly rounded result (same as
+   'strtod'). This is the "fast path" of Clinger's algorithm. */
+static double
+txt_strtod(char *token, char **tailptr)
+{
+  char *c=token;
+  uint64_t m=0;
+  int negative=0, ndigits=0, exp10=0, e=0, eneg=0;
+  static const double pow10[]={1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,
+                               1e7,  1e8,  1e9,  1e10, 1e11, 1e12, 1e13,
+                               1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20,
+                               1e21, 1e22};
+
+  /* Sign. */
+  if(*c=='-' || *c=='+') negative = *c++=='-';
+  if( !isdigit(*c) && !(*c=='.' && isdigit(c[1])) )
+    return strtod(token, tailptr);
+
+  /* Integer and fractional parts (leading zeros are not counted as
+     significant digits). The digits are counted separately from the
+     mantissa, because the mantissa can overflow (and even become zero)
+     when there are more than 19 digits. */
+  for(; isdigit(*c); ++c)
+    if(ndigits || *c!='0') { m = m*10 + (*c-'0'); ++ndigits; }
+  if(*c=='.')
+    for(++c; isdigit(*c); ++c)
+      {
+        if(ndigits || *c!='0') { m = m*10 + (*c-'0'); ++ndigits; }
+        --exp10;
+      }
+
+  /* Exponent. */
+  if(*c=='e' || *c=='E')
+    {
+      ++c;
+      if(*c=='-' || *c=='+') eneg = *c++=='-';
+      if( !isdigit(*c) ) return strtod(token, tailptr);
+      for(; isdigit(*c) && e<10000; ++c) e = e*10 + (*c-'0');
+      exp10 += eneg ? -e : e;
+    }
+
+  /* If the token isn't finished or the fast path isn't exact, use
+     'strtod'. */
+  if( *c!='\0' || ndigits>19 || m>((uint64_t)1<<53)
+      || exp10<-22 || exp10>22 )
+    return strtod(token, tailptr);
+
+  /* Return the value. */
+  *tailptr=c;
+  return ( negative ? -1.0 : 1.0 ) * ( exp10<0
+                                       ? (double)m / pow10[-exp10]
+                                       : (double)m * pow10[ exp10] );
+}
+
+
+
+
+
 static void
 txt_read_token(gal_data_t *data, gal_data_t *info, char *token,
                size_t i, char *filename, size_t lineno, size_t toknum)
@@ -916,49 +1030,49 @@ txt_read_token(gal_data_t *data, gal_data_t *info, char *token,
           break;
 
         case GAL_TYPE_UINT8:
-          uc[i]=strtol(token, &tailptr, 10);
+          uc[i]=txt_strtol(token, &tailptr);
           if( (ucb=info->array) && *ucb==uc[i] )
             uc[i]=GAL_BLANK_UINT8;
           break;
 
         case GAL_TYPE_INT8:
-          c[i]=strtol(token, &tailptr, 10);
+          c[i]=txt_strtol(token, &tailptr);
           if( (cb=info->array) && *cb==c[i] )
             c[i]=GAL_BLANK_INT8;
           break;
 
         case GAL_TYPE_UINT16:
-          us[i]=strtol(token, &tailptr, 10);
+          us[i]=txt_strtol(token, &tailptr);
           if( (usb=info->array) && *usb==us[i] )
             us[i]=GAL_BLANK_UINT16;
           break;
 
         case GAL_TYPE_INT16:
-          s[i]=strtol(token, &tailptr, 10);
+          s[i]=txt_strtol(token, &tailptr);
           if( (sb=info->array) && *sb==s[i] )
             s[i]=GAL_BLANK_INT16;
           break;
 
         case GAL_TYPE_UINT32:
-          ui[i]=strtol(token, &tailptr, 10);
+          ui[i]=txt_strtol(token, &tailptr);
           if( (uib=info->array) && *uib==ui[i] )
             ui[i]=GAL_BLANK_UINT32;
           break;
 
         case GAL_TYPE_INT32:
-          ii[i]=strtol(token, &tailptr, 10);
+          ii[i]=txt_strtol(token, &tailptr);
           if( (ib=info->array) && *ib==ii[i] )
             ii[i]=GAL_BLANK_INT32;
           break;
 
         case GAL_TYPE_UINT64:
-          ul[i]=strtoul(token, &tailptr, 10);
+          ul[i]=txt_strtoul(token, &tailptr);
           if( (ulb=info->array) && *ulb==ul[i] )
             ul[i]=GAL_BLANK_UINT64;
           break;
 
         case GAL_TYPE_INT64:
-          l[i]=strtol(token, &tailptr, 10);
+          l[i]=txt_strtol(token, &tailptr);
           if( (lb=info->array) && *lb==l[i] )
             l[i]=GAL_BLANK_INT64;
           break;
@@ -968,7 +1082,7 @@ txt_read_token(gal_data_t *data, gal_data_t *info, char *token,
              condition check (even '=='). If it isn't NaN, then we can
              compare the values. */
         case GAL_TYPE_FLOAT32:
-          f[i]=strtod(token, &tailptr);
+          f[i]=txt_strtod(token, &tailptr);
           if( (*tailptr=='h' || *tailptr=='d') && isdigit(*(tailptr+1)) )
             {
               f[i] = ( *tailptr=='h'
@@ -986,7 +1100,7 @@ txt_read_token(gal_data_t *data, gal_data_t *info, char *token,
            in these cases, they are actually coordinates (RA for first, Dec
            for second). */
         case GAL_TYPE_FLOAT64:
-          d[i]=strtod(token, &tailptr);
+          d[i]=txt_strtod(token, &tailptr);
           if( (*tailptr=='h' || *tailptr=='d') && isdigit(*(tailptr+1)) )
             {
               d[i] = ( *tailptr=='h'
@@ -1412,15 +1526,269 @@ txt_read_prepare(gal_data_t *info, size_t *indsize,
 
 
 
+/* Minimum number of bytes for each thread when reading a text file. */
+#define TXT_READ_MIN_PER_THREAD 1048576
+
+/* Parameters for reading a memory-mapped text file on multiple threads. */
+struct txt_read_params
+{
+  char            *filename;  /* Name of input file (for error messages). */
+  char                *data;  /* Memory-mapped contents of the file.      */
+  size_t            nchunks;  /* Number of chunks the file is divided to. */
+  size_t            *starts;  /* Starting byte of each chunk (+the end).  */
+  size_t          *rowstart;  /* Counter of first row in each chunk.      */
+  size_t         *linestart;  /* Counter of first line in each chunk.     */
+  int                 count;  /* ==1: only count the rows and lines.      */
+  int                format;  /* Format of the file (table or image).     */
+  size_t         ntokforout;  /* Last input token used in the output.     */
+  size_t       *tokenvecind;  /* Index of each token in a vector column.  */
+  gal_data_t   **tokeninout;  /* Output column(s) of each token.          */
+  gal_data_t  **tokenininfo;  /* Information of each token's column.      */
+};
+
+
+
+
+
+/* Similar to 'gal_txt_line_stat', but on a line that is not necessarily
+   terminated with a '\0' (it ends at 'end'). */
+static int
+txt_line_stat_mem(char *line, char *end)
+{
+  for(; line<end && *line!='\n'; ++line)
+    switch(*line)
+      {
+      case ' ': case ',': case '\t': break;
+      case '#':                      return GAL_TXT_LINESTAT_COMMENT;
+      default:                       return GAL_TXT_LINESTAT_DATAROW;
+      }
+
+  /* The last line of a file may not finish with a new-line character. In
+     'getline', it will finish with '\0' which is not an ignored character,
+     so 'gal_txt_line_stat' will consider it a data row. */
+  return line==end ? GAL_TXT_LINESTAT_DATAROW : GAL_TXT_LINESTAT_BLANK;
+}
+
+
+
+
+
+/* Parse one chunk of the file: either only count its rows and lines (in
+   the first pass), or read the data rows into the output (in the second
+   pass). Each line is copied into 'line' (that is re-allocated if
+   necessary) because 'txt_fill' needs to modify it. */
+static void
+txt_read_chunk(struct txt_read_params *p, size_t c, char **line,
+               size_t *linelen)
+{
+  char *nl, *start=p->data+p->starts[c], *end=p->data+p->starts[c+1];
+  size_t len, numrows=0, numlines=0, rowind=0, lineno=0;
+
+  /* The starting counters of this chunk (in the second pass). */
+  if(p->count==0) { rowind=p->rowstart[c]; lineno=p->linestart[c]; }
+
+  /* Go over the lines. */
+  while(start<end)
+    {
+      /* Find the end of this line (including its new-line character). */
+      nl=memchr(start, '\n', end-start);
+      len = nl ? nl-start+1 : (size_t)(end-start);
+
+      /* Count the line, or parse it. */
+      if(p->count)
+        {
+          ++numlines;
+          if( txt_line_stat_mem(start, start+len)==GAL_TXT_LINESTAT_DATAROW )
+            ++numrows;
+        }
+      else
+        {
+          /* Copy the line into the allocated space. */
+          ++lineno;
+          if(len+1>*linelen)
+            {
+              *linelen=len+1;
+              errno=0;
+              *line=realloc(*line, *linelen);
+              if(*line==NULL)
+                error(EXIT_FAILURE, errno, "%s: couldn't allocate %zu "
+                      "bytes for 'line'", __func__, *linelen);
+            }
+          memcpy(*line, start, len);
+          (*line)[len]='\0';
+
+          /* Read the tokens of this line into the output. */
+          if( gal_txt_line_stat(*line) == GAL_TXT_LINESTAT_DATAROW )
+            txt_fill(*line, p->tokeninout, p->ntokforout, p->tokenininfo,
+                     p->tokenvecind, rowind++, p->filename, lineno, 1,
+                     p->format);
+        }
+
+      /* Go to the next line. */
+      start+=len;
+    }
+
+  /* Keep the counters of the first pass. */
+  if(p->count) { p->rowstart[c]=numrows; p->linestart[c]=numlines; }
+}
+
+
+
+
+
+static void *
+txt_read_on_thread(void *in_prm)
+{
+  struct gal_threads_params *tprm=(struct gal_threads_params *)in_prm;
+  struct txt_read_params *p=(struct txt_read_params *)tprm->params;
+
+  size_t i, linelen=0;
+  char *line=NULL;
+
+  /* Parse all the chunks that were assigned to this thread. */
+  for(i=0; tprm->indexs[i] != GAL_BLANK_SIZE_T; ++i)
+    txt_read_chunk(p, tprm->indexs[i], &line, &linelen);
+
+  /* Clean up, wait for all the other threads to finish, then return. */
+  free(line);
+  if(tprm->b) pthread_barrier_wait(tprm->b);
+  return NULL;
+}
+
+
+
+
+
+/* Run one pass over all the chunks (on multiple threads if there is more
+   than one chunk). */
+static void
+txt_read_pass(struct txt_read_params *p)
+{
+  char *line=NULL;
+  size_t linelen=0;
+
+  if(p->nchunks>1)
+    gal_threads_spin_off(txt_read_on_thread, p, p->nchunks, p->nchunks,
+                         -1, 1);
+  else
+    {
+      txt_read_chunk(p, 0, &line, &linelen);
+      free(line);
+    }
+}
+
+
+
+
+
+/* Read the file by memory-mapping it (instead of reading it line by
+   line). The file is divided into chunks that start at the start of a
+   line, and each chunk is parsed by one thread. Since the row counter of
+   each chunk is necessary (to know where its values should be written in
+   the output), we first count the rows and lines of each chunk, then
+   parse them. */
+static void
+txt_read_mmap(struct txt_read_params *p, size_t numrows,
+              size_t numthreads)
+{
+  int fd;
+  char *nl;
+  struct stat st;
+  size_t c, pos, size, tmp, rows=0, lines=0;
+
+  /* Open the file and find its size. */
+  errno=0;
+  fd=open(p->filename, O_RDONLY);
+  if(fd==-1)
+    error(EXIT_FAILURE, errno, "%s: couldn't open to read as a text "
+          "table in %s", p->filename, __func__);
+  if(fstat(fd, &st)==-1)
+    error(EXIT_FAILURE, errno, "%s: couldn't get the size of the file "
+          "in %s", p->filename, __func__);
+  size=st.st_size;
+
+  /* Map the file into memory (an empty file has nothing to read). */
+  if(size)
+    {
+      errno=0;
+      p->data=mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if(p->data==MAP_FAILED)
+        error(EXIT_FAILURE, errno, "%s: couldn't memory-map the file "
+              "in %s", p->filename, __func__);
+
+      /* Set the number of chunks and allocate the arrays. */
+      p->nchunks=size/TXT_READ_MIN_PER_THREAD;
+      if(p->nchunks>numthreads) p->nchunks=numthreads;
+      if(p->nchunks==0) p->nchunks=1;
+      p->starts=gal_pointer_allocate(GAL_TYPE_SIZE_T, p->nchunks+1, 0,
+                                     __func__, "p->starts");
+      p->rowstart=gal_pointer_allocate(GAL_TYPE_SIZE_T, p->nchunks, 0,
+                                       __func__, "p->rowstart");
+      p->linestart=gal_pointer_allocate(GAL_TYPE_SIZE_T, p->nchunks, 0,
+                                        __func__, "p->linestart");
+
+      /* Each chunk starts after the first new-line character after its
+         nominal starting byte. */
+      p->starts[0]=0;
+      p->starts[p->nchunks]=size;
+      for(c=1;c<p->nchunks;++c)
+        {
+          pos=size*c/p->nchunks;
+          if(pos<p->starts[c-1]) pos=p->starts[c-1];
+          nl=memchr(p->data+pos, '\n', size-pos);
+          p->starts[c] = nl ? nl-p->data+1 : size;
+        }
+
+      /* Count the rows and lines in each chunk, and convert them to the
+         counter of the first row and line of each chunk. */
+      p->count=1;
+      txt_read_pass(p);
+      for(c=0;c<p->nchunks;++c)
+        {
+          tmp=p->rowstart[c];  p->rowstart[c]=rows;   rows+=tmp;
+          tmp=p->linestart[c]; p->linestart[c]=lines; lines+=tmp;
+        }
+
+      /* The number of rows should be the same as the one that was found
+         when reading the file's information. */
+      if(rows!=numrows)
+        error(EXIT_FAILURE, 0, "%s: has %zu rows, but %zu rows were found "
+              "when reading its information (was the file changed while "
+              "being read?)", p->filename, rows, numrows);
+
+      /* Read the data rows. */
+      p->count=0;
+      txt_read_pass(p);
+
+      /* Clean up. */
+      free(p->starts);
+      free(p->rowstart);
+      free(p->linestart);
+      if( munmap(p->data, size)==-1 )
+        error(EXIT_FAILURE, errno, "%s: couldn't un-map the file in %s",
+              p->filename, __func__);
+    }
+
+  /* Close the file. */
+  errno=0;
+  if(close(fd)==-1)
+    error(EXIT_FAILURE, errno, "%s: couldn't close file after reading "
+          "it in %s", p->filename, __func__);
+}
+
+
+
+
+
 static gal_data_t *
 txt_read(char *filename, gal_list_str_t *lines, size_t *indsize,
-         gal_data_t *info, gal_list_sizet_t *indexll, size_t minmapsize,
-         int quietmmap, int format)
+         gal_data_t *info, gal_list_sizet_t *indexll, size_t numthreads,
+         size_t minmapsize, int quietmmap, int format)
 {
-  FILE *fp;
   int test;
   char *line;
   gal_list_str_t *tmp;
+  struct txt_read_params p={0};
   size_t ntokforout=0, rowind=0, lineno=0, *tokenvecind;
   gal_data_t *out=NULL, *ocol, **tokeninout, **tokenininfo;
   size_t linelen=10;        /* 'linelen' will be increased by 'getline'. */
@@ -1437,30 +1805,16 @@ txt_read(char *filename, gal_list_str_t *lines, size_t *indsize,
                        format, &line, linelen, &tokeninout, &ntokforout,
                        &tokenininfo, &tokenvecind);
 
-  /* Read the input line by line. */
+  /* Read the input. */
   if(filename) /* Input from a file. */
     {
-      /* Open the file. */
-      errno=0;
-      fp=fopen(filename, "r");
-      if(fp==NULL)
-        error(EXIT_FAILURE, errno, "%s: couldn't open to read as a text "
-              "table in %s", filename, __func__);
-
-      /* Read the file, line by line. */
-      while( getline(&line, &linelen, fp) != -1 )
-        {
-          ++lineno;
-          if( gal_txt_line_stat(line) == GAL_TXT_LINESTAT_DATAROW )
-            txt_fill(line, tokeninout, ntokforout, tokenininfo,
-                     tokenvecind, rowind++, filename, lineno, 1, format);
-        }
-
-      /* Clean up and close the file. */
-      errno=0;
-      if(fclose(fp))
-        error(EXIT_FAILURE, errno, "%s: couldn't close file after reading "
-              "ASCII table information in %s", filename, __func__);
+      p.format=format;
+      p.filename=filename;
+      p.ntokforout=ntokforout;
+      p.tokeninout=tokeninout;
+      p.tokenininfo=tokenininfo;
+      p.tokenvecind=tokenvecind;
+      txt_read_mmap(&p, indsize[0], numthreads);
     }
 
   else /* Input from standard input */
@@ -1498,8 +1852,24 @@ gal_txt_table_read(char *filename, gal_list_str_t *lines, size_t numrows,
                    gal_data_t *colinfo, gal_list_sizet_t *indexll,
                    size_t minmapsize, int quietmmap)
 {
-  return txt_read(filename, lines, &numrows, colinfo, indexll, minmapsize,
-                  quietmmap, TXT_FORMAT_TABLE);
+  return txt_read(filename, lines, &numrows, colinfo, indexll, 1,
+                  minmapsize, quietmmap, TXT_FORMAT_TABLE);
+}
+
+
+
+
+
+/* Similar to 'gal_txt_table_read', but large files will be parsed on
+   'numthreads' threads. */
+gal_data_t *
+gal_txt_table_read_threads(char *filename, gal_list_str_t *lines,
+                           size_t numrows, gal_data_t *colinfo,
+                           gal_list_sizet_t *indexll, size_t numthreads,
+                           size_t minmapsize, int quietmmap)
+{
+  return txt_read(filename, lines, &numrows, colinfo, indexll, numthreads,
+                  minmapsize, quietmmap, TXT_FORMAT_TABLE);
 }
 
 
@@ -1518,7 +1888,7 @@ gal_txt_image_read(char *filename, gal_list_str_t *lines,
   imginfo=gal_txt_image_info(filename, lines, &numimg, dsize);
 
   /* Read the table. */
-  img=txt_read(filename, lines, dsize, imginfo, indexll, minmapsize,
+  img=txt_read(filename, lines, dsize, imginfo, indexll, 1, minmapsize,
                quietmmap, TXT_FORMAT_IMAGE);
 
   /* Clean up and return. */
@@ -1790,43 +2160,596 @@ txt_fmts_for_printf(gal_data_t *datall, int leftadjust, int tab0_img1)
 
 
 
+/* Parsed version of a format string made by 'txt_fmts_for_printf', so
+   values can be printed without parsing the format string every time. */
+struct txt_fmt
+{
+  uint8_t         fast;  /* ==1: can be printed without 'snprintf'.     */
+  uint8_t        space;  /* ==1: put a space before positive numbers.   */
+  uint8_t         left;  /* ==1: left-adjust within the width.          */
+  uint8_t        trail;  /* ==1: the format ends with a space.          */
+  char            conv;  /* Conversion character (for example 'd').     */
+  size_t         width;  /* Minimum width of the value.                 */
+  int             prec;  /* Precision (-1 when not given).              */
+};
+
+/* Maximum number of characters that the fast formatters write (besides
+   the width's padding or a string's characters). */
+#define TXT_FMT_MAXLEN 64
+
+/* Maximum precision that is printed by the fast formatters. */
+#define TXT_FMT_MAXPREC 40
+
+/* Number of rows that are printed into one buffer (by one thread). */
+#define TXT_WRITE_BLOCK_ROWS 8192
+
+/* Exact powers of ten in a 'long double' (10^27 needs 63 bits). */
+#if LDBL_MANT_DIG >= 64
+#define TXT_FMT_FLOAT 1
+static const long double txt_fmt_pow10[]=
+  {1e0L,  1e1L,  1e2L,  1e3L,  1e4L,  1e5L,  1e6L,  1e7L,  1e8L,  1e9L,
+   1e10L, 1e11L, 1e12L, 1e13L, 1e14L, 1e15L, 1e16L, 1e17L, 1e18L, 1e19L,
+   1e20L, 1e21L, 1e22L, 1e23L, 1e24L, 1e25L, 1e26L, 1e27L};
+#else
+#define TXT_FMT_FLOAT 0
+#endif
+
+
+
+
+
+/* Parse a format string like '% -14.6e ' into a 'struct txt_fmt'. If the
+   format contains anything that the fast formatters don't support, the
+   'fast' flag will be zero. */
+static void
+txt_fmt_parse(char *fmt, struct txt_fmt *f)
+{
+  char *c=fmt;
+
+  /* Initialize the output. */
+  memset(f, 0, sizeof *f);
+  f->prec=-1;
+  if(*c++!='%') return;
+
+  /* The flags, width and precision. */
+  for(;*c==' ' || *c=='-';++c) if(*c==' ') f->space=1; else f->left=1;
+  for(;isdigit(*c);++c) f->width = f->width*10 + (*c-'0');
+  if(*c=='.')
+    for(f->prec=0, ++c; isdigit(*c); ++c)
+      if(f->prec<=TXT_FMT_MAXPREC) f->prec = f->prec*10 + (*c-'0');
+
+  /* The length modifier (the type of the value is known from the
+     dataset, so it is not needed) and the conversion character. */
+  while(*c=='l' || *c=='h') ++c;
+  f->conv=*c++;
+
+  /* A trailing space is the only thing that may follow. */
+  if(*c==' ') { f->trail=1; ++c; }
+  f->fast = ( *c=='\0' && f->prec<=TXT_FMT_MAXPREC
+              && strchr("duoXsfeg", f->conv)!=NULL );
+}
+
+
+
+
+
+/* Write the 'n' characters of 'body' into 'out' with the sign, padding
+   and trailing space of the format and return the number of characters
+   written. */
+static size_t
+txt_fmt_pad(char *out, struct txt_fmt *f, char sign, char *body,
+            size_t n)
+{
+  char *o=out;
+  size_t len=n+(sign!=0), pad = f->width>len ? f->width-len : 0;
+
+  if(!f->left) { memset(o, ' ', pad); o+=pad; }
+  if(sign) *o++=sign;
+  memcpy(o, body, n); o+=n;
+  if(f->left) { memset(o, ' ', pad); o+=pad; }
+  if(f->trail) *o++=' ';
+  return o-out;
+}
+
+
+
+
+
+/* Integers: 'mag' is the absolute value. */
+static size_t
+txt_fmt_int(char *out, struct txt_fmt *f, uint64_t mag, int neg)
+{
+  char tmp[TXT_FMT_MAXLEN], *d=tmp+TXT_FMT_MAXLEN;
+  size_t n, base = f->conv=='o' ? 8 : (f->conv=='X' ? 16 : 10);
+  size_t prec = f->prec<0 ? 1 : f->prec; /* Minimum number of digits. */
+
+  /* Write the digits from the end, then add the necessary zeros. */
+  for(; mag; mag/=base) *--d="0123456789ABCDEF"[mag%base];
+  for(n=tmp+TXT_FMT_MAXLEN-d; n<prec; ++n) *--d='0';
+
+  /* The space flag is only relevant for signed conversions. */
+  return txt_fmt_pad(out, f, neg ? '-' : (f->space && f->conv=='d'
+                                          ? ' ' : 0), d, n);
+}
+
+
+
+
+
+#if TXT_FMT_FLOAT
+/* Round 'a*10^k' to the nearest integer. The multiplication is done in
+   'long double' with an exact power of ten, so the result is within half
+   a unit in the last place of the exact product. If it is too close to a
+   half (where the exact decimal expansion would be necessary to decide),
+   return 0 so the C library is used. */
+static int
+txt_fmt_round(long double a, int k, uint64_t *m, long double *x)
+{
+  long double r, fr;
+
+  /* Only exact powers of ten and exact integers are usable. */
+  if(k>27 || k<-27) return 0;
+  *x = k>=0 ? a*txt_fmt_pow10[k] : a/txt_fmt_pow10[-k];
+  if(*x>=1e18L) return 0;
+
+  /* Round to the nearest integer. */
+  r=floorl(*x);
+  fr=*x-r;
+  if( fabsl(fr-0.5L) <= *x*LDBL_EPSILON ) return 0;
+  *m = (uint64_t)r + (fr>0.5L);
+  return 1;
+}
+
+
+
+
+
+/* Find the 'ndig' significant digits (as an integer in 'm') and the
+   decimal exponent of 'a' (a positive finite number or zero). */
+static int
+txt_fmt_digits(double a, int ndig, uint64_t *m, int *e)
+{
+  int i;
+  long double x;
+
+  /* Zero is a special case. */
+  if(a==0.0) { *m=0; *e=0; return 1; }
+  if(ndig>18) return 0;
+
+  /* The first estimate of the exponent may be one off, so correct it. */
+  *e=floor(log10(a));
+  for(i=0;i<2;++i)
+    {
+      if( txt_fmt_round(a, ndig-1-*e, m, &x)==0 ) return 0;
+      if(x<txt_fmt_pow10[ndig-1])    --*e;
+      else if(x>=txt_fmt_pow10[ndig]) ++*e;
+      else break;
+    }
+  if(i==2) return 0;
+
+  /* Rounding may have increased the number of digits (for example
+     9.9999999 with 3 digits). */
+  if(*m==(uint64_t)txt_fmt_pow10[ndig]) { *m/=10; ++*e; }
+  return 1;
+}
+
+
+
+
+
+/* Write 'n' digits of 'm' (with leading zeros if necessary) into 'd'. */
+static void
+txt_fmt_digits_write(char *d, uint64_t m, size_t n)
+{
+  while(n--) { d[n]='0'+m%10; m/=10; }
+}
+
+
+
+
+
+/* Write the exponent of the '%e' format (at least two digits). */
+static char *
+txt_fmt_exp(char *o, int e)
+{
+  *o++='e';
+  *o++ = e<0 ? '-' : '+';
+  if(e<0) e=-e;
+  if(e>=100) { *o++='0'+e/100; e%=100; }
+  *o++='0'+e/10;
+  *o++='0'+e%10;
+  return o;
+}
+
+
+
+
+
+/* Floating point numbers in the 'f', 'e' and 'g' formats, the output is
+   identical to 'printf' (0 is returned when 'printf' should be used). */
+static size_t
+txt_fmt_float(char *out, struct txt_fmt *f, double v)
+{
+  int e, P;
+  size_t n;
+  long double x;
+  uint64_t m, ip;
+  char body[TXT_FMT_MAXLEN], dig[20], *o=body;
+  int neg=signbit(v), p = f->prec<0 ? 6 : f->prec;
+  double a=fabs(v);
+
+  /* Not-a-number and infinity are left to the C library. */
+  if( !isfinite(v) ) return 0;
+
+  switch(f->conv)
+    {
+    case 'f':
+      /* Round to 'p' decimals, then write the integer and fractional
+         parts (the integer part has at least one digit). */
+      if( p>18 || txt_fmt_round(a, p, &m, &x)==0 ) return 0;
+      ip=m/(uint64_t)txt_fmt_pow10[p];
+      for(n=1; n<19 && ip>=(uint64_t)txt_fmt_pow10[n]; ++n) {}
+      txt_fmt_digits_write(o, ip, n); o+=n;
+      if(p)
+        {
+          *o++='.';
+          txt_fmt_digits_write(o, m%(uint64_t)txt_fmt_pow10[p], p);
+          o+=p;
+        }
+      break;
+
+    case 'e':
+      if( txt_fmt_digits(a, p+1, &m, &e)==0 ) return 0;
+      txt_fmt_digits_write(dig, m, p+1);
+      *o++=dig[0];
+      if(p) { *o++='.'; memcpy(o, dig+1, p); o+=p; }
+      o=txt_fmt_exp(o, e);
+      break;
+
+    case 'g':
+      /* Significant digits, then decide on the style from the exponent
+         after rounding (as described in the C standard). */
+      P = p==0 ? 1 : p;
+      if( txt_fmt_digits(a, P, &m, &e)==0 ) return 0;
+      txt_fmt_digits_write(dig, m, P);
+      if(P>e && e>=-4)
+        {
+          if(e>=0)
+            {
+              memcpy(o, dig, e+1); o+=e+1;
+              *o++='.';
+              memcpy(o, dig+e+1, P-1-e); o+=P-1-e;
+            }
+          else
+            {
+              *o++='0'; *o++='.';
+              memset(o, '0', -e-1); o+=-e-1;
+              memcpy(o, dig, P); o+=P;
+            }
+          while(o[-1]=='0') --o;            /* Remove trailing zeros   */
+          if(o[-1]=='.') --o;               /* and the decimal point.  */
+        }
+      else
+        {
+          *o++=dig[0];
+          if(P>1)
+            {
+              *o++='.';
+              memcpy(o, dig+1, P-1); o+=P-1;
+              while(o[-1]=='0') --o;
+              if(o[-1]=='.') --o;
+            }
+          o=txt_fmt_exp(o, e);
+        }
+      break;
+
+    default:
+      return 0;
+    }
+
+  /* Add the sign and padding. */
+  return txt_fmt_pad(out, f, neg ? '-' : (f->space ? ' ' : 0), body,
+                     o-body);
+}
+#endif
+
+
+
+
+
+/* Growable buffer that the rows are printed into. */
+struct txt_write_buf
+{
+  char            *buf;  /* Allocated space.                            */
+  size_t          size;  /* Allocated size of 'buf'.                    */
+  size_t          used;  /* Number of characters written in 'buf'.      */
+};
+
+
+
+
+
+/* Make sure there is space for 'n' more characters in the buffer. */
 static void
-txt_print_value(FILE *fp, gal_data_t *data, size_t ind, char *fmt)
+txt_write_buf_reserve(struct txt_write_buf *b, size_t n)
+{
+  if(b->used+n <= b->size) return;
+  b->size = 2*(b->used+n);
+  errno=0;
+  b->buf=realloc(b->buf, b->size);
+  if(b->buf==NULL)
+    error(EXIT_FAILURE, errno, "%s: couldn't allocate %zu bytes for "
+          "'b->buf'", __func__, b->size);
+}
+
+
+
+
+
+static int
+txt_print_value(char *out, size_t size, gal_data_t *data, size_t ind,
+                char *fmt)
 {
   void *a=data->array;
 
   switch(data->type)
     {
       /* Numerical types. */
-    case GAL_TYPE_UINT8:   fprintf(fp, fmt, ((uint8_t *) a)[ind]); break;
-    case GAL_TYPE_INT8:    fprintf(fp, fmt, ((int8_t *)  a)[ind]); break;
-    case GAL_TYPE_UINT16:  fprintf(fp, fmt, ((uint16_t *)a)[ind]); break;
-    case GAL_TYPE_INT16:   fprintf(fp, fmt, ((int16_t *) a)[ind]); break;
-    case GAL_TYPE_UINT32:  fprintf(fp, fmt, ((uint32_t *)a)[ind]); break;
-    case GAL_TYPE_INT32:   fprintf(fp, fmt, ((int32_t *) a)[ind]); break;
-    case GAL_TYPE_UINT64:  fprintf(fp, fmt, ((uint64_t *)a)[ind]); break;
-    case GAL_TYPE_INT64:   fprintf(fp, fmt, ((int64_t *) a)[ind]); break;
-    case GAL_TYPE_FLOAT32: fprintf(fp, fmt, ((float *)   a)[ind]); break;
-    case GAL_TYPE_FLOAT64: fprintf(fp, fmt, ((double *)  a)[ind]); break;
+    case GAL_TYPE_UINT8:   return snprintf(out,size,fmt,((uint8_t *) a)[ind]);
+    case GAL_TYPE_INT8:    return snprintf(out,size,fmt,((int8_t *)  a)[ind]);
+    case GAL_TYPE_UINT16:  return snprintf(out,size,fmt,((uint16_t *)a)[ind]);
+    case GAL_TYPE_INT16:   return snprintf(out,size,fmt,((int16_t *) a)[ind]);
+    case GAL_TYPE_UINT32:  return snprintf(out,size,fmt,((uint32_t *)a)[ind]);
+    case GAL_TYPE_INT32:   return snprintf(out,size,fmt,((int32_t *) a)[ind]);
+    case GAL_TYPE_UINT64:  return snprintf(out,size,fmt,((uint64_t *)a)[ind]);
+    case GAL_TYPE_INT64:   return snprintf(out,size,fmt,((int64_t *) a)[ind]);
+    case GAL_TYPE_FLOAT32: return snprintf(out,size,fmt,((float *)   a)[ind]);
+    case GAL_TYPE_FLOAT64: return snprintf(out,size,fmt,((double *)  a)[ind]);
 
       /* Special consideration for strings. */
     case GAL_TYPE_STRING:
       if( !strcmp( ((char **)a)[ind], GAL_BLANK_STRING ) )
-        fprintf(fp, fmt, GAL_BLANK_STRING);
+        return snprintf(out, size, fmt, GAL_BLANK_STRING);
       else
-        fprintf(fp, fmt, ((char **)a)[ind]);
-      break;
+        return snprintf(out, size, fmt, ((char **)a)[ind]);
 
     default:
       error(EXIT_FAILURE, 0, "%s: type code %d not recognized",
             __func__, data->type);
     }
+
+  /* Control should not reach here. */
+  return 0;
 }
 
 
 
 
 
+/* Print one value into the buffer. The fast formatters are used when
+   possible and 'snprintf' is used for the rest. */
+static void
+txt_write_value(struct txt_write_buf *b, gal_data_t *data, size_t ind,
+                char *fmt, struct txt_fmt *f)
+{
+  int64_t i;
+  void *a=data->array;
+  size_t n=0, slen=0;
+  char *o, *str=NULL;
+
+  /* Make sure there is enough space for the fast formatters. */
+  if(data->type==GAL_TYPE_STRING)
+    {
+      str=((char **)a)[ind];
+      slen=strlen(str);
+      if(f->prec>=0 && slen>(size_t)f->prec) slen=f->prec;
+    }
+  txt_write_buf_reserve(b, f->width+slen+TXT_FMT_MAXLEN);
+  o=b->buf+b->used;
+
+  /* Use the fast formatters. */
+  if(f->fast)
+    switch(data->type)
+      {
+      case GAL_TYPE_UINT8:  n=txt_fmt_int(o, f, ((uint8_t *)a)[ind], 0);break;
+      case GAL_TYPE_UINT16: n=txt_fmt_int(o, f, ((uint16_t*)a)[ind], 0);break;
+      case GAL_TYPE_UINT32: n=txt_fmt_int(o, f, ((uint32_t*)a)[ind], 0);break;
+      case GAL_TYPE_UINT64: n=txt_fmt_int(o, f, ((uint64_t*)a)[ind], 0);break;
+      case GAL_TYPE_INT8:   i=((int8_t  *)a)[ind];                 goto sint;
+      case GAL_TYPE_INT16:  i=((int16_t *)a)[ind];                 goto sint;
+      case GAL_TYPE_INT32:  i=((int32_t *)a)[ind];                 goto sint;
+      case GAL_TYPE_INT64:  i=((int64_t *)a)[ind];
+      sint:
+        n = ( f->conv=='d'
+              ? txt_fmt_int(o, f, i<0 ? -(uint64_t)i : (uint64_t)i, i<0)
+              : 0 );
+        break;
+#if TXT_FMT_FLOAT
+      case GAL_TYPE_FLOAT32: n=txt_fmt_float(o, f, ((float *)a)[ind]); break;
+      case GAL_TYPE_FLOAT64: n=txt_fmt_float(o, f, ((double*)a)[ind]); break;
+#endif
+      case GAL_TYPE_STRING:  n=txt_fmt_pad(o, f, 0, str, slen);        break;
+      }
+
+  /* The fast formatters couldn't be used. */
+  if(n==0)
+    {
+      n=txt_print_value(o, b->size-b->used, data, ind, fmt);
+      if(n >= b->size-b->used)
+        {
+          txt_write_buf_reserve(b, n+1);
+          n=txt_print_value(b->buf+b->used, b->size-b->used, data, ind,
+                            fmt);
+        }
+    }
+  b->used+=n;
+}
+
+
+
+
+
+/* Parameters for printing the rows of a table or image. */
+struct txt_write_params
+{
+  gal_data_t       *input;  /* Input dataset(s).                          */
+  char             **fmts;  /* Format strings of each column.             */
+  struct txt_fmt   *pfmts;  /* Parsed formats (same order as 'fmts').     */
+  int           tab0_img1;  /* ==1: input is an image.                    */
+  size_t          numrows;  /* Total number of rows.                      */
+  size_t         rowstart;  /* First row of the current batch of blocks.  */
+  size_t         blocklen;  /* Number of rows in each block.              */
+  struct txt_write_buf *bufs; /* Buffer of each block in the batch.       */
+};
+
+
+
+
+
+/* Print the rows of one block into its buffer. */
+static void
+txt_write_block(struct txt_write_params *p, size_t block)
+{
+  gal_data_t *data;
+  size_t i, j, k, d1, f;
+  struct txt_write_buf *b=&p->bufs[block];
+  size_t start=p->rowstart+block*p->blocklen;
+  size_t end = ( start+p->blocklen < p->numrows
+                 ? start+p->blocklen : p->numrows );
+
+  /* Print the rows. */
+  b->used=0;
+  for(i=start;i<end;++i)
+    {
+      if(p->tab0_img1) /* Image. */
+        {
+          d1=p->input->dsize[1];
+          for(j=0;j<d1;++j)
+            {
+              f = j==d1-1 ? 3 : 0;
+              txt_write_value(b, p->input, i*d1+j, p->fmts[f],
+                              &p->pfmts[f]);
+            }
+        }
+      else /* Table. */
+        {
+          k=0; /* Column counter. */
+          for(data=p->input;data!=NULL;data=data->next)  /* Column. */
+            {
+              if(data->ndim>1)  /* Vector column. */
+                {
+                  d1=data->dsize[1];
+                  for(j=0;j<d1;++j)
+                    {
+                      /* Last of vector column has a different format. */
+                      f = ( k * FMTS_COLS
+                            + (j==d1-1 && data->next==NULL ? 3 : 0) );
+                      txt_write_value(b, data, i*d1+j, p->fmts[f],
+                                      &p->pfmts[f]);
+                    }
+                }
+              else /* Non-vector column: simple! */
+                txt_write_value(b, data, i, p->fmts[k * FMTS_COLS],
+                                &p->pfmts[k * FMTS_COLS]);
+              ++k;
+            }
+        }
+      txt_write_buf_reserve(b, 1);
+      b->buf[b->used++]='\n';
+    }
+}
+
+
+
+
+
+static void *
+txt_write_on_thread(void *in_prm)
+{
+  struct gal_threads_params *tprm=(struct gal_threads_params *)in_prm;
+  struct txt_write_params *p=(struct txt_write_params *)tprm->params;
+
+  size_t i;
+
+  /* Print all the blocks that were assigned to this thread. */
+  for(i=0; tprm->indexs[i] != GAL_BLANK_SIZE_T; ++i)
+    txt_write_block(p, tprm->indexs[i]);
+
+  /* Wait for all the other threads to finish, then return. */
+  if(tprm->b) pthread_barrier_wait(tprm->b);
+  return NULL;
+}
+
+
+
+
+
+/* Print the rows in blocks: each batch of blocks is printed into separate
+   buffers (on separate threads), then the buffers are written into the
+   file in order. */
+static void
+txt_write_rows(FILE *fp, gal_data_t *input, char **fmts, size_t numfmts,
+               int tab0_img1, size_t numthreads)
+{
+  size_t i, nblocks;
+  struct txt_write_params p;
+
+  /* Parse the format strings. */
+  errno=0;
+  p.pfmts=malloc(numfmts*sizeof *p.pfmts);
+  if(p.pfmts==NULL)
+    error(EXIT_FAILURE, errno, "%s: %zu bytes for 'p.pfmts'", __func__,
+          numfmts*sizeof *p.pfmts);
+  for(i=0;i<numfmts;++i)
+    if( (i%FMTS_COLS==0 || i%FMTS_COLS==3) && fmts[i] )
+      txt_fmt_parse(fmts[i], &p.pfmts[i]);
+
+  /* Set the parameters. */
+  p.fmts=fmts;
+  p.input=input;
+  p.tab0_img1=tab0_img1;
+  p.numrows=input->dsize[0];
+  p.blocklen=TXT_WRITE_BLOCK_ROWS;
+  nblocks=(p.numrows+p.blocklen-1)/p.blocklen;
+  if(numthreads==0) numthreads=1;
+  if(nblocks>numthreads) nblocks=numthreads;
+  errno=0;
+  p.bufs=calloc(nblocks, sizeof *p.bufs);
+  if(p.bufs==NULL)
+    error(EXIT_FAILURE, errno, "%s: %zu bytes for 'p.bufs'", __func__,
+          nblocks*sizeof *p.bufs);
+
+  /* Print each batch of blocks and write them. */
+  for(p.rowstart=0; p.rowstart<p.numrows;
+      p.rowstart+=nblocks*p.blocklen)
+    {
+      if(nblocks>1)
+        gal_threads_spin_off(txt_write_on_thread, &p, nblocks, nblocks,
+                             -1, 1);
+      else
+        txt_write_block(&p, 0);
+      for(i=0;i<nblocks;++i)
+        {
+          errno=0;
+          if( p.bufs[i].used
+              && fwrite(p.bufs[i].buf, 1, p.bufs[i].used, fp)
+                 != p.bufs[i].used )
+            error(EXIT_FAILURE, errno, "%s: couldn't write %zu bytes",
+                  __func__, p.bufs[i].used);
+        }
+    }
+
+  /* Clean up. */
+  for(i=0;i<nblocks;++i) free(p.bufs[i].buf);
+  free(p.pfmts);
+  free(p.bufs);
+}
+
+
+
+
+
+
 static void
 txt_write_metadata(FILE *fp, gal_data_t *datall, char **fmts,
                    int tab0_img1)
@@ -1994,11 +2917,28 @@ void
 gal_txt_write(gal_data_t *input, struct gal_fits_list_key_t **keylist,
               gal_list_str_t *comment, char *filename,
               uint8_t colinfoinstdout, int tab0_img1)
+{
+  gal_txt_write_threads(input, keylist, comment, filename,
+                        colinfoinstdout, tab0_img1, 1);
+}
+
+
+
+
+
+/* Similar to 'gal_txt_write', but the rows of large tables are printed
+   on 'numthreads' threads. */
+void
+gal_txt_write_threads(gal_data_t *input,
+                      struct gal_fits_list_key_t **keylist,
+                      gal_list_str_t *comment, char *filename,
+                      uint8_t colinfoinstdout, int tab0_img1,
+                      size_t numthreads)
 {
   FILE *fp;
   char **fmts;
   gal_list_str_t *strt;
-  size_t i, j, k, num=0, d1;
+  size_t i, num=0;
   gal_data_t *data, *nextimg=NULL;
 
   /* Make sure input is valid. */
@@ -2081,41 +3021,9 @@ gal_txt_write(gal_data_t *input, struct gal_fits_list_key_t **keylist,
     txt_write_metadata(fp, input, fmts, tab0_img1);
 
 
-  /* Print row-by-row (if we actually have data to print! */
+  /* Print the rows (if we actually have data to print!). */
   if(input->array)
-    {
-      if(tab0_img1) /* Image. */
-        for(i=0;i<input->dsize[0];++i)
-          {
-            d1=input->dsize[1];
-            for(j=0;j<d1;++j)
-              txt_print_value(fp, input, i*d1+j, fmts[j==d1-1 ? 3 : 0]);
-            fprintf(fp, "\n");
-          }
-      else /* Table. */
-        {
-          for(i=0;i<input->dsize[0];++i)                  /* Row.    */
-            {
-              k=0; /* Column counter. */
-              for(data=input;data!=NULL;data=data->next)  /* Column. */
-                {
-                  if(data->ndim>1)  /* Vector column. */
-                    {
-                      d1=data->dsize[1];
-                      for(j=0;j<d1;++j)
-                        txt_print_value(fp, data, i*d1+j,
-                          fmts[ k * FMTS_COLS
-                      /* Last of vector column has a different format. */
-                                + (j==d1-1 && data->next==NULL ? 3 : 0) ]);
-                    }
-                  else /* Non-vector column: simple! */
-                    txt_print_value(fp, data, i, fmts[k * FMTS_COLS]);
-                  ++k;
-                }
-              fprintf(fp, "\n");
-            }
-        }
-    }
+    txt_write_rows(fp, input, fmts, num*FMTS_COLS, tab0_img1, numthreads);
 
 
   /* Clean up. */
@@ -48,10 +48,11 @@ gal_units_extract_decimal(char *convert, const char *delimiter,
                           double *args, size_t n)
 {
   size_t i = 0;
-  char *copy, *token, *end;
+  char *copy, *token, *end, *saveptr;
 
   /* Create a copy of the string to be parsed and parse it. This is because
-     it will be modified during the parsing. */
+     it will be modified during the parsing. 'strtok_r' is used (instead of
+     'strtok') so this function can be called from multiple threads. */
   copy=strdup(convert);
   do
     {
@@ -65,7 +66,7 @@ gal_units_extract_decimal(char *convert, const char *delimiter,
         }
 
       /* Extract the substring till the next delimiter */
-      token=strtok(i==0?copy:NULL, delimiter);
+      token=strtok_r(i==0?copy:NULL, delimiter, &saveptr);
       if(token)
         {
           /* Parse extracted string as a number, and check if it worked. */
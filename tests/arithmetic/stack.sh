@@ -0,0 +1,77 @@
+# Stack many images (that are read in parallel) with Arithmetic.
+#
+# See the Tests subsection of the manual for a complete explanation
+# (in the Installing gnuastro section).
+#
+# Original author:
+#     agent <agent@local>
+# Contributing author(s):
+# Copyright (C) 2026 Free Software Foundation, Inc.
+#
+# Copying and distribution of this file, with or without modification,
+# are permitted in any medium without royalty provided the copyright
+# notice and this notice are preserved.  This file is offered as-is,
+# without any warranty.
+
+
+
+
+
+# Preliminaries
+# =============
+#
+# Set the variables (The executable is in the build tree). Do the
+# basic checks to see if the executable is made or if the defaults
+# file exists (basicchecks.sh is in the source tree).
+prog=arithmetic
+execname=../bin/$prog/ast$prog
+img=convolve_spatial_noised_detected.fits
+
+
+
+
+
+# Skip?
+# =====
+#
+# If the dependencies of the test don't exist, then skip it. There are two
+# types of dependencies:
+#
+#   - The executable was not made (for example due to a configure option),
+#
+#   - The input data was not made (for example the test that created the
+#     data file failed).
+if [ ! -f $execname ]; then echo "$execname not created."; exit 77; fi
+if [ ! -f $img      ]; then echo "$img does not exist.";   exit 77; fi
+
+
+
+
+
+# Actual test script
+# ==================
+#
+# The operands of the stacking operators are read in parallel before they
+# are popped. The same file is given more than once (with other files in
+# between), and the outputs on one and many threads are compared with the
+# images that should be selected (by the maximum and minimum), so the
+# order and values of the inputs are checked.
+$check_with_program $execname $img 1 + -h1 --output=stack-a.fits || exit 1
+$check_with_program $execname $img 2 + -h1 --output=stack-b.fits || exit 1
+same()
+{
+  n=$($execname $1 $2 ne maxvalue -h1 -h1 --quiet)
+  if ! awk -v n="$n" 'BEGIN{exit (n==0) ? 0 : 1}'; then
+    echo "$1 and $2 are different"; exit 1
+  fi
+}
+for t in 1 4; do
+  $check_with_program $execname $img stack-a.fits $img stack-b.fits 4 \
+                      max -h1 -h1 -h1 -h1 --numthreads=$t \
+                      --output=stack-max-$t.fits || exit 1
+  $check_with_program $execname stack-b.fits $img stack-a.fits $img 4 \
+                      min -h1 -h1 -h1 -h1 --numthreads=$t \
+                      --output=stack-min-$t.fits || exit 1
+  same stack-max-$t.fits stack-b.fits
+  same stack-min-$t.fits $img
+done
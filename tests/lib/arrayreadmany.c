@@ -0,0 +1,147 @@
+/*********************************************************************
+A test program for reading many files and HDUs on multiple threads.
+
+Original author:
+     agent <agent@local>
+Contributing author(s):
+Copyright (C) 2026 Free Software Foundation, Inc.
+
+Gnuastro is free software: you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by the
+Free Software Foundation, either version 3 of the License, or (at your
+option) any later version.
+
+Gnuastro is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Gnuastro. If not, see <http://www.gnu.org/licenses/>.
+**********************************************************************/
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "gnuastro/fits.h"
+#include "gnuastro/list.h"
+#include "gnuastro/array.h"
+
+
+/* Number of files, number of HDUs in each file and size of the images. */
+#define NUMFILES 3
+#define NUMHDUS  4
+#define NROWS    37
+#define NCOLS    23
+
+
+
+
+/* Value of pixel 'i' in HDU 'h' of file 'f': every pixel of every input
+   is different, so the order of the outputs can also be checked. */
+static int32_t
+pixel_value(size_t f, size_t h, size_t i)
+{
+  return (f*NUMHDUS+h)*NROWS*NCOLS+i;
+}
+
+
+
+
+/* Read the inputs (that are given in an order that is different from the
+   files) and check the order and values of the outputs. */
+static int
+read_check(gal_list_str_t *filenames, gal_list_str_t *hdus, size_t *fs,
+           size_t *hs, size_t num, size_t numthreads)
+{
+  int out=0;
+  int32_t *d;
+  size_t i, j;
+  gal_data_t *read, *tmp;
+
+  read=gal_array_read_one_ch_many(filenames, hdus, numthreads, -1, 1);
+  if( gal_list_data_number(read)!=num )
+    {
+      fprintf(stderr, "%zu threads: %zu datasets read (instead of %zu)\n",
+              numthreads, gal_list_data_number(read), num);
+      return 1;
+    }
+  for(j=0, tmp=read; tmp!=NULL && out==0; tmp=tmp->next, ++j)
+    {
+      if( tmp->type!=GAL_TYPE_INT32 || tmp->ndim!=2
+          || tmp->dsize[0]!=NROWS || tmp->dsize[1]!=NCOLS )
+        out=1;
+      d=tmp->array;
+      for(i=0;i<tmp->size && out==0;++i)
+        if( d[i]!=pixel_value(fs[j], hs[j], i) ) out=1;
+      if(out)
+        fprintf(stderr, "%zu threads: output %zu is not HDU %zu of file "
+                "%zu\n", numthreads, j, hs[j]+1, fs[j]);
+    }
+  printf("%zu threads: %s.\n", numthreads, out ? "failed" : "passed");
+  gal_list_data_free(read);
+  return out;
+}
+
+
+
+
+/* Write a few images into each file, then read them in a mixed order
+   (some of them more than once) on one and many threads (zero should be
+   treated as one). When CFITSIO isn't thread-safe, the inputs are read on
+   one thread, so the outputs should always be the same. */
+int
+main(void)
+{
+  int out=0;
+  int32_t *d;
+  gal_data_t *img;
+  char hdu[10], filename[NUMFILES][50];
+  gal_list_str_t *filenames=NULL, *hdus=NULL;
+  size_t i, f, h, num, threads[]={0, 1, 4, 16};
+  size_t dsize[2]={NROWS, NCOLS}, fs[NUMFILES*NUMHDUS+2];
+  size_t hs[NUMFILES*NUMHDUS+2];
+
+  /* Write the files. */
+  for(f=0;f<NUMFILES;++f)
+    {
+      sprintf(filename[f], "arrayreadmany-%zu.fits", f);
+      remove(filename[f]);
+      for(h=0;h<NUMHDUS;++h)
+        {
+          img=gal_data_alloc(NULL, GAL_TYPE_INT32, 2, dsize, NULL, 0, -1,
+                             1, NULL, NULL, NULL);
+          d=img->array;
+          for(i=0;i<img->size;++i) d[i]=pixel_value(f, h, i);
+          gal_fits_img_write(img, filename[f], NULL, "arrayreadmany");
+          gal_data_free(img);
+        }
+    }
+
+  /* The inputs: the HDUs are the outer loop (so consecutive inputs are in
+     different files) and they are read in reverse order. The first and
+     last inputs are repeated at the end. */
+  num=0;
+  for(h=NUMHDUS;h-->0;)
+    for(f=0;f<NUMFILES;++f) { fs[num]=f; hs[num++]=h; }
+  fs[num]=fs[0];       hs[num]=hs[0];
+  fs[num+1]=fs[num-1]; hs[num+1]=hs[num-1];
+  num+=2;
+  for(i=0;i<num;++i)
+    {
+      sprintf(hdu, "%zu", hs[i]+1);
+      gal_list_str_add(&hdus, hdu, 1);
+      gal_list_str_add(&filenames, filename[fs[i]], 1);
+    }
+  gal_list_str_reverse(&hdus);
+  gal_list_str_reverse(&filenames);
+
+  /* Read them on different numbers of threads. */
+  for(i=0;i<sizeof threads/sizeof *threads;++i)
+    out |= read_check(filenames, hdus, fs, hs, num, threads[i]);
+
+  /* Clean up and return. */
+  gal_list_str_free(filenames, 1);
+  gal_list_str_free(hdus, 1);
+  return out ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,116 @@
+/*********************************************************************
+A test program for calculating the DATASUM of FITS HDUs.
+
+Original author:
+     agent <agent@local>
+Contributing author(s):
+Copyright (C) 2026 Free Software Foundation, Inc.
+
+Gnuastro is free software: you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by the
+Free Software Foundation, either version 3 of the License, or (at your
+option) any later version.
+
+Gnuastro is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Gnuastro. If not, see <http://www.gnu.org/licenses/>.
+**********************************************************************/
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "gnuastro/fits.h"
+#include "gnuastro/type.h"
+
+
+/* Number of images (HDUs after the empty zero-th HDU). The first two are
+   larger than one block of the threaded datasum (2880 kilo-bytes), with
+   sizes that aren't a multiple of the block or of 2880 bytes. */
+#define NUMIMGS 3
+
+
+
+
+/* Write an image with the given type and size into the file, the values
+   are pseudo-random (but the same on all systems). */
+static void
+image_write(char *filename, uint8_t type, size_t d0, size_t d1)
+{
+  size_t i;
+  gal_data_t *img;
+  unsigned char *b;
+  uint64_t r=88172645463325252ULL;
+  size_t dsize[2]={d0, d1};
+
+  img=gal_data_alloc(NULL, type, 2, dsize, NULL, 0, -1, 1, NULL, NULL,
+                     NULL);
+  b=img->array;
+  for(i=0;i<img->size*gal_type_sizeof(type);++i)
+    {
+      r^=r<<13; r^=r>>7; r^=r<<17;
+      b[i]=r>>56;
+    }
+  gal_fits_img_write(img, filename, NULL, "fitsdatasum");
+  gal_data_free(img);
+}
+
+
+
+
+/* Write a few images into one file, then compare the DATASUM of every HDU
+   (including the empty zero-th HDU) on one and many threads (zero should
+   be treated as one) with the DATASUM that is calculated by CFITSIO. */
+int
+main(void)
+{
+  char hdu[10];
+  int out=0, status=0;
+  fitsfile *fptr;
+  size_t i, t, threads[]={0, 1, 3, 8};
+  unsigned long direct, cfitsio;
+  char *filename="fitsdatasum.fits";
+
+  /* Write the images. */
+  remove(filename);
+  image_write(filename, GAL_TYPE_FLOAT64, 1001, 757);
+  image_write(filename, GAL_TYPE_UINT8,   3333, 1001);
+  image_write(filename, GAL_TYPE_INT16,   17,   13);
+
+  /* Check the datasums. */
+  for(i=0;i<=NUMIMGS;++i)
+    {
+      sprintf(hdu, "%zu", i);
+      fptr=gal_fits_hdu_open(filename, hdu, READONLY, 1);
+      cfitsio=gal_fits_hdu_datasum_ptr(fptr);
+      fits_close_file(fptr, &status);
+      gal_fits_io_error(status, NULL);
+
+      for(t=0;t<sizeof threads/sizeof *threads;++t)
+        {
+          direct=gal_fits_hdu_datasum_threads(filename, hdu, threads[t]);
+          if(direct!=cfitsio)
+            {
+              fprintf(stderr, "HDU %s on %zu threads: DATASUM is %lu (CFITSIO "
+                      "gives %lu)\n", hdu, threads[t], direct, cfitsio);
+              out=1;
+            }
+        }
+      printf("HDU %s: %s.\n", hdu, out ? "failed" : "passed");
+    }
+
+  /* The single-threaded function (of the same file). */
+  if( gal_fits_hdu_datasum(filename, "1")
+      != gal_fits_hdu_datasum_threads(filename, "1", 4) )
+    {
+      fprintf(stderr, "'gal_fits_hdu_datasum' is different from "
+              "'gal_fits_hdu_datasum_threads'\n");
+      out=1;
+    }
+
+  /* Return. */
+  return out ? EXIT_FAILURE : EXIT_SUCCESS;
+}
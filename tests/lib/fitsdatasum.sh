@@ -0,0 +1,50 @@
+# Run the program to test the DATASUM of FITS HDUs on many threads.
+#
+# See the Tests subsection of the manual for a complete explanation
+# (in the Installing gnuastro section).
+#
+# Original author:
+#     agent <agent@local>
+# Contributing author(s):
+# Copyright (C) 2026 Free Software Foundation, Inc.
+#
+# Copying and distribution of this file, with or without modification,
+# are permitted in any medium without royalty provided the copyright
+# notice and this notice are preserved.  This file is offered as-is,
+# without any warranty.
+
+
+
+
+
+# Preliminaries
+# =============
+#
+# Set the variables (The executable is in the build tree).
+execname=./fitsdatasum
+
+
+
+
+
+# SKIP or FAIL?
+# =============
+#
+# If the actual executable wasn't built, then this is a hard error and must
+# be FAIL.
+if [ ! -f $execname ]; then
+    echo "$execname library program not compiled.";
+    exit 99;
+fi;
+
+
+
+
+
+# Actual test script
+# ==================
+#
+# 'check_with_program' can be something like Valgrind or an empty
+# string. Such programs will execute the command if present and help in
+# debugging when the developer doesn't have access to the user's system.
+$check_with_program $execname
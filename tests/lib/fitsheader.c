@@ -0,0 +1,267 @@
+/*********************************************************************
+A test program for reading the keywords of a parsed FITS header.
+
+Original author:
+     agent <agent@local>
+Contributing author(s):
+Copyright (C) 2026 Free Software Foundation, Inc.
+
+Gnuastro is free software: you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by the
+Free Software Foundation, either version 3 of the License, or (at your
+option) any later version.
+
+Gnuastro is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Gnuastro. If not, see <http://www.gnu.org/licenses/>.
+**********************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "gnuastro/fits.h"
+#include "gnuastro/list.h"
+#include "gnuastro/type.h"
+
+
+/* Number of files that are read on multiple threads. */
+#define NUMFILES 7
+
+
+
+
+/* Cards that are added to the header (after the image's keywords).
+   'DUP' is repeated (only the first should be used), and the integers
+   are at (or beyond) the limits of the different types. */
+static char *cards[]={
+  "DUP     =                    1 / [m] First occurrence",
+  "DUP     =                    2 / Second occurrence",
+  "QUOTE   = 'it''s a test   '    / Doubled quote in a string",
+  "U8MAX   =                  255",
+  "U8OVER  =                  256",
+  "NEGONE  =                   -1",
+  "I64MIN  = -9223372036854775808",
+  "I64UNDER= -9223372036854775809",
+  "U64MAX  = 18446744073709551615",
+  "U64OVER = 18446744073709551616",
+  "FLOAT   =                  3.7",
+  "DEXP    =                1.5D2",
+  "LOGICAL =                    T",
+  "NOVALUE =",
+  NULL};
+
+
+
+
+/* Each check: the keyword and type to read, the expected CFITSIO status
+   and the expected value (for floating point types, it is parsed as a
+   'double' and compared numerically). */
+struct check
+{
+  char     *name;
+  uint8_t   type;
+  int     status;
+  char    *value;
+};
+
+static struct check checks[]={
+  {"DUP",      GAL_TYPE_INT32,   0,               "1"},
+  {"dup",      GAL_TYPE_INT32,   0,               "1"},
+  {"QUOTE",    GAL_TYPE_STRING,  0,               "it's a test"},
+  {"QUOTE",    GAL_TYPE_INT32,   BAD_C2I,         NULL},
+  {"U8MAX",    GAL_TYPE_UINT8,   0,               "255"},
+  {"U8OVER",   GAL_TYPE_UINT8,   NUM_OVERFLOW,    NULL},
+  {"U8OVER",   GAL_TYPE_INT16,   0,               "256"},
+  {"NEGONE",   GAL_TYPE_UINT32,  NUM_OVERFLOW,    NULL},
+  {"NEGONE",   GAL_TYPE_UINT64,  NUM_OVERFLOW,    NULL},
+  {"NEGONE",   GAL_TYPE_INT8,    0,               "-1"},
+  {"I64MIN",   GAL_TYPE_INT64,   0,               "-9223372036854775808"},
+  {"I64MIN",   GAL_TYPE_INT32,   NUM_OVERFLOW,    NULL},
+  {"I64UNDER", GAL_TYPE_INT64,   NUM_OVERFLOW,    NULL},
+  {"U64MAX",   GAL_TYPE_UINT64,  0,               "18446744073709551615"},
+  {"U64MAX",   GAL_TYPE_INT64,   NUM_OVERFLOW,    NULL},
+  {"U64OVER",  GAL_TYPE_UINT64,  NUM_OVERFLOW,    NULL},
+  {"U64OVER",  GAL_TYPE_FLOAT64, 0,               "18446744073709551616"},
+  {"FLOAT",    GAL_TYPE_INT32,   0,               "3"},
+  {"FLOAT",    GAL_TYPE_FLOAT32, 0,               "3.7"},
+  {"DEXP",     GAL_TYPE_FLOAT64, 0,               "150"},
+  {"LOGICAL",  GAL_TYPE_INT32,   0,               "1"},
+  {"NOVALUE",  GAL_TYPE_INT32,   VALUE_UNDEFINED, NULL},
+  {"MISSING",  GAL_TYPE_INT32,   KEY_NO_EXIST,    NULL},
+  {NULL,       0,                0,               NULL}};
+
+
+
+
+/* Read one keyword from the parsed header and check its status and value
+   (and the comment and unit of the first 'DUP'). */
+static int
+check_key(gal_fits_header_t *header, struct check *c)
+{
+  int out=0;
+  char *str=NULL;
+  gal_data_t *key=gal_data_array_calloc(1);
+
+  /* Read the keyword. */
+  key->name=c->name;
+  key->type=c->type;
+  gal_fits_header_key_read(header, key, 1, 1);
+
+  /* Check the status and value. */
+  if(key->status!=c->status)
+    {
+      fprintf(stderr, "%s (type %s): status is %d (instead of %d)\n",
+              c->name, gal_type_name(c->type, 1), key->status, c->status);
+      out=1;
+    }
+  else if(c->value)
+    {
+      if(c->type==GAL_TYPE_FLOAT32)
+        out = *(float *)(key->array) != (float)strtod(c->value, NULL);
+      else if(c->type==GAL_TYPE_FLOAT64)
+        out = *(double *)(key->array) != strtod(c->value, NULL);
+      else
+        {
+          str=gal_type_to_string(key->array, c->type, 0);
+          out = strcmp(str, c->value)!=0;
+        }
+      if(out)
+        fprintf(stderr, "%s (type %s): value is different from '%s'\n",
+                c->name, gal_type_name(c->type, 1), c->value);
+    }
+
+  /* The comment and unit of 'DUP' should be those of the first card. */
+  if( !strcmp(c->name, "DUP")
+      && ( key->comment==NULL || key->unit==NULL
+           || strcmp(key->comment, "[m] First occurrence")
+           || strcmp(key->unit, "m") ) )
+    {
+      fprintf(stderr, "DUP: wrong comment or unit\n");
+      out=1;
+    }
+
+  /* Clean up and return. */
+  free(str);
+  key->name=NULL;
+  gal_data_array_free(key, 1, 1);
+  return out;
+}
+
+
+
+
+/* Read a keyword as a string from the parsed header and with CFITSIO and
+   check that they are the same. */
+static int
+check_with_cfitsio(gal_fits_header_t *header, fitsfile *fptr, char *name)
+{
+  int out;
+  gal_data_t *parsed=gal_data_array_calloc(1);
+  gal_data_t *cfitsio=gal_data_array_calloc(1);
+
+  /* Read the keyword with both. */
+  parsed->name=cfitsio->name=name;
+  parsed->type=cfitsio->type=GAL_TYPE_STRING;
+  gal_fits_header_key_read(header, parsed, 0, 0);
+  gal_fits_key_read_from_ptr(fptr, cfitsio, 0, 0);
+
+  /* Compare them. */
+  out = ( parsed->status!=cfitsio->status
+          || ( parsed->status==0
+               && strcmp(*(char **)(parsed->array),
+                         *(char **)(cfitsio->array)) ) );
+  if(out)
+    fprintf(stderr, "%s: parsed header and CFITSIO are different\n",
+            name);
+
+  /* Clean up and return. */
+  parsed->name=cfitsio->name=NULL;
+  gal_data_array_free(parsed, 1, 1);
+  gal_data_array_free(cfitsio, 1, 1);
+  return out;
+}
+
+
+
+
+/* Write an image with the cards above (and a long string with 'CONTINUE'
+   cards) in its header, then read the keywords from the parsed header
+   (directly from the file, from a cache and with many files on multiple
+   threads) and check them. */
+int
+main(void)
+{
+  size_t i, t;
+  fitsfile *fptr;
+  gal_data_t *img;
+  int out=0, status=0;
+  gal_list_str_t *files=NULL;
+  size_t dsize[2]={3, 5}, threads[]={0, 1, 4};
+  char longstr[200], *filename="fitsheader.fits";
+  gal_fits_header_t *header, *cache=NULL, *cached, **many;
+
+  /* Write the image and add the cards. */
+  remove(filename);
+  img=gal_data_alloc(NULL, GAL_TYPE_UINT8, 2, dsize, NULL, 1, -1, 1,
+                     NULL, NULL, NULL);
+  gal_fits_img_write(img, filename, NULL, "fitsheader");
+  gal_data_free(img);
+  for(i=0;i<sizeof longstr-1;++i) longstr[i]='a'+i%26;
+  longstr[sizeof longstr-1]='\0';
+  fptr=gal_fits_hdu_open(filename, "1", READWRITE, 1);
+  for(i=0;cards[i];++i) fits_write_record(fptr, cards[i], &status);
+  fits_write_key_longstr(fptr, "LONGSTR", longstr, "Long string",
+                         &status);
+  fits_close_file(fptr, &status);
+  gal_fits_io_error(status, NULL);
+
+  /* Read the header and check the keywords. */
+  header=gal_fits_header_read(filename, "1", 1);
+  for(i=0;checks[i].name;++i) out |= check_key(header, checks+i);
+
+  /* Strings (including the long string) should be the same as CFITSIO. */
+  fptr=gal_fits_hdu_open(filename, "1", READONLY, 1);
+  out |= check_with_cfitsio(header, fptr, "DUP");
+  out |= check_with_cfitsio(header, fptr, "QUOTE");
+  out |= check_with_cfitsio(header, fptr, "LONGSTR");
+  fits_close_file(fptr, &status);
+  gal_fits_io_error(status, NULL);
+
+  /* The cached header should only be read once. */
+  cached=gal_fits_header_cache(&cache, filename, "1", 1);
+  if( cached==NULL
+      || gal_fits_header_cache(&cache, filename, "1", 1)!=cached
+      || cached->ncards!=header->ncards )
+    {
+      fprintf(stderr, "the cached header is different\n");
+      out=1;
+    }
+
+  /* Many files (the same file here) on one and many threads (zero should
+     be treated as one). */
+  for(i=0;i<NUMFILES;++i) gal_list_str_add(&files, filename, 0);
+  for(t=0;t<sizeof threads/sizeof *threads;++t)
+    {
+      many=gal_fits_header_read_many(files, "1", threads[t]);
+      for(i=0;i<NUMFILES;++i)
+        if( many[i]==NULL || many[i]->ncards!=header->ncards
+            || check_key(many[i], checks) )
+          {
+            fprintf(stderr, "%zu threads: header %zu is different\n",
+                    threads[t], i);
+            out=1;
+          }
+      gal_fits_header_array_free(many, NUMFILES);
+    }
+
+  /* Clean up and return. */
+  gal_list_str_free(files, 0);
+  gal_fits_header_free(header);
+  gal_fits_header_list_free(cache);
+  printf("%s.\n", out ? "failed" : "passed");
+  return out ? EXIT_FAILURE : EXIT_SUCCESS;
+}
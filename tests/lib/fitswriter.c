@@ -0,0 +1,180 @@
+/*********************************************************************
+A test program for the asynchronous writer of FITS images.
+
+Original author:
+     agent <agent@local>
+Contributing author(s):
+Copyright (C) 2026 Free Software Foundation, Inc.
+
+Gnuastro is free software: you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by the
+Free Software Foundation, either version 3 of the License, or (at your
+option) any later version.
+
+Gnuastro is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Gnuastro. If not, see <http://www.gnu.org/licenses/>.
+**********************************************************************/
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "gnuastro/fits.h"
+#include "gnuastro/blank.h"
+
+
+/* Number of HDUs that are written in each mode and size of each image. */
+#define NUMHDUS 5
+#define NROWS   137
+#define NCOLS   100
+
+
+
+
+/* Value of pixel 'i' in HDU 'k' (the even HDUs are 'int32' and the odd
+   ones are 'float32'). Some pixels are blank. */
+static double
+pixel_value(size_t k, size_t i)
+{
+  if(i%101==k) return NAN;
+  return k%2 ? (i+k)*0.5 : (double)i*(k+1)-5000;
+}
+
+
+
+
+/* Allocate the image of HDU 'k'. */
+static gal_data_t *
+image_make(size_t k)
+{
+  size_t i;
+  float *f;
+  int32_t *d;
+  gal_data_t *img;
+  size_t dsize[2]={NROWS, NCOLS};
+
+  img=gal_data_alloc(NULL, k%2 ? GAL_TYPE_FLOAT32 : GAL_TYPE_INT32, 2,
+                     dsize, NULL, 0, -1, 1, NULL, NULL, NULL);
+  f=img->array;
+  d=img->array;
+  for(i=0;i<img->size;++i)
+    if(k%2) f[i]=pixel_value(k, i);
+    else    d[i]=isnan(pixel_value(k, i)) ? GAL_BLANK_INT32
+                                          : pixel_value(k, i);
+  return img;
+}
+
+
+
+
+/* Read HDU 'k' (counting from zero) of 'filename' and compare it with
+   the image that was written. */
+static int
+image_check(char *filename, size_t k, size_t numthreads, char *title)
+{
+  size_t i;
+  int out=0;
+  float *f;
+  int32_t *d;
+  double v;
+  char hdu[10];
+  gal_data_t *img;
+
+  sprintf(hdu, "%zu", k+1);
+  img=gal_fits_img_read_threads(filename, hdu, numthreads, -1, 1);
+  if( img->type != (k%2 ? GAL_TYPE_FLOAT32 : GAL_TYPE_INT32)
+      || img->ndim!=2 || img->dsize[0]!=NROWS || img->dsize[1]!=NCOLS )
+    {
+      fprintf(stderr, "%s: HDU %s has a different type or size\n", title,
+              hdu);
+      gal_data_free(img);
+      return 1;
+    }
+  f=img->array;
+  d=img->array;
+  for(i=0;i<img->size && out==0;++i)
+    {
+      v=pixel_value(k, i);
+      if(k%2) out = isnan(v) ? !isnan(f[i]) : f[i]!=v;
+      else    out = isnan(v) ? d[i]!=GAL_BLANK_INT32 : d[i]!=v;
+      if(out)
+        fprintf(stderr, "%s: HDU %s, pixel %zu is different\n", title,
+                hdu, i);
+    }
+  gal_data_free(img);
+  return out;
+}
+
+
+
+
+/* Write the HDUs with the different ownership modes (and one with tile
+   compression) into one file, both on a separate I/O thread and
+   directly, then read them back (the compressed HDU is also read on
+   multiple threads). */
+int
+main(void)
+{
+  int async, out=0;
+  gal_fits_writer_t *w;
+  gal_data_t *img[NUMHDUS];
+  size_t k, numthreads=4;
+  char title[100], *filename;
+  char *names[]={"fitswriter-sync.fits", "fitswriter-async.fits"};
+
+  for(async=0; async<2; ++async)
+    {
+      /* Start the writer. With 'maxqueue=2', 'gal_fits_writer_img' will
+         block on the third HDU until the first one is written. */
+      filename=names[async];
+      remove(filename);
+      w=gal_fits_writer_start(2, async);
+      for(k=0;k<NUMHDUS;++k) img[k]=image_make(k);
+
+      /* Borrowed: the arrays must remain until the writer is waited
+         for. */
+      gal_fits_writer_img(w, img[0], filename, NULL, "fitswriter",
+                          GAL_FITS_COMPRESS_NONE, GAL_FITS_WRITER_BORROW);
+      gal_fits_writer_img(w, img[1], filename, NULL, "fitswriter",
+                          GAL_FITS_COMPRESS_NONE, GAL_FITS_WRITER_BORROW);
+
+      /* Copied: the input can be changed immediately. */
+      gal_fits_writer_img(w, img[2], filename, NULL, "fitswriter",
+                          GAL_FITS_COMPRESS_NONE, GAL_FITS_WRITER_COPY);
+      memset(img[2]->array, 0, img[2]->size*sizeof(int32_t));
+
+      /* Freed by the writer. */
+      gal_fits_writer_img(w, img[3], filename, NULL, "fitswriter",
+                          GAL_FITS_COMPRESS_NONE, GAL_FITS_WRITER_FREE);
+      img[3]=NULL;
+
+      /* Tile compressed (with blank pixels in an integer type). */
+      gal_fits_writer_img(w, img[4], filename, NULL, "fitswriter",
+                          GAL_FITS_COMPRESS_RICE, GAL_FITS_WRITER_BORROW);
+
+      /* Wait for all the HDUs to be written and check them. */
+      gal_fits_writer_wait(w);
+      for(k=0;k<NUMHDUS;++k)
+        {
+          sprintf(title, "%s, HDU %zu", async ? "async" : "sync", k+1);
+          out |= image_check(filename, k, 1, title);
+        }
+      sprintf(title, "%s, compressed HDU on %zu threads",
+              async ? "async" : "sync", numthreads);
+      out |= image_check(filename, NUMHDUS-1, numthreads, title);
+
+      /* Finish the writer and clean up. */
+      gal_fits_writer_finish(w);
+      for(k=0;k<NUMHDUS;++k) if(img[k]) gal_data_free(img[k]);
+      printf("%s: %s.\n", async ? "async" : "sync",
+             out ? "failed" : "passed");
+    }
+
+  /* Return. */
+  return out ? EXIT_FAILURE : EXIT_SUCCESS;
+}
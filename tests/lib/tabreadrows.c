@@ -0,0 +1,175 @@
+/*********************************************************************
+A test program for reading a subset of the rows of a table.
+
+Original author:
+     agent <agent@local>
+Contributing author(s):
+Copyright (C) 2026 Free Software Foundation, Inc.
+
+Gnuastro is free software: you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by the
+Free Software Foundation, either version 3 of the License, or (at your
+option) any later version.
+
+Gnuastro is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Gnuastro. If not, see <http://www.gnu.org/licenses/>.
+**********************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "gnuastro/list.h"
+#include "gnuastro/blank.h"
+#include "gnuastro/table.h"
+
+
+/* Number of rows in the table. */
+#define NUMROWS 10000
+
+
+
+
+/* Check that the 'n' rows of the columns that were read are the rows
+   given by 'ids' in the full table (that was written in 'main'). */
+static int
+rows_check(gal_data_t *cols, size_t *ids, size_t n, char *msg)
+{
+  size_t i;
+  int32_t *id;
+  double *x;
+  char **s, str[30];
+  float *v;
+
+  if( gal_list_data_number(cols)!=4 || cols->size!=n )
+    {
+      fprintf(stderr, "%s: %zu columns and %zu rows read (instead of 4 and "
+              "%zu)\n", msg, gal_list_data_number(cols),
+              cols ? cols->size : 0, n);
+      return 1;
+    }
+  id=cols->array;
+  x=cols->next->array;
+  s=cols->next->next->array;
+  v=cols->next->next->next->array;
+  for(i=0;i<n;++i)
+    {
+      sprintf(str, "row%zu", ids[i]);
+      if( id[i]!=(int32_t)ids[i] || x[i]!=ids[i]*0.5 || strcmp(s[i], str)
+          || v[i*2]!=ids[i]+0.25f || v[i*2+1]!=-(ids[i]+0.25f) )
+        {
+          fprintf(stderr, "%s: row %zu of the output is not row %zu of "
+                  "the table\n", msg, i, ids[i]);
+          return 1;
+        }
+    }
+  printf("%s: passed.\n", msg);
+  return 0;
+}
+
+
+
+
+/* Write a table (with a vector and a string column) into a FITS and a
+   plain-text file, then read a range of rows and a list of rows from
+   each with one and many threads. */
+int
+main(void)
+{
+  int out=0;
+  char **s, msg[200];
+  int32_t *id;
+  double *x;
+  float *v;
+  size_t i, f, t, n, *r, ids[NUMROWS];
+  gal_data_t *cols, *read, *rowids;
+  size_t threads[]={1, 4}, dsize[2]={NUMROWS, 2};
+  char *files[]={"tabreadrows.fits", "tabreadrows.txt"};
+
+
+  /* Build the columns. */
+  cols=gal_data_alloc(NULL, GAL_TYPE_INT32, 1, dsize, NULL, 0, -1, 1,
+                      "ID", NULL, NULL);
+  cols->next=gal_data_alloc(NULL, GAL_TYPE_FLOAT64, 1, dsize, NULL, 0,
+                            -1, 1, "X", NULL, NULL);
+  cols->next->next=gal_data_alloc(NULL, GAL_TYPE_STRING, 1, dsize, NULL,
+                                  0, -1, 1, "S", NULL, NULL);
+  cols->next->next->next=gal_data_alloc(NULL, GAL_TYPE_FLOAT32, 2, dsize,
+                                        NULL, 0, -1, 1, "V", NULL, NULL);
+  id=cols->array;
+  x=cols->next->array;
+  s=cols->next->next->array;
+  v=cols->next->next->next->array;
+  for(i=0;i<NUMROWS;++i)
+    {
+      id[i]=i;
+      x[i]=i*0.5;
+      s[i]=malloc(30);
+      sprintf(s[i], "row%zu", i);
+      v[i*2]=i+0.25f;
+      v[i*2+1]=-(i+0.25f);
+    }
+
+
+  /* Write the table into both files. */
+  for(f=0;f<2;++f)
+    {
+      remove(files[f]);
+      gal_table_write(cols, NULL, NULL, GAL_TABLE_FORMAT_BFITS, files[f],
+                      "TABLE", 0);
+    }
+  gal_list_data_free(cols);
+
+
+  /* The list of rows to read: every 7th row and the last one. */
+  rowids=gal_data_alloc(NULL, GAL_TYPE_SIZE_T, 1, dsize, NULL, 0, -1, 1,
+                        NULL, NULL, NULL);
+  r=rowids->array;
+  for(n=0, i=3; i<NUMROWS-1; i+=7) r[n++]=i;
+  r[n++]=NUMROWS-1;
+  rowids->size=rowids->dsize[0]=n;
+
+
+  /* Read the rows and check them. */
+  for(f=0;f<2;++f)
+    for(t=0;t<sizeof threads/sizeof *threads;++t)
+      {
+        /* A range of rows. */
+        for(i=0;i<2500;++i) ids[i]=1000+i;
+        sprintf(msg, "%s (%zu threads, rows 1000 to 3499)", files[f],
+                threads[t]);
+        read=gal_table_read_rows(files[f], "1", NULL, NULL,
+                                 GAL_TABLE_SEARCH_NAME, 0, 1000, 2500,
+                                 NULL, threads[t], -1, 1, NULL);
+        out |= rows_check(read, ids, 2500, msg);
+        gal_list_data_free(read);
+
+        /* All the rows after a given row. */
+        for(i=0;i<5;++i) ids[i]=NUMROWS-5+i;
+        sprintf(msg, "%s (%zu threads, last 5 rows)", files[f], threads[t]);
+        read=gal_table_read_rows(files[f], "1", NULL, NULL,
+                                 GAL_TABLE_SEARCH_NAME, 0, NUMROWS-5,
+                                 GAL_BLANK_SIZE_T, NULL, threads[t], -1, 1,
+                                 NULL);
+        out |= rows_check(read, ids, 5, msg);
+        gal_list_data_free(read);
+
+        /* A list of rows. */
+        sprintf(msg, "%s (%zu threads, %zu listed rows)", files[f],
+                threads[t], n);
+        read=gal_table_read_rows(files[f], "1", NULL, NULL,
+                                 GAL_TABLE_SEARCH_NAME, 0, 0, 0, rowids,
+                                 threads[t], -1, 1, NULL);
+        out |= rows_check(read, r, n, msg);
+        gal_list_data_free(read);
+      }
+
+
+  /* Clean up and return. */
+  gal_data_free(rowids);
+  return out ? EXIT_FAILURE : EXIT_SUCCESS;
+}
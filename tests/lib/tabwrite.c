@@ -0,0 +1,192 @@
+/*********************************************************************
+A test program for writing FITS binary tables with Gnuastro's library.
+
+Original author:
+     agent <agent@local>
+Contributing author(s):
+Copyright (C) 2026 Free Software Foundation, Inc.
+
+Gnuastro is free software: you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by the
+Free Software Foundation, either version 3 of the License, or (at your
+option) any later version.
+
+Gnuastro is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Gnuastro. If not, see <http://www.gnu.org/licenses/>.
+**********************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "gnuastro/list.h"
+#include "gnuastro/blank.h"
+#include "gnuastro/table.h"
+#include "gnuastro/pointer.h"
+
+
+/* Number of rows: large enough to need multiple blocks (that are filled
+   on different threads) when the rows are written together. */
+#define NUMROWS 100000
+
+
+
+
+/* Add a column to the end of the list. The values are derived from the
+   index of each element and every 97th row is blank. Signed types have
+   negative values to check the flipping of the sign-bit that CFITSIO does
+   for 'int8' (stored as unsigned bytes with 'TZERO=-128') and unsigned 16
+   and 32-bit integers (stored as signed integers with a 'TZERO'). */
+static void
+column_add(gal_data_t **cols, uint8_t type, size_t width, char *name)
+{
+  size_t i;
+  void *a;
+  gal_data_t *col, *t;
+  size_t ndim=width>1 ? 2 : 1, dsize[2]={NUMROWS, width};
+
+  col=gal_data_alloc(NULL, type, ndim, dsize, NULL, 0, -1, 1, name, NULL,
+                     NULL);
+  a=col->array;
+  for(i=0;i<col->size;++i)
+    if( (i/width)%97==0 )
+      {
+        if(type==GAL_TYPE_STRING) ((char **)a)[i]=strdup(GAL_BLANK_STRING);
+        else gal_blank_write(gal_pointer_increment(a, i, type), type);
+      }
+    else
+      switch(type)
+        {
+        case GAL_TYPE_UINT8:   ((uint8_t  *)a)[i] = i%200;             break;
+        case GAL_TYPE_INT8:    ((int8_t   *)a)[i] = i%200 - 100;       break;
+        case GAL_TYPE_UINT16:  ((uint16_t *)a)[i] = 60000 - i%60000;   break;
+        case GAL_TYPE_INT16:   ((int16_t  *)a)[i] = i%30000 - 15000;   break;
+        case GAL_TYPE_UINT32:  ((uint32_t *)a)[i] = 4000000000U - i;   break;
+        case GAL_TYPE_INT32:   ((int32_t  *)a)[i] = i - 2000000000;    break;
+        case GAL_TYPE_UINT64:  ((uint64_t *)a)[i] = UINT64_MAX/2 + i;  break;
+        case GAL_TYPE_INT64:   ((int64_t  *)a)[i] = i - INT64_MAX/2;   break;
+        case GAL_TYPE_FLOAT32: ((float *)a)[i] = i%89 ? i*-1.25e-3f : -0.0f;
+                               break;
+        case GAL_TYPE_FLOAT64: ((double *)a)[i] = i%89 ? i*3.3e100 : -0.0;
+                               break;
+        default:
+          ((char **)a)[i]=malloc(20);
+          sprintf(((char **)a)[i], "s%zu", i%1234);
+        }
+
+  /* Put it at the end of the list (to keep the order of the columns). */
+  if(*cols) { for(t=*cols; t->next!=NULL; t=t->next) {} t->next=col; }
+  else      *cols=col;
+}
+
+
+
+
+/* Read the table and compare it with 'repeat' copies of the written
+   columns (one after the other). Floating point values are compared
+   bit-by-bit (to check negative zero), only blank values (NaN) can have
+   different bits. */
+static int
+table_check(gal_data_t *cols, char *filename, size_t numthreads,
+            size_t repeat, char *title)
+{
+  size_t i;
+  int out=0;
+  void *w, *r;
+  gal_data_t *wcol, *rcol, *read;
+
+  read=gal_table_read(filename, "1", NULL, NULL, GAL_TABLE_SEARCH_NAME, 0,
+                      numthreads, -1, 1, NULL);
+  for(wcol=cols, rcol=read; wcol!=NULL && out==0;
+      wcol=wcol->next, rcol=rcol->next)
+    {
+      if( rcol==NULL || rcol->type!=wcol->type
+          || rcol->size!=wcol->size*repeat )
+        {
+          fprintf(stderr, "%s: column '%s' has a different type or size "
+                  "after reading\n", title, wcol->name);
+          out=1;
+          break;
+        }
+      for(i=0;i<rcol->size && out==0;++i)
+        {
+          w=gal_pointer_increment(wcol->array, i%wcol->size, wcol->type);
+          r=gal_pointer_increment(rcol->array, i, wcol->type);
+          if(wcol->type==GAL_TYPE_STRING)
+            out = strcmp(*(char **)w, *(char **)r)!=0;
+          else if( !gal_blank_is(w, wcol->type)
+                   || !gal_blank_is(r, wcol->type) )
+            out = memcmp(w, r, gal_type_sizeof(wcol->type))!=0;
+          if(out)
+            fprintf(stderr, "%s: column '%s', element %zu is different "
+                    "after reading\n", title, wcol->name, i);
+        }
+    }
+  gal_list_data_free(read);
+  if(out==0) printf("%s: passed.\n", title);
+  return out;
+}
+
+
+
+
+/* Write tables with all the types that CFITSIO stores in a different
+   format than the host (big-endian byte order, and offsets with 'TZERO'),
+   then read them back and check all the values. When all the columns can
+   be written as raw bytes, the rows are written together (here, the
+   buffer of the rows is also forced to be memory-mapped). A 'uint64'
+   column can't be written as raw bytes (its 'TZERO' doesn't fit in a
+   64-bit signed integer), so with it, the columns are written one by
+   one. The same rows are then appended to both tables. */
+int
+main(void)
+{
+  int out=0;
+  gal_data_t *cols=NULL;
+  size_t numthreads=4;   /* Independent of the CPU to use many blocks. */
+  char *raw="tabwrite-raw.fits", *fallback="tabwrite-fallback.fits";
+
+
+  /* Build the columns. */
+  column_add(&cols, GAL_TYPE_UINT8,   1, "UINT8");
+  column_add(&cols, GAL_TYPE_INT8,    1, "INT8");
+  column_add(&cols, GAL_TYPE_UINT16,  1, "UINT16");
+  column_add(&cols, GAL_TYPE_INT16,   1, "INT16");
+  column_add(&cols, GAL_TYPE_UINT32,  1, "UINT32");
+  column_add(&cols, GAL_TYPE_INT32,   1, "INT32");
+  column_add(&cols, GAL_TYPE_INT64,   1, "INT64");
+  column_add(&cols, GAL_TYPE_FLOAT32, 1, "FLOAT32");
+  column_add(&cols, GAL_TYPE_FLOAT64, 1, "FLOAT64");
+  column_add(&cols, GAL_TYPE_FLOAT32, 3, "VECTOR");
+  column_add(&cols, GAL_TYPE_STRING,  1, "STRING");
+
+
+  /* Write all the rows together and check. */
+  remove(raw);
+  cols->minmapsize=1;
+  gal_table_write_threads(cols, NULL, NULL, GAL_TABLE_FORMAT_BFITS, raw,
+                          "RAW", 0, numthreads);
+  out |= table_check(cols, raw, numthreads, 1, "Rows together");
+  gal_table_write_append(cols, raw, numthreads);
+  out |= table_check(cols, raw, numthreads, 2, "Rows together, appended");
+
+
+  /* Add a 'uint64' column and check the column-by-column writing. */
+  remove(fallback);
+  column_add(&cols, GAL_TYPE_UINT64, 1, "UINT64");
+  gal_table_write_threads(cols, NULL, NULL, GAL_TABLE_FORMAT_BFITS,
+                          fallback, "FALLBACK", 0, numthreads);
+  out |= table_check(cols, fallback, numthreads, 1, "Columns one by one");
+  gal_table_write_append(cols, fallback, numthreads);
+  out |= table_check(cols, fallback, numthreads, 2,
+                     "Columns one by one, appended");
+
+
+  /* Clean up and return. */
+  gal_list_data_free(cols);
+  return out ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,156 @@
+/*********************************************************************
+A test program for reading plain-text tables with Gnuastro's library.
+
+Original author:
+     agent <agent@local>
+Contributing author(s):
+Copyright (C) 2026 Free Software Foundation, Inc.
+
+Gnuastro is free software: you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by the
+Free Software Foundation, either version 3 of the License, or (at your
+option) any later version.
+
+Gnuastro is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Gnuastro. If not, see <http://www.gnu.org/licenses/>.
+**********************************************************************/
+#include <math.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "gnuastro/list.h"
+#include "gnuastro/table.h"
+
+
+/* Number of rows: the file should be a few times larger than the minimum
+   size that is parsed by one thread (one mega-byte), so it is divided
+   into chunks that start in the middle of lines. */
+#define NUMROWS 150000
+
+
+/* Floating point tokens that are harder to parse: overflow, underflow,
+   denormals, more digits than a 64-bit integer, exact ties between two
+   'double's and different forms of writing the same number. */
+static char *special[]={"0", "-0", "+0", "0.0", "-0.0", ".5", "-.5", "5.",
+                        "+.25", "007.50", "1e0", "1E5", "1e-5", "1e+22",
+                        "1e23", "-1e-22", "1e-23", "123.456e-20", "0.1",
+                        "0.0000000000000000000000000000001234",
+                        "9007199254740993", "18446744073709551616",
+                        "123456789012345678901234567890",
+                        "1.000000000000000111022302462515654"
+                        "04236316680908203125",
+                        "1.7976931348623157e308", "1.8e308", "-1e400",
+                        "2.2250738585072011e-308", "4.9e-324", "2.4e-324",
+                        "1e99999999999", "1e-99999999999", "0x1p-3",
+                        "inf", "-INF", "infinity", "nan", "3.4028236e38",
+                        "1.4e-45", "16777217"};
+
+
+
+
+/* The three tokens of each row (floating point, signed and unsigned
+   integers): after the special cases, they are pseudo-random (but the
+   same on all systems) with different numbers of digits and exponents. */
+static void
+row_tokens(size_t i, char *f, char *s, char *u)
+{
+  uint64_t r=i*6364136223846793005ULL+1442695040888963407ULL;
+  size_t nspecial=sizeof special/sizeof *special;
+
+  if(i<nspecial) strcpy(f, special[i]);
+  else sprintf(f, "%s%.*f%s%d", r%3 ? "" : "-", (int)(r%19),
+               (double)(r>>11)/(double)(1ULL<<(r%50)),
+               r%2 ? "e" : "", r%2 ? (int)(r%600)-300 : 0);
+  sprintf(s, "%s%llu", r%5 ? "" : "-",
+          (unsigned long long)((r>>1) >> (r%63)));
+  sprintf(u, "%s%llu", i%7 ? "" : "000", (unsigned long long)r);
+}
+
+
+
+
+/* Write a plain-text table with CRLF and LF line endings, different
+   delimiters, comments, empty lines and no new-line at the end. Then read
+   it on different numbers of threads (so the chunks start at different
+   places) and compare the values with the C library's parsers. */
+int
+main(void)
+{
+  FILE *fp;
+  int64_t *i64;
+  uint64_t *u64;
+  int bad, out=0;
+  float fl, *f32;
+  double d, *f64;
+  gal_data_t *cols;
+  size_t i, t, threads[]={1, 3, 4};
+  char f[100], s[100], u[100], *filename="txtread.txt";
+
+
+  /* Write the table. */
+  fp=fopen(filename, "w");
+  if(fp==NULL) { fprintf(stderr, "%s: couldn't open\n", filename); exit(1); }
+  fprintf(fp, "# Column 1: F64 [,f64] 64-bit floating point.\n");
+  fprintf(fp, "# Column 2: F32 [,f32] 32-bit floating point.\n");
+  fprintf(fp, "# Column 3: I64 [,i64] Signed integer.\n");
+  fprintf(fp, "# Column 4: U64 [,u64] Unsigned integer.\n");
+  for(i=0;i<NUMROWS;++i)
+    {
+      row_tokens(i, f, s, u);
+      fprintf(fp, "%s%s%s%s\t%s , %s%s", i%2 ? " " : "", f,
+              i%3 ? " " : ",", f, s, u,
+              i==NUMROWS-1 ? "" : (i%3 ? "\n" : "\r\n"));
+      if(i%1001==500) fprintf(fp, "# A comment.\r\n");
+      if(i%1003==7)   fprintf(fp, "\n");
+    }
+  fclose(fp);
+
+
+  /* Read it with different numbers of threads and check every value.
+     Floating points are compared bit-by-bit (to check negative zero),
+     except for NaN. */
+  for(t=0;t<sizeof threads/sizeof *threads;++t)
+    {
+      cols=gal_table_read(filename, NULL, NULL, NULL, GAL_TABLE_SEARCH_NAME,
+                          0, threads[t], -1, 1, NULL);
+      if( gal_list_data_number(cols)!=4 || cols->size!=NUMROWS )
+        {
+          fprintf(stderr, "%zu threads: %zu columns and %zu rows read\n",
+                  threads[t], gal_list_data_number(cols), cols->size);
+          return EXIT_FAILURE;
+        }
+      f64=cols->array;
+      f32=cols->next->array;
+      i64=cols->next->next->array;
+      u64=cols->next->next->next->array;
+      for(i=0;i<NUMROWS;++i)
+        {
+          row_tokens(i, f, s, u);
+          d=strtod(f, NULL);
+          fl=d;
+          bad  = isnan(d)  ? !isnan(f64[i]) : memcmp(&d,  f64+i, sizeof d);
+          bad |= isnan(fl) ? !isnan(f32[i]) : memcmp(&fl, f32+i, sizeof fl);
+          bad |= i64[i]!=strtol(s, NULL, 10) || u64[i]!=strtoul(u, NULL, 10);
+          if(bad)
+            {
+              fprintf(stderr, "%zu threads: row %zu ('%s %s %s') not read "
+                      "correctly\n", threads[t], i+1, f, s, u);
+              out=1;
+              break;
+            }
+        }
+      printf("%zu threads: %s.\n", threads[t], out ? "failed" : "passed");
+      gal_list_data_free(cols);
+    }
+
+
+  /* Return. */
+  return out ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,279 @@
+/*********************************************************************
+A test program for writing plain-text tables with Gnuastro's library.
+
+Original author:
+     agent <agent@local>
+Contributing author(s):
+Copyright (C) 2026 Free Software Foundation, Inc.
+
+Gnuastro is free software: you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by the
+Free Software Foundation, either version 3 of the License, or (at your
+option) any later version.
+
+Gnuastro is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Gnuastro. If not, see <http://www.gnu.org/licenses/>.
+**********************************************************************/
+#include <math.h>
+#include <float.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "gnuastro/txt.h"
+#include "gnuastro/list.h"
+#include "gnuastro/blank.h"
+#include "gnuastro/table.h"
+
+
+/* Number of rows: large enough to be printed in multiple blocks (on
+   different threads). */
+#define NUMROWS 20000
+
+
+
+
+/* Add a column to the end of the list and fill it: the first rows of
+   floating point columns are values that need special care in printing
+   (exact ties, values that round up to the next power of ten, the
+   extremes and negative zero), the rest are pseudo-random (but the same
+   on all systems) with a wide range of exponents. Signed columns have
+   negative values and the last column is a vector (with two elements). */
+static void
+column_add(gal_data_t **cols, uint8_t type, uint8_t fmt, int precision)
+{
+  char **str;
+  uint64_t r;
+  gal_data_t *col, *t;
+  double v, max, *d;
+  int isunsigned = ( type==GAL_TYPE_UINT8 || type==GAL_TYPE_UINT16
+                     || type==GAL_TYPE_UINT32 || type==GAL_TYPE_UINT64 );
+  size_t i, j, width=type==GAL_TYPE_INT16 ? 2 : 1;
+  size_t ndim=width==2 ? 2 : 1, dsize[2]={NUMROWS, width};
+  double special[]={0.0, -0.0, 0.5, 1.5, 2.5, -2.5, 0.125, 0.1, 1.0/3,
+                    9.9999995, 0.95, 99.5, 999999.5, 1e15, 1e16, 1e17,
+                    1e22, 1e23, -1e23, 123456789012345678.0, DBL_MAX,
+                    DBL_MIN, DBL_MIN/3, 1e-300, FLT_MAX, FLT_MIN, 5e-5,
+                    0.00015, INFINITY, -INFINITY, NAN};
+  size_t nspecial=sizeof special/sizeof *special;
+
+  /* Allocate the column (as 64-bit floating point). */
+  col=gal_data_alloc(NULL, GAL_TYPE_FLOAT64, ndim, dsize, NULL, 0, -1, 1,
+                     "COL", NULL, NULL);
+  d=col->array;
+  for(i=0;i<NUMROWS;++i)
+    {
+      r=i*6364136223846793005ULL+1442695040888963407ULL;
+      switch(i%3)
+        {
+        case 0:  v=ldexp(r>>11, -53) * pow(10, (int)(r%61)-30);  break;
+        case 1:  v=((r>>11)%100000)/1000.0+0.0005;                break;
+        default: v=(double)((r>>11)%100000);
+        }
+      if(r%2) v=-v;
+      if(i<nspecial) v=special[i];
+      if(i%97==96)   v=NAN;
+      for(j=0;j<width;++j) d[i*width+j]=v;
+    }
+
+  /* Convert it to the desired type (strings are based on the values). */
+  if(type==GAL_TYPE_STRING)
+    {
+      str=malloc(NUMROWS*sizeof *str);
+      for(i=0;i<NUMROWS;++i)
+        {
+          str[i]=malloc(30);
+          sprintf(str[i], "%.*s", (int)(i%20), "abcdefghijklmnopqrstuvw");
+        }
+      gal_data_free(col);
+      col=gal_data_alloc(str, GAL_TYPE_STRING, 1, dsize, NULL, 0, -1, 1,
+                         "COL", NULL, NULL);
+    }
+  else if(type!=GAL_TYPE_FLOAT64)
+    {
+      /* Integers should be within the range of the type. */
+      if(type!=GAL_TYPE_FLOAT32)
+        {
+          max = ( gal_type_sizeof(type)==1 ? 100 : gal_type_sizeof(type)==2
+                  ? 30000 : gal_type_sizeof(type)==4 ? 2e9 : 9e18 );
+          for(i=0;i<col->size;++i)
+            {
+              d[i] = isfinite(d[i]) ? round(fmod(d[i], max)) : 7;
+              if(isunsigned) d[i]=fabs(d[i]);
+            }
+        }
+      col=gal_data_copy_to_new_type_free(col, type);
+    }
+
+  /* Set the display formats and add it to the end of the list. */
+  col->disp_fmt=fmt;
+  col->disp_precision=precision;
+  col->disp_width=type==GAL_TYPE_FLOAT32 || type==GAL_TYPE_FLOAT64 ? 25 : 0;
+  if(*cols) { for(t=*cols; t->next!=NULL; t=t->next) {} t->next=col; }
+  else      *cols=col;
+}
+
+
+
+
+/* Print one value with 'sprintf' and the format that is described in the
+   manual for plain-text tables: left-adjusted (with a space for the sign
+   in signed columns) and the last value of each row has no width. The
+   width and precision are the ones that 'gal_txt_write' used. */
+static char *
+value_print(char *out, gal_data_t *col, size_t ind, int last)
+{
+  void *a=col->array;
+  char *lng, *space, fmt[50], prec[20]="", conv;
+  int isunsigned = ( col->type==GAL_TYPE_UINT8
+                     || col->type==GAL_TYPE_UINT16
+                     || col->type==GAL_TYPE_UINT32
+                     || col->type==GAL_TYPE_UINT64 );
+
+  /* The conversion character. */
+  switch(col->disp_fmt)
+    {
+    case GAL_TABLE_DISPLAY_FMT_FIXED:   conv='f'; break;
+    case GAL_TABLE_DISPLAY_FMT_GENERAL: conv='g'; break;
+    case GAL_TABLE_DISPLAY_FMT_OCTAL:   conv='o'; break;
+    case GAL_TABLE_DISPLAY_FMT_HEX:     conv='X'; break;
+    default:
+      conv = ( col->type==GAL_TYPE_STRING ? 's'
+               : isunsigned ? 'u'
+               : col->type==GAL_TYPE_FLOAT32 || col->type==GAL_TYPE_FLOAT64
+               ? 'e' : 'd' );
+    }
+
+  /* The format. */
+  if(col->disp_precision!=GAL_BLANK_INT)
+    sprintf(prec, ".%d", col->disp_precision);
+  lng = col->type==GAL_TYPE_UINT64 || col->type==GAL_TYPE_INT64 ? "l" : "";
+  space = isunsigned || col->type==GAL_TYPE_STRING ? "" : " ";
+  if(last) sprintf(fmt, "%%%s%s%s%c", space, prec, lng, conv);
+  else     sprintf(fmt, "%%%s-%d%s%s%c ", space, col->disp_width, prec,
+                   lng, conv);
+
+  /* Print the value. */
+  switch(col->type)
+    {
+    case GAL_TYPE_UINT8:   return out+sprintf(out, fmt, ((uint8_t *)a)[ind]);
+    case GAL_TYPE_INT8:    return out+sprintf(out, fmt, ((int8_t *)a)[ind]);
+    case GAL_TYPE_UINT16:  return out+sprintf(out, fmt, ((uint16_t*)a)[ind]);
+    case GAL_TYPE_INT16:   return out+sprintf(out, fmt, ((int16_t *)a)[ind]);
+    case GAL_TYPE_UINT32:  return out+sprintf(out, fmt, ((uint32_t*)a)[ind]);
+    case GAL_TYPE_INT32:   return out+sprintf(out, fmt, ((int32_t *)a)[ind]);
+    case GAL_TYPE_UINT64:  return out+sprintf(out, fmt, ((uint64_t*)a)[ind]);
+    case GAL_TYPE_INT64:   return out+sprintf(out, fmt, ((int64_t *)a)[ind]);
+    case GAL_TYPE_FLOAT32: return out+sprintf(out, fmt, ((float *)a)[ind]);
+    case GAL_TYPE_FLOAT64: return out+sprintf(out, fmt, ((double *)a)[ind]);
+    default:               return out+sprintf(out, fmt, ((char **)a)[ind]);
+    }
+}
+
+
+
+
+/* Write plain-text tables with all the column types and formats on one
+   and many threads, then compare each row with what 'printf' prints. The
+   writer has its own formatters for the common formats, so this checks
+   them against the C library. */
+int
+main(void)
+{
+  FILE *fp;
+  int p, out=0;
+  ssize_t linelen;
+  gal_data_t *col, *cols=NULL;
+  size_t j, t, w, row, linesize=0, threads[]={1, 4};
+  char *o, *line=NULL, *expected, *filename="txtwrite.txt";
+  int precisions[]={0, 1, 5, 9, 17, GAL_BLANK_INT};
+  uint8_t f, fmts[]={GAL_TABLE_DISPLAY_FMT_FIXED, GAL_TABLE_DISPLAY_FMT_EXP,
+                     GAL_TABLE_DISPLAY_FMT_GENERAL};
+
+
+  /* Floating point columns with the default format and different formats
+     and precisions (a 32-bit float has no more than 9 significant
+     digits). */
+  column_add(&cols, GAL_TYPE_FLOAT64, 0, GAL_BLANK_INT);
+  column_add(&cols, GAL_TYPE_FLOAT32, 0, GAL_BLANK_INT);
+  for(f=0;f<3;++f)
+    for(p=0;p<6;++p)
+      {
+        column_add(&cols, GAL_TYPE_FLOAT64, fmts[f], precisions[p]);
+        if(precisions[p]!=17)
+          column_add(&cols, GAL_TYPE_FLOAT32, fmts[f], precisions[p]);
+      }
+
+
+  /* Integer and string columns, the last column is a vector. */
+  column_add(&cols, GAL_TYPE_UINT8,  0, GAL_BLANK_INT);
+  column_add(&cols, GAL_TYPE_INT8,   0, GAL_BLANK_INT);
+  column_add(&cols, GAL_TYPE_UINT16, GAL_TABLE_DISPLAY_FMT_OCTAL,
+             GAL_BLANK_INT);
+  column_add(&cols, GAL_TYPE_INT32,  0, 4);
+  column_add(&cols, GAL_TYPE_UINT32, GAL_TABLE_DISPLAY_FMT_HEX,
+             GAL_BLANK_INT);
+  column_add(&cols, GAL_TYPE_UINT64, 0, GAL_BLANK_INT);
+  column_add(&cols, GAL_TYPE_INT64,  0, GAL_BLANK_INT);
+  column_add(&cols, GAL_TYPE_STRING, 0, GAL_BLANK_INT);
+  column_add(&cols, GAL_TYPE_INT16,  0, GAL_BLANK_INT);
+
+
+  /* Write the table on different numbers of threads and check each
+     row. */
+  expected=malloc(gal_list_data_number(cols)*1000);
+  for(t=0;t<sizeof threads/sizeof *threads;++t)
+    {
+      remove(filename);
+      gal_txt_write_threads(cols, NULL, NULL, filename, 0, 0, threads[t]);
+      fp=fopen(filename, "r");
+      if(fp==NULL) { fprintf(stderr, "%s: can't open\n", filename); exit(1); }
+      row=0;
+      while( (linelen=getline(&line, &linesize, fp))!=-1 && out==0 )
+        {
+          /* Ignore the metadata and the new-line character. */
+          if(line[0]=='#') continue;
+          if(linelen && line[linelen-1]=='\n') line[linelen-1]='\0';
+
+          /* Print the expected row and compare. */
+          o=expected;
+          *o='\0';
+          if(row<NUMROWS)
+            for(col=cols; col!=NULL; col=col->next)
+              {
+                w = col->ndim==2 ? col->dsize[1] : 1;
+                for(j=0;j<w;++j)
+                  o=value_print(o, col, row*w+j,
+                                col->next==NULL && j==w-1);
+              }
+          if( row>=NUMROWS || strcmp(line, expected) )
+            {
+              fprintf(stderr, "%zu threads: row %zu is different:\n  "
+                      "written:  '%s'\n  expected: '%s'\n", threads[t],
+                      row+1, line, row>=NUMROWS ? "(no row)" : expected);
+              out=1;
+            }
+          ++row;
+        }
+      fclose(fp);
+      if(out==0 && row!=NUMROWS)
+        {
+          fprintf(stderr, "%zu threads: %zu rows written\n", threads[t], row);
+          out=1;
+        }
+      printf("%zu threads: %s.\n", threads[t], out ? "failed" : "passed");
+    }
+
+
+  /* Clean up and return. */
+  free(line);
+  free(expected);
+  gal_list_data_free(cols);
+  return out ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,135 @@
+# Compare MakeCatalog's incremental mode ('--prevcat') with full runs.
+#
+# See the Tests subsection of the manual for a complete explanation
+# (in the Installing gnuastro section).
+#
+# Original author:
+#     agent <agent@local>
+# Contributing author(s):
+# Copyright (C) 2026 Free Software Foundation, Inc.
+#
+# Copying and distribution of this file, with or without modification,
+# are permitted in any medium without royalty provided the copyright
+# notice and this notice are preserved.  This file is offered as-is,
+# without any warranty.
+
+
+
+
+
+# Preliminaries
+# =============
+#
+# Set the variables (The executable is in the build tree). Do the
+# basic checks to see if the executable is made or if the defaults
+# file exists (basicchecks.sh is in the source tree).
+prog=mkcatalog
+execname=../bin/$prog/ast$prog
+arith=../bin/arithmetic/astarithmetic
+img=convolve_spatial_noised_detected_segmented.fits
+
+
+
+
+
+# Skip?
+# =====
+#
+# If the dependencies of the test don't exist, then skip it. There are two
+# types of dependencies:
+#
+#   - The executable was not made (for example due to a configure option),
+#
+#   - The input data was not made (for example the test that created the
+#     data file failed).
+if [ ! -f $execname ]; then echo "$execname not created."; exit 77; fi
+if [ ! -f $arith    ]; then echo "$arith not created.";    exit 77; fi
+if [ ! -f $img      ]; then echo "$img does not exist.";   exit 77; fi
+
+
+
+
+
+# Actual test script
+# ==================
+#
+# 'check_with_program' can be something like 'Valgrind' or an empty
+# string. Such programs will execute the command if present and help in
+# debugging when the developer doesn't have access to the user's system.
+#
+# The upper-limit measurements use a fixed seed, so the full and
+# incremental runs can be compared row by row. The comment lines at the
+# start of the text tables contain the date and the checksums, so they
+# are ignored in the comparison.
+export GSL_RNG_SEED=1
+cols="--ids --x --y --magnitude --sn --upperlimit-mag --envseed"
+prev="--prevlabels=$img --prevlabelshdu=OBJECTS"
+prev="$prev --prevvalues=$img --prevvalueshdu=1"
+prev="$prev --prevclumps=$img --prevclumpshdu=CLUMPS"
+prev="$prev --prevclumpscat=incremental-full_c.txt"
+same()
+{
+  for s in o c; do
+    grep -v '^#' $1_$s.txt > incremental-a.txt
+    grep -v '^#' $2_$s.txt > incremental-b.txt
+    if ! cmp incremental-a.txt incremental-b.txt; then
+      echo "$1_$s.txt and $2_$s.txt are different"; exit 1
+    fi
+  done
+}
+
+# The full catalog (that is used as the previous catalog).
+$check_with_program $execname $img $cols --instd=$img --clumpscat \
+                    --checksums --tableformat=txt \
+                    --output=incremental-full.txt || exit 1
+
+# Nothing has changed: all rows should be reused.
+$check_with_program $execname $img $cols --instd=$img --clumpscat \
+                    --tableformat=txt --output=incremental-same.txt \
+                    --prevcat=incremental-full_o.txt $prev \
+                    > incremental.log || exit 1
+same incremental-full incremental-same
+n=$(awk '/Incremental:.*objects reused/{print ($3==$5) ? "all" : "some"}' \
+        incremental.log)
+if [ x"$n" != xall ]; then echo "not all objects were reused"; exit 1; fi
+
+# A new column: it should be measured for all objects, while the other
+# columns are copied.
+$check_with_program $execname $img $cols --area --instd=$img --clumpscat \
+                    --tableformat=txt --output=incremental-areafull.txt \
+                    || exit 1
+$check_with_program $execname $img $cols --area --instd=$img --clumpscat \
+                    --tableformat=txt --output=incremental-area.txt \
+                    --prevcat=incremental-full_o.txt $prev || exit 1
+same incremental-areafull incremental-area
+
+# Change the values of the first object: only that object should be
+# measured again (the upper-limit columns are measured again for all
+# objects, since the values of the image have changed).
+$check_with_program $arith $img $img 1 eq 1000 where -h1 -hOBJECTS \
+                    --output=incremental-values.fits || exit 1
+$check_with_program $execname $img $cols --instd=$img --clumpscat \
+                    --valuesfile=incremental-values.fits --valueshdu=1 \
+                    --tableformat=txt --output=incremental-valfull.txt \
+                    || exit 1
+$check_with_program $execname $img $cols --instd=$img --clumpscat \
+                    --valuesfile=incremental-values.fits --valueshdu=1 \
+                    --tableformat=txt --output=incremental-val.txt \
+                    --prevcat=incremental-full_o.txt $prev \
+                    > incremental.log || exit 1
+same incremental-valfull incremental-val
+n=$(awk '/Incremental:.*objects reused/{print $5-$3}' incremental.log)
+if [ x"$n" != x1 ]; then echo "$n objects measured (instead of 1)"; exit 1; fi
+
+# A values image that didn't produce the previous catalog should be
+# rejected (it is run without 'check_with_program', because it should
+# fail).
+if $execname $img $cols --instd=$img --clumpscat --tableformat=txt \
+             --valuesfile=incremental-values.fits --valueshdu=1 \
+             --output=incremental-bad.txt --prevcat=incremental-full_o.txt \
+             --prevlabels=$img --prevlabelshdu=OBJECTS --prevclumps=$img \
+             --prevclumpshdu=CLUMPS --prevclumpscat=incremental-full_c.txt \
+             --prevvalues=incremental-values.fits --prevvalueshdu=1 \
+             2> /dev/null; then
+  echo "wrong '--prevvalues' was accepted"; exit 1
+fi
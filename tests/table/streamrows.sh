@@ -0,0 +1,87 @@
+# Process a FITS table in chunks of rows ('--streamrows') and make sure
+# the output is identical to processing the full table.
+#
+# See the Tests subsection of the manual for a complete explanation
+# (in the Installing gnuastro section).
+#
+# Original author:
+#     agent <agent@local>
+# Contributing author(s):
+# Copyright (C) 2026 Free Software Foundation, Inc.
+#
+# Copying and distribution of this file, with or without modification,
+# are permitted in any medium without royalty provided the copyright
+# notice and this notice are preserved.  This file is offered as-is,
+# without any warranty.
+
+
+
+
+
+# Preliminaries
+# =============
+#
+# Set the variables (The executable is in the build tree). Do the
+# basic checks to see if the executable is made or if the defaults
+# file exists (basicchecks.sh is in the source tree).
+prog=table
+table=binary-table.fits
+execname=../bin/$prog/ast$prog
+
+
+
+
+
+# Skip?
+# =====
+#
+# If the dependencies of the test don't exist, then skip it. There are two
+# types of dependencies:
+#
+#   - The executable was not made (for example due to a configure option),
+#
+#   - The input data was not made (for example the test that created the
+#     data file failed).
+if [ ! -f $execname ]; then echo "$execname not created."; exit 77; fi
+if [ ! -f $table    ]; then echo "$table doesn't exist.";  exit 77; fi
+
+
+
+
+
+# Actual test script
+# ==================
+#
+# The input has all the column types (including strings that become
+# longer in later rows, blank values and a vector column). A selection by
+# value and column arithmetic are applied, so the chunk boundaries (every
+# 3 rows) don't correspond to the rows in the output. The 'uint64' column
+# can't be written as raw bytes, so its chunks are appended by CFITSIO.
+#
+# With a plain-text output, '--streamrows' is ignored (the widths of the
+# columns depend on all the rows), so the output should still be
+# identical to the full table.
+#
+# 'check_with_program' can be something like 'Valgrind' or an empty
+# string. Such programs will execute the command if present and help in
+# debugging when the developer doesn't have access to the user's system.
+$check_with_program $execname $table --range=6,2:11 -c1,2,3,4,5,6 \
+                    -c7,8,9,10,11,12 -c'arith $9 2 x' \
+                    -c'arith $1 uint64' \
+                    --output=stream-full.fits
+$check_with_program $execname $table --range=6,2:11 -c1,2,3,4,5,6 \
+                    -c7,8,9,10,11,12 -c'arith $9 2 x' \
+                    -c'arith $1 uint64' \
+                    --output=stream-chunks.fits --streamrows=3
+$check_with_program $execname $table --range=6,2:11 -c1,2,3,4,5,6 \
+                    -c7,8,9,10,11,12 -c'arith $9 2 x' \
+                    -c'arith $1 uint64' \
+                    --output=stream-full.txt
+$check_with_program $execname $table --range=6,2:11 -c1,2,3,4,5,6 \
+                    -c7,8,9,10,11,12 -c'arith $9 2 x' \
+                    -c'arith $1 uint64' \
+                    --output=stream-chunks.txt --streamrows=3 --quiet
+$execname stream-full.fits   --colinfoinstdout > stream-full-fits.txt
+$execname stream-chunks.fits --colinfoinstdout > stream-chunks-fits.txt
+cmp stream-full-fits.txt stream-chunks-fits.txt \
+    && cmp stream-full.txt stream-chunks.txt